@@ -22,6 +22,7 @@
 #include <string.h>
 
 #include "fhi.h"
+#include "hgh.h"
 #include "oncv.h"
 #include "abinit.h"
 
@@ -40,6 +41,13 @@ int pspio_abinit_read(FILE *fp, pspio_pspdata_t *pspdata, int format)
   ierr = abinit_read_header(fp, format, pspdata);
 
   switch (format) {
+  case PSPIO_FMT_ABINIT_2:
+  case PSPIO_FMT_ABINIT_3:
+  case PSPIO_FMT_ABINIT_10:
+    if (ierr == PSPIO_SUCCESS) {
+      ierr = pspio_hgh_read_abinit(fp, pspdata, format);
+    }
+    break;
   case PSPIO_FMT_ABINIT_6:
     if (ierr == PSPIO_SUCCESS) {
       ierr = pspio_fhi_read(fp, pspdata);
@@ -55,12 +63,49 @@ int pspio_abinit_read(FILE *fp, pspio_pspdata_t *pspdata, int format)
     ierr = PSPIO_EFILE_FORMAT;
     break;
   case PSPIO_FMT_ABINIT_1:
+  case PSPIO_FMT_ABINIT_4:
+  case PSPIO_FMT_ABINIT_5:
+  case PSPIO_FMT_ABINIT_7:
+  case PSPIO_FMT_ABINIT_11:
+  case PSPIO_FMT_ABINIT_17:
+    ierr = PSPIO_ENOSUPPORT;
+    break;
+  default:
+    ierr = PSPIO_EVALUE;
+  }
+
+  RETURN_WITH_ERROR( ierr );
+}
+
+
+int pspio_abinit_read_header(FILE *fp, pspio_pspdata_t *pspdata, int format)
+{
+  int ierr;
+
+  assert(fp != NULL);
+  assert(pspdata != NULL);
+
+  /* Only the formats supported by pspio_abinit_read are accepted */
+  switch (format) {
+  case PSPIO_FMT_ABINIT_6:
+    ierr = abinit_read_header(fp, format, pspdata);
+    if (ierr == PSPIO_SUCCESS) {
+      ierr = pspio_fhi_read_header(fp, pspdata);
+    }
+    break;
   case PSPIO_FMT_ABINIT_2:
   case PSPIO_FMT_ABINIT_3:
+  case PSPIO_FMT_ABINIT_8:
+  case PSPIO_FMT_ABINIT_10:
+    ierr = abinit_read_header(fp, format, pspdata);
+    break;
+  case PSPIO_FMT_ABINIT_9:
+    ierr = PSPIO_EFILE_FORMAT;
+    break;
+  case PSPIO_FMT_ABINIT_1:
   case PSPIO_FMT_ABINIT_4:
   case PSPIO_FMT_ABINIT_5:
   case PSPIO_FMT_ABINIT_7:
-  case PSPIO_FMT_ABINIT_10:
   case PSPIO_FMT_ABINIT_11:
   case PSPIO_FMT_ABINIT_17:
     ierr = PSPIO_ENOSUPPORT;
@@ -42,6 +42,15 @@
  */
 int pspio_abinit_read(FILE *fp, pspio_pspdata_t *pspdata, int format);
 
+/**
+ * Read only the header of an Abinit-formatted file
+ * @param[in] fp a stream of the input file
+ * @param[in,out] pspdata the data structure
+ * @param[in] format: the Abinit format number
+ * @return error code
+ */
+int pspio_abinit_read_header(FILE *fp, pspio_pspdata_t *pspdata, int format);
+
 /**
  * Write the data contained in the psp_data structure to a file using an Abinit format
  * @param[in] fp a stream of the input file
@@ -23,6 +23,7 @@
 #include <math.h>
 
 #include "abinit.h"
+#include "instrument.h"
 #include "util.h"
 #include "pspio_pspinfo.h"
 
@@ -42,16 +43,25 @@ int abinit_read_header(FILE *fp, int format, pspio_pspdata_t *pspdata)
   int exchange, correlation;
   int ppl[6], npso[2];
   double zatom, zval, r2well, rchrg, fchrg, qchrg;
+  int analytic;
 
-  /* Line 1: read title */
-  FULFILL_OR_RETURN( fgets(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
-  FULFILL_OR_RETURN( sscanf(line, "%s %s : %s", tmp, code_name, description) == 3, PSPIO_EFILE_CORRUPT );
+  /* GTH and HGH files only hold parameters after line 3 */
+  analytic = (format == PSPIO_FMT_ABINIT_2) || (format == PSPIO_FMT_ABINIT_3) ||
+    (format == PSPIO_FMT_ABINIT_10);
+
+  /* Line 1: read title, which is free-form in GTH and HGH files */
+  FULFILL_OR_RETURN( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+  if ( sscanf(line, "%s %s : %s", tmp, code_name, description) != 3 ) {
+    FULFILL_OR_RETURN( analytic && (sscanf(line, "%s", code_name) == 1), PSPIO_EFILE_CORRUPT );
+    line[strcspn(line, "\r\n")] = '\0';
+    strcpy(description, line);
+  }
   SUCCEED_OR_RETURN( pspio_pspinfo_alloc(&pspdata->pspinfo) );
   SUCCEED_OR_RETURN( pspio_pspinfo_set_code_name(pspdata->pspinfo, code_name) );
   SUCCEED_OR_RETURN( pspio_pspinfo_set_description(pspdata->pspinfo, description) );
 
   /* Line 2: read atomic number, Z valence */
-  FULFILL_OR_RETURN( fgets(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+  FULFILL_OR_RETURN( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
   FULFILL_OR_RETURN( sscanf(line, "%lf %lf %2d%2d%2d", &zatom, &zval, &year, &month, &day) == 5, PSPIO_EFILE_CORRUPT );
   SUCCEED_OR_RETURN( pspio_pspdata_set_z(pspdata, zatom) );
   SUCCEED_OR_RETURN( pspio_pspdata_set_zvalence(pspdata, zval) );
@@ -62,7 +72,7 @@ int abinit_read_header(FILE *fp, int format, pspio_pspdata_t *pspdata)
   SUCCEED_OR_RETURN( pspio_pspinfo_set_generation_year(pspdata->pspinfo, year) );
 
   /* Line 3: read pspcod, pspxc, lmax, lloc, mmax, r2well */
-  FULFILL_OR_RETURN( fgets(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+  FULFILL_OR_RETURN( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
   FULFILL_OR_RETURN( sscanf(line, "%d %d %d %d %d %lf",
     &pspcod, &pspxc, &lmax, &lloc, &mmax, &r2well) == 6, PSPIO_EFILE_CORRUPT );
   SUCCEED_OR_RETURN( pspio_pspdata_set_l_max(pspdata, lmax) );
@@ -79,10 +89,19 @@ int abinit_read_header(FILE *fp, int format, pspio_pspdata_t *pspdata)
   SUCCEED_OR_RETURN( pspio_xc_set_exchange(pspdata->xc, exchange) );
   SUCCEED_OR_RETURN( pspio_xc_set_correlation(pspdata->xc, correlation) );
 
+  /* The rest of GTH and HGH files is read by pspio_hgh_read_abinit */
+  if ( analytic ) {
+    FULFILL_OR_RETURN( ((pspcod == 2) && (format == PSPIO_FMT_ABINIT_2)) ||
+      ((pspcod == 3) && (format == PSPIO_FMT_ABINIT_3)) ||
+      ((pspcod == 10) && (format == PSPIO_FMT_ABINIT_10)), PSPIO_EFILE_FORMAT );
+    return PSPIO_SUCCESS;
+  }
+  pspdata->np = mmax;
+
   /* Line 4: read rchrg, fchrg, qchrg if NLCC */
   /* Note: tolerance copied from Abinit */
   /* Note: qchrg is not used and might be removed from future formats */
-  FULFILL_OR_RETURN( fgets(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+  FULFILL_OR_RETURN( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
   line4 = my_strndup(line, 3);
   if ( strcmp("4--", line4) != 0 ) {
     DEFER_TEST_ERROR( sscanf(line, "%lf %lf %lf",
@@ -99,15 +118,15 @@ int abinit_read_header(FILE *fp, int format, pspio_pspdata_t *pspdata)
   /* FIXME: do something with multiple projectors */
   /* FIXME: add spin-orbit support */
   if ( pspcod == 8 ) {
-    FULFILL_OR_RETURN( fgets(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+    FULFILL_OR_RETURN( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
     FULFILL_OR_RETURN( sscanf(line, "%d %d %d %d %d", &ppl[0], &ppl[1], &ppl[2], &ppl[3], &ppl[4]) == 5, PSPIO_EFILE_CORRUPT );
-    FULFILL_OR_RETURN( fgets(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+    FULFILL_OR_RETURN( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
     FULFILL_OR_RETURN( sscanf(line, "%d %d", &npso[0], &npso[1]) == 2, PSPIO_EFILE_CORRUPT );
     FULFILL_OR_RETURN( ((npso[0] == 1) && (npso[1] == 1)), PSPIO_ENOSUPPORT );
   } else {
-    FULFILL_OR_RETURN( fgets(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
-    FULFILL_OR_RETURN( fgets(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
-    FULFILL_OR_RETURN( fgets(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+    FULFILL_OR_RETURN( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+    FULFILL_OR_RETURN( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+    FULFILL_OR_RETURN( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
   }
 
   /* Check that the format found is the one we expected */
@@ -160,7 +179,7 @@ int abinit_write_header(FILE *fp, int format, const pspio_pspdata_t *pspdata)
 {
   char pspdate[7];
   int pspxc, have_nlcc;
-  int *ppl;
+  int l, ppl[5];
   double rchrg, fchrg, qchrg;
 
   assert(fp != NULL);
@@ -179,7 +198,7 @@ int abinit_write_header(FILE *fp, int format, const pspio_pspdata_t *pspdata)
             pspio_pspinfo_get_code_name(pspdata->pspinfo),
             0.0, 0.0, 0.0);
   } else {
-    fprintf(fp, " %3s %s: %s\n", pspio_pspdata_get_symbol(pspdata),
+    fprintf(fp, " %3s %s : %s\n", pspio_pspdata_get_symbol(pspdata),
             pspio_pspinfo_get_code_name(pspdata->pspinfo),
             psp_scheme_name(pspio_pspdata_get_scheme(pspdata)));
   }
@@ -221,7 +240,9 @@ int abinit_write_header(FILE *fp, int format, const pspio_pspdata_t *pspdata)
 
     /* FIXME: get spin-orbit information, no spin-orbit for now */
     if ( format == 8 ) {
-      ppl = pspio_projectors_per_l(pspdata->projectors, pspdata->n_projectors);
+      for (l=0; l<5; l++) {
+        ppl[l] = pspio_pspdata_find_projectors_l(pspdata, l, NULL);
+      }
       FULFILL_OR_RETURN( fprintf(fp, " %5d %5d %5d %5d %5d          nproj\n",
         ppl[0],ppl[1],ppl[2],ppl[3],ppl[4]) > 0, PSPIO_EIO );
       FULFILL_OR_RETURN( fprintf(fp, " %5d %5d                      extension_switch\n", 1, 1) > 0, PSPIO_EIO );
@@ -41,6 +41,11 @@ int main(void)
   srunner_add_suite(sr, make_xc_suite());
   srunner_add_suite(sr, make_pspinfo_suite());
   srunner_add_suite(sr, make_pspdata_suite());
+  srunner_add_suite(sr, make_packed_suite());
+  srunner_add_suite(sr, make_resample_suite());
+  srunner_add_suite(sr, make_library_suite());
+  srunner_add_suite(sr, make_shared_suite());
+  srunner_add_suite(sr, make_gth_suite());
 
   srunner_run_all(sr, CK_VERBOSE);
   number_failed = srunner_ntests_failed(sr);
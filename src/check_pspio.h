@@ -34,5 +34,10 @@ Suite *make_state_suite(void);
 Suite *make_xc_suite(void);
 Suite *make_pspinfo_suite(void);
 Suite *make_pspdata_suite(void);
+Suite *make_packed_suite(void);
+Suite *make_resample_suite(void);
+Suite *make_library_suite(void);
+Suite *make_shared_suite(void);
+Suite *make_gth_suite(void);
 
 #endif
@@ -0,0 +1,454 @@
+/* Copyright (C) 2018 Micael Oliveira <micael.oliveira@mpsd.mpg.de>
+ *                    Yann Pouillon <devops@materialsevolution.es>
+ *
+ * This file is part of Libpspio.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * version 2.0. If a copy of the MPL was not distributed with this file, You
+ * can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Libpspio is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the Mozilla Public License version 2.0 for
+ * more details.
+ */
+
+/**
+ * @file check_pspio_gth.c
+ * @brief checks pspio_gth.c, pspio_gth.h and the GTH/HGH readers
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include <check.h>
+
+#include "pspio_error.h"
+#include "pspio_gth.h"
+#include "pspio_packed.h"
+#include "pspio_pspdata.h"
+
+#if defined HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#if !defined M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static pspio_gth_t *gth = NULL;
+static pspio_pspdata_t *pspdata = NULL;
+static pspio_pspdata_t *pspdata2 = NULL;
+
+static char filename[200];
+
+
+void gth_setup(void)
+{
+  /* Parameters of Cr with 6 valence electrons, PRB 58, 3641 (1998) */
+  const double hs[3] = {2.400756, 2.072337, 2.952179};
+  const double hp[3] = {1.145557, 0.278236, 0.0};
+  const double kp[3] = {-0.013176, 0.035625, 0.0};
+  const double hd[3] = {-6.615878, 0.0, 0.0};
+  const double kd[3] = {0.003514, 0.0, 0.0};
+  const double c[2] = {-1.5, 0.25};
+
+  pspio_error_free();
+  pspio_gth_alloc(&gth);
+  ck_assert(pspio_gth_init(gth, 6.0, 0.66, 2, c) == PSPIO_SUCCESS);
+  ck_assert(pspio_gth_set_channel_hgh(gth, 0, 0.498578, hs, NULL) == PSPIO_SUCCESS);
+  ck_assert(pspio_gth_set_channel_hgh(gth, 1, 0.719768, hp, kp) == PSPIO_SUCCESS);
+  ck_assert(pspio_gth_set_channel_hgh(gth, 2, 0.354341, hd, kd) == PSPIO_SUCCESS);
+
+  pspio_pspdata_alloc(&pspdata);
+  pspio_pspdata_alloc(&pspdata2);
+}
+
+void gth_teardown(void)
+{
+  pspio_gth_free(gth);
+  gth = NULL;
+  pspio_pspdata_free(pspdata);
+  pspdata = NULL;
+  pspio_pspdata_free(pspdata2);
+  pspdata2 = NULL;
+  pspio_error_free();
+}
+
+/* Spherical Bessel functions up to l = 2 */
+static double gth_bessel(int l, double x)
+{
+  if ( x < 1.0e-3 ) {
+    return (l == 0) ? 1.0 - x*x/6.0 : (l == 1) ? x/3.0 : x*x/15.0;
+  }
+  switch (l) {
+  case 0:
+    return sin(x)/x;
+  case 1:
+    return sin(x)/(x*x) - cos(x)/x;
+  default:
+    return (3.0/(x*x) - 1.0)*sin(x)/x - 3.0*cos(x)/(x*x);
+  }
+}
+
+/* Gaussian part of the local potential, without the Coulomb tail */
+static double gth_gauss(const pspio_gth_term_t *term, double r)
+{
+  double x2 = r*r/(term->r*term->r);
+
+  return exp(-0.5*x2)*(term->c[0] + x2*(term->c[1] + x2*(term->c[2] +
+    x2*term->c[3])));
+}
+
+/*
+ * Simpson quadrature of 4 pi int r^2 j_l(q r) f(r) dr, with f either
+ * a projector or the Gaussian part of the local potential
+ */
+static double gth_transform(const pspio_gth_term_t *term, double q)
+{
+  int i, n = 4000, l;
+  double r, dr, f, sum = 0.0;
+
+  l = (term->l < 0) ? 0 : term->l;
+  dr = 20.0*term->r/n;
+  for (i=0; i<=n; i++) {
+    r = i*dr;
+    f = (term->l < 0) ? gth_gauss(term, r) : pspio_gth_term_eval(term, r);
+    f *= r*r*gth_bessel(l, q*r);
+    sum += ((i == 0) || (i == n)) ? f : ((i % 2) ? 4.0*f : 2.0*f);
+  }
+
+  return 4.0*M_PI*sum*dr/3.0;
+}
+
+
+START_TEST(test_gth_alloc)
+{
+  ck_assert(pspio_gth_get_zion(gth) == 6.0);
+  ck_assert(pspio_gth_get_rloc(gth) == 0.66);
+  ck_assert(pspio_gth_get_c(gth, 1) == 0.25);
+  ck_assert(pspio_gth_get_c(gth, 3) == 0.0);
+  ck_assert(pspio_gth_get_l_max(gth) == 2);
+  ck_assert(pspio_gth_get_n_proj(gth, 0) == 3);
+  ck_assert(pspio_gth_get_n_proj(gth, 1) == 2);
+  ck_assert(pspio_gth_get_n_proj(gth, 2) == 1);
+  ck_assert(pspio_gth_get_n_proj(gth, 3) == 0);
+  ck_assert(pspio_gth_get_r(gth, 1) == 0.719768);
+}
+END_TEST
+
+START_TEST(test_gth_init_invalid)
+{
+  const double h[1] = {1.0};
+
+  ck_assert(pspio_gth_init(gth, 1.0, 0.0, 0, NULL) == PSPIO_EVALUE);
+  ck_assert(pspio_gth_set_channel(gth, 4, 1.0, 1, h, NULL) == PSPIO_EVALUE);
+  ck_assert(pspio_gth_set_channel(gth, 0, 0.0, 1, h, NULL) == PSPIO_EVALUE);
+  pspio_error_free();
+}
+END_TEST
+
+START_TEST(test_gth_hgh_relations)
+{
+  double h22 = pspio_gth_get_h(gth, 0, 1, 1);
+
+  ck_assert(fabs(pspio_gth_get_h(gth, 0, 0, 1) + 0.5*sqrt(3.0/5.0)*h22) < 1.0e-12);
+  ck_assert(pspio_gth_get_h(gth, 0, 1, 0) == pspio_gth_get_h(gth, 0, 0, 1));
+  ck_assert(fabs(pspio_gth_get_h(gth, 1, 0, 1) +
+    0.5*sqrt(5.0/7.0)*pspio_gth_get_h(gth, 1, 1, 1)) < 1.0e-12);
+  ck_assert(fabs(pspio_gth_get_k(gth, 1, 0, 1) +
+    0.5*sqrt(5.0/7.0)*pspio_gth_get_k(gth, 1, 1, 1)) < 1.0e-12);
+  ck_assert(pspio_gth_get_k(gth, 0, 0, 0) == 0.0);
+}
+END_TEST
+
+START_TEST(test_gth_copy_cmp)
+{
+  pspio_gth_t *copy = NULL;
+
+  ck_assert(pspio_gth_copy(&copy, gth) == PSPIO_SUCCESS);
+  ck_assert(pspio_gth_cmp(gth, copy) == PSPIO_EQUAL);
+  copy->h[1][0][0] += 1.0e-3;
+  ck_assert(pspio_gth_cmp(gth, copy) == PSPIO_DIFF);
+  pspio_gth_free(copy);
+}
+END_TEST
+
+START_TEST(test_gth_projector_norm)
+{
+  int l, i, j, n = 20000;
+  double r, dr, p, sum;
+  pspio_gth_term_t term;
+
+  for (l=0; l<=2; l++) {
+    for (i=0; i<pspio_gth_get_n_proj(gth, l); i++) {
+      ck_assert(pspio_gth_term_projector(gth, l, i, &term) == PSPIO_SUCCESS);
+      dr = 20.0*term.r/n;
+      sum = 0.0;
+      for (j=1; j<n; j++) {
+        r = j*dr;
+        p = pspio_gth_term_eval(&term, r);
+        sum += r*r*p*p;
+      }
+      ck_assert(fabs(sum*dr - 1.0) < 1.0e-8);
+    }
+  }
+  ck_assert(pspio_gth_term_projector(gth, 2, 1, &term) == PSPIO_EVALUE);
+  pspio_error_free();
+}
+END_TEST
+
+START_TEST(test_gth_deriv)
+{
+  int l, i, k;
+  const double rs[4] = {1.0e-3, 0.1, 0.7, 2.3};
+  const double d = 1.0e-5;
+  double r, f0, fm, fp;
+  pspio_gth_term_t term;
+
+  for (l=-1; l<=2; l++) {
+    for (i=0; (l < 0) ? (i < 1) : (i < pspio_gth_get_n_proj(gth, l)); i++) {
+      if ( l < 0 ) {
+        ck_assert(pspio_gth_term_local(gth, &term) == PSPIO_SUCCESS);
+      } else {
+        ck_assert(pspio_gth_term_projector(gth, l, i, &term) == PSPIO_SUCCESS);
+      }
+      for (k=0; k<4; k++) {
+        r = rs[k];
+        f0 = pspio_gth_term_eval(&term, r);
+        fm = pspio_gth_term_eval(&term, r-d);
+        fp = pspio_gth_term_eval(&term, r+d);
+        ck_assert(fabs(pspio_gth_term_eval_deriv(&term, r) - (fp-fm)/(2.0*d)) < 1.0e-6);
+        ck_assert(fabs(pspio_gth_term_eval_deriv2(&term, r) - (fp-2.0*f0+fm)/(d*d)) < 1.0e-3);
+      }
+    }
+  }
+}
+END_TEST
+
+START_TEST(test_gth_local_origin)
+{
+  pspio_gth_term_t term;
+  double v0, rc;
+
+  ck_assert(pspio_gth_term_local(gth, &term) == PSPIO_SUCCESS);
+  v0 = -6.0*sqrt(2.0/M_PI)/0.66 - 1.5;
+  ck_assert(fabs(pspio_gth_term_eval(&term, 0.0) - v0) < 1.0e-12);
+
+  /* The series and the closed form match where they meet */
+  rc = 1.0e-2*sqrt(2.0)*0.66;
+  ck_assert(fabs(pspio_gth_term_eval(&term, rc*(1.0-1.0e-9)) -
+                 pspio_gth_term_eval(&term, rc*(1.0+1.0e-9))) < 1.0e-10);
+  ck_assert(fabs(pspio_gth_term_eval_deriv(&term, rc*(1.0-1.0e-9)) -
+                 pspio_gth_term_eval_deriv(&term, rc*(1.0+1.0e-9))) < 1.0e-8);
+}
+END_TEST
+
+START_TEST(test_gth_eval_q)
+{
+  int l, i, k;
+  const double qs[4] = {0.0, 0.5, 2.0, 5.0};
+  const double d = 1.0e-5;
+  double q, v, a, z;
+  pspio_gth_term_t term;
+
+  /* Projectors */
+  for (l=0; l<=2; l++) {
+    for (i=0; i<pspio_gth_get_n_proj(gth, l); i++) {
+      ck_assert(pspio_gth_term_projector(gth, l, i, &term) == PSPIO_SUCCESS);
+      for (k=0; k<4; k++) {
+        q = qs[k];
+        ck_assert(fabs(pspio_gth_term_eval_q(&term, q) - gth_transform(&term, q)) < 1.0e-8);
+        if ( q > 0.0 ) {
+          ck_assert(fabs(pspio_gth_term_eval_q_deriv(&term, q) -
+            (pspio_gth_term_eval_q(&term, q+d) - pspio_gth_term_eval_q(&term, q-d))/(2.0*d)) < 1.0e-6);
+        }
+      }
+    }
+  }
+
+  /* Local part: the Coulomb tail is transformed analytically */
+  ck_assert(pspio_gth_term_local(gth, &term) == PSPIO_SUCCESS);
+  a = term.r;
+  z = term.zion;
+  ck_assert(fabs(pspio_gth_term_eval_q(&term, 0.0) -
+    (2.0*M_PI*z*a*a + gth_transform(&term, 0.0))) < 1.0e-8);
+  for (k=1; k<4; k++) {
+    q = qs[k];
+    v = pspio_gth_term_eval_q(&term, q) + 4.0*M_PI*z*exp(-0.5*q*q*a*a)/(q*q);
+    ck_assert(fabs(v - gth_transform(&term, q)) < 1.0e-8);
+    ck_assert(fabs(pspio_gth_term_eval_q_deriv(&term, q) -
+      (pspio_gth_term_eval_q(&term, q+d) - pspio_gth_term_eval_q(&term, q-d))/(2.0*d)) < 1.0e-4);
+  }
+}
+END_TEST
+
+START_TEST(test_gth_read_abinit_gth)
+{
+  const pspio_gth_t *g;
+
+  sprintf(filename, "%s/%s", PSPIO_CHK_DATADIR, "abinit_gth/09f.pspgth");
+  ck_assert(pspio_pspdata_read(pspdata, PSPIO_FMT_ABINIT_2, filename) == PSPIO_SUCCESS);
+  ck_assert(pspio_pspdata_get_mesh(pspdata) == NULL);
+  ck_assert(pspio_pspdata_get_scheme(pspdata) == PSPIO_SCM_GTH);
+  ck_assert(pspio_pspdata_get_zvalence(pspdata) == 7.0);
+  ck_assert(pspio_pspdata_get_n_projectors(pspdata) == 1);
+  g = pspio_pspdata_get_gth(pspdata);
+  ck_assert(g != NULL);
+  ck_assert(pspio_gth_get_rloc(g) == 0.2168956);
+  ck_assert(pspio_gth_get_c(g, 1) == 3.0763646);
+  ck_assert(pspio_gth_get_l_max(g) == 0);
+  ck_assert(pspio_gth_get_h(g, 0, 0, 0) == 23.5641867);
+  ck_assert(pspio_pspdata_get_projector_energy(pspdata, 0, 0) == 23.5641867);
+
+  pspio_pspdata_free(pspdata);
+  pspdata = NULL;
+  pspio_pspdata_alloc(&pspdata);
+  sprintf(filename, "%s/%s", PSPIO_CHK_DATADIR, "abinit_gth/03li.pspgth");
+  ck_assert(pspio_pspdata_read(pspdata, PSPIO_FMT_ABINIT_2, filename) == PSPIO_SUCCESS);
+  ck_assert(pspio_pspdata_get_n_projectors(pspdata) == 0);
+  ck_assert(pspio_gth_get_l_max(pspio_pspdata_get_gth(pspdata)) == -1);
+  ck_assert(pspio_gth_get_c(pspio_pspdata_get_gth(pspdata), 3) == 0.0834586);
+}
+END_TEST
+
+START_TEST(test_gth_read_abinit_hgh)
+{
+  int i;
+  const pspio_projector_t *projector;
+
+  sprintf(filename, "%s/%s", PSPIO_CHK_DATADIR, "abinit_hgh/24cr.6.hgh");
+  ck_assert(pspio_pspdata_read(pspdata, PSPIO_FMT_ABINIT_3, filename) == PSPIO_SUCCESS);
+  ck_assert(pspio_pspdata_get_scheme(pspdata) == PSPIO_SCM_HGH);
+  ck_assert(pspio_pspdata_get_n_projectors(pspdata) == 6);
+  ck_assert(pspio_pspdata_get_projectors_l_max(pspdata) == 2);
+  ck_assert(pspio_gth_cmp(pspio_pspdata_get_gth(pspdata), gth) == PSPIO_DIFF);
+  for (i=0; i<6; i++) {
+    projector = pspio_pspdata_get_projector(pspdata, i);
+    ck_assert(pspio_projector_get_analytic(projector) != NULL);
+    ck_assert(pspio_qn_get_l(pspio_projector_get_qn(projector)) == ((i < 3) ? 0 : (i < 5) ? 1 : 2));
+  }
+  ck_assert(fabs(pspio_pspdata_get_projector_energy(pspdata, 0, 1) +
+    0.5*sqrt(3.0/5.0)*2.072337) < 1.0e-12);
+  ck_assert(pspio_pspdata_get_projector_energy(pspdata, 0, 3) == 0.0);
+}
+END_TEST
+
+START_TEST(test_gth_read_octopus)
+{
+  sprintf(filename, "%s/%s", PSPIO_CHK_DATADIR, "octopus_hgh/Cr.hgh");
+  ck_assert(pspio_pspdata_read(pspdata, PSPIO_FMT_OCTOPUS_HGH, filename) == PSPIO_SUCCESS);
+  sprintf(filename, "%s/%s", PSPIO_CHK_DATADIR, "abinit_hgh/24cr.6.hgh");
+  ck_assert(pspio_pspdata_read(pspdata2, PSPIO_FMT_ABINIT_3, filename) == PSPIO_SUCCESS);
+  ck_assert_str_eq(pspio_pspdata_get_symbol(pspdata), "Cr");
+  ck_assert(pspio_pspdata_get_z(pspdata) == 24.0);
+  ck_assert(pspio_gth_cmp(pspio_pspdata_get_gth(pspdata),
+    pspio_pspdata_get_gth(pspdata2)) == PSPIO_EQUAL);
+
+  pspio_pspdata_free(pspdata);
+  pspio_pspdata_free(pspdata2);
+  pspdata = NULL;
+  pspdata2 = NULL;
+  pspio_pspdata_alloc(&pspdata);
+  pspio_pspdata_alloc(&pspdata2);
+  sprintf(filename, "%s/%s", PSPIO_CHK_DATADIR, "octopus_hgh/Cr_sc.hgh");
+  ck_assert(pspio_pspdata_read(pspdata, PSPIO_FMT_UNKNOWN, filename) == PSPIO_SUCCESS);
+  ck_assert(pspio_pspdata_get_format_guessed(pspdata) == PSPIO_FMT_OCTOPUS_HGH);
+  ck_assert(pspio_pspdata_get_zvalence(pspdata) == 14.0);
+  sprintf(filename, "%s/%s", PSPIO_CHK_DATADIR, "abinit_hgh/24cr.14.hgh");
+  ck_assert(pspio_pspdata_read(pspdata2, PSPIO_FMT_ABINIT_3, filename) == PSPIO_SUCCESS);
+  ck_assert(pspio_gth_cmp(pspio_pspdata_get_gth(pspdata),
+    pspio_pspdata_get_gth(pspdata2)) == PSPIO_EQUAL);
+}
+END_TEST
+
+START_TEST(test_gth_read_abinit10)
+{
+  sprintf(filename, "%s/%s", PSPIO_CHK_DATADIR, "abinit10/3li.1.hgh");
+  ck_assert(pspio_pspdata_read(pspdata, PSPIO_FMT_ABINIT_10, filename) == PSPIO_SUCCESS);
+  sprintf(filename, "%s/%s", PSPIO_CHK_DATADIR, "abinit_hgh/3li.1.hgh");
+  ck_assert(pspio_pspdata_read(pspdata2, PSPIO_FMT_ABINIT_3, filename) == PSPIO_SUCCESS);
+  ck_assert(pspio_gth_cmp(pspio_pspdata_get_gth(pspdata),
+    pspio_pspdata_get_gth(pspdata2)) == PSPIO_EQUAL);
+  ck_assert(pspio_gth_get_k(pspio_pspdata_get_gth(pspdata), 1, 0, 0) == 0.000019);
+}
+END_TEST
+
+START_TEST(test_gth_pspdata_eval)
+{
+  const pspio_potential_t *vlocal;
+  const pspio_projector_t *projector;
+  pspio_gth_term_t term;
+  pspio_packed_t *packed = NULL;
+
+  sprintf(filename, "%s/%s", PSPIO_CHK_DATADIR, "abinit_hgh/24cr.6.hgh");
+  ck_assert(pspio_pspdata_read(pspdata, PSPIO_FMT_ABINIT_3, filename) == PSPIO_SUCCESS);
+
+  vlocal = pspio_pspdata_get_vlocal(pspdata);
+  ck_assert(vlocal != NULL);
+  ck_assert(pspio_gth_term_local(pspio_pspdata_get_gth(pspdata), &term) == PSPIO_SUCCESS);
+  ck_assert(pspio_potential_eval(vlocal, 0.8) == pspio_gth_term_eval(&term, 0.8));
+  ck_assert(pspio_potential_eval_deriv(vlocal, 0.8) == pspio_gth_term_eval_deriv(&term, 0.8));
+  ck_assert(pspio_potential_eval_q(vlocal, 1.5) == pspio_gth_term_eval_q(&term, 1.5));
+  ck_assert(fabs(pspio_potential_eval(vlocal, 30.0) + 6.0/30.0) < 1.0e-12);
+
+  projector = pspio_pspdata_get_projector(pspdata, 5);
+  ck_assert(pspio_gth_term_projector(pspio_pspdata_get_gth(pspdata), 2, 0, &term) == PSPIO_SUCCESS);
+  ck_assert(pspio_projector_eval(projector, 0.3) == pspio_gth_term_eval(&term, 0.3));
+  ck_assert(pspio_projector_eval_q_deriv(projector, 2.0) == pspio_gth_term_eval_q_deriv(&term, 2.0));
+
+  /* Analytic data cannot be tabulated */
+  sprintf(filename, "test_gth_%d.tmp", PSPIO_FMT_UPF);
+  ck_assert(pspio_pspdata_write(pspdata, PSPIO_FMT_UPF, filename) == PSPIO_ENOSUPPORT);
+  pspio_packed_alloc(&packed);
+  ck_assert(pspio_packed_init(packed, pspdata) == PSPIO_EVALUE);
+  pspio_packed_free(packed);
+  pspio_error_free();
+}
+END_TEST
+
+START_TEST(test_gth_read_header)
+{
+  sprintf(filename, "%s/%s", PSPIO_CHK_DATADIR, "octopus_hgh/Cr_sc.hgh");
+  ck_assert(pspio_pspdata_read_header(pspdata, PSPIO_FMT_OCTOPUS_HGH, filename) == PSPIO_SUCCESS);
+  ck_assert_str_eq(pspio_pspdata_get_symbol(pspdata), "Cr");
+  ck_assert(pspio_pspdata_get_zvalence(pspdata) == 14.0);
+  ck_assert(pspio_pspdata_get_gth(pspdata) == NULL);
+}
+END_TEST
+
+
+Suite * make_gth_suite(void)
+{
+  Suite *s;
+  TCase *tc_par, *tc_eval, *tc_io;
+
+  s = suite_create("GTH");
+
+  tc_par = tcase_create("Parameters");
+  tcase_add_checked_fixture(tc_par, gth_setup, gth_teardown);
+  tcase_add_test(tc_par, test_gth_alloc);
+  tcase_add_test(tc_par, test_gth_init_invalid);
+  tcase_add_test(tc_par, test_gth_hgh_relations);
+  tcase_add_test(tc_par, test_gth_copy_cmp);
+  suite_add_tcase(s, tc_par);
+
+  tc_eval = tcase_create("Evaluation");
+  tcase_add_checked_fixture(tc_eval, gth_setup, gth_teardown);
+  tcase_add_test(tc_eval, test_gth_projector_norm);
+  tcase_add_test(tc_eval, test_gth_deriv);
+  tcase_add_test(tc_eval, test_gth_local_origin);
+  tcase_add_test(tc_eval, test_gth_eval_q);
+  suite_add_tcase(s, tc_eval);
+
+  tc_io = tcase_create("I/O");
+  tcase_add_checked_fixture(tc_io, gth_setup, gth_teardown);
+  tcase_add_test(tc_io, test_gth_read_abinit_gth);
+  tcase_add_test(tc_io, test_gth_read_abinit_hgh);
+  tcase_add_test(tc_io, test_gth_read_octopus);
+  tcase_add_test(tc_io, test_gth_read_abinit10);
+  tcase_add_test(tc_io, test_gth_pspdata_eval);
+  tcase_add_test(tc_io, test_gth_read_header);
+  suite_add_tcase(s, tc_io);
+
+  return s;
+}
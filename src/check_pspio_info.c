@@ -23,7 +23,9 @@
 #include <stdio.h>
 #include <check.h>
 
+#include "pspio_error.h"
 #include "pspio_info.h"
+#include "pspio_pspdata.h"
 
 #if defined HAVE_CONFIG_H
 #include "config.h"
@@ -63,11 +65,61 @@ START_TEST(test_info_string)
 }
 END_TEST
 
+START_TEST(test_info_instrumentation)
+{
+  int i;
+  char filename[200];
+  pspio_pspdata_t *pspdata = NULL;
+
+  pspio_info_reset_instrumentation();
+
+  sprintf(filename, "%s/%s", PSPIO_CHK_DATADIR, "fhi/Li.cpi");
+  ck_assert(pspio_pspdata_alloc(&pspdata) == PSPIO_SUCCESS);
+  ck_assert(pspio_pspdata_read(pspdata, PSPIO_FMT_FHI98PP, filename) == PSPIO_SUCCESS);
+
+  if ( pspio_info_instrumentation_enabled() ) {
+    ck_assert(pspio_info_get_counter(PSPIO_COUNTER_BYTES_READ) > 0);
+    ck_assert(pspio_info_get_counter(PSPIO_COUNTER_LINES_PARSED) > 0);
+    ck_assert(pspio_info_get_counter(PSPIO_COUNTER_SPLINE_INITS) > 0);
+    ck_assert(pspio_info_get_counter(PSPIO_COUNTER_ALLOCS) > 0);
+    ck_assert(pspio_info_get_timer(PSPIO_TIMER_READ) > 0.0);
+
+    pspio_info_reset_instrumentation();
+    pspio_state_wf_eval(pspio_pspdata_get_state(pspdata, 0), 1.0);
+    pspio_state_wf_eval(pspio_pspdata_get_state(pspdata, 0), 1.0e6);
+    ck_assert(pspio_info_get_counter(PSPIO_COUNTER_EVAL_STATE) == 2);
+    ck_assert(pspio_info_get_counter(PSPIO_COUNTER_EVAL_MESHFUNC) == 2);
+    ck_assert(pspio_info_get_counter(PSPIO_COUNTER_EXTRAPOLATIONS) == 1);
+
+    /* Nothing is recorded while switched off */
+    ck_assert(pspio_info_set_instrumentation(0) == PSPIO_SUCCESS);
+    pspio_state_wf_eval(pspio_pspdata_get_state(pspdata, 0), 1.0);
+    ck_assert(pspio_info_get_counter(PSPIO_COUNTER_EVAL_STATE) == 2);
+    ck_assert(pspio_info_set_instrumentation(1) == PSPIO_SUCCESS);
+
+    pspio_info_reset_instrumentation();
+  } else {
+    ck_assert(pspio_info_set_instrumentation(1) == PSPIO_ENOSUPPORT);
+    pspio_error_free();
+  }
+  for (i=0; i<PSPIO_NCOUNTERS; i++) {
+    ck_assert(pspio_info_get_counter(i) == 0);
+    ck_assert(strlen(pspio_info_counter_name(i)) > 0);
+  }
+  for (i=0; i<PSPIO_NTIMERS; i++) {
+    ck_assert(pspio_info_get_timer(i) == 0.0);
+    ck_assert(strlen(pspio_info_timer_name(i)) > 0);
+  }
+
+  pspio_pspdata_free(pspdata);
+}
+END_TEST
+
 
 Suite * make_info_suite(void)
 {
   Suite *s;
-  TCase *tc_info;
+  TCase *tc_info, *tc_instr;
 
   s = suite_create("Info");
 
@@ -76,5 +128,9 @@ Suite * make_info_suite(void)
   tcase_add_test(tc_info, test_info_string);
   suite_add_tcase(s, tc_info);
 
+  tc_instr = tcase_create("Instrumentation");
+  tcase_add_test(tc_instr, test_info_instrumentation);
+  suite_add_tcase(s, tc_instr);
+
   return s;
 }
@@ -0,0 +1,286 @@
+/* Copyright (C) 2018 Micael Oliveira <micael.oliveira@mpsd.mpg.de>
+ *                    Yann Pouillon <devops@materialsevolution.es>
+ *
+ * This file is part of Libpspio.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * version 2.0. If a copy of the MPL was not distributed with this file, You
+ * can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Libpspio is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the Mozilla Public License version 2.0 for
+ * more details.
+ */
+
+/**
+ * @file check_pspio_library.c
+ * @brief checks pspio_library.c and pspio_library.h
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <check.h>
+
+#include "pspio_error.h"
+#include "pspio_library.h"
+
+#if defined HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#define LIBRARY_DIR "test_library_dir.tmp"
+
+static pspio_library_t *library = NULL;
+
+static const char *library_files[4] = {
+  "UPF/Li.UPF", "UPF/Xe.UPF", "abinit6/03-Li.LDA.fhi", "UPF/README"};
+
+static char filename[200];
+
+
+/* Copies a reference file into the test directory */
+static void library_copy(const char *name, const char *dest)
+{
+  char buf[4096], source[200];
+  size_t n;
+  FILE *src, *dst;
+
+  sprintf(source, "%s/%s", PSPIO_CHK_DATADIR, name);
+  src = fopen(source, "r");
+  ck_assert(src != NULL);
+  dst = fopen(dest, "w");
+  ck_assert(dst != NULL);
+  while ( (n = fread(buf, 1, sizeof(buf), src)) > 0 ) {
+    ck_assert(fwrite(buf, 1, n, dst) == n);
+  }
+  fclose(src);
+  fclose(dst);
+}
+
+void library_setup(void)
+{
+  int i;
+
+  pspio_library_free(library);
+  library = NULL;
+  pspio_library_alloc(&library);
+
+  mkdir(LIBRARY_DIR, 0755);
+  mkdir(LIBRARY_DIR "/sub", 0755);
+  for (i=0; i<4; i++) {
+    sprintf(filename, "%s/%s%d", LIBRARY_DIR, (i % 2) ? "sub/" : "", i);
+    library_copy(library_files[i], filename);
+  }
+}
+
+void library_teardown(void)
+{
+  int i;
+
+  pspio_library_free(library);
+  library = NULL;
+
+  for (i=0; i<4; i++) {
+    sprintf(filename, "%s/%s%d", LIBRARY_DIR, (i % 2) ? "sub/" : "", i);
+    remove(filename);
+  }
+  rmdir(LIBRARY_DIR "/sub");
+  rmdir(LIBRARY_DIR);
+  remove("test_library.tmp");
+}
+
+START_TEST(test_library_alloc)
+{
+  ck_assert(pspio_library_get_n_entries(library) == 0);
+  ck_assert(pspio_library_get_n_parsed(library) == 0);
+}
+END_TEST
+
+START_TEST(test_library_scan)
+{
+  int i;
+  const pspio_library_entry_t *entry;
+
+  ck_assert(pspio_library_scan(library, LIBRARY_DIR, 2) == PSPIO_SUCCESS);
+  ck_assert(pspio_library_get_n_entries(library) == 4);
+  ck_assert(pspio_library_get_n_parsed(library) == 4);
+
+  /* Entries are sorted by path and keep what the headers tell */
+  for (i=1; i<4; i++) {
+    ck_assert(strcmp(pspio_library_get_entry(library, i-1)->path,
+                     pspio_library_get_entry(library, i)->path) < 0);
+  }
+  entry = pspio_library_get_entry(library, 0);
+  ck_assert_str_eq(entry->path, LIBRARY_DIR "/0");
+  ck_assert(entry->format == PSPIO_FMT_UPF);
+  ck_assert_str_eq(entry->symbol, "Li");
+  ck_assert(entry->z == 3.0);
+  ck_assert(entry->np > 0);
+  entry = pspio_library_get_entry(library, 1);
+  ck_assert(entry->format == PSPIO_FMT_ABINIT_6);
+  ck_assert_str_eq(entry->symbol, "Li");
+  entry = pspio_library_get_entry(library, 3);
+  ck_assert_str_eq(entry->path, LIBRARY_DIR "/sub/3");
+  ck_assert(entry->format == PSPIO_FMT_UNKNOWN);
+
+  /* Nothing changed, nothing is parsed again */
+  ck_assert(pspio_library_scan(library, LIBRARY_DIR, 0) == PSPIO_SUCCESS);
+  ck_assert(pspio_library_get_n_entries(library) == 4);
+  ck_assert(pspio_library_get_n_parsed(library) == 0);
+  ck_assert(pspio_library_get_entry(library, 0)->format == PSPIO_FMT_UPF);
+
+  /* Trailing slashes name the same root */
+  ck_assert(pspio_library_scan(library, LIBRARY_DIR "//", 4) == PSPIO_SUCCESS);
+  ck_assert(pspio_library_get_n_entries(library) == 4);
+  ck_assert(pspio_library_get_n_parsed(library) == 0);
+  ck_assert_str_eq(library->root, LIBRARY_DIR);
+  ck_assert_str_eq(pspio_library_get_entry(library, 3)->path, LIBRARY_DIR "/sub/3");
+
+  /* Missing root */
+  ck_assert(pspio_library_scan(library, LIBRARY_DIR "/none", 1) == PSPIO_ENOFILE);
+  pspio_error_free();
+}
+END_TEST
+
+START_TEST(test_library_query)
+{
+  int i, n, indices[4];
+  pspio_library_query_t query;
+  const pspio_library_entry_t *entry;
+
+  ck_assert(pspio_library_scan(library, LIBRARY_DIR, 1) == PSPIO_SUCCESS);
+
+  /* The unreadable file is never returned */
+  pspio_library_query_init(&query);
+  ck_assert(pspio_library_query(library, &query, indices, 4) == 3);
+
+  strcpy(query.symbol, "Li");
+  n = pspio_library_query(library, &query, indices, 4);
+  ck_assert(n == 2);
+  ck_assert(indices[0] == 0 && indices[1] == 1);
+  ck_assert(pspio_library_query(library, &query, indices, 1) == 2);
+
+  query.format = PSPIO_FMT_ABINIT_6;
+  ck_assert(pspio_library_query(library, &query, indices, 4) == 1);
+  ck_assert(indices[0] == 1);
+
+  /* Same functional and valence range as the UPF lithium */
+  entry = pspio_library_get_entry(library, 0);
+  pspio_library_query_init(&query);
+  query.exchange = entry->exchange;
+  query.correlation = entry->correlation;
+  query.zvalence_min = entry->zvalence;
+  query.zvalence_max = entry->zvalence;
+  n = pspio_library_query(library, &query, indices, 4);
+  ck_assert(n >= 1);
+  ck_assert(indices[0] == 0);
+
+  /* Only the entries with all the requested flags remain */
+  query.flags = PSPIO_LIBRARY_NLCC;
+  ck_assert(pspio_library_query(library, &query, indices, 4) <= n);
+  n = pspio_library_query(library, &query, indices, 4);
+  for (i=0; i<n; i++) {
+    ck_assert(pspio_library_get_entry(library, indices[i])->flags & PSPIO_LIBRARY_NLCC);
+  }
+
+  pspio_library_query_init(&query);
+  strcpy(query.symbol, "Fe");
+  ck_assert(pspio_library_query(library, &query, NULL, 0) == 0);
+}
+END_TEST
+
+START_TEST(test_library_save_load)
+{
+  int i;
+  int32_t header[3];
+  FILE *fp;
+  pspio_library_t *loaded = NULL;
+  const pspio_library_entry_t *e1, *e2;
+
+  ck_assert(pspio_library_scan(library, LIBRARY_DIR, 2) == PSPIO_SUCCESS);
+  ck_assert(pspio_library_save(library, "test_library.tmp") == PSPIO_SUCCESS);
+
+  pspio_library_alloc(&loaded);
+  ck_assert(pspio_library_load(loaded, "test_library.tmp") == PSPIO_SUCCESS);
+  ck_assert(pspio_library_get_n_entries(loaded) == 4);
+  for (i=0; i<4; i++) {
+    e1 = pspio_library_get_entry(library, i);
+    e2 = pspio_library_get_entry(loaded, i);
+    ck_assert_str_eq(e1->path, e2->path);
+    ck_assert_str_eq(e1->symbol, e2->symbol);
+    ck_assert(e1->mtime == e2->mtime && e1->size == e2->size);
+    ck_assert(e1->format == e2->format && e1->np == e2->np);
+    ck_assert(e1->zvalence == e2->zvalence && e1->flags == e2->flags);
+  }
+
+  /* Only the modified file is parsed on refresh */
+  sprintf(filename, "%s/2", LIBRARY_DIR);
+  fp = fopen(filename, "a");
+  ck_assert(fp != NULL);
+  fprintf(fp, "\n");
+  fclose(fp);
+  ck_assert(pspio_library_scan(loaded, LIBRARY_DIR, 2) == PSPIO_SUCCESS);
+  ck_assert(pspio_library_get_n_entries(loaded) == 4);
+  ck_assert(pspio_library_get_n_parsed(loaded) == 1);
+  ck_assert(pspio_library_get_entry(loaded, 1)->format == PSPIO_FMT_ABINIT_6);
+
+  /* Removed files are dropped */
+  sprintf(filename, "%s/sub/1", LIBRARY_DIR);
+  remove(filename);
+  ck_assert(pspio_library_scan(loaded, LIBRARY_DIR, 2) == PSPIO_SUCCESS);
+  ck_assert(pspio_library_get_n_entries(loaded) == 3);
+  ck_assert(pspio_library_get_n_parsed(loaded) == 0);
+
+  /* Not an index */
+  sprintf(filename, "%s/%s", PSPIO_CHK_DATADIR, "UPF/Li.UPF");
+  ck_assert(pspio_library_load(loaded, filename) == PSPIO_EFILE_FORMAT);
+  pspio_error_free();
+
+  /* Sizes larger than the file are rejected before allocating */
+  ck_assert(pspio_library_save(loaded, "test_library.tmp") == PSPIO_SUCCESS);
+  fp = fopen("test_library.tmp", "r+b");
+  ck_assert(fp != NULL);
+  header[0] = 1;
+  header[1] = INT32_MAX;
+  header[2] = 0;
+  ck_assert(fseek(fp, 8, SEEK_SET) == 0);
+  ck_assert(fwrite(header, sizeof(header), 1, fp) == 1);
+  fclose(fp);
+  ck_assert(pspio_library_load(loaded, "test_library.tmp") == PSPIO_EFILE_CORRUPT);
+  pspio_error_free();
+  ck_assert(pspio_library_save(library, "test_library.tmp") == PSPIO_SUCCESS);
+  fp = fopen("test_library.tmp", "r+b");
+  ck_assert(fp != NULL);
+  /* Path length of the first entry, after 4 doubles and 7 integers */
+  ck_assert(fseek(fp, 8 + sizeof(header) + strlen(library->root) + 60, SEEK_SET) == 0);
+  header[0] = INT32_MAX;
+  ck_assert(fwrite(header, sizeof(int32_t), 1, fp) == 1);
+  fclose(fp);
+  ck_assert(pspio_library_load(loaded, "test_library.tmp") == PSPIO_EFILE_CORRUPT);
+  pspio_error_free();
+
+  pspio_library_free(loaded);
+}
+END_TEST
+
+
+Suite * make_library_suite(void)
+{
+  Suite *s;
+  TCase *tc_scan;
+
+  s = suite_create("Library");
+
+  tc_scan = tcase_create("Scan");
+  tcase_add_checked_fixture(tc_scan, library_setup, library_teardown);
+  tcase_add_test(tc_scan, test_library_alloc);
+  tcase_add_test(tc_scan, test_library_scan);
+  tcase_add_test(tc_scan, test_library_query);
+  tcase_add_test(tc_scan, test_library_save_load);
+  suite_add_tcase(s, tc_scan);
+
+  return s;
+}
@@ -308,6 +308,76 @@ START_TEST(test_mesh_get_rab)
 }
 END_TEST
 
+static void mesh_check_locate(const pspio_mesh_t *mesh, double r)
+{
+  int i, np;
+  const double *rm;
+  pspio_mesh_loc_t loc;
+
+  np = pspio_mesh_get_np(mesh);
+  rm = pspio_mesh_get_r(mesh);
+  ck_assert(pspio_mesh_locate(mesh, r, &loc) == loc.i);
+  ck_assert(loc.r == r);
+  ck_assert(loc.h == rm[loc.i+1] - rm[loc.i]);
+  ck_assert(fabs(rm[loc.i] + loc.t*loc.h - r) <= 1e-12*fabs(r) + 1e-14);
+  if ( r < rm[0] ) {
+    ck_assert(loc.outside == -1 && loc.i == 0);
+  } else if ( r >= rm[np-1] ) {
+    ck_assert(loc.outside == 1 && loc.i == np-2);
+  } else {
+    /* Same interval as a plain search */
+    for (i=0; r >= rm[i+1]; i++);
+    ck_assert(loc.outside == 0 && loc.i == i);
+    ck_assert(loc.t >= 0.0 && loc.t < 1.0);
+  }
+}
+
+START_TEST(test_mesh_locate)
+{
+  int i, k;
+  const double r_init[8] = {0.0, 0.05, 0.10, 0.20, 0.40, 0.65, 0.85, 1.00};
+  const double rab_init[8] = {0.05, 0.05, 0.20, 0.20, 0.20, 0.20, 0.05, 0.05};
+  const double *r;
+
+  pspio_mesh_init(m1, PSPIO_MESH_UNKNOWN, 0.0, 0.0, r_init, rab_init);
+  for (k=0; k<3; k++) {
+    if ( k == 1 ) pspio_mesh_init_from_parameters(m1, PSPIO_MESH_LOG1, 0.3, 0.01);
+    if ( k == 2 ) pspio_mesh_init_from_parameters(m1, PSPIO_MESH_LINEAR, 0.1, -0.1);
+    r = pspio_mesh_get_r(m1);
+    mesh_check_locate(m1, r[0] - 0.5);
+    mesh_check_locate(m1, r[7] + 0.5);
+    for (i=0; i<8; i++) {
+      /* Mesh points fall at the start of their interval */
+      mesh_check_locate(m1, r[i]);
+      if ( i < 7 ) {
+        mesh_check_locate(m1, 0.3*r[i] + 0.7*r[i+1]);
+        mesh_check_locate(m1, nextafter(r[i+1], r[i]));
+      }
+    }
+  }
+}
+END_TEST
+
+START_TEST(test_mesh_memory_usage)
+{
+  pspio_memory_t usage;
+
+  pspio_memory_reset(&usage);
+  pspio_mesh_memory_usage(NULL, &usage);
+  ck_assert(pspio_memory_total(&usage) == 0);
+
+  pspio_mesh_memory_usage(m1, &usage);
+  ck_assert(usage.arrays == 2 * 8 * sizeof(double));
+  ck_assert(usage.metadata == sizeof(pspio_mesh_t));
+  ck_assert(usage.splines == 0);
+  ck_assert(usage.meshes == 0);
+
+  /* Footprints accumulate */
+  pspio_mesh_memory_usage(m2, &usage);
+  ck_assert(pspio_memory_total(&usage) == 2 * (2 * 8 * sizeof(double) + sizeof(pspio_mesh_t)));
+}
+END_TEST
+
 
 Suite * make_mesh_suite(void)
 {
@@ -356,6 +426,8 @@ Suite * make_mesh_suite(void)
   tcase_add_test(tc_get, test_mesh_get_b);
   tcase_add_test(tc_get, test_mesh_get_r);
   tcase_add_test(tc_get, test_mesh_get_rab);
+  tcase_add_test(tc_get, test_mesh_locate);
+  tcase_add_test(tc_get, test_mesh_memory_usage);
   suite_add_tcase(s, tc_get);
 
   return s;
@@ -24,6 +24,7 @@
 #include <check.h>
 
 #include "pspio_error.h"
+#include "pspio_interp.h"
 #include "pspio_mesh.h"
 #include "pspio_meshfunc.h"
 
@@ -165,6 +166,38 @@ START_TEST(test_meshfunc_init3)
 }
 END_TEST
 
+START_TEST(test_meshfunc_prepare_batch)
+{
+  int i, defer;
+  pspio_meshfunc_t *funcs[3], *ref = NULL;
+
+  /* Mesh points are available before the interpolation is built */
+  defer = pspio_meshfunc_defer_interp(1);
+  ck_assert(pspio_meshfunc_init(mf11, m1, f11, NULL, NULL) == PSPIO_SUCCESS);
+  ck_assert(pspio_meshfunc_init(mf12, m1, f12, f12p, NULL) == PSPIO_SUCCESS);
+  ck_assert(pspio_meshfunc_init(mf2, m2, f2, NULL, NULL) == PSPIO_SUCCESS);
+  pspio_meshfunc_defer_interp(defer);
+  ck_assert(pspio_meshfunc_eval(mf11, 0.40) == f11[4]);
+  ck_assert(mf11->pending != 0);
+
+  /* Functions on different meshes can be prepared together */
+  funcs[0] = mf11;
+  funcs[1] = mf2;
+  funcs[2] = mf12;
+  ck_assert(pspio_meshfunc_prepare_batch(3, funcs) == PSPIO_SUCCESS);
+
+  pspio_meshfunc_alloc(&ref, 8);
+  pspio_meshfunc_init(ref, m1, f12, f12p, NULL);
+  ck_assert(mf12->pending == 0);
+  for (i=0; i<8; i++) {
+    ck_assert(fabs(pspio_meshfunc_get_deriv2(mf12)[i] - pspio_meshfunc_get_deriv2(ref)[i]) <= 1e-12);
+  }
+  ck_assert(fabs(pspio_meshfunc_eval(mf12, 0.3) - pspio_meshfunc_eval(ref, 0.3)) <= 1e-12);
+  ck_assert(fabs(pspio_meshfunc_eval_deriv2(mf12, 0.3) - pspio_meshfunc_eval_deriv2(ref, 0.3)) <= 1e-12);
+  pspio_meshfunc_free(ref);
+}
+END_TEST
+
 START_TEST(test_meshfunc_cmp_equal)
 {
   pspio_meshfunc_init(mf11, m1, f11, f11p, f11pp);
@@ -328,6 +361,275 @@ START_TEST(test_meshfunc_eval_deriv2)
 }
 END_TEST
 
+START_TEST(test_meshfunc_eval_batch)
+{
+  int i;
+  const double r[4] = {-0.1, 0.001, 0.5, 1.1};
+  double f[4], fp[4], fpp[4];
+
+  pspio_meshfunc_init(mf11, m1, f12, f12p, f12pp);
+  pspio_meshfunc_eval_batch(mf11, 4, r, f);
+  pspio_meshfunc_eval_deriv_batch(mf11, 4, r, fp);
+  pspio_meshfunc_eval_deriv2_batch(mf11, 4, r, fpp);
+  for (i=0; i<4; i++) {
+    ck_assert(f[i] == pspio_meshfunc_eval(mf11, r[i]));
+    ck_assert(fp[i] == pspio_meshfunc_eval_deriv(mf11, r[i]));
+    ck_assert(fpp[i] == pspio_meshfunc_eval_deriv2(mf11, r[i]));
+  }
+}
+END_TEST
+
+START_TEST(test_meshfunc_eval_located)
+{
+  int i;
+  const double r[5] = {-0.1, 0.001, 0.40, 0.5, 1.1};
+  pspio_mesh_loc_t loc;
+
+  pspio_meshfunc_init(mf11, m1, f12, f12p, f12pp);
+  for (i=0; i<5; i++) {
+    pspio_mesh_locate(m1, r[i], &loc);
+    ck_assert(pspio_meshfunc_eval_located(mf11, &loc) == pspio_meshfunc_eval(mf11, r[i]));
+    ck_assert(pspio_meshfunc_eval_deriv_located(mf11, &loc) == pspio_meshfunc_eval_deriv(mf11, r[i]));
+    ck_assert(pspio_meshfunc_eval_deriv2_located(mf11, &loc) == pspio_meshfunc_eval_deriv2(mf11, r[i]));
+  }
+}
+END_TEST
+
+/* Largest error of the interpolation of r^2 exp(-r) between mesh points */
+static double meshfunc_hermite_error(int method, int nderivs, double *dmax)
+{
+  int i, np = 200, prev;
+  double r, err, derr;
+  double *f, *fp, *fpp;
+  pspio_mesh_t *mesh = NULL;
+  pspio_meshfunc_t *func = NULL, *copy = NULL;
+
+  pspio_mesh_alloc(&mesh, np);
+  pspio_mesh_init_from_parameters(mesh, PSPIO_MESH_LOG1, 0.05, 1.0e-3);
+  f = (double *) malloc (3 * np * sizeof(double));
+  fp = f + np;
+  fpp = fp + np;
+  for (i=0; i<np; i++) {
+    r = mesh->r[i];
+    f[i] = r*r*exp(-r);
+    fp[i] = (2.0*r - r*r)*exp(-r);
+    fpp[i] = (2.0 - 4.0*r + r*r)*exp(-r);
+  }
+
+  prev = pspio_meshfunc_default_interp(method);
+  ck_assert(pspio_meshfunc_alloc(&func, np) == PSPIO_SUCCESS);
+  pspio_meshfunc_default_interp(prev);
+  ck_assert(pspio_meshfunc_init(func, mesh, f, (nderivs > 0) ? fp : NULL,
+    (nderivs > 1) ? fpp : NULL) == PSPIO_SUCCESS);
+  if ( method != 0 ) ck_assert(pspio_meshfunc_get_interp_method(func) == method);
+
+  /* The copies interpolate their own data */
+  ck_assert(pspio_meshfunc_copy(&copy, func) == PSPIO_SUCCESS);
+  pspio_meshfunc_free(func);
+
+  err = 0.0;
+  derr = 0.0;
+  for (i=0; i<np-1; i++) {
+    r = 0.5*(mesh->r[i] + mesh->r[i+1]);
+    err = fmax(err, fabs(pspio_meshfunc_eval(copy, r) - r*r*exp(-r)));
+    derr = fmax(derr, fabs(pspio_meshfunc_eval_deriv(copy, r) - (2.0*r - r*r)*exp(-r)));
+  }
+  *dmax = derr;
+
+  pspio_meshfunc_free(copy);
+  pspio_mesh_free(mesh);
+  free(f);
+
+  return err;
+}
+
+START_TEST(test_meshfunc_eval_hermite)
+{
+  double spl, dspl, err, derr;
+
+  spl = meshfunc_hermite_error(0, 0, &dspl);
+
+  /* Analytic derivatives */
+  err = meshfunc_hermite_error(PSPIO_INTERP_HERMITE3, 1, &derr);
+  ck_assert(err <= spl);
+  ck_assert(derr <= dspl);
+  err = meshfunc_hermite_error(PSPIO_INTERP_HERMITE5, 2, &derr);
+  ck_assert(err <= spl);
+  ck_assert(derr <= dspl);
+
+  /* Estimated derivatives */
+  err = meshfunc_hermite_error(PSPIO_INTERP_HERMITE3, 0, &derr);
+  ck_assert(err <= spl);
+  err = meshfunc_hermite_error(PSPIO_INTERP_HERMITE5, 0, &derr);
+  ck_assert(err <= spl);
+}
+END_TEST
+
+START_TEST(test_meshfunc_interp_copy_hermite)
+{
+  int i, np = 50;
+  double r, ref[3];
+  double *f;
+  pspio_mesh_t *mesh = NULL;
+  pspio_interp_t *interp = NULL, *copy = NULL;
+
+  pspio_mesh_alloc(&mesh, np);
+  pspio_mesh_init_from_parameters(mesh, PSPIO_MESH_LOG1, 0.1, 1.0e-2);
+  f = (double *) malloc (3 * np * sizeof(double));
+  for (i=0; i<np; i++) {
+    r = mesh->r[i];
+    f[i] = r*r*exp(-r);
+    f[np+i] = (2.0*r - r*r)*exp(-r);
+    f[2*np+i] = (2.0 - 4.0*r + r*r)*exp(-r);
+  }
+  ck_assert(pspio_interp_alloc(&interp, PSPIO_INTERP_HERMITE5, np) == PSPIO_SUCCESS);
+  ck_assert(pspio_interp_init_derivs(interp, mesh, f, f+np, f+2*np) == PSPIO_SUCCESS);
+  ck_assert(pspio_interp_copy(&copy, interp) == PSPIO_SUCCESS);
+
+  /* The copy must not depend on the data of the source */
+  r = 0.5*(mesh->r[10] + mesh->r[11]);
+  ref[0] = pspio_interp_eval(interp, r);
+  ref[1] = pspio_interp_eval_deriv(interp, r);
+  ref[2] = pspio_interp_eval_deriv2(interp, r);
+  pspio_interp_free(interp);
+  for (i=0; i<3*np; i++) f[i] = 0.0;
+  pspio_mesh_free(mesh);
+  free(f);
+  ck_assert(pspio_interp_eval(copy, r) == ref[0]);
+  ck_assert(pspio_interp_eval_deriv(copy, r) == ref[1]);
+  ck_assert(pspio_interp_eval_deriv2(copy, r) == ref[2]);
+
+  pspio_interp_free(copy);
+}
+END_TEST
+
+START_TEST(test_meshfunc_tabulate)
+{
+  int i, k, np = 200;
+  double r, err;
+  double f[200], x[50], ft[50];
+  pspio_mesh_t *mesh = NULL;
+  pspio_meshfunc_t *func = NULL, *copy = NULL;
+
+  pspio_mesh_alloc(&mesh, np);
+  pspio_mesh_init_from_parameters(mesh, PSPIO_MESH_LOG1, 0.05, 1.0e-3);
+  for (i=0; i<np; i++) {
+    r = mesh->r[i];
+    f[i] = exp(-r*r);
+  }
+  pspio_meshfunc_alloc(&func, np);
+  pspio_meshfunc_init(func, mesh, f, NULL, NULL);
+  ck_assert(pspio_meshfunc_get_table_size(func) == 0);
+  ck_assert(pspio_meshfunc_tabulate(func, 0, 1.0e-8) == PSPIO_EVALUE);
+  pspio_error_free();
+
+  for (k=PSPIO_TABLE_R; k<=PSPIO_TABLE_R2; k++) {
+    ck_assert(pspio_meshfunc_tabulate(func, k, 1.0e-6) == PSPIO_SUCCESS);
+    ck_assert(pspio_meshfunc_get_table_size(func) >= np);
+    ck_assert(pspio_meshfunc_get_table_error(func) <= 1.0e-6);
+
+    /* The table reproduces the interpolation of the function */
+    for (i=0; i<50; i++) {
+      r = 0.37*i;
+      x[i] = (k == PSPIO_TABLE_R2) ? r*r : r;
+      err = fabs(pspio_meshfunc_eval_table(func, x[i]) - pspio_meshfunc_eval(func, r));
+      ck_assert(err <= 2.0e-6);
+    }
+    pspio_meshfunc_eval_table_batch(func, 50, x, ft);
+    for (i=0; i<50; i++) {
+      ck_assert(ft[i] == pspio_meshfunc_eval_table(func, x[i]));
+    }
+    r = 1.3;
+    err = pspio_meshfunc_eval_deriv(func, r);
+    if ( k == PSPIO_TABLE_R2 ) err /= 2.0*r;
+    ck_assert(fabs(pspio_meshfunc_eval_table_deriv(func, (k == PSPIO_TABLE_R2) ? r*r : r) - err) <= 1.0e-4);
+  }
+
+  /* Copies keep the table, new data discards it */
+  ck_assert(pspio_meshfunc_copy(&copy, func) == PSPIO_SUCCESS);
+  ck_assert(pspio_meshfunc_get_table_size(copy) == pspio_meshfunc_get_table_size(func));
+  ck_assert(pspio_meshfunc_eval_table(copy, 0.5) == pspio_meshfunc_eval_table(func, 0.5));
+  pspio_meshfunc_init(func, mesh, f, NULL, NULL);
+  ck_assert(pspio_meshfunc_get_table_size(func) == 0);
+
+  pspio_meshfunc_free(copy);
+  pspio_meshfunc_free(func);
+  pspio_mesh_free(mesh);
+}
+END_TEST
+
+START_TEST(test_meshfunc_eval_float)
+{
+  int i, k, np = 200, prev;
+  const int methods[3] = {0, PSPIO_INTERP_HERMITE3, PSPIO_INTERP_HERMITE5};
+  float rs[100], fs[100], fps[100];
+  double r, f[200], fp[200], fpp[200], fmax_abs, err, derr;
+  pspio_mesh_t *mesh = NULL;
+  pspio_meshfunc_t *func = NULL;
+
+  pspio_mesh_alloc(&mesh, np);
+  pspio_mesh_init_from_parameters(mesh, PSPIO_MESH_LOG1, 0.05, 1.0e-3);
+  for (i=0; i<np; i++) {
+    r = mesh->r[i];
+    f[i] = r*r*exp(-r);
+    fp[i] = (2.0*r - r*r)*exp(-r);
+    fpp[i] = (2.0 - 4.0*r + r*r)*exp(-r);
+  }
+  for (i=0; i<100; i++) {
+    rs[i] = 0.25f*i - 0.1f;
+  }
+
+  for (k=0; k<3; k++) {
+    prev = pspio_meshfunc_default_interp(methods[k] | PSPIO_INTERP_SINGLE);
+    pspio_meshfunc_alloc(&func, np);
+    pspio_meshfunc_default_interp(prev);
+    ck_assert(pspio_meshfunc_get_interp_method(func) & PSPIO_INTERP_SINGLE);
+    ck_assert(pspio_meshfunc_init(func, mesh, f, fp, fpp) == PSPIO_SUCCESS);
+
+    /* The double precision path is unchanged */
+    ck_assert(pspio_meshfunc_get_function(func)[7] == f[7]);
+
+    pspio_meshfunc_eval_float_batch(func, 100, rs, fs);
+    pspio_meshfunc_eval_deriv_float_batch(func, 100, rs, fps);
+    fmax_abs = 0.0;
+    err = 0.0;
+    derr = 0.0;
+    for (i=0; i<100; i++) {
+      fmax_abs = fmax(fmax_abs, fabs(pspio_meshfunc_eval(func, rs[i])));
+      err = fmax(err, fabs(fs[i] - pspio_meshfunc_eval(func, rs[i])));
+      derr = fmax(derr, fabs(fps[i] - pspio_meshfunc_eval_deriv(func, rs[i])));
+    }
+    printf("Single precision evaluation, method %d: max error %.3e (relative %.3e), derivative %.3e\n",
+      pspio_meshfunc_get_interp_method(func), err, err/fmax_abs, derr);
+    ck_assert(err <= 1.0e-6 * fmax_abs);
+    ck_assert(derr <= 1.0e-4 * fmax_abs);
+
+    pspio_meshfunc_free(func);
+    func = NULL;
+  }
+
+  pspio_mesh_free(mesh);
+}
+END_TEST
+
+START_TEST(test_meshfunc_memory_usage)
+{
+  pspio_memory_t usage, mesh_usage;
+
+  pspio_meshfunc_init(mf11, m1, f11, f11p, f11pp);
+
+  pspio_memory_reset(&mesh_usage);
+  pspio_mesh_memory_usage(m1, &mesh_usage);
+
+  pspio_memory_reset(&usage);
+  pspio_meshfunc_memory_usage(mf11, &usage);
+  ck_assert(usage.arrays == 3 * 8 * sizeof(double));
+  ck_assert(usage.meshes == pspio_memory_total(&mesh_usage));
+  ck_assert(usage.splines >= 3 * 3 * 8 * sizeof(double));
+  ck_assert(usage.metadata >= sizeof(pspio_meshfunc_t));
+}
+END_TEST
+
 
 Suite * make_meshfunc_suite(void)
 {
@@ -346,6 +648,7 @@ Suite * make_meshfunc_suite(void)
   tcase_add_test(tc_init, test_meshfunc_init1);
   tcase_add_test(tc_init, test_meshfunc_init2);
   tcase_add_test(tc_init, test_meshfunc_init3);
+  tcase_add_test(tc_init, test_meshfunc_prepare_batch);
   suite_add_tcase(s, tc_init);
 
   tc_cmp = tcase_create("Comparison");
@@ -371,6 +674,7 @@ Suite * make_meshfunc_suite(void)
   tcase_add_test(tc_get, test_meshfunc_get_deriv2);
   tcase_add_test(tc_get, test_meshfunc_get_interp_method);
   tcase_add_test(tc_get, test_meshfunc_get_mesh);
+  tcase_add_test(tc_get, test_meshfunc_memory_usage);
   suite_add_tcase(s, tc_get);
 
   tc_eval = tcase_create("Evaluation");
@@ -378,6 +682,12 @@ Suite * make_meshfunc_suite(void)
   tcase_add_test(tc_eval, test_meshfunc_eval);
   tcase_add_test(tc_eval, test_meshfunc_eval_deriv);
   tcase_add_test(tc_eval, test_meshfunc_eval_deriv2);
+  tcase_add_test(tc_eval, test_meshfunc_eval_batch);
+  tcase_add_test(tc_eval, test_meshfunc_eval_located);
+  tcase_add_test(tc_eval, test_meshfunc_eval_hermite);
+  tcase_add_test(tc_eval, test_meshfunc_interp_copy_hermite);
+  tcase_add_test(tc_eval, test_meshfunc_tabulate);
+  tcase_add_test(tc_eval, test_meshfunc_eval_float);
   suite_add_tcase(s, tc_eval);
     
   return s;
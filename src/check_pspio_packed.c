@@ -0,0 +1,237 @@
+/* Copyright (C) 2018 Micael Oliveira <micael.oliveira@mpsd.mpg.de>
+ *                    Yann Pouillon <devops@materialsevolution.es>
+ *
+ * This file is part of Libpspio.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * version 2.0. If a copy of the MPL was not distributed with this file, You
+ * can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Libpspio is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the Mozilla Public License version 2.0 for
+ * more details.
+ */
+
+/**
+ * @file check_pspio_packed.c
+ * @brief checks pspio_packed.c and pspio_packed.h
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <check.h>
+
+#include "pspio_error.h"
+#include "pspio_packed.h"
+
+#if defined HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+static pspio_pspdata_t *pspdata = NULL;
+static pspio_packed_t *packed = NULL;
+
+static char filename[200];
+
+
+void packed_setup(void)
+{
+  pspio_pspdata_free(pspdata);
+  pspdata = NULL;
+  pspio_pspdata_alloc(&pspdata);
+  pspio_packed_free(packed);
+  packed = NULL;
+  pspio_packed_alloc(&packed);
+}
+
+void packed_teardown(void)
+{
+  pspio_packed_free(packed);
+  packed = NULL;
+  pspio_pspdata_free(pspdata);
+  pspdata = NULL;
+}
+
+static void packed_check_block(const double *block, int n,
+                               const pspio_meshfunc_t *(*getf)(int))
+{
+  int i, k, np, ld;
+  const double *f;
+
+  np = pspio_packed_get_np(packed);
+  ld = pspio_packed_get_ld(packed);
+  for (i=0; i<n; i++) {
+    ck_assert((uintptr_t)(block + (size_t)i*ld) % PSPIO_PACKED_ALIGN == 0);
+    f = pspio_meshfunc_get_function(getf(i));
+    for (k=0; k<np; k++) {
+      ck_assert(block[(size_t)i*ld + k] == f[k]);
+    }
+    for (k=np; k<ld; k++) {
+      ck_assert(block[(size_t)i*ld + k] == 0.0);
+    }
+  }
+}
+
+static const pspio_meshfunc_t *packed_get_wf(int i)
+{
+  return pspio_state_get_wf(pspio_pspdata_get_state(pspdata, i));
+}
+
+static const pspio_meshfunc_t *packed_get_proj(int i)
+{
+  return pspio_pspdata_get_projector(pspdata, i)->proj;
+}
+
+static const pspio_meshfunc_t *packed_get_pot(int i)
+{
+  return pspio_pspdata_get_potential(pspdata, i)->v;
+}
+
+
+START_TEST(test_packed_alloc)
+{
+  ck_assert(pspio_packed_get_np(packed) == 0);
+  ck_assert(pspio_packed_get_n_states(packed) == 0);
+  ck_assert(pspio_packed_get_states(packed) == NULL);
+  ck_assert(pspio_packed_get_projectors(packed) == NULL);
+}
+END_TEST
+
+START_TEST(test_packed_upf)
+{
+  int i;
+
+  sprintf(filename, "%s/%s", PSPIO_CHK_DATADIR, "UPF/Li.UPF");
+  ck_assert(pspio_pspdata_read(pspdata, PSPIO_FMT_UPF, filename) == PSPIO_SUCCESS);
+  ck_assert(pspio_packed_init(packed, pspdata) == PSPIO_SUCCESS);
+
+  ck_assert(pspio_packed_get_mesh(packed) == pspio_pspdata_get_mesh(pspdata));
+  ck_assert(pspio_packed_get_np(packed) == pspio_mesh_get_np(pspio_pspdata_get_mesh(pspdata)));
+  ck_assert(pspio_packed_get_ld(packed) >= pspio_packed_get_np(packed));
+  ck_assert(pspio_packed_get_ld(packed) % (PSPIO_PACKED_ALIGN / sizeof(double)) == 0);
+
+  ck_assert(pspio_packed_get_n_states(packed) == pspio_pspdata_get_n_states(pspdata));
+  packed_check_block(pspio_packed_get_states(packed),
+    pspio_packed_get_n_states(packed), packed_get_wf);
+  for (i=0; i<pspio_packed_get_n_states(packed); i++) {
+    ck_assert(pspio_packed_get_states_l(packed)[i] ==
+      pspio_qn_get_l(pspio_state_get_qn(pspio_pspdata_get_state(pspdata, i))));
+  }
+
+  ck_assert(pspio_packed_get_n_projectors(packed) == pspio_pspdata_get_n_projectors(pspdata));
+  packed_check_block(pspio_packed_get_projectors(packed),
+    pspio_packed_get_n_projectors(packed), packed_get_proj);
+  for (i=0; i<pspio_packed_get_n_projectors(packed); i++) {
+    ck_assert(pspio_packed_get_projectors_l(packed)[i] ==
+      pspio_qn_get_l(pspio_projector_get_qn(pspio_pspdata_get_projector(pspdata, i))));
+    ck_assert(pspio_packed_get_projectors_j(packed)[i] ==
+      pspio_qn_get_j(pspio_projector_get_qn(pspio_pspdata_get_projector(pspdata, i))));
+  }
+}
+END_TEST
+
+START_TEST(test_packed_fhi)
+{
+  int i;
+
+  sprintf(filename, "%s/%s", PSPIO_CHK_DATADIR, "fhi/Li.cpi");
+  ck_assert(pspio_pspdata_read(pspdata, PSPIO_FMT_FHI98PP, filename) == PSPIO_SUCCESS);
+  ck_assert(pspio_packed_init(packed, pspdata) == PSPIO_SUCCESS);
+
+  ck_assert(pspio_packed_get_n_potentials(packed) == pspio_pspdata_get_n_potentials(pspdata));
+  packed_check_block(pspio_packed_get_potentials(packed),
+    pspio_packed_get_n_potentials(packed), packed_get_pot);
+  for (i=0; i<pspio_packed_get_n_potentials(packed); i++) {
+    ck_assert(pspio_packed_get_potentials_l(packed)[i] ==
+      pspio_qn_get_l(pspio_potential_get_qn(pspio_pspdata_get_potential(pspdata, i))));
+  }
+
+  /* Packing twice must release the previous blocks */
+  ck_assert(pspio_packed_init(packed, pspdata) == PSPIO_SUCCESS);
+  ck_assert(pspio_packed_get_n_states(packed) == pspio_pspdata_get_n_states(pspdata));
+}
+END_TEST
+
+START_TEST(test_packed_methods)
+{
+  int prev;
+
+  /* Functions interpolated by Hermite polynomials are rejected */
+  sprintf(filename, "%s/%s", PSPIO_CHK_DATADIR, "fhi/Li.cpi");
+  prev = pspio_meshfunc_default_interp(PSPIO_INTERP_HERMITE3);
+  ck_assert(pspio_pspdata_read(pspdata, PSPIO_FMT_FHI98PP, filename) == PSPIO_SUCCESS);
+  pspio_meshfunc_default_interp(prev);
+  ck_assert(pspio_packed_init(packed, pspdata) == PSPIO_ENOSUPPORT);
+  pspio_error_free();
+
+  /* The single-precision copy does not change the double-precision spline */
+  pspio_pspdata_free(pspdata);
+  pspdata = NULL;
+  pspio_pspdata_alloc(&pspdata);
+  prev = pspio_meshfunc_default_interp(PSPIO_INTERP_JB_CSPLINE | PSPIO_INTERP_SINGLE);
+  ck_assert(pspio_pspdata_read(pspdata, PSPIO_FMT_FHI98PP, filename) == PSPIO_SUCCESS);
+  pspio_meshfunc_default_interp(prev);
+  ck_assert(pspio_packed_init(packed, pspdata) == PSPIO_SUCCESS);
+}
+END_TEST
+
+START_TEST(test_packed_eval)
+{
+  int i, k, m, np;
+  double r, f[16], fp[16];
+  const double *rm;
+  const pspio_projector_t *proj;
+
+  sprintf(filename, "%s/%s", PSPIO_CHK_DATADIR, "UPF/Li.UPF");
+  ck_assert(pspio_pspdata_read(pspdata, PSPIO_FMT_UPF, filename) == PSPIO_SUCCESS);
+  ck_assert(pspio_packed_init(packed, pspdata) == PSPIO_SUCCESS);
+  ck_assert(pspio_packed_get_n_projectors(packed) <= 16);
+  ck_assert(pspio_packed_get_n_states(packed) <= 16);
+
+  np = pspio_packed_get_np(packed);
+  rm = pspio_mesh_get_r(pspio_packed_get_mesh(packed));
+  for (m=0; m<=8; m++) {
+    /* Between mesh points, and outside the mesh at both ends */
+    k = (m == 0) ? -1 : (m == 8) ? np-1 : m*(np-1)/8;
+    r = (k < 0) ? rm[0] - 0.01 : (k == np-1) ? rm[k] + 0.01 : 0.5*(rm[k] + rm[k+1]);
+
+    pspio_packed_eval_projectors(packed, r, f, fp);
+    for (i=0; i<pspio_packed_get_n_projectors(packed); i++) {
+      proj = pspio_pspdata_get_projector(pspdata, i);
+      ck_assert(fabs(f[i] - pspio_projector_eval(proj, r)) <= 1e-10);
+      ck_assert(fabs(fp[i] - pspio_projector_eval_deriv(proj, r)) <= 1e-4*(1.0 + fabs(fp[i])));
+    }
+
+    pspio_packed_eval_states(packed, r, f, NULL);
+    for (i=0; i<pspio_packed_get_n_states(packed); i++) {
+      ck_assert(fabs(f[i] - pspio_state_wf_eval(pspio_pspdata_get_state(pspdata, i), r)) <= 1e-10);
+    }
+  }
+}
+END_TEST
+
+
+Suite * make_packed_suite(void)
+{
+  Suite *s;
+  TCase *tc_alloc, *tc_init;
+
+  s = suite_create("Packed");
+
+  tc_alloc = tcase_create("Allocation");
+  tcase_add_checked_fixture(tc_alloc, packed_setup, packed_teardown);
+  tcase_add_test(tc_alloc, test_packed_alloc);
+  suite_add_tcase(s, tc_alloc);
+
+  tc_init = tcase_create("Packing");
+  tcase_add_checked_fixture(tc_init, packed_setup, packed_teardown);
+  tcase_add_test(tc_init, test_packed_upf);
+  tcase_add_test(tc_init, test_packed_fhi);
+  tcase_add_test(tc_init, test_packed_methods);
+  tcase_add_test(tc_init, test_packed_eval);
+  suite_add_tcase(s, tc_init);
+
+  return s;
+}
@@ -192,6 +192,19 @@ START_TEST(test_potential_get_qn)
 }
 END_TEST
 
+START_TEST(test_potential_get_v)
+{
+  int i;
+  const double *f;
+
+  pspio_potential_init(pot11, qn11, m1, v11);
+  f = pspio_meshfunc_get_function(pspio_potential_get_v(pot11));
+  for (i=0; i<8; i++) {
+    ck_assert(f[i] == v11[i]);
+  }
+}
+END_TEST
+
 START_TEST(test_potential_eval)
 {
   double eval, expect;
@@ -260,6 +273,7 @@ Suite * make_potential_suite(void)
   tc_get = tcase_create("Getters");
   tcase_add_checked_fixture(tc_get, potential_setup, potential_teardown);
   tcase_add_test(tc_get, test_potential_get_qn);
+  tcase_add_test(tc_get, test_potential_get_v);
   suite_add_tcase(s, tc_get);
 
   tc_eval = tcase_create("Evaluation");
@@ -224,6 +224,19 @@ START_TEST(test_projector_get_qn)
 }
 END_TEST
 
+START_TEST(test_projector_get_proj)
+{
+  int i;
+  const double *f;
+
+  pspio_projector_init(proj11, qn11, m1, p11);
+  f = pspio_meshfunc_get_function(pspio_projector_get_proj(proj11));
+  for (i=0; i<8; i++) {
+    ck_assert(f[i] == p11[i]);
+  }
+}
+END_TEST
+
 START_TEST(test_projector_eval)
 {
   double eval, expect;
@@ -294,6 +307,7 @@ Suite * make_projector_suite(void)
   tcase_add_checked_fixture(tc_get, projector_setup, projector_teardown);
   tcase_add_test(tc_get, test_projector_get_energy);
   tcase_add_test(tc_get, test_projector_get_qn);
+  tcase_add_test(tc_get, test_projector_get_proj);
   suite_add_tcase(s, tc_get);
 
   tc_eval = tcase_create("Evaluation");
@@ -18,6 +18,7 @@
  * @brief checks pspio_pspdata.c and pspio_pspdata.h
  */
 
+#include <string.h>
 #include <check.h>
 
 #include "pspio_error.h"
@@ -27,6 +28,19 @@
 #include "config.h"
 #endif
 
+#if defined _OPENMP
+#include <omp.h>
+#endif
+#if defined HAVE_ZLIB
+#include <zlib.h>
+#endif
+#if defined HAVE_LZMA
+#include <lzma.h>
+#endif
+#if defined HAVE_ZSTD
+#include <zstd.h>
+#endif
+
 static pspio_pspdata_t *pspdata = NULL;
 static pspio_pspinfo_t *pspinfo = NULL;
 static pspio_mesh_t *mesh = NULL;
@@ -304,6 +318,66 @@ START_TEST(test_pspdata_setget_rho_valence)
 }
 END_TEST
 
+START_TEST(test_pspdata_take)
+{
+  pspio_state_t *s = NULL;
+  pspio_potential_t *v = NULL, *vl = NULL;
+  pspio_projector_t *p = NULL;
+  pspio_xc_t *x = NULL;
+  pspio_meshfunc_t *rho = NULL;
+  const void *addr;
+
+  ck_assert(pspio_pspdata_set_n_states(pspdata, 1) == PSPIO_SUCCESS);
+  ck_assert(pspio_pspdata_set_n_potentials(pspdata, 1) == PSPIO_SUCCESS);
+  ck_assert(pspio_pspdata_set_n_projectors(pspdata, 1) == PSPIO_SUCCESS);
+  ck_assert(pspio_state_copy(&s, state) == PSPIO_SUCCESS);
+  ck_assert(pspio_potential_copy(&v, potential) == PSPIO_SUCCESS);
+  ck_assert(pspio_potential_copy(&vl, potential) == PSPIO_SUCCESS);
+  ck_assert(pspio_projector_copy(&p, projector) == PSPIO_SUCCESS);
+  ck_assert(pspio_xc_copy(&x, xc) == PSPIO_SUCCESS);
+  ck_assert(pspio_meshfunc_copy(&rho, rho_valence) == PSPIO_SUCCESS);
+
+  /* The objects are stored as they are, replacing the previous ones */
+  ck_assert(pspio_pspdata_set_state(pspdata, 0, state) == PSPIO_SUCCESS);
+  addr = s;
+  ck_assert(pspio_pspdata_take_state(pspdata, 0, &s) == PSPIO_SUCCESS);
+  ck_assert(s == NULL && (const void *)pspio_pspdata_get_state(pspdata, 0) == addr);
+  addr = v;
+  ck_assert(pspio_pspdata_take_potential(pspdata, 0, &v) == PSPIO_SUCCESS);
+  ck_assert(v == NULL && (const void *)pspio_pspdata_get_potential(pspdata, 0) == addr);
+  addr = p;
+  ck_assert(pspio_pspdata_take_projector(pspdata, 0, &p) == PSPIO_SUCCESS);
+  ck_assert(p == NULL && (const void *)pspio_pspdata_get_projector(pspdata, 0) == addr);
+  addr = vl;
+  ck_assert(pspio_pspdata_take_vlocal(pspdata, &vl) == PSPIO_SUCCESS);
+  ck_assert(vl == NULL && (const void *)pspio_pspdata_get_vlocal(pspdata) == addr);
+  addr = x;
+  ck_assert(pspio_pspdata_take_xc(pspdata, &x) == PSPIO_SUCCESS);
+  ck_assert(x == NULL && (const void *)pspio_pspdata_get_xc(pspdata) == addr);
+  addr = rho;
+  ck_assert(pspio_pspdata_take_rho_valence(pspdata, &rho) == PSPIO_SUCCESS);
+  ck_assert(rho == NULL && (const void *)pspio_pspdata_get_rho_valence(pspdata) == addr);
+
+  ck_assert(pspio_state_cmp(pspio_pspdata_get_state(pspdata, 0), state) == PSPIO_EQUAL);
+  ck_assert(pspio_xc_cmp(pspio_pspdata_get_xc(pspdata), xc) == PSPIO_EQUAL);
+
+  /* Giving back the stored objects leaves them in place */
+  s = (pspio_state_t *)pspio_pspdata_get_state(pspdata, 0);
+  ck_assert(pspio_pspdata_take_state(pspdata, 0, &s) == PSPIO_SUCCESS);
+  ck_assert(s == NULL && pspio_pspdata_get_state(pspdata, 0) != NULL);
+  v = (pspio_potential_t *)pspio_pspdata_get_potential(pspdata, 0);
+  ck_assert(pspio_pspdata_take_potential(pspdata, 0, &v) == PSPIO_SUCCESS);
+  ck_assert(v == NULL && pspio_pspdata_get_potential(pspdata, 0) != NULL);
+  p = (pspio_projector_t *)pspio_pspdata_get_projector(pspdata, 0);
+  ck_assert(pspio_pspdata_take_projector(pspdata, 0, &p) == PSPIO_SUCCESS);
+  ck_assert(p == NULL && pspio_pspdata_get_projector(pspdata, 0) != NULL);
+  x = (pspio_xc_t *)pspio_pspdata_get_xc(pspdata);
+  ck_assert(pspio_pspdata_take_xc(pspdata, &x) == PSPIO_SUCCESS);
+  ck_assert(x == NULL && pspio_xc_cmp(pspio_pspdata_get_xc(pspdata), xc) == PSPIO_EQUAL);
+  ck_assert(pspio_state_cmp(pspio_pspdata_get_state(pspdata, 0), state) == PSPIO_EQUAL);
+}
+END_TEST
+
 
 START_TEST(test_pspdata_fhi_io)
 {
@@ -356,6 +430,987 @@ START_TEST(test_pspdata_upf_guess)
 }
 END_TEST
 
+START_TEST(test_pspdata_memory_usage)
+{
+  int i;
+  pspio_memory_t usage, parts;
+
+  sprintf(filename, "%s/%s", PSPIO_CHK_DATADIR, "UPF/Li.UPF");
+  ck_assert(pspio_pspdata_read(pspdata, PSPIO_FMT_UPF, filename) == PSPIO_SUCCESS);
+
+  pspio_memory_reset(&usage);
+  pspio_pspdata_memory_usage(pspdata, &usage);
+
+  /* Every mesh function carries its own copy of the mesh */
+  pspio_memory_reset(&parts);
+  for (i=0; i<pspio_pspdata_get_n_states(pspdata); i++) {
+    pspio_state_memory_usage(pspio_pspdata_get_state(pspdata, i), &parts);
+  }
+  for (i=0; i<pspio_pspdata_get_n_potentials(pspdata); i++) {
+    pspio_potential_memory_usage(pspio_pspdata_get_potential(pspdata, i), &parts);
+  }
+  for (i=0; i<pspio_pspdata_get_n_projectors(pspdata); i++) {
+    pspio_projector_memory_usage(pspio_pspdata_get_projector(pspdata, i), &parts);
+  }
+  pspio_potential_memory_usage(pspio_pspdata_get_vlocal(pspdata), &parts);
+  pspio_xc_memory_usage(pspio_pspdata_get_xc(pspdata), &parts);
+  pspio_meshfunc_memory_usage(pspio_pspdata_get_rho_valence(pspdata), &parts);
+
+  ck_assert(usage.meshes > 0);
+  ck_assert(usage.meshes == parts.meshes);
+  ck_assert(usage.splines == parts.splines);
+  ck_assert(usage.arrays > parts.arrays);
+  ck_assert(usage.metadata > parts.metadata);
+}
+END_TEST
+
+/* Replaces the first state by a copy of itself, discarding the index */
+static void pspdata_retake_state(pspio_pspdata_t *data)
+{
+  pspio_state_t *state = NULL;
+
+  ck_assert(pspio_state_copy(&state, pspio_pspdata_get_state(data, 0)) == PSPIO_SUCCESS);
+  ck_assert(pspio_pspdata_take_state(data, 0, &state) == PSPIO_SUCCESS);
+}
+
+START_TEST(test_pspdata_index)
+{
+  int i, n;
+  const int *ip;
+  const pspio_qn_t *qn;
+
+  /* Relativistic states and projectors */
+  sprintf(filename, "%s/%s", PSPIO_CHK_DATADIR, "UPF/Xe.UPF");
+  ck_assert(pspio_pspdata_read(pspdata, PSPIO_FMT_UPF, filename) == PSPIO_SUCCESS);
+  for (i=0; i<pspio_pspdata_get_n_states(pspdata); i++) {
+    qn = pspio_state_get_qn(pspio_pspdata_get_state(pspdata, i));
+    ck_assert(pspio_pspdata_find_state(pspdata, pspio_qn_get_n(qn),
+      pspio_qn_get_l(qn), pspio_qn_get_j(qn)) == i);
+  }
+  ck_assert(pspio_pspdata_find_state(pspdata, 5, 1, 0.0) == -1);
+  ck_assert(pspio_pspdata_find_state(pspdata, 5, 7, 6.5) == -1);
+  ck_assert(pspio_pspdata_find_state(pspdata, 9, 1, 0.5) == -1);
+
+  n = pspio_pspdata_find_projectors_l(pspdata, 2, &ip);
+  ck_assert(n == 2);
+  for (i=0; i<n; i++) {
+    qn = pspio_projector_get_qn(pspio_pspdata_get_projector(pspdata, ip[i]));
+    ck_assert(pspio_qn_get_l(qn) == 2);
+  }
+  n = pspio_pspdata_find_projectors(pspdata, 1, 1.5, &ip);
+  ck_assert(n == 1);
+  qn = pspio_projector_get_qn(pspio_pspdata_get_projector(pspdata, ip[0]));
+  ck_assert(pspio_qn_get_l(qn) == 1 && pspio_qn_get_j(qn) == 1.5);
+  ck_assert(pspio_pspdata_find_projectors(pspdata, 1, 0.0, &ip) == 0);
+  ck_assert(pspio_pspdata_get_n_projectors_per_l(pspdata)[2] == 2);
+  ck_assert(pspio_pspdata_get_n_projectors_per_l(pspdata)[5] == 0);
+
+  /* Lookups rebuild the index discarded by a setter */
+  pspdata_retake_state(pspdata);
+  ck_assert(pspdata->index == NULL);
+  ck_assert(pspio_pspdata_get_n_projectors_per_l(pspdata) != NULL);
+  ck_assert(pspio_pspdata_get_n_projectors_per_l(pspdata)[2] == 2);
+  pspdata_retake_state(pspdata);
+  qn = pspio_state_get_qn(pspio_pspdata_get_state(pspdata, 0));
+  ck_assert(pspio_pspdata_find_state(pspdata, pspio_qn_get_n(qn),
+    pspio_qn_get_l(qn), pspio_qn_get_j(qn)) == 0);
+  pspdata_retake_state(pspdata);
+  ck_assert(pspio_pspdata_find_potential(pspdata, 9, 0.0) == -1);
+  ck_assert(pspdata->index != NULL);
+  pspdata_retake_state(pspdata);
+  ck_assert(pspio_pspdata_find_projectors(pspdata, 1, 1.5, &ip) == 1);
+  pspdata_retake_state(pspdata);
+  ck_assert(pspio_pspdata_find_projectors_l(pspdata, 2, &ip) == 2);
+
+  /* Setters discard the index */
+  ck_assert(pspio_pspdata_set_n_projectors(pspdata, 0) == PSPIO_SUCCESS);
+  ck_assert(pspdata->index == NULL);
+  ck_assert(pspio_pspdata_build_index(pspdata) == PSPIO_SUCCESS);
+  ck_assert(pspio_pspdata_find_projectors_l(pspdata, 2, NULL) == 0);
+
+  /* Objects not set yet cannot be indexed */
+  ck_assert(pspio_pspdata_set_n_states(pspdata, 1) == PSPIO_SUCCESS);
+  ck_assert(pspio_pspdata_find_state(pspdata, 1, 0, 0.0) == -1);
+  ck_assert(pspio_pspdata_find_projectors_l(pspdata, 2, &ip) == 0 && ip == NULL);
+  pspio_error_free();
+  pspio_pspdata_free(pspdata);
+  pspdata = NULL;
+  pspio_pspdata_alloc(&pspdata);
+
+  /* Semi-local potentials */
+  sprintf(filename, "%s/%s", PSPIO_CHK_DATADIR, "fhi/Li.cpi");
+  ck_assert(pspio_pspdata_read(pspdata, PSPIO_FMT_FHI98PP, filename) == PSPIO_SUCCESS);
+  for (i=0; i<pspio_pspdata_get_n_potentials(pspdata); i++) {
+    ck_assert(pspio_pspdata_find_potential(pspdata, i, 0.0) == i);
+  }
+  ck_assert(pspio_pspdata_find_potential(pspdata,
+    pspio_pspdata_get_n_potentials(pspdata), 0.0) == -1);
+}
+END_TEST
+
+START_TEST(test_pspdata_hash_cmp)
+{
+  uint64_t hash;
+  pspio_pspdata_t *other = NULL;
+
+  sprintf(filename, "%s/%s", PSPIO_CHK_DATADIR, "UPF/Li.UPF");
+  ck_assert(pspio_pspdata_read(pspdata, PSPIO_FMT_UPF, filename) == PSPIO_SUCCESS);
+  pspio_pspdata_alloc(&other);
+  ck_assert(pspio_pspdata_read(other, PSPIO_FMT_UPF, filename) == PSPIO_SUCCESS);
+
+  /* Same contents, hashed on demand */
+  ck_assert(pspdata->hash == 0);
+  hash = pspio_pspdata_hash(pspdata);
+  ck_assert(hash != 0);
+  ck_assert(pspdata->hash == hash);
+  ck_assert(pspio_pspdata_hash(other) == hash);
+  ck_assert(pspio_pspdata_cmp(pspdata, other, 0.0) == PSPIO_EQUAL);
+
+  /* Slightly different contents */
+  ck_assert(pspio_pspdata_set_z(other, pspio_pspdata_get_z(pspdata)*(1.0 + 1.0e-12)) == PSPIO_SUCCESS);
+  ck_assert(pspio_pspdata_cmp(pspdata, other, 0.0) == PSPIO_DIFF);
+  ck_assert(pspio_pspdata_cmp(pspdata, other, 1.0e-10) == PSPIO_EQUAL);
+  ck_assert(pspio_pspdata_hash(other) != hash);
+  ck_assert(pspio_pspdata_cmp(pspdata, other, 0.0) == PSPIO_DIFF);
+  ck_assert(pspio_pspdata_set_z(other, pspio_pspdata_get_z(pspdata)) == PSPIO_SUCCESS);
+  ck_assert(pspio_pspdata_hash(other) == hash);
+
+  /* Signed zeros compare equal, whether the hashes are known or not */
+  ck_assert(pspio_pspdata_set_total_energy(pspdata, 0.0) == PSPIO_SUCCESS);
+  ck_assert(pspio_pspdata_set_total_energy(other, -0.0) == PSPIO_SUCCESS);
+  ck_assert(pspio_pspdata_cmp(pspdata, other, 0.0) == PSPIO_EQUAL);
+  ck_assert(pspio_pspdata_hash(other) == pspio_pspdata_hash(pspdata));
+  ck_assert(pspio_pspdata_cmp(pspdata, other, 0.0) == PSPIO_EQUAL);
+  hash = pspio_pspdata_hash(pspdata);
+
+  /* Different pseudopotential */
+  pspio_pspdata_free(other);
+  other = NULL;
+  pspio_pspdata_alloc(&other);
+  sprintf(filename, "%s/%s", PSPIO_CHK_DATADIR, "UPF/F.UPF");
+  ck_assert(pspio_pspdata_read(other, PSPIO_FMT_UPF, filename) == PSPIO_SUCCESS);
+  ck_assert(pspio_pspdata_hash(other) != hash);
+  ck_assert(pspio_pspdata_cmp(pspdata, other, 1.0e-6) == PSPIO_DIFF);
+
+  pspio_pspdata_free(other);
+}
+END_TEST
+
+START_TEST(test_pspdata_read_header)
+{
+  int k;
+  const char *files[3] = {"UPF/Li.UPF", "abinit6/03-Li.LDA.fhi", "fhi/Li.cpi"};
+  const int formats[3] = {PSPIO_FMT_UPF, PSPIO_FMT_ABINIT_6, PSPIO_FMT_FHI98PP};
+  pspio_pspdata_t *full = NULL;
+
+  for (k=0; k<3; k++) {
+    sprintf(filename, "%s/%s", PSPIO_CHK_DATADIR, files[k]);
+    pspio_pspdata_alloc(&full);
+    ck_assert(pspio_pspdata_read(full, formats[k], filename) == PSPIO_SUCCESS);
+    ck_assert(pspio_pspdata_read_header(pspdata, PSPIO_FMT_UNKNOWN, filename) == PSPIO_SUCCESS);
+
+    /* Same metadata as a full read, without the functions */
+    ck_assert(pspio_pspdata_get_format_guessed(pspdata) == formats[k]);
+    ck_assert(pspio_pspdata_get_mesh(pspdata) == NULL);
+    ck_assert(pspio_pspdata_get_np(pspdata) == pspio_pspdata_get_np(full));
+    ck_assert(pspio_pspdata_get_zvalence(pspdata) == pspio_pspdata_get_zvalence(full));
+    ck_assert(pspio_pspdata_get_n_states(pspdata) == pspio_pspdata_get_n_states(full));
+    /* UPF full reads recompute l_max from the pseudo-wavefunctions */
+    if ( formats[k] != PSPIO_FMT_UPF ) {
+      ck_assert(pspio_pspdata_get_l_max(pspdata) == pspio_pspdata_get_l_max(full));
+    }
+    /* Full reads of FHI data replace the symbol with N/D */
+    if ( formats[k] == PSPIO_FMT_UPF ) {
+      ck_assert_str_eq(pspio_pspdata_get_symbol(pspdata), pspio_pspdata_get_symbol(full));
+    }
+    if ( formats[k] != PSPIO_FMT_FHI98PP ) {
+      ck_assert(pspio_pspdata_get_z(pspdata) == pspio_pspdata_get_z(full));
+      ck_assert(pspio_xc_get_exchange(pspio_pspdata_get_xc(pspdata)) ==
+        pspio_xc_get_exchange(pspio_pspdata_get_xc(full)));
+      ck_assert(pspio_xc_has_nlcc(pspio_pspdata_get_xc(pspdata)) ==
+        pspio_xc_has_nlcc(pspio_pspdata_get_xc(full)));
+    }
+    /* Nothing was loaded, so nothing is indexed */
+    ck_assert(pspio_pspdata_get_loaded(pspdata) == 0);
+    ck_assert(pspio_pspdata_build_index(pspdata) == PSPIO_SUCCESS);
+    ck_assert(pspio_pspdata_find_potential(pspdata, 0, 0.0) == -1);
+
+    pspio_pspdata_free(full);
+    full = NULL;
+    pspio_pspdata_free(pspdata);
+    pspdata = NULL;
+    pspio_pspdata_alloc(&pspdata);
+  }
+}
+END_TEST
+
+START_TEST(test_pspdata_read_select)
+{
+  int i, k, load;
+  const char *files[2] = {"UPF/Li.UPF", "fhi/Li.cpi"};
+  const int formats[2] = {PSPIO_FMT_UPF, PSPIO_FMT_FHI98PP};
+  pspio_pspdata_t *full = NULL;
+
+  for (k=0; k<2; k++) {
+    sprintf(filename, "%s/%s", PSPIO_CHK_DATADIR, files[k]);
+    pspio_pspdata_alloc(&full);
+    ck_assert(pspio_pspdata_read(full, formats[k], filename) == PSPIO_SUCCESS);
+    ck_assert(pspio_pspdata_get_loaded(full) == PSPIO_LOAD_ALL);
+
+    /* Potentials only */
+    load = PSPIO_LOAD_POTENTIALS | PSPIO_LOAD_VLOCAL;
+    ck_assert(pspio_pspdata_read_select(pspdata, formats[k], filename, load) == PSPIO_SUCCESS);
+    ck_assert(pspio_pspdata_get_loaded(pspdata) == load);
+    ck_assert(pspio_pspdata_get_n_states(pspdata) == pspio_pspdata_get_n_states(full));
+    for (i=0; i<pspio_pspdata_get_n_states(pspdata); i++) {
+      ck_assert(pspio_pspdata_get_state(pspdata, i) == NULL);
+    }
+    for (i=0; i<pspio_pspdata_get_n_projectors(pspdata); i++) {
+      ck_assert(pspio_pspdata_get_projector(pspdata, i) == NULL);
+    }
+    ck_assert(pspio_pspdata_get_rho_valence(pspdata) == NULL);
+    ck_assert(pspio_pspdata_find_state(pspdata, 2, 0, 0.0) == -1);
+    ck_assert(pspio_pspdata_get_n_potentials(pspdata) == pspio_pspdata_get_n_potentials(full));
+    for (i=0; i<pspio_pspdata_get_n_potentials(pspdata); i++) {
+      ck_assert(pspio_potential_cmp(pspio_pspdata_get_potential(pspdata, i),
+        pspio_pspdata_get_potential(full, i)) == PSPIO_EQUAL);
+    }
+    /* Without the projectors, l_local of UPF files is unknown */
+    if ( pspio_pspdata_get_vlocal(full) != NULL ) {
+      ck_assert(pspio_meshfunc_cmp(pspio_pspdata_get_vlocal(pspdata)->v,
+        pspio_pspdata_get_vlocal(full)->v) == PSPIO_EQUAL);
+    }
+    ck_assert(pspio_mesh_cmp(pspio_pspdata_get_mesh(pspdata),
+      pspio_pspdata_get_mesh(full)) == PSPIO_EQUAL);
+
+    /* Incomplete data cannot be written */
+    ck_assert(pspio_pspdata_write(pspdata, formats[k], "test_select.tmp") == PSPIO_EVALUE);
+    pspio_error_free();
+
+    /* States only */
+    pspio_pspdata_free(pspdata);
+    pspdata = NULL;
+    pspio_pspdata_alloc(&pspdata);
+    ck_assert(pspio_pspdata_read_select(pspdata, formats[k], filename, PSPIO_LOAD_STATES) == PSPIO_SUCCESS);
+    for (i=0; i<pspio_pspdata_get_n_states(pspdata); i++) {
+      ck_assert(pspio_state_cmp(pspio_pspdata_get_state(pspdata, i),
+        pspio_pspdata_get_state(full, i)) == PSPIO_EQUAL);
+    }
+    for (i=0; i<pspio_pspdata_get_n_potentials(pspdata); i++) {
+      ck_assert(pspio_pspdata_get_potential(pspdata, i) == NULL);
+    }
+    ck_assert(pspio_pspdata_get_vlocal(pspdata) == NULL);
+
+    /* Nothing but the mesh */
+    pspio_pspdata_free(pspdata);
+    pspdata = NULL;
+    pspio_pspdata_alloc(&pspdata);
+    ck_assert(pspio_pspdata_read_select(pspdata, formats[k], filename, 0) == PSPIO_SUCCESS);
+    ck_assert(pspio_mesh_cmp(pspio_pspdata_get_mesh(pspdata),
+      pspio_pspdata_get_mesh(full)) == PSPIO_EQUAL);
+    ck_assert(pspio_pspdata_get_zvalence(pspdata) == pspio_pspdata_get_zvalence(full));
+
+    pspio_pspdata_free(full);
+    full = NULL;
+    pspio_pspdata_free(pspdata);
+    pspdata = NULL;
+    pspio_pspdata_alloc(&pspdata);
+  }
+}
+END_TEST
+
+/* Sink collecting what it receives, for test_pspdata_write_buffer */
+typedef struct{
+  int calls;
+  size_t size;
+  char *data;
+  int ierr;
+} pspdata_sink_t;
+
+static int pspdata_sink(const char *data, size_t size, void *context)
+{
+  pspdata_sink_t *sink = (pspdata_sink_t *)context;
+
+  sink->calls++;
+  sink->data = (char *)realloc(sink->data, sink->size + size);
+  memcpy(sink->data + sink->size, data, size);
+  sink->size += size;
+
+  return sink->ierr;
+}
+
+START_TEST(test_pspdata_write_buffer)
+{
+  int k;
+  char *buffer, *contents;
+  size_t size, file_size;
+  FILE *fp;
+  const char *files[3] = {"UPF/Li.UPF", "fhi/Li.cpi", "abinit6/03-Li.LDA.fhi"};
+  const int formats[3] = {PSPIO_FMT_UPF, PSPIO_FMT_FHI98PP, PSPIO_FMT_ABINIT_6};
+  pspdata_sink_t sink;
+
+  for (k=0; k<3; k++) {
+    pspio_pspdata_free(pspdata);
+    pspdata = NULL;
+    pspio_pspdata_alloc(&pspdata);
+    sprintf(filename, "%s/%s", PSPIO_CHK_DATADIR, files[k]);
+    ck_assert(pspio_pspdata_read(pspdata, formats[k], filename) == PSPIO_SUCCESS);
+
+    /* Same bytes as in a file */
+    ck_assert(pspio_pspdata_write_buffer(pspdata, formats[k], &buffer, &size) == PSPIO_SUCCESS);
+    ck_assert(size > 0);
+    ck_assert(pspio_pspdata_write(pspdata, formats[k], "test_buffer.tmp") == PSPIO_SUCCESS);
+    fp = fopen("test_buffer.tmp", "r");
+    ck_assert(fp != NULL);
+    contents = (char *)malloc(size + 1);
+    file_size = fread(contents, 1, size + 1, fp);
+    fclose(fp);
+    ck_assert(file_size == size);
+    ck_assert(memcmp(contents, buffer, size) == 0);
+    ck_assert(buffer[size] == '\0');
+    free(contents);
+
+    /* A single call to the sink */
+    sink.calls = 0;
+    sink.size = 0;
+    sink.data = NULL;
+    sink.ierr = PSPIO_SUCCESS;
+    ck_assert(pspio_pspdata_write_sink(pspdata, formats[k], pspdata_sink, &sink) == PSPIO_SUCCESS);
+    ck_assert(sink.calls == 1);
+    ck_assert(sink.size == size);
+    ck_assert(memcmp(sink.data, buffer, size) == 0);
+    free(sink.data);
+    free(buffer);
+  }
+  remove("test_buffer.tmp");
+
+  /* Errors of the sink are returned */
+  sink.calls = 0;
+  sink.size = 0;
+  sink.data = NULL;
+  sink.ierr = PSPIO_EIO;
+  ck_assert(pspio_pspdata_write_sink(pspdata, PSPIO_FMT_ABINIT_6, pspdata_sink, &sink) == PSPIO_EIO);
+  pspio_error_free();
+  free(sink.data);
+
+  /* Nothing is produced for unsupported formats */
+  sink.calls = 0;
+  sink.data = NULL;
+  ck_assert(pspio_pspdata_write_buffer(pspdata, PSPIO_FMT_XML, &buffer, &size) == PSPIO_EFILE_FORMAT);
+  pspio_error_free();
+  ck_assert(buffer == NULL && size == 0);
+  ck_assert(pspio_pspdata_write_sink(pspdata, PSPIO_FMT_XML, pspdata_sink, &sink) == PSPIO_EFILE_FORMAT);
+  pspio_error_free();
+  ck_assert(sink.calls == 0);
+}
+END_TEST
+
+START_TEST(test_pspdata_read_async)
+{
+  int k, done;
+  const char *files[3] = {"UPF/Li.UPF", "abinit6/03-Li.LDA.fhi", "fhi/Li.cpi"};
+  char names[3][200];
+  pspio_pspdata_t *async[3] = {NULL, NULL, NULL};
+  pspio_request_t *requests[3];
+
+  /* Several reads in flight at once */
+  for (k=0; k<3; k++) {
+    sprintf(names[k], "%s/%s", PSPIO_CHK_DATADIR, files[k]);
+    pspio_pspdata_alloc(&async[k]);
+    ck_assert(pspio_pspdata_read_async(async[k], PSPIO_FMT_UNKNOWN, names[k], &requests[k]) == PSPIO_SUCCESS);
+  }
+  for (k=0; k<3; k++) {
+    ck_assert(pspio_test(requests[k], &done) == PSPIO_SUCCESS);
+    ck_assert(done == 0 || done == 1);
+    ck_assert(pspio_wait(&requests[k]) == PSPIO_SUCCESS);
+    ck_assert(requests[k] == NULL);
+  }
+
+  /* Same result as a synchronous read */
+  for (k=0; k<3; k++) {
+    ck_assert(pspio_pspdata_read(pspdata, PSPIO_FMT_UNKNOWN, names[k]) == PSPIO_SUCCESS);
+    ck_assert(pspio_pspdata_get_format_guessed(async[k]) == pspio_pspdata_get_format_guessed(pspdata));
+    ck_assert(pspio_pspdata_hash(async[k]) == pspio_pspdata_hash(pspdata));
+    pspio_pspdata_free(async[k]);
+    pspio_pspdata_free(pspdata);
+    pspdata = NULL;
+    pspio_pspdata_alloc(&pspdata);
+  }
+
+  /* Errors of the read are returned by pspio_wait */
+  sprintf(filename, "%s/%s", PSPIO_CHK_DATADIR, "UPF/none.UPF");
+  ck_assert(pspio_pspdata_read_async(pspdata, PSPIO_FMT_UPF, filename, &requests[0]) == PSPIO_SUCCESS);
+  do {
+    ck_assert(pspio_test(requests[0], &done) == PSPIO_SUCCESS);
+  } while ( !done );
+  ck_assert(pspio_wait(&requests[0]) == PSPIO_ENOFILE);
+  pspio_error_free();
+
+  /* The worker uses the interpolation settings of the caller */
+  k = pspio_meshfunc_default_interp(PSPIO_INTERP_HERMITE3);
+  sprintf(filename, "%s/%s", PSPIO_CHK_DATADIR, "UPF/Li.UPF");
+  async[0] = NULL;
+  pspio_pspdata_alloc(&async[0]);
+  ck_assert(pspio_pspdata_read_async(async[0], PSPIO_FMT_UPF, filename, &requests[0]) == PSPIO_SUCCESS);
+  ck_assert(pspio_wait(&requests[0]) == PSPIO_SUCCESS);
+  ck_assert(pspio_meshfunc_get_interp_method(pspio_pspdata_get_rho_valence(async[0])) == PSPIO_INTERP_HERMITE3);
+  pspio_meshfunc_default_interp(k);
+  pspio_pspdata_free(async[0]);
+}
+END_TEST
+
+#if defined HAVE_ZLIB
+/* Reads a whole reference file into memory */
+static char *pspdata_slurp(const char *name, size_t *size)
+{
+  char *data;
+  FILE *fp;
+
+  fp = fopen(name, "rb");
+  ck_assert(fp != NULL);
+  fseek(fp, 0, SEEK_END);
+  *size = (size_t)ftell(fp);
+  rewind(fp);
+  data = (char *)malloc(*size);
+  ck_assert(data != NULL);
+  ck_assert(fread(data, 1, *size, fp) == *size);
+  fclose(fp);
+
+  return data;
+}
+
+START_TEST(test_pspdata_read_compressed)
+{
+  char *data;
+  size_t size;
+  uint64_t hash;
+  FILE *fp;
+  gzFile gz;
+#if defined HAVE_LZMA
+  uint8_t *xz;
+  size_t xz_size = 0;
+#endif
+#if defined HAVE_ZSTD
+  char *zst;
+  size_t zst_size;
+#endif
+
+  sprintf(filename, "%s/%s", PSPIO_CHK_DATADIR, "UPF/Li.UPF");
+  ck_assert(pspio_pspdata_read(pspdata, PSPIO_FMT_UPF, filename) == PSPIO_SUCCESS);
+  hash = pspio_pspdata_hash(pspdata);
+  data = pspdata_slurp(filename, &size);
+
+  /* gzip, with the format guessed */
+  gz = gzopen("test_compressed.tmp.gz", "wb");
+  ck_assert(gz != NULL);
+  ck_assert(gzwrite(gz, data, (unsigned)size) == (int)size);
+  ck_assert(gzclose(gz) == Z_OK);
+  pspio_pspdata_free(pspdata);
+  pspdata = NULL;
+  pspio_pspdata_alloc(&pspdata);
+  ck_assert(pspio_pspdata_read(pspdata, PSPIO_FMT_UNKNOWN, "test_compressed.tmp.gz") == PSPIO_SUCCESS);
+  ck_assert(pspio_pspdata_get_format_guessed(pspdata) == PSPIO_FMT_UPF);
+  ck_assert(pspio_pspdata_hash(pspdata) == hash);
+
+  /* Headers of compressed files are read too */
+  pspio_pspdata_free(pspdata);
+  pspdata = NULL;
+  pspio_pspdata_alloc(&pspdata);
+  ck_assert(pspio_pspdata_read_header(pspdata, PSPIO_FMT_UNKNOWN, "test_compressed.tmp.gz") == PSPIO_SUCCESS);
+  ck_assert_str_eq(pspio_pspdata_get_symbol(pspdata), "Li");
+
+  /* Truncated stream */
+  fp = fopen("test_compressed.tmp.gz", "r+b");
+  ck_assert(fp != NULL);
+  ck_assert(fread(data, 1, 64, fp) == 64);
+  fclose(fp);
+  fp = fopen("test_compressed.tmp.gz", "wb");
+  ck_assert(fwrite(data, 1, 64, fp) == 64);
+  fclose(fp);
+  pspio_pspdata_free(pspdata);
+  pspdata = NULL;
+  pspio_pspdata_alloc(&pspdata);
+  ck_assert(pspio_pspdata_read(pspdata, PSPIO_FMT_UPF, "test_compressed.tmp.gz") == PSPIO_EFILE_CORRUPT);
+  pspio_error_free();
+  remove("test_compressed.tmp.gz");
+  free(data);
+
+#if defined HAVE_LZMA
+  /* xz */
+  data = pspdata_slurp(filename, &size);
+  xz = (uint8_t *)malloc(size + 1024);
+  ck_assert(lzma_easy_buffer_encode(6, LZMA_CHECK_CRC64, NULL, (const uint8_t *)data,
+    size, xz, &xz_size, size + 1024) == LZMA_OK);
+  fp = fopen("test_compressed.tmp.xz", "wb");
+  ck_assert(fp != NULL);
+  ck_assert(fwrite(xz, 1, xz_size, fp) == xz_size);
+  fclose(fp);
+  pspio_pspdata_free(pspdata);
+  pspdata = NULL;
+  pspio_pspdata_alloc(&pspdata);
+  ck_assert(pspio_pspdata_read(pspdata, PSPIO_FMT_UNKNOWN, "test_compressed.tmp.xz") == PSPIO_SUCCESS);
+  ck_assert(pspio_pspdata_hash(pspdata) == hash);
+  remove("test_compressed.tmp.xz");
+  free(xz);
+  free(data);
+#endif
+
+#if defined HAVE_ZSTD
+  /* zstd, with more data than a chunk of the decompressor */
+  sprintf(filename, "%s/%s", PSPIO_CHK_DATADIR, "UPF/Xe.UPF");
+  pspio_pspdata_free(pspdata);
+  pspdata = NULL;
+  pspio_pspdata_alloc(&pspdata);
+  ck_assert(pspio_pspdata_read(pspdata, PSPIO_FMT_UPF, filename) == PSPIO_SUCCESS);
+  hash = pspio_pspdata_hash(pspdata);
+  data = pspdata_slurp(filename, &size);
+  zst_size = ZSTD_compressBound(size);
+  zst = (char *)malloc(zst_size);
+  ck_assert(zst != NULL);
+  zst_size = ZSTD_compress(zst, zst_size, data, size, 19);
+  ck_assert(!ZSTD_isError(zst_size));
+  fp = fopen("test_compressed.tmp.zst", "wb");
+  ck_assert(fp != NULL);
+  ck_assert(fwrite(zst, 1, zst_size, fp) == zst_size);
+  fclose(fp);
+  pspio_pspdata_free(pspdata);
+  pspdata = NULL;
+  pspio_pspdata_alloc(&pspdata);
+  ck_assert(pspio_pspdata_read(pspdata, PSPIO_FMT_UNKNOWN, "test_compressed.tmp.zst") == PSPIO_SUCCESS);
+  ck_assert(pspio_pspdata_hash(pspdata) == hash);
+
+  /* Truncated frame */
+  fp = fopen("test_compressed.tmp.zst", "wb");
+  ck_assert(fwrite(zst, 1, zst_size/2, fp) == zst_size/2);
+  fclose(fp);
+  pspio_pspdata_free(pspdata);
+  pspdata = NULL;
+  pspio_pspdata_alloc(&pspdata);
+  ck_assert(pspio_pspdata_read(pspdata, PSPIO_FMT_UPF, "test_compressed.tmp.zst") == PSPIO_EFILE_CORRUPT);
+  pspio_error_free();
+  remove("test_compressed.tmp.zst");
+  free(zst);
+  free(data);
+#endif
+}
+END_TEST
+#endif
+
+/* Returns 1 if both files have the same contents */
+static int pspdata_same_file(const char *name1, const char *name2)
+{
+  int c1, c2;
+  FILE *fp1, *fp2;
+
+  fp1 = fopen(name1, "r");
+  fp2 = fopen(name2, "r");
+  if ( (fp1 == NULL) || (fp2 == NULL) ) {
+    if ( fp1 != NULL ) fclose(fp1);
+    if ( fp2 != NULL ) fclose(fp2);
+    return 0;
+  }
+  do {
+    c1 = fgetc(fp1);
+    c2 = fgetc(fp2);
+  } while ( (c1 == c2) && (c1 != EOF) );
+  fclose(fp1);
+  fclose(fp2);
+
+  return c1 == c2;
+}
+
+START_TEST(test_pspdata_convert)
+{
+  char converted[200];
+
+  /* Converting without interpolation must give the same file */
+  sprintf(filename, "%s/%s", PSPIO_CHK_DATADIR, "UPF/Li.UPF");
+  ck_assert(pspio_pspdata_read(pspdata, PSPIO_FMT_UPF, filename) == PSPIO_SUCCESS);
+  ck_assert(pspio_pspdata_write(pspdata, PSPIO_FMT_UPF, "test_convert_ref.tmp") == PSPIO_SUCCESS);
+  sprintf(converted, "test_convert_%d.tmp", PSPIO_FMT_UPF);
+  ck_assert(pspio_pspdata_convert(PSPIO_FMT_UPF, filename, PSPIO_FMT_UPF, converted) == PSPIO_SUCCESS);
+  ck_assert(pspdata_same_file("test_convert_ref.tmp", converted));
+
+  sprintf(filename, "%s/%s", PSPIO_CHK_DATADIR, "nofile");
+  ck_assert(pspio_pspdata_convert(PSPIO_FMT_UPF, filename, PSPIO_FMT_UPF, converted) == PSPIO_ENOFILE);
+  pspio_error_free();
+}
+END_TEST
+
+START_TEST(test_pspdata_convert_batch)
+{
+  int i, status[4];
+  char src[4][200], dst[4][200];
+  const char *src_names[4], *dst_names[4];
+
+  for (i=0; i<4; i++) {
+    sprintf(src[i], "%s/%s", PSPIO_CHK_DATADIR, (i == 2) ? "nofile" : "fhi/Li.cpi");
+    sprintf(dst[i], "test_convert_batch_%d.tmp", i);
+    src_names[i] = src[i];
+    dst_names[i] = dst[i];
+  }
+  ck_assert(pspio_pspdata_convert_batch(4, PSPIO_FMT_FHI98PP, src_names,
+    PSPIO_FMT_FHI98PP, dst_names, status) == PSPIO_ENOFILE);
+  pspio_error_free();
+
+  ck_assert(status[0] == PSPIO_SUCCESS);
+  ck_assert(status[1] == PSPIO_SUCCESS);
+  ck_assert(status[2] == PSPIO_ENOFILE);
+  ck_assert(status[3] == PSPIO_SUCCESS);
+  ck_assert(pspdata_same_file(dst[0], dst[1]));
+  ck_assert(pspdata_same_file(dst[0], dst[3]));
+
+  /* Same output as a single conversion */
+  ck_assert(pspio_pspdata_convert(PSPIO_FMT_FHI98PP, src[0], PSPIO_FMT_FHI98PP, "test_convert_ref.tmp") == PSPIO_SUCCESS);
+  ck_assert(pspdata_same_file("test_convert_ref.tmp", dst[0]));
+}
+END_TEST
+
+START_TEST(test_pspdata_convert_formats)
+{
+  int i, j, ierr, status;
+  const char *src[3] = {"UPF/Li.UPF", "fhi/Li.cpi", "abinit6/03-Li.LDA.fhi"};
+  const int format[3] = {PSPIO_FMT_UPF, PSPIO_FMT_FHI98PP, PSPIO_FMT_ABINIT_6};
+
+  /* UPF files have no semilocal potentials to write as FHI98PP, and
+     FHI98PP files neither the local potential of UPF files nor the
+     atomic number of ABINIT files */
+  const int supported[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 1, 1}};
+  const char *src_names[1], *dst_names[1] = {"test_convert_pair.tmp"};
+  pspio_pspdata_t *source, *converted;
+  FILE *fp;
+
+  /* Every pair of formats either converts or is rejected cleanly */
+  for (i=0; i<3; i++) {
+    sprintf(filename, "%s/%s", PSPIO_CHK_DATADIR, src[i]);
+    source = NULL;
+    ck_assert(pspio_pspdata_alloc(&source) == PSPIO_SUCCESS);
+    ck_assert(pspio_pspdata_read(source, format[i], filename) == PSPIO_SUCCESS);
+    for (j=0; j<3; j++) {
+      remove(dst_names[0]);
+      ierr = pspio_pspdata_convert(format[i], filename, format[j], dst_names[0]);
+      pspio_error_free();
+
+      if ( !supported[i][j] ) {
+        ck_assert(ierr == PSPIO_ENOSUPPORT);
+        fp = fopen(dst_names[0], "r");
+        ck_assert(fp == NULL);
+        continue;
+      }
+
+      ck_assert(ierr == PSPIO_SUCCESS);
+      converted = NULL;
+      ck_assert(pspio_pspdata_alloc(&converted) == PSPIO_SUCCESS);
+      ck_assert(pspio_pspdata_read(converted, format[j], dst_names[0]) == PSPIO_SUCCESS);
+      ck_assert(pspio_pspdata_get_n_states(converted) == pspio_pspdata_get_n_states(source));
+      ck_assert(pspio_pspdata_get_l_max(converted) == pspio_pspdata_get_l_max(source));
+      ck_assert(pspio_pspdata_get_zvalence(converted) == pspio_pspdata_get_zvalence(source));
+      pspio_pspdata_free(converted);
+    }
+    pspio_pspdata_free(source);
+  }
+
+  /* Same through the batch conversion */
+  for (i=0; i<3; i++) {
+    sprintf(filename, "%s/%s", PSPIO_CHK_DATADIR, src[i]);
+    src_names[0] = filename;
+    for (j=0; j<3; j++) {
+      ierr = pspio_pspdata_convert_batch(1, format[i], src_names, format[j],
+        dst_names, &status);
+      pspio_error_free();
+      ck_assert(ierr == status);
+      ck_assert(status == (supported[i][j] ? PSPIO_SUCCESS : PSPIO_ENOSUPPORT));
+    }
+  }
+}
+END_TEST
+
+/* Returns 1 if both functions have exactly the same derivatives */
+static int pspdata_same_derivs(const pspio_meshfunc_t *f1, const pspio_meshfunc_t *f2)
+{
+  size_t size = pspio_mesh_get_np(pspio_meshfunc_get_mesh(f1)) * sizeof(double);
+
+  return (memcmp(pspio_meshfunc_get_deriv1(f1), pspio_meshfunc_get_deriv1(f2), size) == 0) &&
+    (memcmp(pspio_meshfunc_get_deriv2(f1), pspio_meshfunc_get_deriv2(f2), size) == 0) &&
+    (pspio_meshfunc_eval(f1, 0.123) == pspio_meshfunc_eval(f2, 0.123));
+}
+
+START_TEST(test_pspdata_read_parallel)
+{
+  int i, k, nthreads;
+  const char *files[2] = {"UPF/Xe.UPF", "fhi/Cu_nlcc.cpi"};
+  const int formats[2] = {PSPIO_FMT_UPF, PSPIO_FMT_FHI98PP};
+  pspio_pspdata_t *serial = NULL;
+
+  /* Building the interpolation in parallel gives the serial results */
+  for (k=0; k<2; k++) {
+    sprintf(filename, "%s/%s", PSPIO_CHK_DATADIR, files[k]);
+    pspio_pspdata_alloc(&serial);
+#if defined _OPENMP
+    nthreads = omp_get_max_threads();
+    omp_set_num_threads(1);
+#endif
+    ck_assert(pspio_pspdata_read(serial, formats[k], filename) == PSPIO_SUCCESS);
+#if defined _OPENMP
+    omp_set_num_threads((nthreads > 1) ? nthreads : 4);
+#endif
+    ck_assert(pspio_pspdata_read(pspdata, formats[k], filename) == PSPIO_SUCCESS);
+#if defined _OPENMP
+    omp_set_num_threads(nthreads);
+#else
+    nthreads = 1;
+    (void)nthreads;
+#endif
+
+    for (i=0; i<pspio_pspdata_get_n_states(pspdata); i++) {
+      ck_assert(pspdata_same_derivs(pspio_state_get_wf(pspio_pspdata_get_state(serial, i)),
+        pspio_state_get_wf(pspio_pspdata_get_state(pspdata, i))));
+    }
+    for (i=0; i<pspio_pspdata_get_n_potentials(pspdata); i++) {
+      ck_assert(pspdata_same_derivs(pspio_pspdata_get_potential(serial, i)->v,
+        pspio_pspdata_get_potential(pspdata, i)->v));
+    }
+    for (i=0; i<pspio_pspdata_get_n_projectors(pspdata); i++) {
+      ck_assert(pspdata_same_derivs(pspio_pspdata_get_projector(serial, i)->proj,
+        pspio_pspdata_get_projector(pspdata, i)->proj));
+    }
+    if ( pspio_pspdata_get_rho_valence(serial) != NULL ) {
+      ck_assert(pspdata_same_derivs(pspio_pspdata_get_rho_valence(serial),
+        pspio_pspdata_get_rho_valence(pspdata)));
+    }
+
+    pspio_pspdata_free(serial);
+    serial = NULL;
+    pspio_pspdata_free(pspdata);
+    pspdata = NULL;
+    pspio_pspdata_alloc(&pspdata);
+  }
+}
+END_TEST
+
+
+#if defined HAVE_XML
+/* Returns 1 if both functions hold exactly the same values */
+static int pspdata_same_values(const pspio_meshfunc_t *f1, const pspio_meshfunc_t *f2)
+{
+  size_t size = pspio_mesh_get_np(pspio_meshfunc_get_mesh(f1)) * sizeof(double);
+
+  return (pspio_mesh_get_np(pspio_meshfunc_get_mesh(f1)) ==
+          pspio_mesh_get_np(pspio_meshfunc_get_mesh(f2))) &&
+    (memcmp(pspio_meshfunc_get_function(f1), pspio_meshfunc_get_function(f2), size) == 0);
+}
+
+START_TEST(test_pspdata_psml_io)
+{
+  int i;
+  pspio_pspdata_t *upf = NULL;
+
+  /* Li.psml holds the data of Li.UPF, in Hartree and without r factors */
+  sprintf(filename, "%s/%s", PSPIO_CHK_DATADIR, "psml/Li.psml");
+  ck_assert(pspio_pspdata_read(pspdata, PSPIO_FMT_XML, filename) == PSPIO_SUCCESS);
+  sprintf(filename, "%s/%s", PSPIO_CHK_DATADIR, "UPF/Li.UPF");
+  pspio_pspdata_alloc(&upf);
+  ck_assert(pspio_pspdata_read(upf, PSPIO_FMT_UPF, filename) == PSPIO_SUCCESS);
+
+  ck_assert_str_eq(pspio_pspdata_get_symbol(pspdata), "Li");
+  ck_assert(pspio_pspdata_get_z(pspdata) == pspio_pspdata_get_z(upf));
+  ck_assert(pspio_pspdata_get_zvalence(pspdata) == pspio_pspdata_get_zvalence(upf));
+  ck_assert(pspio_pspdata_get_nelvalence(pspdata) == pspio_pspdata_get_nelvalence(upf));
+  ck_assert(pspio_pspdata_get_l_max(pspdata) == pspio_pspdata_get_l_max(upf));
+  ck_assert(pspio_pspdata_get_wave_eq(pspdata) == PSPIO_EQN_SCHRODINGER);
+  ck_assert(pspio_xc_get_exchange(pspio_pspdata_get_xc(pspdata)) ==
+    pspio_xc_get_exchange(pspio_pspdata_get_xc(upf)));
+  ck_assert(pspio_xc_get_correlation(pspio_pspdata_get_xc(pspdata)) ==
+    pspio_xc_get_correlation(pspio_pspdata_get_xc(upf)));
+  ck_assert(pspdata_same_values(pspio_xc_get_nlcc_density(pspio_pspdata_get_xc(pspdata)),
+    pspio_xc_get_nlcc_density(pspio_pspdata_get_xc(upf))));
+
+  /* The grid is given without its derivative */
+  ck_assert(pspio_mesh_get_np(pspio_pspdata_get_mesh(pspdata)) == 200);
+  ck_assert(memcmp(pspio_mesh_get_r(pspio_pspdata_get_mesh(pspdata)),
+    pspio_mesh_get_r(pspio_pspdata_get_mesh(upf)), 200*sizeof(double)) == 0);
+
+  ck_assert(pspio_pspdata_get_n_states(pspdata) == pspio_pspdata_get_n_states(upf));
+  for (i=0; i<pspio_pspdata_get_n_states(pspdata); i++) {
+    ck_assert(pspio_qn_cmp(pspio_state_get_qn(pspio_pspdata_get_state(pspdata, i)),
+      pspio_state_get_qn(pspio_pspdata_get_state(upf, i))) == PSPIO_EQUAL);
+    ck_assert(pspio_state_get_occ(pspio_pspdata_get_state(pspdata, i)) ==
+      pspio_state_get_occ(pspio_pspdata_get_state(upf, i)));
+    ck_assert(pspdata_same_values(pspio_state_get_wf(pspio_pspdata_get_state(pspdata, i)),
+      pspio_state_get_wf(pspio_pspdata_get_state(upf, i))));
+  }
+  ck_assert(pspio_pspdata_get_n_projectors(pspdata) == 1);
+  ck_assert(pspdata_same_values(pspio_pspdata_get_projector(pspdata, 0)->proj,
+    pspio_pspdata_get_projector(upf, 0)->proj));
+  ck_assert(pspio_pspdata_get_projector_energy(pspdata, 0, 0) ==
+    pspio_pspdata_get_projector_energy(upf, 0, 0));
+  ck_assert(pspdata_same_values(pspio_pspdata_get_vlocal(pspdata)->v,
+    pspio_pspdata_get_vlocal(upf)->v));
+  ck_assert(pspdata_same_values(pspio_pspdata_get_rho_valence(pspdata),
+    pspio_pspdata_get_rho_valence(upf)));
+
+  pspio_pspdata_free(upf);
+}
+END_TEST
+
+START_TEST(test_pspdata_psml_guess)
+{
+  sprintf(filename, "%s/%s", PSPIO_CHK_DATADIR, "psml/Li.psml");
+  ck_assert(pspio_pspdata_read(pspdata, PSPIO_FMT_UNKNOWN, filename) == PSPIO_SUCCESS);
+  ck_assert(pspio_pspdata_get_format_guessed(pspdata) == PSPIO_FMT_XML);
+
+  /* The header stops at the grid */
+  pspio_pspdata_free(pspdata);
+  pspdata = NULL;
+  pspio_pspdata_alloc(&pspdata);
+  ck_assert(pspio_pspdata_read_header(pspdata, PSPIO_FMT_UNKNOWN, filename) == PSPIO_SUCCESS);
+  ck_assert(pspio_pspdata_get_format_guessed(pspdata) == PSPIO_FMT_XML);
+  ck_assert(pspio_pspdata_get_np(pspdata) == 200);
+  ck_assert(pspio_pspdata_get_mesh(pspdata) == NULL);
+  ck_assert(pspio_pspdata_get_zvalence(pspdata) == 1.0);
+  ck_assert(pspio_xc_has_nlcc(pspio_pspdata_get_xc(pspdata)));
+
+  /* Sections that are not wanted are skipped */
+  pspio_pspdata_free(pspdata);
+  pspdata = NULL;
+  pspio_pspdata_alloc(&pspdata);
+  ck_assert(pspio_pspdata_read_select(pspdata, PSPIO_FMT_XML, filename, PSPIO_LOAD_VLOCAL) == PSPIO_SUCCESS);
+  ck_assert(pspio_pspdata_get_vlocal(pspdata) != NULL);
+  ck_assert(pspio_pspdata_get_n_states(pspdata) == 0);
+  ck_assert(pspio_pspdata_get_n_projectors(pspdata) == 0);
+  ck_assert(pspio_pspdata_get_rho_valence(pspdata) == NULL);
+}
+END_TEST
+
+/* Writes a small PSML file around the given functions */
+static void pspdata_psml_file(const char *name, const char *funcs)
+{
+  FILE *fp = fopen(name, "w");
+
+  ck_assert(fp != NULL);
+  fprintf(fp, "<?xml version=\"1.0\"?>\n<psml version=\"1.1\">\n"
+    "<provenance creator=\"ONCVPSP-3.3.0\" date=\"2018-03-06\"/>\n"
+    "<pseudo-atom-spec atomic-label=\"C\" atomic-number=\"6\" z-pseudo=\"4\""
+    " relativity=\"dirac\" core-corrections=\"no\">\n"
+    "<exchange-correlation><libxc-info number-of-functionals=\"2\">"
+    "<functional type=\"exchange\" id=\"101\"/>"
+    "<functional type=\"correlation\" id=\"130\"/></libxc-info></exchange-correlation>\n"
+    "<valence-configuration total-valence-charge=\"4\">"
+    "<shell n=\"2\" l=\"s\" occupation=\"2\"/><shell n=\"2\" l=\"p\" occupation=\"2\"/>"
+    "</valence-configuration>\n</pseudo-atom-spec>\n"
+    "<grid npts=\"4\"><grid-data>0.5 1.0\n1.5 2.0</grid-data></grid>\n%s</psml>\n", funcs);
+  fclose(fp);
+}
+
+START_TEST(test_pspdata_psml_sets)
+{
+  const pspio_potential_t *potential;
+
+  /* Short data blocks are padded, later sets of a kind are skipped */
+  pspdata_psml_file("test_psml.tmp",
+    "<semilocal-potentials set=\"lj\">\n"
+    "<slps l=\"s\" n=\"1\" j=\"0.5\"><radfunc><data>-1 -2 -3 -4</data></radfunc></slps>\n"
+    "<slps l=\"p\" n=\"2\" j=\"1.5\"><radfunc><data>-5 -6</data></radfunc></slps>\n"
+    "</semilocal-potentials>\n"
+    "<semilocal-potentials set=\"scalar_relativistic\">\n"
+    "<slps l=\"s\" n=\"1\"><radfunc><data>7 7 7 7</data></radfunc></slps>\n"
+    "</semilocal-potentials>\n"
+    "<nonlocal-projectors set=\"lj\">\n"
+    "<proj l=\"s\" seq=\"1\" j=\"0.5\" ekb=\"2.5\"><radfunc><data>1 2 3 4</data></radfunc></proj>\n"
+    "<proj l=\"d\" seq=\"1\" j=\"2.5\" ekb=\"-0.5\"><radfunc><data>4 3 2 1</data></radfunc></proj>\n"
+    "</nonlocal-projectors>\n");
+  ck_assert(pspio_pspdata_read(pspdata, PSPIO_FMT_XML, "test_psml.tmp") == PSPIO_SUCCESS);
+  ck_assert_str_eq(pspio_pspdata_get_symbol(pspdata), "C");
+  ck_assert(pspio_pspdata_get_wave_eq(pspdata) == PSPIO_EQN_DIRAC);
+  ck_assert(pspio_pspdata_get_scheme(pspdata) == PSPIO_SCM_ONCV);
+  ck_assert(pspio_xc_get_exchange(pspio_pspdata_get_xc(pspdata)) == 101);
+  ck_assert(pspio_xc_get_correlation(pspio_pspdata_get_xc(pspdata)) == 130);
+  ck_assert(pspio_pspdata_get_n_potentials(pspdata) == 2);
+  potential = pspio_pspdata_get_potential(pspdata, 1);
+  ck_assert(pspio_qn_get_l(pspio_potential_get_qn(potential)) == 1);
+  ck_assert(pspio_qn_get_j(pspio_potential_get_qn(potential)) == 1.5);
+  ck_assert(pspio_meshfunc_get_function(potential->v)[1] == -6.0);
+  ck_assert(pspio_meshfunc_get_function(potential->v)[3] == 0.0);
+  ck_assert(pspio_meshfunc_get_function(pspio_pspdata_get_potential(pspdata, 0)->v)[0] == -1.0);
+  ck_assert(pspio_pspdata_get_n_projectors(pspdata) == 2);
+  ck_assert(pspio_pspdata_get_projectors_l_max(pspdata) == 2);
+  ck_assert(pspio_pspdata_get_l_max(pspdata) == 2);
+  ck_assert(pspio_pspdata_get_projector_energy(pspdata, 1, 1) == -0.5);
+  ck_assert(pspio_pspdata_get_projector_energy(pspdata, 0, 1) == 0.0);
+  ck_assert(pspio_pspdata_get_vlocal(pspdata) == NULL);
+}
+END_TEST
+
+START_TEST(test_pspdata_psml_errors)
+{
+  FILE *fp;
+
+  /* Too many numbers */
+  pspdata_psml_file("test_psml.tmp",
+    "<local-potential><radfunc><data>1 2 3 4 5</data></radfunc></local-potential>\n");
+  ck_assert(pspio_pspdata_read(pspdata, PSPIO_FMT_XML, "test_psml.tmp") == PSPIO_EFILE_CORRUPT);
+
+  /* Not a number */
+  pspio_pspdata_free(pspdata);
+  pspdata = NULL;
+  pspio_pspdata_alloc(&pspdata);
+  pspdata_psml_file("test_psml.tmp",
+    "<local-potential><radfunc><data>1 2 x 4</data></radfunc></local-potential>\n");
+  ck_assert(pspio_pspdata_read(pspdata, PSPIO_FMT_XML, "test_psml.tmp") == PSPIO_EFILE_CORRUPT);
+
+  /* Grids local to a function */
+  pspio_pspdata_free(pspdata);
+  pspdata = NULL;
+  pspio_pspdata_alloc(&pspdata);
+  pspdata_psml_file("test_psml.tmp",
+    "<local-potential><grid npts=\"2\"><grid-data>1 2</grid-data></grid>"
+    "<radfunc><data>1 2</data></radfunc></local-potential>\n");
+  ck_assert(pspio_pspdata_read(pspdata, PSPIO_FMT_XML, "test_psml.tmp") == PSPIO_ENOSUPPORT);
+
+  /* More than one atom */
+  pspio_pspdata_free(pspdata);
+  pspdata = NULL;
+  pspio_pspdata_alloc(&pspdata);
+  pspdata_psml_file("test_psml.tmp",
+    "<pseudo-atom-spec atomic-label=\"C\" atomic-number=\"6\" z-pseudo=\"4\"/>\n");
+  ck_assert(pspio_pspdata_read(pspdata, PSPIO_FMT_XML, "test_psml.tmp") == PSPIO_EFILE_CORRUPT);
+
+  /* Core charge before the atom it belongs to */
+  pspio_pspdata_free(pspdata);
+  pspdata = NULL;
+  pspio_pspdata_alloc(&pspdata);
+  fp = fopen("test_psml.tmp", "w");
+  ck_assert(fp != NULL);
+  fprintf(fp, "<?xml version=\"1.0\"?>\n<psml version=\"1.1\">\n"
+    "<grid npts=\"4\"><grid-data>0.5 1.0 1.5 2.0</grid-data></grid>\n"
+    "<pseudocore-charge><radfunc><data>1 2 3 4</data></radfunc></pseudocore-charge>\n"
+    "</psml>\n");
+  fclose(fp);
+  ck_assert(pspio_pspdata_read(pspdata, PSPIO_FMT_XML, "test_psml.tmp") == PSPIO_EFILE_CORRUPT);
+
+  /* Other XML documents and broken files */
+  pspio_pspdata_free(pspdata);
+  pspdata = NULL;
+  pspio_pspdata_alloc(&pspdata);
+  sprintf(filename, "%s/%s", PSPIO_CHK_DATADIR, "UPF/Li.UPF");
+  ck_assert(pspio_pspdata_read(pspdata, PSPIO_FMT_XML, filename) == PSPIO_EFILE_FORMAT);
+  pspio_pspdata_free(pspdata);
+  pspdata = NULL;
+  pspio_pspdata_alloc(&pspdata);
+  pspdata_psml_file("test_psml.tmp", "<local-potential><radfunc><data>1 2 3 4</data>\n");
+  ck_assert(pspio_pspdata_read(pspdata, PSPIO_FMT_XML, "test_psml.tmp") == PSPIO_EFILE_FORMAT);
+  pspio_error_free();
+}
+END_TEST
+#else
+START_TEST(test_pspdata_psml_nosupport)
+{
+  sprintf(filename, "%s/%s", PSPIO_CHK_DATADIR, "psml/Li.psml");
+  ck_assert(pspio_pspdata_read(pspdata, PSPIO_FMT_XML, filename) == PSPIO_ENOSUPPORT);
+  pspio_error_free();
+}
+END_TEST
+#endif
 
 Suite * make_pspdata_suite(void)
 {
@@ -393,6 +1448,7 @@ Suite * make_pspdata_suite(void)
   tcase_add_test(tc_setget, test_pspdata_setget_vlocal);
   tcase_add_test(tc_setget, test_pspdata_setget_xc);
   tcase_add_test(tc_setget, test_pspdata_setget_rho_valence);
+  tcase_add_test(tc_setget, test_pspdata_take);
   suite_add_tcase(s, tc_setget);
 
   tc_io = tcase_create("File parsing and writing");
@@ -403,6 +1459,28 @@ Suite * make_pspdata_suite(void)
   tcase_add_test(tc_io, test_pspdata_abinit6_guess);
   tcase_add_test(tc_io, test_pspdata_upf_io);
   tcase_add_test(tc_io, test_pspdata_upf_guess);
+  tcase_add_test(tc_io, test_pspdata_memory_usage);
+  tcase_add_test(tc_io, test_pspdata_convert);
+  tcase_add_test(tc_io, test_pspdata_convert_batch);
+  tcase_add_test(tc_io, test_pspdata_convert_formats);
+  tcase_add_test(tc_io, test_pspdata_read_parallel);
+  tcase_add_test(tc_io, test_pspdata_index);
+  tcase_add_test(tc_io, test_pspdata_hash_cmp);
+  tcase_add_test(tc_io, test_pspdata_read_header);
+  tcase_add_test(tc_io, test_pspdata_read_select);
+  tcase_add_test(tc_io, test_pspdata_read_async);
+  tcase_add_test(tc_io, test_pspdata_write_buffer);
+#if defined HAVE_ZLIB
+  tcase_add_test(tc_io, test_pspdata_read_compressed);
+#endif
+#if defined HAVE_XML
+  tcase_add_test(tc_io, test_pspdata_psml_io);
+  tcase_add_test(tc_io, test_pspdata_psml_guess);
+  tcase_add_test(tc_io, test_pspdata_psml_sets);
+  tcase_add_test(tc_io, test_pspdata_psml_errors);
+#else
+  tcase_add_test(tc_io, test_pspdata_psml_nosupport);
+#endif
   suite_add_tcase(s, tc_io);
 
   return s;
@@ -0,0 +1,216 @@
+/* Copyright (C) 2018 Micael Oliveira <micael.oliveira@mpsd.mpg.de>
+ *                    Yann Pouillon <devops@materialsevolution.es>
+ *
+ * This file is part of Libpspio.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * version 2.0. If a copy of the MPL was not distributed with this file, You
+ * can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Libpspio is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the Mozilla Public License version 2.0 for
+ * more details.
+ */
+
+/**
+ * @file check_pspio_resample.c
+ * @brief checks pspio_resample.c and pspio_resample.h
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <check.h>
+
+#include "pspio_error.h"
+#include "pspio_resample.h"
+#include "pspio_pspdata.h"
+
+#if defined HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#define NP_SRC 51
+#define NP_DST 37
+
+static pspio_mesh_t *src = NULL, *dst = NULL;
+static pspio_resample_t *plan = NULL;
+static pspio_pspdata_t *pspdata = NULL, *pspdata_ref = NULL;
+
+static char filename[200];
+
+
+void resample_setup(void)
+{
+  pspio_mesh_free(src);
+  src = NULL;
+  pspio_mesh_alloc(&src, NP_SRC);
+  pspio_mesh_init_from_parameters(src, PSPIO_MESH_LOG1, 0.1, 0.01);
+
+  /* Goes beyond both ends of the source mesh */
+  pspio_mesh_free(dst);
+  dst = NULL;
+  pspio_mesh_alloc(&dst, NP_DST);
+  pspio_mesh_init_from_parameters(dst, PSPIO_MESH_LINEAR, 0.005, 0.001);
+
+  pspio_resample_free(plan);
+  plan = NULL;
+  pspio_resample_alloc(&plan);
+}
+
+void resample_teardown(void)
+{
+  pspio_resample_free(plan);
+  plan = NULL;
+  pspio_mesh_free(dst);
+  dst = NULL;
+  pspio_mesh_free(src);
+  src = NULL;
+}
+
+void resample_pspdata_setup(void)
+{
+  pspio_pspdata_free(pspdata);
+  pspdata = NULL;
+  pspio_pspdata_alloc(&pspdata);
+  pspio_pspdata_free(pspdata_ref);
+  pspdata_ref = NULL;
+  pspio_pspdata_alloc(&pspdata_ref);
+  pspio_mesh_free(dst);
+  dst = NULL;
+}
+
+void resample_pspdata_teardown(void)
+{
+  pspio_mesh_free(dst);
+  dst = NULL;
+  pspio_pspdata_free(pspdata_ref);
+  pspdata_ref = NULL;
+  pspio_pspdata_free(pspdata);
+  pspdata = NULL;
+}
+
+static void resample_compare(const pspio_meshfunc_t *ref, const pspio_meshfunc_t *func)
+{
+  int k;
+  const double *r = pspio_mesh_get_r(dst);
+
+  ck_assert(pspio_mesh_get_np(pspio_meshfunc_get_mesh(func)) == NP_DST);
+  for (k=0; k<NP_DST; k++) {
+    ck_assert(fabs(pspio_meshfunc_get_function(func)[k] - pspio_meshfunc_eval(ref, r[k])) <= 1.0e-10);
+    ck_assert(fabs(pspio_meshfunc_get_deriv1(func)[k] - pspio_meshfunc_eval_deriv(ref, r[k])) <= 1.0e-8);
+    ck_assert(fabs(pspio_meshfunc_get_deriv2(func)[k] - pspio_meshfunc_eval_deriv2(ref, r[k])) <= 1.0e-6);
+  }
+}
+
+
+START_TEST(test_resample_alloc)
+{
+  ck_assert(plan->np == 0);
+  ck_assert(plan->w == NULL);
+}
+END_TEST
+
+START_TEST(test_resample_method)
+{
+  ck_assert(pspio_resample_init(plan, src, dst, PSPIO_INTERP_JB_CSPLINE + 100) == PSPIO_ENOSUPPORT);
+  pspio_error_free();
+}
+END_TEST
+
+START_TEST(test_resample_identity)
+{
+  int k;
+  double f[NP_SRC], g[NP_SRC];
+  const double *fl[1] = {f};
+  double *gl[1] = {g};
+  const double *r = pspio_mesh_get_r(src);
+
+  for (k=0; k<NP_SRC; k++) f[k] = exp(-r[k]) * r[k];
+  ck_assert(pspio_resample_init(plan, src, src, PSPIO_INTERP_JB_CSPLINE) == PSPIO_SUCCESS);
+  ck_assert(pspio_resample_apply(plan, 1, fl, gl) == PSPIO_SUCCESS);
+  for (k=0; k<NP_SRC; k++) {
+    ck_assert(g[k] == f[k]);
+  }
+}
+END_TEST
+
+START_TEST(test_resample_meshfunc)
+{
+  int k;
+  double f[NP_SRC], g[2][NP_DST];
+  const double *fl[2];
+  double *gl[2] = {g[0], g[1]};
+  const double *r = pspio_mesh_get_r(src);
+  const double *rd = pspio_mesh_get_r(dst);
+  pspio_meshfunc_t *func = NULL;
+
+  for (k=0; k<NP_SRC; k++) f[k] = exp(-r[k]) * r[k];
+  ck_assert(pspio_meshfunc_alloc(&func, NP_SRC) == PSPIO_SUCCESS);
+  ck_assert(pspio_meshfunc_init(func, src, f, NULL, NULL) == PSPIO_SUCCESS);
+
+  /* The same plan serves several functions */
+  fl[0] = pspio_meshfunc_get_function(func);
+  fl[1] = pspio_meshfunc_get_deriv1(func);
+  ck_assert(pspio_resample_init(plan, src, dst, PSPIO_INTERP_JB_CSPLINE) == PSPIO_SUCCESS);
+  ck_assert(pspio_resample_apply(plan, 2, fl, gl) == PSPIO_SUCCESS);
+  for (k=0; k<NP_DST; k++) {
+    ck_assert(fabs(g[0][k] - pspio_meshfunc_eval(func, rd[k])) <= 1.0e-12);
+    ck_assert(fabs(g[1][k] - pspio_meshfunc_eval_deriv(func, rd[k])) <= 1.0e-10);
+  }
+
+  pspio_meshfunc_free(func);
+}
+END_TEST
+
+START_TEST(test_resample_pspdata)
+{
+  int i;
+
+  sprintf(filename, "%s/%s", PSPIO_CHK_DATADIR, "UPF/Li.UPF");
+  ck_assert(pspio_pspdata_read(pspdata, PSPIO_FMT_UPF, filename) == PSPIO_SUCCESS);
+  ck_assert(pspio_pspdata_read(pspdata_ref, PSPIO_FMT_UPF, filename) == PSPIO_SUCCESS);
+
+  pspio_mesh_alloc(&dst, NP_DST);
+  pspio_mesh_init_from_parameters(dst, PSPIO_MESH_LINEAR, 0.25, 0.0);
+  ck_assert(pspio_pspdata_resample(pspdata, dst, PSPIO_INTERP_JB_CSPLINE) == PSPIO_SUCCESS);
+  ck_assert(pspio_mesh_cmp(pspio_pspdata_get_mesh(pspdata), dst) == PSPIO_EQUAL);
+
+  for (i=0; i<pspio_pspdata_get_n_states(pspdata); i++) {
+    resample_compare(pspio_state_get_wf(pspio_pspdata_get_state(pspdata_ref, i)),
+                     pspio_state_get_wf(pspio_pspdata_get_state(pspdata, i)));
+  }
+  for (i=0; i<pspio_pspdata_get_n_projectors(pspdata); i++) {
+    resample_compare(pspio_pspdata_get_projector(pspdata_ref, i)->proj,
+                     pspio_pspdata_get_projector(pspdata, i)->proj);
+  }
+  resample_compare(pspio_pspdata_get_vlocal(pspdata_ref)->v,
+                   pspio_pspdata_get_vlocal(pspdata)->v);
+  resample_compare(pspio_pspdata_get_rho_valence(pspdata_ref),
+                   pspio_pspdata_get_rho_valence(pspdata));
+}
+END_TEST
+
+
+Suite * make_resample_suite(void)
+{
+  Suite *s;
+  TCase *tc_plan, *tc_pspdata;
+
+  s = suite_create("Resample");
+
+  tc_plan = tcase_create("Plan");
+  tcase_add_checked_fixture(tc_plan, resample_setup, resample_teardown);
+  tcase_add_test(tc_plan, test_resample_alloc);
+  tcase_add_test(tc_plan, test_resample_method);
+  tcase_add_test(tc_plan, test_resample_identity);
+  tcase_add_test(tc_plan, test_resample_meshfunc);
+  suite_add_tcase(s, tc_plan);
+
+  tc_pspdata = tcase_create("Pspdata");
+  tcase_add_checked_fixture(tc_pspdata, resample_pspdata_setup, resample_pspdata_teardown);
+  tcase_add_test(tc_pspdata, test_resample_pspdata);
+  suite_add_tcase(s, tc_pspdata);
+
+  return s;
+}
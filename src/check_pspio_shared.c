@@ -0,0 +1,271 @@
+/* Copyright (C) 2018 Micael Oliveira <micael.oliveira@mpsd.mpg.de>
+ *                    Yann Pouillon <devops@materialsevolution.es>
+ *
+ * This file is part of Libpspio.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * version 2.0. If a copy of the MPL was not distributed with this file, You
+ * can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Libpspio is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the Mozilla Public License version 2.0 for
+ * more details.
+ */
+
+/**
+ * @file check_pspio_shared.c
+ * @brief checks pspio_shared.c and pspio_shared.h
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <check.h>
+
+#include "pspio_error.h"
+#include "pspio_packed.h"
+#include "pspio_shared.h"
+
+#if defined HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+static pspio_pspdata_t *pspdata = NULL;
+static pspio_packed_t *packed = NULL;
+static pspio_shared_t *shared = NULL;
+
+static char filename[200];
+static char segment[64];
+
+
+void shared_setup(void)
+{
+  sprintf(segment, "/pspio_check_%ld", (long)getpid());
+  pspio_shared_unlink(segment);
+  pspio_error_free();
+
+  pspio_pspdata_alloc(&pspdata);
+  sprintf(filename, "%s/%s", PSPIO_CHK_DATADIR, "UPF/Li.UPF");
+  ck_assert(pspio_pspdata_read(pspdata, PSPIO_FMT_UPF, filename) == PSPIO_SUCCESS);
+  pspio_packed_alloc(&packed);
+  ck_assert(pspio_packed_init(packed, pspdata) == PSPIO_SUCCESS);
+  pspio_shared_alloc(&shared);
+}
+
+void shared_teardown(void)
+{
+  pspio_shared_free(shared);
+  shared = NULL;
+  pspio_packed_free(packed);
+  packed = NULL;
+  pspio_pspdata_free(pspdata);
+  pspdata = NULL;
+
+  pspio_shared_unlink(segment);
+  pspio_error_free();
+}
+
+/* Returns 1 if a view evaluates as the local packed structure */
+static int shared_same_eval(const pspio_packed_t *view)
+{
+  int j, m;
+  double r, f1[16], f2[16], fp1[16], fp2[16];
+  const double *rm;
+
+  if ( (pspio_packed_get_n_states(view) != pspio_packed_get_n_states(packed)) ||
+       (pspio_packed_get_n_projectors(view) != pspio_packed_get_n_projectors(packed)) ||
+       (pspio_packed_get_n_states(view) > 16) ||
+       (pspio_packed_get_n_projectors(view) > 16) ) {
+    return 0;
+  }
+
+  rm = pspio_mesh_get_r(pspio_packed_get_mesh(packed));
+  for (m=0; m<=8; m++) {
+    r = rm[0]*0.5 + m*(rm[pspio_packed_get_np(packed)-1]*1.1)/8.0;
+    pspio_packed_eval_states(view, r, f1, fp1);
+    pspio_packed_eval_states(packed, r, f2, fp2);
+    for (j=0; j<pspio_packed_get_n_states(view); j++) {
+      if ( (f1[j] != f2[j]) || (fp1[j] != fp2[j]) ) return 0;
+    }
+    pspio_packed_eval_projectors(view, r, f1, NULL);
+    pspio_packed_eval_projectors(packed, r, f2, NULL);
+    for (j=0; j<pspio_packed_get_n_projectors(view); j++) {
+      if ( f1[j] != f2[j] ) return 0;
+    }
+  }
+
+  return 1;
+}
+
+/* Returns 1 if the values of a function match a published array */
+static int shared_same_values(const pspio_meshfunc_t *func, const double *values)
+{
+  int i;
+  const double *f;
+
+  if ( (func == NULL) || (values == NULL) ) return (func == NULL) && (values == NULL);
+  f = pspio_meshfunc_get_function(func);
+  for (i=0; i<pspio_mesh_get_np(pspio_meshfunc_get_mesh(func)); i++) {
+    if ( f[i] != values[i] ) return 0;
+  }
+
+  return 1;
+}
+
+/* Returns 1 if a view holds the data of pspdata that is not packed */
+static int shared_same_data(const pspio_shared_t *view)
+{
+  int i, j, n;
+  const double *dij;
+  const pspio_xc_t *xc = pspio_pspdata_get_xc(pspdata);
+
+  if ( (pspio_shared_get_l_local(view) != pspio_pspdata_get_l_local(pspdata)) ||
+       (pspio_shared_get_exchange(view) != pspio_xc_get_exchange(xc)) ||
+       (pspio_shared_get_correlation(view) != pspio_xc_get_correlation(xc)) ||
+       (pspio_shared_get_nlcc_scheme(view) != pspio_xc_get_nlcc_scheme(xc)) ) {
+    return 0;
+  }
+  if ( !shared_same_values(pspio_potential_get_v(pspio_pspdata_get_vlocal(pspdata)),
+         pspio_shared_get_vlocal(view)) ||
+       !shared_same_values(pspio_xc_get_nlcc_density(xc),
+         pspio_shared_get_nlcc_density(view)) ||
+       !shared_same_values(pspio_pspdata_get_rho_valence(pspdata),
+         pspio_shared_get_rho_valence(view)) ) {
+    return 0;
+  }
+
+  dij = pspio_shared_get_projector_energies(view);
+  n = pspio_pspdata_get_n_projectors(pspdata);
+  if ( (dij == NULL) || (n == 0) ) return 0;
+  for (i=0; i<n; i++) {
+    for (j=0; j<n; j++) {
+      if ( dij[i*n+j] != pspio_pspdata_get_projector_energy(pspdata, i, j) ) return 0;
+    }
+  }
+
+  return 1;
+}
+
+START_TEST(test_shared_alloc)
+{
+  ck_assert(pspio_shared_get_name(shared) == NULL);
+  ck_assert(pspio_shared_get_size(shared) == 0);
+}
+END_TEST
+
+#if defined HAVE_SHM_OPEN
+START_TEST(test_shared_publish)
+{
+  pspio_shared_t *other = NULL;
+
+  ck_assert(pspio_shared_publish(shared, segment, pspdata) == PSPIO_SUCCESS);
+  ck_assert_str_eq(pspio_shared_get_name(shared), segment);
+  ck_assert(pspio_shared_get_size(shared) > 0);
+  ck_assert_str_eq(pspio_shared_get_symbol(shared), "Li");
+  ck_assert(pspio_shared_get_z(shared) == pspio_pspdata_get_z(pspdata));
+  ck_assert(pspio_shared_get_zvalence(shared) == pspio_pspdata_get_zvalence(pspdata));
+  ck_assert(pspio_shared_get_format(shared) == PSPIO_FMT_UPF);
+  ck_assert(pspio_mesh_cmp(pspio_shared_get_mesh(shared),
+    pspio_pspdata_get_mesh(pspdata)) == PSPIO_EQUAL);
+  ck_assert(shared_same_eval(pspio_shared_get_packed(shared)));
+
+  /* Names are not reused */
+  pspio_shared_alloc(&other);
+  ck_assert(pspio_shared_publish(other, segment, pspdata) == PSPIO_EVALUE);
+  pspio_error_free();
+  pspio_shared_free(other);
+}
+END_TEST
+
+START_TEST(test_shared_attach)
+{
+  pspio_shared_t *view = NULL;
+
+  ck_assert(pspio_shared_publish(shared, segment, pspdata) == PSPIO_SUCCESS);
+
+  /* A second mapping, at another address */
+  pspio_shared_alloc(&view);
+  ck_assert(pspio_shared_attach(view, segment) == PSPIO_SUCCESS);
+  ck_assert(pspio_shared_get_packed(view)->states != pspio_shared_get_packed(shared)->states);
+  ck_assert(pspio_shared_get_size(view) == pspio_shared_get_size(shared));
+  ck_assert(pspio_shared_get_l_max(view) == pspio_pspdata_get_l_max(pspdata));
+  ck_assert(pspio_mesh_cmp(pspio_shared_get_mesh(view),
+    pspio_pspdata_get_mesh(pspdata)) == PSPIO_EQUAL);
+  ck_assert(shared_same_eval(pspio_shared_get_packed(view)));
+  ck_assert(pspio_shared_get_vlocal(view) != NULL);
+  ck_assert(pspio_shared_get_rho_valence(view) != NULL);
+  ck_assert(shared_same_data(view));
+
+  /* The view survives the publisher and the removal of the name */
+  pspio_shared_free(shared);
+  shared = NULL;
+  ck_assert(pspio_shared_unlink(segment) == PSPIO_SUCCESS);
+  ck_assert(shared_same_eval(pspio_shared_get_packed(view)));
+  pspio_shared_free(view);
+  view = NULL;
+
+  pspio_shared_alloc(&view);
+  ck_assert(pspio_shared_attach(view, segment) == PSPIO_ENOFILE);
+  pspio_error_free();
+  pspio_shared_free(view);
+}
+END_TEST
+
+START_TEST(test_shared_processes)
+{
+  int k, status, ok, ierr;
+  pid_t pids[4];
+  pspio_shared_t *view;
+
+  /*
+   * Each process attaches by name and evaluates on its own mapping,
+   * racing the publisher: it only retries until the name exists
+   */
+  for (k=0; k<4; k++) {
+    pids[k] = fork();
+    ck_assert(pids[k] >= 0);
+    if ( pids[k] == 0 ) {
+      view = NULL;
+      pspio_shared_alloc(&view);
+      while ( (ierr = pspio_shared_attach(view, segment)) == PSPIO_ENOFILE ) {
+        pspio_error_free();
+        usleep(100);
+      }
+      ok = (ierr == PSPIO_SUCCESS) &&
+        shared_same_eval(pspio_shared_get_packed(view)) && shared_same_data(view);
+      pspio_shared_free(view);
+      _exit(ok ? 0 : 1);
+    }
+  }
+  ck_assert(pspio_shared_publish(shared, segment, pspdata) == PSPIO_SUCCESS);
+  for (k=0; k<4; k++) {
+    ck_assert(waitpid(pids[k], &status, 0) == pids[k]);
+    ck_assert(WIFEXITED(status) && (WEXITSTATUS(status) == 0));
+  }
+}
+END_TEST
+#endif
+
+
+Suite * make_shared_suite(void)
+{
+  Suite *s;
+  TCase *tc_seg;
+
+  s = suite_create("Shared");
+
+  tc_seg = tcase_create("Segments");
+  tcase_add_checked_fixture(tc_seg, shared_setup, shared_teardown);
+  tcase_add_test(tc_seg, test_shared_alloc);
+#if defined HAVE_SHM_OPEN
+  tcase_add_test(tc_seg, test_shared_publish);
+  tcase_add_test(tc_seg, test_shared_attach);
+  tcase_add_test(tc_seg, test_shared_processes);
+#endif
+  suite_add_tcase(s, tc_seg);
+
+  return s;
+}
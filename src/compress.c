@@ -0,0 +1,304 @@
+/* Copyright (C) 2018 Micael Oliveira <micael.oliveira@mpsd.mpg.de>
+ *                    Yann Pouillon <devops@materialsevolution.es>
+ *
+ * This file is part of Libpspio.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * version 2.0. If a copy of the MPL was not distributed with this file, You
+ * can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Libpspio is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the Mozilla Public License version 2.0 for
+ * more details.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "compress.h"
+#include "pspio_error.h"
+
+#if defined HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#if defined HAVE_POSIX_FADVISE
+#include <fcntl.h>
+#endif
+#if defined HAVE_ZLIB
+#include <zlib.h>
+#endif
+#if defined HAVE_LZMA
+#include <lzma.h>
+#endif
+#if defined HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+
+/**********************************************************************
+ * Data structures                                                    *
+ **********************************************************************/
+
+/* Size of the chunks read from compressed files */
+#define COMPRESS_CHUNK 65536
+
+/* Growable buffer receiving the decompressed data */
+typedef struct{
+  char *data;
+  size_t size;
+  size_t capacity;
+} compress_buffer_t;
+
+
+/**********************************************************************
+ * Private routines                                                   *
+ **********************************************************************/
+
+/* Makes room for at least n more bytes and returns where they go */
+static char *compress_reserve(compress_buffer_t *buf, size_t n)
+{
+  if ( buf->size + n > buf->capacity ) {
+    while ( buf->size + n > buf->capacity ) {
+      buf->capacity = (buf->capacity == 0) ? 4*COMPRESS_CHUNK : 2*buf->capacity;
+    }
+    buf->data = (char *) realloc (buf->data, buf->capacity);
+    FULFILL_OR_EXIT( buf->data != NULL, PSPIO_ENOMEM );
+  }
+
+  return buf->data + buf->size;
+}
+
+#if defined HAVE_ZLIB
+static int compress_gunzip(FILE *raw, compress_buffer_t *buf)
+{
+  int ret;
+  size_t n;
+  unsigned char in[COMPRESS_CHUNK];
+  z_stream zs;
+
+  memset(&zs, 0, sizeof(zs));
+  /* 32 lets zlib recognize the gzip header */
+  FULFILL_OR_RETURN( inflateInit2(&zs, 15 + 32) == Z_OK, PSPIO_ERROR );
+
+  ret = Z_OK;
+  while ( (n = fread(in, 1, sizeof(in), raw)) > 0 ) {
+    zs.next_in = in;
+    zs.avail_in = (uInt)n;
+    while ( zs.avail_in > 0 ) {
+      /* Concatenated members are decompressed one after the other */
+      if ( ret == Z_STREAM_END ) inflateReset(&zs);
+      zs.next_out = (Bytef *)compress_reserve(buf, COMPRESS_CHUNK);
+      zs.avail_out = COMPRESS_CHUNK;
+      ret = inflate(&zs, Z_NO_FLUSH);
+      buf->size += COMPRESS_CHUNK - zs.avail_out;
+      if ( (ret != Z_OK) && (ret != Z_STREAM_END) ) {
+        inflateEnd(&zs);
+        RETURN_WITH_ERROR( PSPIO_EFILE_CORRUPT );
+      }
+    }
+  }
+
+  /* Flush what zlib still holds */
+  while ( ret == Z_OK ) {
+    zs.next_out = (Bytef *)compress_reserve(buf, COMPRESS_CHUNK);
+    zs.avail_out = COMPRESS_CHUNK;
+    ret = inflate(&zs, Z_FINISH);
+    buf->size += COMPRESS_CHUNK - zs.avail_out;
+    if ( zs.avail_out == COMPRESS_CHUNK && ret != Z_STREAM_END ) break;
+  }
+  inflateEnd(&zs);
+  FULFILL_OR_RETURN( ret == Z_STREAM_END, PSPIO_EFILE_CORRUPT );
+
+  return PSPIO_SUCCESS;
+}
+#endif
+
+#if defined HAVE_LZMA
+static int compress_unxz(FILE *raw, compress_buffer_t *buf)
+{
+  lzma_ret ret;
+  lzma_action action;
+  unsigned char in[COMPRESS_CHUNK];
+  lzma_stream xs = LZMA_STREAM_INIT;
+
+  FULFILL_OR_RETURN( lzma_stream_decoder(&xs, UINT64_MAX, LZMA_CONCATENATED) ==
+    LZMA_OK, PSPIO_ERROR );
+
+  action = LZMA_RUN;
+  ret = LZMA_OK;
+  while ( ret == LZMA_OK ) {
+    if ( (xs.avail_in == 0) && (action == LZMA_RUN) ) {
+      xs.next_in = in;
+      xs.avail_in = fread(in, 1, sizeof(in), raw);
+      if ( xs.avail_in == 0 ) action = LZMA_FINISH;
+    }
+    xs.next_out = (uint8_t *)compress_reserve(buf, COMPRESS_CHUNK);
+    xs.avail_out = COMPRESS_CHUNK;
+    ret = lzma_code(&xs, action);
+    buf->size += COMPRESS_CHUNK - xs.avail_out;
+  }
+  lzma_end(&xs);
+  FULFILL_OR_RETURN( ret == LZMA_STREAM_END, PSPIO_EFILE_CORRUPT );
+
+  return PSPIO_SUCCESS;
+}
+#endif
+
+#if defined HAVE_ZSTD
+static int compress_unzstd(FILE *raw, compress_buffer_t *buf)
+{
+  int full;
+  size_t ret;
+  unsigned char in[COMPRESS_CHUNK];
+  ZSTD_DStream *zs;
+  ZSTD_inBuffer zin;
+  ZSTD_outBuffer zout;
+
+  zs = ZSTD_createDStream();
+  FULFILL_OR_EXIT( zs != NULL, PSPIO_ENOMEM );
+  ZSTD_initDStream(zs);
+
+  /* ret is 0 at the end of each frame. The input is only refilled once
+     the decoder leaves room in the output, since a full output may hide
+     data it still holds */
+  ret = 1;
+  full = 0;
+  zin.src = in;
+  zin.size = 0;
+  zin.pos = 0;
+  while ( 1 ) {
+    if ( (zin.pos == zin.size) && !full ) {
+      zin.size = fread(in, 1, sizeof(in), raw);
+      zin.pos = 0;
+      if ( zin.size == 0 ) break;
+    }
+    zout.dst = compress_reserve(buf, COMPRESS_CHUNK);
+    zout.size = COMPRESS_CHUNK;
+    zout.pos = 0;
+    ret = ZSTD_decompressStream(zs, &zout, &zin);
+    buf->size += zout.pos;
+    if ( ZSTD_isError(ret) ) {
+      ZSTD_freeDStream(zs);
+      RETURN_WITH_ERROR( PSPIO_EFILE_CORRUPT );
+    }
+    full = (zout.pos == zout.size);
+  }
+  ZSTD_freeDStream(zs);
+  FULFILL_OR_RETURN( ret == 0, PSPIO_EFILE_CORRUPT );
+
+  return PSPIO_SUCCESS;
+}
+#endif
+
+
+/**********************************************************************
+ * Global routines                                                    *
+ **********************************************************************/
+
+int compress_detect(const unsigned char *magic, size_t n)
+{
+  static const unsigned char gzip[2] = {0x1f, 0x8b};
+  static const unsigned char xz[6] = {0xfd, '7', 'z', 'X', 'Z', 0x00};
+  static const unsigned char zstd[4] = {0x28, 0xb5, 0x2f, 0xfd};
+
+  assert(magic != NULL || n == 0);
+
+  if ( (n >= sizeof(gzip)) && (memcmp(magic, gzip, sizeof(gzip)) == 0) ) {
+    return COMPRESS_GZIP;
+  }
+  if ( (n >= sizeof(xz)) && (memcmp(magic, xz, sizeof(xz)) == 0) ) {
+    return COMPRESS_XZ;
+  }
+  if ( (n >= sizeof(zstd)) && (memcmp(magic, zstd, sizeof(zstd)) == 0) ) {
+    return COMPRESS_ZSTD;
+  }
+
+  return COMPRESS_NONE;
+}
+
+int compress_fopen(const char *file_name, FILE **fp, char **buffer)
+{
+  int ierr, method;
+  size_t n;
+  unsigned char magic[6];
+  FILE *raw;
+  compress_buffer_t buf;
+
+  assert(file_name != NULL);
+  assert(fp != NULL);
+  assert(buffer != NULL);
+
+  *fp = NULL;
+  *buffer = NULL;
+
+  raw = fopen(file_name, "rb");
+  FULFILL_OR_RETURN( raw != NULL, PSPIO_ENOFILE );
+  n = fread(magic, 1, sizeof(magic), raw);
+  method = compress_detect(magic, n);
+
+  /* Plain files are read sequentially through a large buffer */
+  if ( method == COMPRESS_NONE ) {
+    fclose(raw);
+    *fp = fopen(file_name, "r");
+    FULFILL_OR_RETURN( *fp != NULL, PSPIO_ENOFILE );
+    setvbuf(*fp, NULL, _IOFBF, COMPRESS_CHUNK);
+#if defined HAVE_POSIX_FADVISE
+    posix_fadvise(fileno(*fp), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    return PSPIO_SUCCESS;
+  }
+
+  rewind(raw);
+  buf.data = NULL;
+  buf.size = 0;
+  buf.capacity = 0;
+  switch (method) {
+#if defined HAVE_ZLIB
+  case COMPRESS_GZIP:
+    ierr = compress_gunzip(raw, &buf);
+    break;
+#endif
+#if defined HAVE_LZMA
+  case COMPRESS_XZ:
+    ierr = compress_unxz(raw, &buf);
+    break;
+#endif
+#if defined HAVE_ZSTD
+  case COMPRESS_ZSTD:
+    ierr = compress_unzstd(raw, &buf);
+    break;
+#endif
+  default:
+    ierr = PSPIO_ENOSUPPORT;
+  }
+  fclose(raw);
+  if ( (ierr == PSPIO_SUCCESS) && (buf.size == 0) ) {
+    ierr = PSPIO_EFILE_CORRUPT;
+  }
+  if ( ierr != PSPIO_SUCCESS ) {
+    free(buf.data);
+    RETURN_WITH_ERROR( ierr );
+  }
+
+  /* Serve the decompressed data through a regular stream */
+#if defined HAVE_FMEMOPEN
+  *fp = fmemopen(buf.data, buf.size, "r");
+  if ( *fp != NULL ) {
+    *buffer = buf.data;
+    return PSPIO_SUCCESS;
+  }
+#endif
+  *fp = tmpfile();
+  if ( (*fp != NULL) && (fwrite(buf.data, 1, buf.size, *fp) != buf.size) ) {
+    fclose(*fp);
+    *fp = NULL;
+  }
+  free(buf.data);
+  FULFILL_OR_RETURN( *fp != NULL, PSPIO_EIO );
+  rewind(*fp);
+
+  return PSPIO_SUCCESS;
+}
@@ -0,0 +1,66 @@
+/* Copyright (C) 2018 Micael Oliveira <micael.oliveira@mpsd.mpg.de>
+ *                    Yann Pouillon <devops@materialsevolution.es>
+ *
+ * This file is part of Libpspio.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * version 2.0. If a copy of the MPL was not distributed with this file, You
+ * can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Libpspio is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the Mozilla Public License version 2.0 for
+ * more details.
+ */
+
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include <stdio.h>
+
+/**
+ * @file compress.h
+ * @brief transparent reading of compressed files
+ */
+
+
+/**********************************************************************
+ * Defines                                                            *
+ **********************************************************************/
+
+#define COMPRESS_NONE 0
+#define COMPRESS_GZIP 1
+#define COMPRESS_XZ   2
+#define COMPRESS_ZSTD 3
+
+
+/**********************************************************************
+ * Routines                                                           *
+ **********************************************************************/
+
+/**
+ * Tells the compression of a file from its first bytes
+ *
+ * @param[in] magic: first bytes of the file
+ * @param[in] n: number of bytes available in magic
+ * @return one of the COMPRESS_* values
+ */
+int compress_detect(const unsigned char *magic, size_t n);
+
+/**
+ * Opens a file for reading, decompressing it if its magic bytes tell a
+ * gzip, xz or zstd stream. Compressed files are decompressed once, in
+ * chunks, and the parsers read the result through a stream that can be
+ * rewound and seeked like a plain file.
+ *
+ * @param[in] file_name: name of the file
+ * @param[out] fp: stream to read from
+ * @param[out] buffer: memory behind fp, to free after closing fp
+ * @return error code: PSPIO_ENOFILE if the file cannot be opened,
+ *         PSPIO_ENOSUPPORT if its compression was not enabled at
+ *         configure time, PSPIO_EFILE_CORRUPT if it cannot be
+ *         decompressed
+ */
+int compress_fopen(const char *file_name, FILE **fp, char **buffer);
+
+#endif
@@ -22,6 +22,7 @@
 #include <assert.h>
 #include <math.h>
 
+#include "instrument.h"
 #include "pspio_error.h"
 #include "pspio_pspdata.h"
 #include "util.h"
@@ -31,35 +32,75 @@
 #endif
 
 
-int pspio_fhi_read(FILE *fp, pspio_pspdata_t *pspdata)
+/* Reads the first 11 lines of the file, which contain no mesh data */
+static int fhi_read_header(FILE *fp, pspio_pspdata_t *pspdata)
 {
   char line[PSPIO_STRLEN_LINE];
-  int i, l, np, n_potentials, ir, has_nlcc;
-  double zvalence, r12;
-  double *wf, *r, *v;
-  pspio_qn_t *qn = NULL;
-
-  assert(fp != NULL);
-  assert(pspdata != NULL); 
+  int i, n_potentials;
+  double zvalence;
 
-  /* Read header */
-  FULFILL_OR_RETURN( fgets(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+  FULFILL_OR_RETURN( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
   FULFILL_OR_RETURN( sscanf(line, "%lf %d", &zvalence, &n_potentials ) == 2, PSPIO_EFILE_CORRUPT );
+  FULFILL_OR_RETURN( n_potentials > 0, PSPIO_EFILE_CORRUPT );
   SUCCEED_OR_RETURN( pspio_pspdata_set_zvalence(pspdata, zvalence) );
   SUCCEED_OR_RETURN( pspio_pspdata_set_n_potentials(pspdata, n_potentials) );
   for (i=0; i<10; i++) {
     /* We ignore the next 10 lines, as they contain no information */
-    FULFILL_OR_RETURN( fgets(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+    FULFILL_OR_RETURN( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
   }
   SUCCEED_OR_RETURN( pspio_pspdata_set_l_max(pspdata, n_potentials-1) );
   SUCCEED_OR_RETURN( pspio_pspdata_set_n_states(pspdata, n_potentials) );
 
+  return PSPIO_SUCCESS;
+}
+
+int pspio_fhi_read_header(FILE *fp, pspio_pspdata_t *pspdata)
+{
+  char line[PSPIO_STRLEN_LINE];
+  double r12;
+
+  assert(fp != NULL);
+  assert(pspdata != NULL);
+
+  SUCCEED_OR_RETURN( fhi_read_header(fp, pspdata) );
+
+  /* The first line of the first block gives the size of the mesh */
+  FULFILL_OR_RETURN( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+  FULFILL_OR_RETURN( sscanf(line, "%d %lf", &pspdata->np, &r12 ) == 2, PSPIO_EFILE_CORRUPT );
+
+  return PSPIO_SUCCESS;
+}
+
+int pspio_fhi_read(FILE *fp, pspio_pspdata_t *pspdata)
+{
+  char line[PSPIO_STRLEN_LINE];
+  int i, l, np, ir, has_nlcc, load;
+  double r12;
+  double *wf, *r, *v;
+  pspio_qn_t *qn = NULL;
+
+  assert(fp != NULL);
+  assert(pspdata != NULL); 
+
+  /* Read header */
+  SUCCEED_OR_RETURN( fhi_read_header(fp, pspdata) );
+  load = pspdata->loaded & (PSPIO_LOAD_STATES | PSPIO_LOAD_POTENTIALS);
+
 
   /* Read mesh, potentials and wavefunctions */
   for (l=0; l < pspdata->l_max+1; l++) {
-    FULFILL_OR_RETURN( fgets(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+    FULFILL_OR_RETURN( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
     FULFILL_OR_RETURN( sscanf(line, "%d %lf", &np, &r12 ) == 2, PSPIO_EFILE_CORRUPT );
 
+    /* Only the mesh is needed when both components are skipped, and
+       only from the first block */
+    if ( !load && (l > 0) ) {
+      for (ir=0; ir<np; ir++) {
+        FULFILL_OR_RETURN( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+      }
+      continue;
+    }
+
     /* Allocate temporary data */
     SUCCEED_OR_RETURN( pspio_qn_alloc(&qn) );
     r = (double *) malloc (np*sizeof(double));
@@ -71,10 +112,15 @@ int pspio_fhi_read(FILE *fp, pspio_pspdata_t *pspdata)
 
     /* Read first line of block */
     for (ir=0; ir<np; ir++) {
-      FULFILL_OR_BREAK( fgets(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
-      FULFILL_OR_BREAK( sscanf(line, "%d %lf %lf %lf", &i, &r[ir],
-        &wf[ir], &v[ir]) == 4, PSPIO_EFILE_CORRUPT );
-      wf[ir] = wf[ir]/r[ir];
+      FULFILL_OR_BREAK( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+      if ( load ) {
+        FULFILL_OR_BREAK( sscanf(line, "%d %lf %lf %lf", &i, &r[ir],
+          &wf[ir], &v[ir]) == 4, PSPIO_EFILE_CORRUPT );
+        wf[ir] = wf[ir]/r[ir];
+      } else {
+        FULFILL_OR_BREAK( sscanf(line, "%d %lf", &i, &r[ir]) == 2,
+          PSPIO_EFILE_CORRUPT );
+      }
     }
 
     if ( l == 0 ) {
@@ -89,13 +135,17 @@ int pspio_fhi_read(FILE *fp, pspio_pspdata_t *pspdata)
 
     /* Set pseudopotential and wavefunction */
     SKIP_FUNC_ON_ERROR( pspio_qn_init(qn, 0, l, 0.0) );
-    SKIP_FUNC_ON_ERROR(
-      pspio_potential_alloc(&pspdata->potentials[LJ_TO_I(l,0.0)], np) );
-    SKIP_FUNC_ON_ERROR( pspio_potential_init(pspdata->potentials[LJ_TO_I(l,0.0)],
-      qn, pspdata->mesh, v) );
-    SKIP_FUNC_ON_ERROR( pspio_state_alloc(&pspdata->states[l], np) );
-    SKIP_FUNC_ON_ERROR( pspio_state_init(pspdata->states[l], 0.0, qn,
-      0.0, 0.0, pspdata->mesh, wf, NULL) );
+    if ( pspdata->loaded & PSPIO_LOAD_POTENTIALS ) {
+      SKIP_FUNC_ON_ERROR(
+        pspio_potential_alloc(&pspdata->potentials[LJ_TO_I(l,0.0)], np) );
+      SKIP_FUNC_ON_ERROR( pspio_potential_init(pspdata->potentials[LJ_TO_I(l,0.0)],
+        qn, pspdata->mesh, v) );
+    }
+    if ( pspdata->loaded & PSPIO_LOAD_STATES ) {
+      SKIP_FUNC_ON_ERROR( pspio_state_alloc(&pspdata->states[l], np) );
+      SKIP_FUNC_ON_ERROR( pspio_state_init(pspdata->states[l], 0.0, qn,
+        0.0, 0.0, pspdata->mesh, wf, NULL) );
+    }
 
     /* Free temporary data */
     free(r);
@@ -114,7 +164,7 @@ int pspio_fhi_read(FILE *fp, pspio_pspdata_t *pspdata)
   }
 
   /* Non-linear core-corrections */
-  has_nlcc = ( fgets(line, PSPIO_STRLEN_LINE, fp) != NULL );
+  has_nlcc = ( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL );
   if ( has_nlcc ) {
     double *cd, *cdp, *cdpp;
 
@@ -131,7 +181,7 @@ int pspio_fhi_read(FILE *fp, pspio_pspdata_t *pspdata)
     /* Read core density */
     for (ir=0; ir<np; ir++) {
       if ( ir != 0 ) {
-	FULFILL_OR_BREAK(fgets(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO);
+	FULFILL_OR_BREAK(INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO);
       }
 
       FULFILL_OR_BREAK(sscanf(line, "%lf %lf %lf %lf", &r12, &cd[ir],
@@ -190,15 +240,14 @@ int pspio_fhi_write(FILE *fp, const pspio_pspdata_t *pspdata)
     FULFILL_OR_RETURN( fprintf(fp, "%-4d %20.14E\n", pspdata->mesh->np,
       pspdata->mesh->r[1]/pspdata->mesh->r[0]) > 0, PSPIO_EIO );
 
-    i = LJ_TO_I(l,0.0);
-
-    in = 0;
-    while ((is = pspdata->qn_to_istate[in][i]) < 0)
-      in ++;
-
-    /* This format is not suitable for j-dependent pseudos */
-    FULFILL_OR_RETURN( pspio_qn_get_j(pspio_state_get_qn(pspdata->states[is])) == 0.0,
-      PSPIO_EVALUE );
+    /* Lowest state and potential of the channel, which must exist since
+       this format is not suitable for j-dependent pseudos */
+    is = -1;
+    for (in=0; (is < 0) && (in <= pspdata->index->n_max); in++) {
+      is = pspio_pspdata_find_state(pspdata, in, l, 0.0);
+    }
+    i = pspio_pspdata_find_potential(pspdata, l, 0.0);
+    FULFILL_OR_RETURN( (is >= 0) && (i >= 0), PSPIO_EVALUE );
 
     for (ir=0; ir<pspdata->mesh->np; ir++) {
       r = pspdata->mesh->r[ir];
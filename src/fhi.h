@@ -41,6 +41,15 @@
  */
 int pspio_fhi_read(FILE * fp, pspio_pspdata_t *pspdata);
 
+/**
+ * Read the header of a FHI file and the size of its mesh, without the
+ * radial functions
+ * @param[in] fp a stream of the input file
+ * @param[in,out] pspdata the data structure
+ * @return error code
+ */
+int pspio_fhi_read_header(FILE * fp, pspio_pspdata_t *pspdata);
+
 /**
  * Write the data contained in the psp_data structure to a file using the FHI format
  * @param[in] fp a stream of the input file
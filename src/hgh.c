@@ -0,0 +1,328 @@
+/* Copyright (C) 2018 Micael Oliveira <micael.oliveira@mpsd.mpg.de>
+ *                    Yann Pouillon <devops@materialsevolution.es>
+ *
+ * This file is part of Libpspio.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * version 2.0. If a copy of the MPL was not distributed with this file, You
+ * can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Libpspio is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the Mozilla Public License version 2.0 for
+ * more details.
+ */
+
+/**
+ * @file hgh.c
+ * @brief implementation to read GTH and HGH files
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "hgh.h"
+#include "instrument.h"
+#include "pspio_gth.h"
+#include "pspio_xc_funcs.h"
+#include "util.h"
+
+#if defined HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+
+/**********************************************************************
+ * Private routines                                                   *
+ **********************************************************************/
+
+/*
+ * Parses up to max numbers at the beginning of a line, ignoring the
+ * trailing comments, and returns how many were found
+ */
+static int hgh_parse(const char *line, int max, double *x)
+{
+  int n;
+  char *end;
+
+  for (n=0; n<max; n++) {
+    x[n] = strtod(line, &end);
+    if ( end == line ) break;
+    line = end;
+  }
+
+  return n;
+}
+
+/* Reads the next line and parses exactly n numbers from it */
+static int hgh_read_values(FILE *fp, int n, double *x)
+{
+  char line[PSPIO_STRLEN_LINE];
+
+  FULFILL_OR_RETURN( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+  FULFILL_OR_RETURN( hgh_parse(line, n, x) == n, PSPIO_EFILE_CORRUPT );
+
+  return PSPIO_SUCCESS;
+}
+
+/* Number of projectors of a diagonal coupling, without trailing zeros */
+static int hgh_diag_count(double r, int n, const double *h)
+{
+  int i, count = 0;
+
+  if ( r <= 0.0 ) return 0;
+  for (i=0; i<n; i++) {
+    if ( h[i] != 0.0 ) count = i + 1;
+  }
+
+  return count;
+}
+
+/* GTH (1996): diagonal couplings, two s and one p projectors */
+static int hgh_read_gth(FILE *fp, pspio_gth_t *gth)
+{
+  int n;
+  double x[5], h[4];
+
+  SUCCEED_OR_RETURN( hgh_read_values(fp, 5, x) );
+  SUCCEED_OR_RETURN( pspio_gth_init(gth, gth->zion, x[0], 4, &x[1]) );
+
+  SUCCEED_OR_RETURN( hgh_read_values(fp, 3, x) );
+  n = hgh_diag_count(x[0], 2, &x[1]);
+  h[0] = x[1];
+  if ( n == 2 ) {
+    h[1] = 0.0;
+    h[2] = 0.0;
+    h[3] = x[2];
+  }
+  SUCCEED_OR_RETURN( pspio_gth_set_channel(gth, 0, x[0], n, h, NULL) );
+
+  SUCCEED_OR_RETURN( hgh_read_values(fp, 2, x) );
+  SUCCEED_OR_RETURN( pspio_gth_set_channel(gth, 1, x[0],
+    hgh_diag_count(x[0], 1, &x[1]), &x[1], NULL) );
+
+  return PSPIO_SUCCESS;
+}
+
+/* HGH (1998): diagonal couplings, one line of k for l > 0 */
+static int hgh_read_hgh(FILE *fp, pspio_gth_t *gth, int l_max)
+{
+  int l;
+  double x[5], k[3];
+
+  SUCCEED_OR_RETURN( hgh_read_values(fp, 5, x) );
+  SUCCEED_OR_RETURN( pspio_gth_init(gth, gth->zion, x[0], 4, &x[1]) );
+
+  for (l=0; (l<=l_max) && (l<=PSPIO_GTH_L_MAX); l++) {
+    SUCCEED_OR_RETURN( hgh_read_values(fp, 4, x) );
+    if ( l > 0 ) {
+      SUCCEED_OR_RETURN( hgh_read_values(fp, 3, k) );
+    }
+    SUCCEED_OR_RETURN( pspio_gth_set_channel_hgh(gth, l, x[0], &x[1],
+      (l > 0) ? k : NULL) );
+  }
+
+  return PSPIO_SUCCESS;
+}
+
+/*
+ * HGH with full matrices (Abinit pspcod 10): the upper triangles of h
+ * and k are given row by row, the first row of h on the line of r_l
+ */
+static int hgh_read_full(FILE *fp, pspio_gth_t *gth)
+{
+  char line[PSPIO_STRLEN_LINE];
+  int l, i, j, n, nc, n_nonloc;
+  double x[8], h[9], k[9];
+
+  FULFILL_OR_RETURN( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+  FULFILL_OR_RETURN( hgh_parse(line, 2, x) == 2, PSPIO_EFILE_CORRUPT );
+  nc = (int)x[1];
+  FULFILL_OR_RETURN( (nc >= 0) && (nc <= 4) && (x[1] == nc), PSPIO_EFILE_CORRUPT );
+  FULFILL_OR_RETURN( hgh_parse(line, 2+nc, x) == 2+nc, PSPIO_EFILE_CORRUPT );
+  SUCCEED_OR_RETURN( pspio_gth_init(gth, gth->zion, x[0], nc, &x[2]) );
+
+  SUCCEED_OR_RETURN( hgh_read_values(fp, 1, x) );
+  n_nonloc = (int)x[0];
+  FULFILL_OR_RETURN( (n_nonloc >= 0) && (n_nonloc <= PSPIO_GTH_L_MAX+1),
+    PSPIO_EFILE_CORRUPT );
+
+  for (l=0; l<n_nonloc; l++) {
+    FULFILL_OR_RETURN( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+    FULFILL_OR_RETURN( hgh_parse(line, 2, x) == 2, PSPIO_EFILE_CORRUPT );
+    n = (int)x[1];
+    FULFILL_OR_RETURN( (n >= 0) && (n <= PSPIO_GTH_N_PROJ) && (x[1] == n),
+      PSPIO_EFILE_CORRUPT );
+    FULFILL_OR_RETURN( hgh_parse(line, 2+n, x) == 2+n, PSPIO_EFILE_CORRUPT );
+    for (j=0; j<n; j++) {
+      h[j] = h[j*n] = x[2+j];
+    }
+    for (i=1; i<n; i++) {
+      SUCCEED_OR_RETURN( hgh_read_values(fp, n-i, &x[2]) );
+      for (j=i; j<n; j++) {
+        h[i*n+j] = h[j*n+i] = x[2+j-i];
+      }
+    }
+    for (i=0; (l>0) && (i<n); i++) {
+      SUCCEED_OR_RETURN( hgh_read_values(fp, n-i, &x[2]) );
+      for (j=i; j<n; j++) {
+        k[i*n+j] = k[j*n+i] = x[2+j-i];
+      }
+    }
+    SUCCEED_OR_RETURN( pspio_gth_set_channel(gth, l, x[0], n, h,
+      (l > 0) ? k : NULL) );
+  }
+
+  return PSPIO_SUCCESS;
+}
+
+/*
+ * Reads the parameters of an Octopus HGH file, stopping after the local
+ * part when only the header is wanted
+ */
+static int hgh_read_octopus(FILE *fp, pspio_pspdata_t *pspdata, pspio_gth_t *gth,
+                            int header_only)
+{
+  char line[PSPIO_STRLEN_LINE], label[PSPIO_STRLEN_LINE], symbol[4];
+  int l, n, nk, offset;
+  double z, x[7], k[3];
+
+  /* Line 1: free-form description */
+  FULFILL_OR_RETURN( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+  line[strcspn(line, "\r\n")] = '\0';
+  FULFILL_OR_RETURN( strlen(line) > 0, PSPIO_EFILE_FORMAT );
+  SUCCEED_OR_RETURN( pspio_pspinfo_alloc(&pspdata->pspinfo) );
+  SUCCEED_OR_RETURN( pspio_pspinfo_set_description(pspdata->pspinfo, line) );
+
+  /* Line 2: label, ionic charge, rloc and up to 4 coefficients */
+  FULFILL_OR_RETURN( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+  FULFILL_OR_RETURN( sscanf(line, "%s%n", label, &offset) == 1, PSPIO_EFILE_FORMAT );
+  n = hgh_parse(line + offset, 6, x);
+  FULFILL_OR_RETURN( (n >= 2) && (x[1] > 0.0), PSPIO_EFILE_FORMAT );
+
+  /* The label is the symbol, possibly followed by an underscore */
+  label[strcspn(label, "_")] = '\0';
+  FULFILL_OR_RETURN( strlen(label) < sizeof(symbol), PSPIO_EFILE_FORMAT );
+  strcpy(symbol, label);
+  FULFILL_OR_RETURN( symbol_to_z(symbol, &z) == PSPIO_SUCCESS, PSPIO_EFILE_FORMAT );
+  SUCCEED_OR_RETURN( pspio_pspdata_set_symbol(pspdata, symbol) );
+  SUCCEED_OR_RETURN( pspio_pspdata_set_z(pspdata, z) );
+  SUCCEED_OR_RETURN( pspio_pspdata_set_zvalence(pspdata, x[0]) );
+  SUCCEED_OR_RETURN( pspio_pspdata_set_nelvalence(pspdata, x[0]) );
+  SUCCEED_OR_RETURN( pspio_gth_init(gth, x[0], x[1], n-2, &x[2]) );
+  if ( header_only ) return PSPIO_SUCCESS;
+
+  /*
+   * One line per channel with r_l and the diagonal of h, followed for
+   * l > 0 by the diagonal of k, until a blank line or the end of file
+   */
+  for (l=0; l<=PSPIO_GTH_L_MAX; l++) {
+    if ( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) == NULL ) break;
+    n = hgh_parse(line, 4, x);
+    if ( n == 0 ) {
+      FULFILL_OR_RETURN( strspn(line, " \t\r\n") == strlen(line), PSPIO_EFILE_CORRUPT );
+      break;
+    }
+    memset(&x[n], 0, (4-n)*sizeof(double));
+    memset(k, 0, sizeof(k));
+    nk = 0;
+    if ( (l > 0) && (INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL) ) {
+      nk = hgh_parse(line, 3, k);
+    }
+    SUCCEED_OR_RETURN( pspio_gth_set_channel_hgh(gth, l, x[0], &x[1], k) );
+    if ( (l > 0) && (nk == 0) ) break;
+  }
+
+  return PSPIO_SUCCESS;
+}
+
+
+/**********************************************************************
+ * Global routines                                                    *
+ **********************************************************************/
+
+int pspio_hgh_read_header(FILE *fp, pspio_pspdata_t *pspdata)
+{
+  pspio_gth_t *gth = NULL;
+  int ierr;
+
+  assert(fp != NULL);
+  assert(pspdata != NULL);
+
+  SUCCEED_OR_RETURN( pspio_gth_alloc(&gth) );
+  ierr = hgh_read_octopus(fp, pspdata, gth, 1);
+  pspio_gth_free(gth);
+  SUCCEED_OR_RETURN( ierr );
+
+  /* HGH tables are fitted to the Teter LDA functional */
+  SUCCEED_OR_RETURN( pspio_xc_alloc(&pspdata->xc) );
+  SUCCEED_OR_RETURN( pspio_xc_set_exchange(pspdata->xc, XC_LDA_XC_TETER93) );
+  SUCCEED_OR_RETURN( pspio_xc_set_correlation(pspdata->xc, XC_LDA_XC_TETER93) );
+  SUCCEED_OR_RETURN( pspio_pspdata_set_scheme(pspdata, PSPIO_SCM_HGH) );
+
+  return PSPIO_SUCCESS;
+}
+
+int pspio_hgh_read(FILE *fp, pspio_pspdata_t *pspdata)
+{
+  pspio_gth_t *gth = NULL;
+  int ierr;
+
+  assert(fp != NULL);
+  assert(pspdata != NULL);
+
+  SUCCEED_OR_RETURN( pspio_gth_alloc(&gth) );
+  ierr = hgh_read_octopus(fp, pspdata, gth, 0);
+  if ( ierr == PSPIO_SUCCESS ) {
+    ierr = pspio_pspdata_set_gth(pspdata, gth);
+  }
+  if ( ierr == PSPIO_SUCCESS ) {
+    ierr = pspio_pspdata_set_l_max(pspdata, (gth->l_max < 0) ? 0 : gth->l_max);
+  }
+  pspio_gth_free(gth);
+  SUCCEED_OR_RETURN( ierr );
+
+  SUCCEED_OR_RETURN( pspio_xc_alloc(&pspdata->xc) );
+  SUCCEED_OR_RETURN( pspio_xc_set_exchange(pspdata->xc, XC_LDA_XC_TETER93) );
+  SUCCEED_OR_RETURN( pspio_xc_set_correlation(pspdata->xc, XC_LDA_XC_TETER93) );
+  SUCCEED_OR_RETURN( pspio_pspdata_set_scheme(pspdata, PSPIO_SCM_HGH) );
+
+  return PSPIO_SUCCESS;
+}
+
+int pspio_hgh_read_abinit(FILE *fp, pspio_pspdata_t *pspdata, int format)
+{
+  pspio_gth_t *gth = NULL;
+  int ierr;
+
+  assert(fp != NULL);
+  assert(pspdata != NULL);
+
+  SUCCEED_OR_RETURN( pspio_gth_alloc(&gth) );
+  gth->zion = pspio_pspdata_get_zvalence(pspdata);
+  switch (format) {
+  case PSPIO_FMT_ABINIT_2:
+    ierr = hgh_read_gth(fp, gth);
+    break;
+  case PSPIO_FMT_ABINIT_3:
+    ierr = hgh_read_hgh(fp, gth, pspio_pspdata_get_l_max(pspdata));
+    break;
+  case PSPIO_FMT_ABINIT_10:
+    ierr = hgh_read_full(fp, gth);
+    break;
+  default:
+    ierr = PSPIO_EVALUE;
+  }
+  if ( ierr == PSPIO_SUCCESS ) {
+    ierr = pspio_pspdata_set_gth(pspdata, gth);
+  }
+  pspio_gth_free(gth);
+  SUCCEED_OR_RETURN( ierr );
+
+  SUCCEED_OR_RETURN( pspio_pspdata_set_nelvalence(pspdata,
+    pspio_pspdata_get_zvalence(pspdata)) );
+  SUCCEED_OR_RETURN( pspio_pspdata_set_scheme(pspdata,
+    (format == PSPIO_FMT_ABINIT_2) ? PSPIO_SCM_GTH : PSPIO_SCM_HGH) );
+
+  return PSPIO_SUCCESS;
+}
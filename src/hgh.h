@@ -0,0 +1,63 @@
+/* Copyright (C) 2018 Micael Oliveira <micael.oliveira@mpsd.mpg.de>
+ *                    Yann Pouillon <devops@materialsevolution.es>
+ *
+ * This file is part of Libpspio.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * version 2.0. If a copy of the MPL was not distributed with this file, You
+ * can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Libpspio is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the Mozilla Public License version 2.0 for
+ * more details.
+ */
+
+/**
+ * @file hgh.h
+ * @brief header file for the GTH and HGH routines accessible to the
+ *        other parts of the library
+ */
+
+#if !defined PSPIO_HGH_H
+#define PSPIO_HGH_H
+
+#include <stdio.h>
+#include <assert.h>
+
+#include "pspio_pspdata.h"
+
+
+/**********************************************************************
+ * Global routines                                                    *
+ **********************************************************************/
+
+/**
+ * Read the parameters contained in an Octopus HGH file and store them
+ * in the psp_data structure
+ * @param[in] fp a stream of the input file
+ * @param[in,out] pspdata the data structure
+ * @return error code
+ */
+int pspio_hgh_read(FILE * fp, pspio_pspdata_t *pspdata);
+
+/**
+ * Read the symbol and the charges of an Octopus HGH file
+ * @param[in] fp a stream of the input file
+ * @param[in,out] pspdata the data structure
+ * @return error code
+ */
+int pspio_hgh_read_header(FILE * fp, pspio_pspdata_t *pspdata);
+
+/**
+ * Read the GTH or HGH parameters that follow the header of an Abinit
+ * file, see abinit_read_header
+ * @param[in] fp a stream of the input file, after line 3
+ * @param[in,out] pspdata the data structure, with the header already set
+ * @param[in] format PSPIO_FMT_ABINIT_2, PSPIO_FMT_ABINIT_3 or
+ *            PSPIO_FMT_ABINIT_10
+ * @return error code
+ */
+int pspio_hgh_read_abinit(FILE * fp, pspio_pspdata_t *pspdata, int format);
+
+#endif
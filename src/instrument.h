@@ -0,0 +1,90 @@
+/* Copyright (C) 2018 Micael Oliveira <micael.oliveira@mpsd.mpg.de>
+ *                    Yann Pouillon <devops@materialsevolution.es>
+ *
+ * This file is part of Libpspio.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * version 2.0. If a copy of the MPL was not distributed with this file, You
+ * can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Libpspio is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the Mozilla Public License version 2.0 for
+ * more details.
+ */
+
+#ifndef INSTRUMENT_H
+#define INSTRUMENT_H
+
+/**
+ * @file instrument.h
+ * @brief internal macros to update the instrumentation counters and timers
+ *
+ * All the macros expand to nothing (or to the plain library call) unless
+ * the library has been configured with --enable-instrumentation, so that
+ * they can be left in the hot paths at no cost.
+ */
+
+#include <stdio.h>
+
+#include "pspio_common.h"
+
+/* The macros below depend on INSTRUMENTATION_MODE, hence config.h is
+   needed before anything else */
+#if defined HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+
+#if defined INSTRUMENTATION_MODE
+
+/**********************************************************************
+ * Storage (defined in pspio_info.c)                                  *
+ **********************************************************************/
+
+extern int instr_enabled;
+extern PSPIO_THREAD_LOCAL long instr_counters[PSPIO_NCOUNTERS];
+extern PSPIO_THREAD_LOCAL double instr_timers[PSPIO_NTIMERS];
+
+/**
+ * Returns a monotonic time stamp, in seconds
+ */
+double instr_clock(void);
+
+/**
+ * Same as fgets, but accounts for the bytes read and the lines parsed
+ */
+char *instr_fgets(char *s, int size, FILE *stream);
+
+
+/**********************************************************************
+ * Macros                                                             *
+ **********************************************************************/
+
+#define INSTR_ADD(id, n) \
+  do { if ( instr_enabled ) instr_counters[id] += (n); } while (0)
+
+#define INSTR_COUNT(id) INSTR_ADD(id, 1)
+
+#define INSTR_TIMER_DECLARE(t) double t = 0.0
+
+#define INSTR_TIMER_START(t) \
+  do { if ( instr_enabled ) t = instr_clock(); } while (0)
+
+#define INSTR_TIMER_STOP(id, t) \
+  do { if ( instr_enabled ) instr_timers[id] += instr_clock() - t; } while (0)
+
+#define INSTR_FGETS(s, size, stream) instr_fgets(s, size, stream)
+
+#else
+
+#define INSTR_ADD(id, n)
+#define INSTR_COUNT(id)
+#define INSTR_TIMER_DECLARE(t)
+#define INSTR_TIMER_START(t)
+#define INSTR_TIMER_STOP(id, t)
+#define INSTR_FGETS(s, size, stream) fgets(s, size, stream)
+
+#endif
+
+#endif
@@ -22,6 +22,7 @@
 #include <assert.h>
 #include <math.h>
 
+#include "instrument.h"
 #include "pspio_error.h"
 #include "pspio_pspdata.h"
 #include "util.h"
@@ -43,13 +44,13 @@ int pspio_oncv_read(FILE *fp, pspio_pspdata_t *pspdata)
   assert(pspdata != NULL); 
 
   /* Read header */
-  FULFILL_OR_RETURN( fgets(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+  FULFILL_OR_RETURN( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
   FULFILL_OR_RETURN( sscanf(line, "%lf %d", &zvalence, &n_potentials ) == 2, PSPIO_EFILE_CORRUPT );
   SUCCEED_OR_RETURN( pspio_pspdata_set_zvalence(pspdata, zvalence) );
   SUCCEED_OR_RETURN( pspio_pspdata_set_n_potentials(pspdata, n_potentials) );
   for (i=0; i<10; i++) {
     /* We ignore the next 10 lines, as they contain no information */
-    FULFILL_OR_RETURN( fgets(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+    FULFILL_OR_RETURN( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
   }
   SUCCEED_OR_RETURN( pspio_pspdata_set_l_max(pspdata, n_potentials-1) );
   SUCCEED_OR_RETURN( pspio_pspdata_set_n_states(pspdata, n_potentials) );
@@ -57,7 +58,7 @@ int pspio_oncv_read(FILE *fp, pspio_pspdata_t *pspdata)
 
   /* Read mesh, potentials and wavefunctions */
   for (l=0; l < pspdata->l_max+1; l++) {
-    FULFILL_OR_RETURN( fgets(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+    FULFILL_OR_RETURN( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
     FULFILL_OR_RETURN( sscanf(line, "%d %lf", &np, &r12 ) == 2, PSPIO_EFILE_CORRUPT );
 
     /* Allocate temporary data */
@@ -71,7 +72,7 @@ int pspio_oncv_read(FILE *fp, pspio_pspdata_t *pspdata)
 
     /* Read first line of block */
     for (ir=0; ir<np; ir++) {
-      FULFILL_OR_BREAK( fgets(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+      FULFILL_OR_BREAK( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
       FULFILL_OR_BREAK( sscanf(line, "%d %lf %lf %lf", &i, &r[ir],
         &wf[ir], &v[ir]) == 4, PSPIO_EFILE_CORRUPT );
       wf[ir] = wf[ir]/r[ir];
@@ -114,7 +115,7 @@ int pspio_oncv_read(FILE *fp, pspio_pspdata_t *pspdata)
   }
 
   /* Non-linear core-corrections */
-  has_nlcc = ( fgets(line, PSPIO_STRLEN_LINE, fp) != NULL );
+  has_nlcc = ( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL );
   if ( has_nlcc ) {
     double *cd, *cdp, *cdpp;
 
@@ -131,7 +132,7 @@ int pspio_oncv_read(FILE *fp, pspio_pspdata_t *pspdata)
     /* Read core density */
     for (ir=0; ir<np; ir++) {
       if ( ir != 0 ) {
-	FULFILL_OR_BREAK(fgets(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO);
+	FULFILL_OR_BREAK(INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO);
       }
 
       FULFILL_OR_BREAK(sscanf(line, "%lf %lf %lf %lf", &r12, &cd[ir],
@@ -162,7 +163,8 @@ int pspio_oncv_read(FILE *fp, pspio_pspdata_t *pspdata)
 
 int pspio_oncv_write(FILE *fp, const pspio_pspdata_t *pspdata)
 {
-  int ip, ir, l;
+  int ir, l, np;
+  const int *ip;
   pspio_projector_t *proj1, *proj2;
 
   assert(fp != NULL);
@@ -176,53 +178,25 @@ int pspio_oncv_write(FILE *fp, const pspio_pspdata_t *pspdata)
   */
   assert(pspdata->mesh->type == PSPIO_MESH_LINEAR);
 
-  /* We cannot treat l_max > 5 for now */
-  assert(pspdata->l_max < 6);
-
-  /* Make sure we know how many projectors there are for each angular
-     momentum */
-  FULFILL_OR_RETURN( pspdata->n_projectors_per_l != NULL, PSPIO_ERROR );
-
-  /* Write projectors */
+  /* Write projectors, grouped by angular momentum in the index */
   for (l=0; l<pspdata->projectors_l_max+1; l++) {
+    np = pspio_pspdata_find_projectors_l(pspdata, l, &ip);
     if ( l == pspdata->l_local ) {
       FULFILL_OR_RETURN( fprintf(fp, "%4d\n", l) > 0, PSPIO_EIO );
       for (ir=0; ir<pspdata->mesh->np; ir++) {
         FULFILL_OR_RETURN( fprintf(fp, "%6d %21.13E %21.13E\n",
           ir+1, pspdata->mesh->r[ir], pspdata->vlocal->v[ir]) > 0, PSPIO_EIO );
       }
-    } else if ( pspdata->n_projectors_per_l[l] == 1 ) {
-      for (ip=0; ip<pspdata->n_projectors; ip++) {
-        proj1 = pspdata->projectors[ip];
-        if ( proj1->qn->l == l ) {
-          FULFILL_OR_RETURN( fprintf(fp, "%4d %21.13E\n", l,
-            proj1->energy) > 0, PSPIO_EIO );
-          break;
-        }
-      }
+    } else if ( np == 1 ) {
+      proj1 = pspdata->projectors[ip[0]];
+      FULFILL_OR_RETURN( fprintf(fp, "%4d %21.13E\n", l,
+        proj1->energy) > 0, PSPIO_EIO );
       /* FIXME: output values */
-    } else if ( pspdata->n_projectors_per_l[l] == 2 ) {
-      proj1 = NULL;
-      proj2 = NULL;
-      for (ip=0; ip<pspdata->n_projectors; ip++) {
-        if ( (proj1 != NULL) && (proj2 != NULL) ) {
-          FULFILL_OR_RETURN( fprintf(fp, "%4d %21.13E %21.13E\n", l,
-            proj1->energy, proj2->energy) > 0, PSPIO_EIO );
-          break;
-        }
-        if ( proj1 == NULL ) {
-          proj1 = pspdata->projectors[ip];
-          if ( proj1->qn->l != l ) {
-            proj1 = NULL;
-          }
-        } else if ( proj2 == NULL ) {
-          proj2 = pspdata->projectors[ip];
-          if ( proj2->qn->l != l ) {
-            proj2 = NULL;
-          }
-        }
-      }
-      FULFILL_OR_RETURN( (proj1 != NULL) && (proj2 != NULL), PSPIO_ERROR );
+    } else if ( np == 2 ) {
+      proj1 = pspdata->projectors[ip[0]];
+      proj2 = pspdata->projectors[ip[1]];
+      FULFILL_OR_RETURN( fprintf(fp, "%4d %21.13E %21.13E\n", l,
+        proj1->energy, proj2->energy) > 0, PSPIO_EIO );
       /* FIXME: output values */
     }
   }
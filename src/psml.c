@@ -0,0 +1,770 @@
+/* Copyright (C) 2018 Micael Oliveira <micael.oliveira@mpsd.mpg.de>
+ *                    Yann Pouillon <devops@materialsevolution.es>
+ *
+ * This file is part of Libpspio.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * version 2.0. If a copy of the MPL was not distributed with this file, You
+ * can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Libpspio is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the Mozilla Public License version 2.0 for
+ * more details.
+ */
+
+/**
+ * @file psml.c
+ * @brief implementation to read PSPIO_FMT_XML (PSML) files
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "psml.h"
+#include "util.h"
+
+#if defined HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#if defined HAVE_XML
+#include <libxml/parser.h>
+#endif
+
+
+#if defined HAVE_XML
+
+/**********************************************************************
+ * Private data structures                                            *
+ **********************************************************************/
+
+#define PSML_CHUNK 16384 /* Bytes passed to the parser at once */
+#define PSML_TOKEN 64    /* Longest number in a data block */
+#define PSML_SHELLS 32   /* Most shells in a valence configuration */
+
+/* Radial functions being read */
+#define PSML_NONE   0
+#define PSML_SKIP   1
+#define PSML_RHO    2
+#define PSML_CORE   4
+#define PSML_VLOCAL 8
+#define PSML_SLPS   16
+#define PSML_PROJ   32
+#define PSML_PSWF   64
+
+/*
+ * Elements holding radial functions, with the components they load. The
+ * core charge belongs to the exchange-correlation data, which is always
+ * loaded.
+ */
+static const struct {
+  const char *name;
+  int section;
+  int load;
+} psml_sections[] = {
+  {"valence-charge", PSML_RHO, PSPIO_LOAD_RHO_VALENCE},
+  {"pseudocore-charge", PSML_CORE, 0},
+  {"local-potential", PSML_VLOCAL, PSPIO_LOAD_VLOCAL},
+  {"semilocal-potentials", PSML_SLPS, PSPIO_LOAD_POTENTIALS},
+  {"nonlocal-projectors", PSML_PROJ, PSPIO_LOAD_PROJECTORS},
+  {"pseudo-wave-functions", PSML_PSWF, PSPIO_LOAD_STATES},
+  {NULL, PSML_NONE, 0}
+};
+
+/* State of the parser between two SAX events */
+typedef struct {
+  pspio_pspdata_t *pspdata;
+  xmlParserCtxtPtr ctxt;
+  int header;     /* Stop at the grid */
+  int ierr;       /* First error raised by a handler */
+  int stop;       /* The parser was stopped on purpose */
+  int root;       /* The psml element was found */
+  int done;       /* The psml element was closed */
+
+  /* Numbers of the current grid or data block */
+  int section;    /* Functions being read, PSML_* */
+  int seen;       /* Sections already read */
+  int in_data;    /* Characters are numbers */
+  int np;
+  int n;
+  double *values;
+  char token[PSML_TOKEN];
+  int ntoken;
+
+  /* Attributes of the current function */
+  pspio_qn_t *qn;
+  int fn, fl;
+  double fj, fekb;
+  int l_max;      /* Highest channel of all functions */
+  int l_proj;     /* Highest channel of the projectors */
+
+  /* Valence configuration */
+  int n_shells;
+  int shell_n[PSML_SHELLS], shell_l[PSML_SHELLS];
+  double shell_occ[PSML_SHELLS];
+
+  /* Functions of the current set, until it is closed */
+  int n_funcs, max_funcs;
+  pspio_potential_t **potentials;
+  pspio_projector_t **projectors;
+  pspio_state_t **states;
+  double *ekb;
+} psml_parser_t;
+
+
+/**********************************************************************
+ * Private routines                                                   *
+ **********************************************************************/
+
+/* Copies the value of an attribute given by SAX2, NULL if absent */
+static const char *psml_attr(int nb_attributes, const xmlChar **attributes,
+                             const char *name, char *value)
+{
+  int i;
+  size_t len;
+
+  for (i=0; i<nb_attributes; i++) {
+    if ( strcmp((const char *)attributes[5*i], name) == 0 ) {
+      len = attributes[5*i+4] - attributes[5*i+3];
+      if ( len >= PSPIO_STRLEN_LINE ) len = PSPIO_STRLEN_LINE - 1;
+      memcpy(value, attributes[5*i+3], len);
+      value[len] = '\0';
+      return value;
+    }
+  }
+
+  return NULL;
+}
+
+/* Reads a numerical attribute, PSPIO_EFILE_CORRUPT if absent or invalid */
+static int psml_attr_double(int nb_attributes, const xmlChar **attributes,
+                            const char *name, double *x)
+{
+  char value[PSPIO_STRLEN_LINE], *end;
+
+  FULFILL_OR_RETURN( psml_attr(nb_attributes, attributes, name, value) != NULL,
+    PSPIO_EFILE_CORRUPT );
+  *x = strtod(value, &end);
+  FULFILL_OR_RETURN( (end != value) && (*end == '\0'), PSPIO_EFILE_CORRUPT );
+
+  return PSPIO_SUCCESS;
+}
+
+static int psml_attr_int(int nb_attributes, const xmlChar **attributes,
+                         const char *name, int *i)
+{
+  double x;
+
+  SUCCEED_OR_RETURN( psml_attr_double(nb_attributes, attributes, name, &x) );
+  *i = (int)x;
+  FULFILL_OR_RETURN( *i == x, PSPIO_EFILE_CORRUPT );
+
+  return PSPIO_SUCCESS;
+}
+
+/* Reads an angular momentum given as a letter */
+static int psml_attr_l(int nb_attributes, const xmlChar **attributes, int *l)
+{
+  char value[PSPIO_STRLEN_LINE];
+  const char *letters = "spdfgh", *c;
+
+  FULFILL_OR_RETURN( psml_attr(nb_attributes, attributes, "l", value) != NULL,
+    PSPIO_EFILE_CORRUPT );
+  c = strchr(letters, value[0]);
+  FULFILL_OR_RETURN( (value[0] != '\0') && (value[1] == '\0') && (c != NULL),
+    PSPIO_EFILE_CORRUPT );
+  *l = (int)(c - letters);
+
+  return PSPIO_SUCCESS;
+}
+
+/* Stores a number of a data block */
+static int psml_push(psml_parser_t *p, const char *token, const char *end)
+{
+  char *last;
+
+  FULFILL_OR_RETURN( p->n < p->np, PSPIO_EFILE_CORRUPT );
+  p->values[p->n] = strtod(token, &last);
+  FULFILL_OR_RETURN( (last == end) && (last != token), PSPIO_EFILE_CORRUPT );
+  p->n++;
+
+  return PSPIO_SUCCESS;
+}
+
+/* Stores the number split across the previous chunks of characters */
+static int psml_flush(psml_parser_t *p)
+{
+  if ( p->ntoken == 0 ) return PSPIO_SUCCESS;
+  p->token[p->ntoken] = '\0';
+  SUCCEED_OR_RETURN( psml_push(p, p->token, p->token + p->ntoken) );
+  p->ntoken = 0;
+
+  return PSPIO_SUCCESS;
+}
+
+/*
+ * Scans a chunk of characters of a data block. Numbers followed by a
+ * blank are converted in place, only a number cut by the end of the
+ * chunk is copied until the next chunk completes it.
+ */
+static int psml_scan(psml_parser_t *p, const char *ch, int len)
+{
+  int i = 0, j;
+
+  while ( i < len ) {
+    if ( (ch[i] == ' ') || (ch[i] == '\n') || (ch[i] == '\t') || (ch[i] == '\r') ) {
+      SUCCEED_OR_RETURN( psml_flush(p) );
+      i++;
+    } else if ( p->ntoken > 0 ) {
+      FULFILL_OR_RETURN( p->ntoken < PSML_TOKEN-1, PSPIO_EFILE_CORRUPT );
+      p->token[p->ntoken++] = ch[i++];
+    } else {
+      for (j=i; (j<len) && (ch[j] != ' ') && (ch[j] != '\n') &&
+           (ch[j] != '\t') && (ch[j] != '\r'); j++);
+      if ( j == len ) {
+        FULFILL_OR_RETURN( j-i < PSML_TOKEN-1, PSPIO_EFILE_CORRUPT );
+        memcpy(p->token, ch+i, j-i);
+        p->ntoken = j - i;
+      } else {
+        SUCCEED_OR_RETURN( psml_push(p, ch+i, ch+j) );
+      }
+      i = j;
+    }
+  }
+
+  return PSPIO_SUCCESS;
+}
+
+/* Makes room for one more function in the current set */
+static int psml_grow(psml_parser_t *p)
+{
+  int i, n_max;
+
+  if ( p->n_funcs < p->max_funcs ) return PSPIO_SUCCESS;
+
+  n_max = (p->max_funcs == 0) ? 8 : 2*p->max_funcs;
+  p->potentials = (pspio_potential_t **) realloc (p->potentials, n_max*sizeof(pspio_potential_t *));
+  p->projectors = (pspio_projector_t **) realloc (p->projectors, n_max*sizeof(pspio_projector_t *));
+  p->states = (pspio_state_t **) realloc (p->states, n_max*sizeof(pspio_state_t *));
+  p->ekb = (double *) realloc (p->ekb, n_max*sizeof(double));
+  FULFILL_OR_EXIT( (p->potentials != NULL) && (p->projectors != NULL) &&
+    (p->states != NULL) && (p->ekb != NULL), PSPIO_ENOMEM );
+  for (i=p->max_funcs; i<n_max; i++) {
+    p->potentials[i] = NULL;
+    p->projectors[i] = NULL;
+    p->states[i] = NULL;
+  }
+  p->max_funcs = n_max;
+
+  return PSPIO_SUCCESS;
+}
+
+/* Frees the functions that were not handed over to pspdata */
+static void psml_free_funcs(psml_parser_t *p)
+{
+  int i;
+
+  for (i=0; i<p->n_funcs; i++) {
+    pspio_potential_free(p->potentials[i]);
+    pspio_projector_free(p->projectors[i]);
+    pspio_state_free(p->states[i]);
+    p->potentials[i] = NULL;
+    p->projectors[i] = NULL;
+    p->states[i] = NULL;
+  }
+  p->n_funcs = 0;
+}
+
+/* Builds the global grid from the numbers just read */
+static int psml_store_grid(psml_parser_t *p)
+{
+  int i;
+  pspio_mesh_t *mesh;
+
+  FULFILL_OR_RETURN( p->n == p->np, PSPIO_EFILE_CORRUPT );
+  SUCCEED_OR_RETURN( pspio_mesh_alloc(&p->pspdata->mesh, p->np) );
+  mesh = p->pspdata->mesh;
+  pspio_mesh_init_from_points(mesh, p->values, NULL);
+
+  /* PSML does not give the derivative of the grid */
+  if ( mesh->type == PSPIO_MESH_UNKNOWN ) {
+    mesh->rab[0] = mesh->r[1] - mesh->r[0];
+    for (i=1; i<p->np-1; i++) {
+      mesh->rab[i] = 0.5*(mesh->r[i+1] - mesh->r[i-1]);
+    }
+    mesh->rab[p->np-1] = mesh->r[p->np-1] - mesh->r[p->np-2];
+  }
+  p->pspdata->np = p->np;
+
+  return PSPIO_SUCCESS;
+}
+
+/* Stores the function just read, padded with zeros */
+static int psml_store_data(psml_parser_t *p)
+{
+  int i;
+  double occ;
+  char label[PSPIO_STRLEN_LINE];
+  pspio_pspdata_t *pspdata = p->pspdata;
+
+  FULFILL_OR_RETURN( p->n > 0, PSPIO_EFILE_CORRUPT );
+  for (i=p->n; i<p->np; i++) p->values[i] = 0.0;
+
+  switch (p->section) {
+  case PSML_RHO:
+    SUCCEED_OR_RETURN( pspio_meshfunc_alloc(&pspdata->rho_valence, p->np) );
+    SUCCEED_OR_RETURN( pspio_meshfunc_init(pspdata->rho_valence,
+      pspdata->mesh, p->values, NULL, NULL) );
+    break;
+
+  case PSML_CORE:
+    FULFILL_OR_RETURN( pspdata->xc != NULL, PSPIO_EFILE_CORRUPT );
+    SUCCEED_OR_RETURN( pspio_xc_set_nlcc_density(pspdata->xc, pspdata->mesh,
+      p->values, NULL, NULL) );
+    break;
+
+  case PSML_VLOCAL:
+    SUCCEED_OR_RETURN( pspio_qn_init(p->qn, 0, -1, 0.0) );
+    SUCCEED_OR_RETURN( pspio_potential_alloc(&pspdata->vlocal, p->np) );
+    SUCCEED_OR_RETURN( pspio_potential_init(pspdata->vlocal, p->qn,
+      pspdata->mesh, p->values) );
+    break;
+
+  case PSML_SLPS:
+    SUCCEED_OR_RETURN( psml_grow(p) );
+    SUCCEED_OR_RETURN( pspio_qn_init(p->qn, p->fn, p->fl, p->fj) );
+    SUCCEED_OR_RETURN( pspio_potential_alloc(&p->potentials[p->n_funcs], p->np) );
+    p->n_funcs++;
+    SUCCEED_OR_RETURN( pspio_potential_init(p->potentials[p->n_funcs-1], p->qn,
+      pspdata->mesh, p->values) );
+    break;
+
+  case PSML_PROJ:
+    SUCCEED_OR_RETURN( psml_grow(p) );
+    SUCCEED_OR_RETURN( pspio_qn_init(p->qn, p->fn, p->fl, p->fj) );
+    SUCCEED_OR_RETURN( pspio_projector_alloc(&p->projectors[p->n_funcs], p->np) );
+    p->ekb[p->n_funcs] = p->fekb;
+    if ( p->fl > p->l_proj ) p->l_proj = p->fl;
+    p->n_funcs++;
+    SUCCEED_OR_RETURN( pspio_projector_init(p->projectors[p->n_funcs-1], p->qn,
+      pspdata->mesh, p->values) );
+    break;
+
+  case PSML_PSWF:
+    SUCCEED_OR_RETURN( psml_grow(p) );
+    SUCCEED_OR_RETURN( pspio_qn_init(p->qn, p->fn, p->fl, p->fj) );
+    occ = 0.0;
+    for (i=0; i<p->n_shells; i++) {
+      if ( (p->shell_n[i] == p->fn) && (p->shell_l[i] == p->fl) ) {
+        occ = p->shell_occ[i];
+      }
+    }
+    sprintf(label, "%d%c", p->fn, "spdfgh"[p->fl]);
+    SUCCEED_OR_RETURN( pspio_state_alloc(&p->states[p->n_funcs], p->np) );
+    p->n_funcs++;
+    SUCCEED_OR_RETURN( pspio_state_init(p->states[p->n_funcs-1], 0.0, p->qn,
+      occ, 0.0, pspdata->mesh, p->values, label) );
+    break;
+  }
+
+  return PSPIO_SUCCESS;
+}
+
+/* Hands the functions of a set over to pspdata */
+static int psml_store_set(psml_parser_t *p)
+{
+  int i, ierr;
+  double *energies;
+  pspio_pspdata_t *pspdata = p->pspdata;
+
+  if ( p->n_funcs == 0 ) return PSPIO_SUCCESS;
+
+  switch (p->section) {
+  case PSML_SLPS:
+    SUCCEED_OR_RETURN( pspio_pspdata_set_n_potentials(pspdata, p->n_funcs) );
+    for (i=0; i<p->n_funcs; i++) {
+      SUCCEED_OR_RETURN( pspio_pspdata_take_potential(pspdata, i, &p->potentials[i]) );
+    }
+    break;
+
+  case PSML_PROJ:
+    SUCCEED_OR_RETURN( pspio_pspdata_set_n_projectors(pspdata, p->n_funcs) );
+    energies = (double *) calloc (p->n_funcs*p->n_funcs, sizeof(double));
+    FULFILL_OR_EXIT( energies != NULL, PSPIO_ENOMEM );
+    ierr = PSPIO_SUCCESS;
+    for (i=0; (i<p->n_funcs) && (ierr == PSPIO_SUCCESS); i++) {
+      energies[i*p->n_funcs + i] = p->ekb[i];
+      ierr = pspio_pspdata_take_projector(pspdata, i, &p->projectors[i]);
+    }
+    if ( ierr == PSPIO_SUCCESS ) {
+      ierr = pspio_pspdata_set_projector_energies(pspdata, energies);
+    }
+    free(energies);
+    SUCCEED_OR_RETURN( ierr );
+    break;
+
+  case PSML_PSWF:
+    SUCCEED_OR_RETURN( pspio_pspdata_set_n_states(pspdata, p->n_funcs) );
+    for (i=0; i<p->n_funcs; i++) {
+      SUCCEED_OR_RETURN( pspio_pspdata_take_state(pspdata, i, &p->states[i]) );
+    }
+    break;
+  }
+  p->n_funcs = 0;
+
+  return PSPIO_SUCCESS;
+}
+
+/* Reads the attributes of the provenance and of the atom */
+static int psml_start_spec(psml_parser_t *p, const char *name,
+                           int nb_attributes, const xmlChar **attributes)
+{
+  char value[PSPIO_STRLEN_LINE], symbol[4];
+  int id, year, month, day;
+  double x;
+  pspio_pspdata_t *pspdata = p->pspdata;
+
+  if ( strcmp(name, "provenance") == 0 ) {
+    /* Provenance records can be nested, the outermost one is kept */
+    if ( pspdata->pspinfo != NULL ) return PSPIO_SUCCESS;
+    SUCCEED_OR_RETURN( pspio_pspinfo_alloc(&pspdata->pspinfo) );
+    if ( psml_attr(nb_attributes, attributes, "creator", value) != NULL ) {
+      SUCCEED_OR_RETURN( pspio_pspinfo_set_code_name(pspdata->pspinfo, value) );
+      if ( strncmp(value, "ONCVPSP", 7) == 0 ) {
+        SUCCEED_OR_RETURN( pspio_pspdata_set_scheme(pspdata, PSPIO_SCM_ONCV) );
+      }
+    }
+    if ( (psml_attr(nb_attributes, attributes, "date", value) != NULL) &&
+         (sscanf(value, "%d-%d-%d", &year, &month, &day) == 3) ) {
+      SUCCEED_OR_RETURN( pspio_pspinfo_set_generation_year(pspdata->pspinfo, year) );
+      SUCCEED_OR_RETURN( pspio_pspinfo_set_generation_month(pspdata->pspinfo, month) );
+      SUCCEED_OR_RETURN( pspio_pspinfo_set_generation_day(pspdata->pspinfo, day) );
+    }
+
+  } else if ( strcmp(name, "pseudo-atom-spec") == 0 ) {
+    /* A single atom per file */
+    FULFILL_OR_RETURN( pspdata->xc == NULL, PSPIO_EFILE_CORRUPT );
+    SUCCEED_OR_RETURN( psml_attr_double(nb_attributes, attributes, "atomic-number", &x) );
+    SUCCEED_OR_RETURN( z_to_symbol(x, symbol) );
+    SUCCEED_OR_RETURN( pspio_pspdata_set_z(pspdata, x) );
+    SUCCEED_OR_RETURN( pspio_pspdata_set_symbol(pspdata, symbol) );
+    SUCCEED_OR_RETURN( psml_attr_double(nb_attributes, attributes, "z-pseudo", &x) );
+    SUCCEED_OR_RETURN( pspio_pspdata_set_zvalence(pspdata, x) );
+    SUCCEED_OR_RETURN( pspio_pspdata_set_nelvalence(pspdata, x) );
+
+    if ( psml_attr(nb_attributes, attributes, "relativity", value) != NULL ) {
+      if ( strcmp(value, "dirac") == 0 ) {
+        pspdata->wave_eq = PSPIO_EQN_DIRAC;
+      } else if ( strcmp(value, "scalar") == 0 ) {
+        pspdata->wave_eq = PSPIO_EQN_SCALAR_REL;
+      } else {
+        pspdata->wave_eq = PSPIO_EQN_SCHRODINGER;
+      }
+    }
+
+    SUCCEED_OR_RETURN( pspio_xc_alloc(&pspdata->xc) );
+    if ( (psml_attr(nb_attributes, attributes, "core-corrections", value) != NULL) &&
+         (strcmp(value, "yes") == 0) ) {
+      SUCCEED_OR_RETURN( pspio_xc_set_nlcc_scheme(pspdata->xc, PSPIO_NLCC_UNKNOWN) );
+    } else {
+      SUCCEED_OR_RETURN( pspio_xc_set_nlcc_scheme(pspdata->xc, PSPIO_NLCC_NONE) );
+    }
+
+  } else if ( strcmp(name, "functional") == 0 ) {
+    FULFILL_OR_RETURN( pspdata->xc != NULL, PSPIO_EFILE_CORRUPT );
+    SUCCEED_OR_RETURN( psml_attr_int(nb_attributes, attributes, "id", &id) );
+    FULFILL_OR_RETURN( psml_attr(nb_attributes, attributes, "type", value) != NULL,
+      PSPIO_EFILE_CORRUPT );
+    if ( strstr(value, "exchange") != NULL ) {
+      SUCCEED_OR_RETURN( pspio_xc_set_exchange(pspdata->xc, id) );
+    }
+    if ( strstr(value, "correlation") != NULL ) {
+      SUCCEED_OR_RETURN( pspio_xc_set_correlation(pspdata->xc, id) );
+    }
+
+  } else if ( strcmp(name, "valence-configuration") == 0 ) {
+    if ( psml_attr(nb_attributes, attributes, "total-valence-charge", value) != NULL ) {
+      SUCCEED_OR_RETURN( psml_attr_double(nb_attributes, attributes,
+        "total-valence-charge", &x) );
+      SUCCEED_OR_RETURN( pspio_pspdata_set_nelvalence(pspdata, x) );
+    }
+
+  } else if ( strcmp(name, "shell") == 0 ) {
+    FULFILL_OR_RETURN( p->n_shells < PSML_SHELLS, PSPIO_EFILE_CORRUPT );
+    SUCCEED_OR_RETURN( psml_attr_int(nb_attributes, attributes, "n",
+      &p->shell_n[p->n_shells]) );
+    SUCCEED_OR_RETURN( psml_attr_l(nb_attributes, attributes,
+      &p->shell_l[p->n_shells]) );
+    SUCCEED_OR_RETURN( psml_attr_double(nb_attributes, attributes, "occupation",
+      &p->shell_occ[p->n_shells]) );
+    p->n_shells++;
+  }
+
+  return PSPIO_SUCCESS;
+}
+
+/* Handles the opening of an element */
+static int psml_start(psml_parser_t *p, const char *name,
+                      int nb_attributes, const xmlChar **attributes)
+{
+  int i;
+  char value[PSPIO_STRLEN_LINE];
+
+  /* The root element identifies the format */
+  if ( !p->root ) {
+    FULFILL_OR_RETURN( strcmp(name, "psml") == 0, PSPIO_EFILE_FORMAT );
+    p->root = 1;
+    return PSPIO_SUCCESS;
+  }
+
+  if ( strcmp(name, "grid") == 0 ) {
+    /* Grids local to a set of functions are not supported */
+    FULFILL_OR_RETURN( (p->section == PSML_NONE) && (p->pspdata->mesh == NULL),
+      PSPIO_ENOSUPPORT );
+    SUCCEED_OR_RETURN( psml_attr_int(nb_attributes, attributes, "npts", &p->np) );
+    FULFILL_OR_RETURN( p->np > 1, PSPIO_EFILE_CORRUPT );
+    if ( p->header ) {
+      p->pspdata->np = p->np;
+      p->stop = 1;
+      xmlStopParser(p->ctxt);
+      return PSPIO_SUCCESS;
+    }
+    p->values = (double *) malloc (p->np*sizeof(double));
+    FULFILL_OR_EXIT( p->values != NULL, PSPIO_ENOMEM );
+
+  } else if ( strcmp(name, "grid-data") == 0 ) {
+    FULFILL_OR_RETURN( p->values != NULL, PSPIO_EFILE_CORRUPT );
+    p->in_data = 1;
+    p->n = 0;
+
+  } else if ( strcmp(name, "data") == 0 ) {
+    if ( p->section > PSML_SKIP ) {
+      p->in_data = 1;
+      p->n = 0;
+    }
+
+  } else if ( (strcmp(name, "slps") == 0) || (strcmp(name, "proj") == 0) ||
+              (strcmp(name, "pswf") == 0) ) {
+    if ( p->section <= PSML_SKIP ) return PSPIO_SUCCESS;
+    SUCCEED_OR_RETURN( psml_attr_l(nb_attributes, attributes, &p->fl) );
+    SUCCEED_OR_RETURN( psml_attr_int(nb_attributes, attributes,
+      (p->section == PSML_PROJ) ? "seq" : "n", &p->fn) );
+    p->fj = 0.0;
+    if ( psml_attr(nb_attributes, attributes, "j", value) != NULL ) {
+      SUCCEED_OR_RETURN( psml_attr_double(nb_attributes, attributes, "j", &p->fj) );
+    }
+    p->fekb = 0.0;
+    if ( p->section == PSML_PROJ ) {
+      SUCCEED_OR_RETURN( psml_attr_double(nb_attributes, attributes, "ekb", &p->fekb) );
+    }
+    if ( p->fl > p->l_max ) p->l_max = p->fl;
+
+  } else {
+    for (i=0; psml_sections[i].name != NULL; i++) {
+      if ( strcmp(name, psml_sections[i].name) == 0 ) break;
+    }
+    if ( psml_sections[i].name == NULL ) {
+      return psml_start_spec(p, name, nb_attributes, attributes);
+    }
+
+    /* Only the first set of each kind is read */
+    if ( (p->seen & psml_sections[i].section) || (psml_sections[i].load &&
+         !(p->pspdata->loaded & psml_sections[i].load)) ) {
+      p->section = PSML_SKIP;
+    } else {
+      FULFILL_OR_RETURN( p->pspdata->mesh != NULL, PSPIO_EFILE_CORRUPT );
+      p->section = psml_sections[i].section;
+      p->seen |= p->section;
+    }
+  }
+
+  return PSPIO_SUCCESS;
+}
+
+/* Handles the closing of an element */
+static int psml_end(psml_parser_t *p, const char *name)
+{
+  int i;
+
+  if ( strcmp(name, "grid-data") == 0 ) {
+    SUCCEED_OR_RETURN( psml_flush(p) );
+    p->in_data = 0;
+    SUCCEED_OR_RETURN( psml_store_grid(p) );
+
+  } else if ( strcmp(name, "data") == 0 ) {
+    if ( p->in_data ) {
+      SUCCEED_OR_RETURN( psml_flush(p) );
+      p->in_data = 0;
+      SUCCEED_OR_RETURN( psml_store_data(p) );
+    }
+
+  } else if ( strcmp(name, "psml") == 0 ) {
+    p->done = 1;
+
+  } else {
+    for (i=0; psml_sections[i].name != NULL; i++) {
+      if ( strcmp(name, psml_sections[i].name) == 0 ) {
+        SUCCEED_OR_RETURN( psml_store_set(p) );
+        p->section = PSML_NONE;
+      }
+    }
+  }
+
+  return PSPIO_SUCCESS;
+}
+
+
+/**********************************************************************
+ * SAX handlers                                                       *
+ **********************************************************************/
+
+static void psml_sax_start(void *ctx, const xmlChar *localname,
+                           const xmlChar *prefix, const xmlChar *uri,
+                           int nb_namespaces, const xmlChar **namespaces,
+                           int nb_attributes, int nb_defaulted,
+                           const xmlChar **attributes)
+{
+  psml_parser_t *p = (psml_parser_t *)ctx;
+
+  (void)prefix;
+  (void)uri;
+  (void)nb_namespaces;
+  (void)namespaces;
+  (void)nb_defaulted;
+
+  if ( (p->ierr != PSPIO_SUCCESS) || p->stop ) return;
+  p->ierr = psml_start(p, (const char *)localname, nb_attributes, attributes);
+  if ( p->ierr != PSPIO_SUCCESS ) xmlStopParser(p->ctxt);
+}
+
+static void psml_sax_end(void *ctx, const xmlChar *localname,
+                         const xmlChar *prefix, const xmlChar *uri)
+{
+  psml_parser_t *p = (psml_parser_t *)ctx;
+
+  (void)prefix;
+  (void)uri;
+
+  if ( (p->ierr != PSPIO_SUCCESS) || p->stop ) return;
+  p->ierr = psml_end(p, (const char *)localname);
+  if ( p->ierr != PSPIO_SUCCESS ) xmlStopParser(p->ctxt);
+}
+
+static void psml_sax_characters(void *ctx, const xmlChar *ch, int len)
+{
+  psml_parser_t *p = (psml_parser_t *)ctx;
+
+  if ( (p->ierr != PSPIO_SUCCESS) || p->stop || !p->in_data ) return;
+  p->ierr = psml_scan(p, (const char *)ch, len);
+  if ( p->ierr != PSPIO_SUCCESS ) xmlStopParser(p->ctxt);
+}
+
+/* Syntax errors are reported through the error chain only */
+static void psml_sax_error(void *ctx, xmlErrorPtr error)
+{
+  (void)ctx;
+  (void)error;
+}
+
+/* Parses the whole stream, or its header */
+static int psml_parse(FILE *fp, pspio_pspdata_t *pspdata, int header)
+{
+  char buffer[PSML_CHUNK];
+  size_t nread;
+  int ierr;
+  xmlSAXHandler sax;
+  psml_parser_t p;
+
+  assert(fp != NULL);
+  assert(pspdata != NULL);
+
+  memset(&sax, 0, sizeof(sax));
+  sax.initialized = XML_SAX2_MAGIC;
+  sax.startElementNs = psml_sax_start;
+  sax.endElementNs = psml_sax_end;
+  sax.characters = psml_sax_characters;
+  sax.serror = psml_sax_error;
+
+  memset(&p, 0, sizeof(p));
+  p.pspdata = pspdata;
+  p.header = header;
+  p.ierr = PSPIO_SUCCESS;
+  p.l_max = -1;
+  p.l_proj = -1;
+  SUCCEED_OR_RETURN( pspio_qn_alloc(&p.qn) );
+
+  xmlInitParser();
+  p.ctxt = xmlCreatePushParserCtxt(&sax, &p, NULL, 0, NULL);
+  FULFILL_OR_EXIT( p.ctxt != NULL, PSPIO_ENOMEM );
+  xmlCtxtUseOptions(p.ctxt, XML_PARSE_NONET);
+
+  /* Feed the parser chunk by chunk, the handlers fill pspdata */
+  ierr = 0;
+  while ( (ierr == 0) && (p.ierr == PSPIO_SUCCESS) && !p.stop &&
+          ((nread = fread(buffer, 1, PSML_CHUNK, fp)) > 0) ) {
+    ierr = xmlParseChunk(p.ctxt, buffer, (int)nread, 0);
+  }
+  if ( (ierr == 0) && (p.ierr == PSPIO_SUCCESS) && !p.stop ) {
+    ierr = xmlParseChunk(p.ctxt, NULL, 0, 1);
+  }
+  xmlFreeParserCtxt(p.ctxt);
+
+  psml_free_funcs(&p);
+  free(p.potentials);
+  free(p.projectors);
+  free(p.states);
+  free(p.ekb);
+  free(p.values);
+  pspio_qn_free(p.qn);
+
+  FULFILL_OR_RETURN( p.ierr == PSPIO_SUCCESS, p.ierr );
+  FULFILL_OR_RETURN( p.stop || (ierr == 0), PSPIO_EFILE_FORMAT );
+  FULFILL_OR_RETURN( p.stop || (p.done && (pspdata->mesh != NULL)),
+    PSPIO_EFILE_CORRUPT );
+  FULFILL_OR_RETURN( pspdata->xc != NULL, PSPIO_EFILE_CORRUPT );
+
+  /* The local potential is not one of the channels */
+  if ( !header ) {
+    pspdata->l_max = (p.l_max < 0) ? 0 : p.l_max;
+    pspdata->l_local = -1;
+    if ( p.l_proj >= 0 ) {
+      SUCCEED_OR_RETURN( pspio_pspdata_set_projectors_l_max(pspdata, p.l_proj) );
+    }
+  }
+
+  return PSPIO_SUCCESS;
+}
+
+#endif
+
+
+/**********************************************************************
+ * Global routines                                                    *
+ **********************************************************************/
+
+int pspio_psml_read(FILE *fp, pspio_pspdata_t *pspdata)
+{
+#if defined HAVE_XML
+  SUCCEED_OR_RETURN( psml_parse(fp, pspdata, 0) );
+
+  return PSPIO_SUCCESS;
+#else
+  (void)fp;
+  (void)pspdata;
+  RETURN_WITH_ERROR( PSPIO_ENOSUPPORT );
+#endif
+}
+
+int pspio_psml_read_header(FILE *fp, pspio_pspdata_t *pspdata)
+{
+#if defined HAVE_XML
+  SUCCEED_OR_RETURN( psml_parse(fp, pspdata, 1) );
+
+  return PSPIO_SUCCESS;
+#else
+  (void)fp;
+  (void)pspdata;
+  RETURN_WITH_ERROR( PSPIO_ENOSUPPORT );
+#endif
+}
@@ -0,0 +1,57 @@
+/* Copyright (C) 2018 Micael Oliveira <micael.oliveira@mpsd.mpg.de>
+ *                    Yann Pouillon <devops@materialsevolution.es>
+ *
+ * This file is part of Libpspio.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * version 2.0. If a copy of the MPL was not distributed with this file, You
+ * can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Libpspio is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the Mozilla Public License version 2.0 for
+ * more details.
+ */
+
+/**
+ * @file psml.h
+ * @brief header file for the PSML routines accessible to the other
+ *        parts of the library
+ */
+
+#if !defined PSPIO_PSML_H
+#define PSPIO_PSML_H
+
+#include <stdio.h>
+#include <assert.h>
+
+#include "pspio_pspdata.h"
+
+
+/**********************************************************************
+ * Global routines                                                    *
+ **********************************************************************/
+
+/**
+ * Read the content of a PSML file and store it in the psp_data
+ * structure. The file is parsed as a stream of SAX events, and the
+ * numbers of each radial function are scanned into a buffer of the
+ * size of the grid, so that no document tree is built.
+ * @param[in] fp a stream of the input file
+ * @param[in,out] pspdata the data structure
+ * @return error code: PSPIO_ENOSUPPORT if Libpspio was built without
+ *         XML support
+ * @note Only the global grid is supported, and only the first set of
+ *       each kind of functions is read.
+ */
+int pspio_psml_read(FILE * fp, pspio_pspdata_t *pspdata);
+
+/**
+ * Read the atom specification of a PSML file, stopping at the grid
+ * @param[in] fp a stream of the input file
+ * @param[in,out] pspdata the data structure
+ * @return error code
+ */
+int pspio_psml_read_header(FILE * fp, pspio_pspdata_t *pspdata);
+
+#endif
@@ -24,6 +24,11 @@
  */
 
 #include "pspio_error.h"
+#include "pspio_gth.h"
 #include "pspio_pspdata.h"
+#include "pspio_packed.h"
+#include "pspio_resample.h"
+#include "pspio_library.h"
+#include "pspio_shared.h"
 
 #endif
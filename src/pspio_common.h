@@ -128,6 +128,27 @@
  */
 #define PSPIO_INTERP_GSL_CSPLINE 1
 #define PSPIO_INTERP_JB_CSPLINE 2
+#define PSPIO_INTERP_HERMITE3 3 /**< local cubic Hermite, from f and f' */
+#define PSPIO_INTERP_HERMITE5 4 /**< local quintic Hermite, from f, f' and f'' */
+#define PSPIO_INTERP_SINGLE 256 /**< flag adding a single-precision copy, see pspio_interp_alloc */
+
+
+/**
+ * Variables of the uniform lookup tables of mesh functions
+ */
+#define PSPIO_TABLE_R  1 /**< uniform in r */
+#define PSPIO_TABLE_R2 2 /**< uniform in r^2 */
+
+
+/**
+ * Components of a pseudopotential file that can be loaded selectively
+ */
+#define PSPIO_LOAD_STATES      1 /**< pseudo-wavefunctions */
+#define PSPIO_LOAD_POTENTIALS  2 /**< semi-local potentials */
+#define PSPIO_LOAD_PROJECTORS  4 /**< non-local projectors and their energies */
+#define PSPIO_LOAD_VLOCAL      8 /**< local potential */
+#define PSPIO_LOAD_RHO_VALENCE 16 /**< valence density */
+#define PSPIO_LOAD_ALL         31
 
 
 /** 
@@ -142,4 +163,32 @@
 #define PSPIO_NLCC_ATOM 5 /* Scheme implemented in the ATOM pseudopotential generator code. */
 #define PSPIO_NLCC_ONCV 5 /* Scheme implemented in the ONCVPSP pseudopotential generator code. */
 
+/**
+ * Instrumentation counters
+ *
+ * Note: keep the number of counters up-to-date
+ */
+#define PSPIO_NCOUNTERS 11
+#define PSPIO_COUNTER_BYTES_READ      0 /**< bytes read from input files */
+#define PSPIO_COUNTER_LINES_PARSED    1 /**< lines read from input files */
+#define PSPIO_COUNTER_SPLINE_INITS    2 /**< interpolation objects initialized */
+#define PSPIO_COUNTER_EVAL_MESHFUNC   3 /**< mesh function evaluations */
+#define PSPIO_COUNTER_EVAL_POTENTIAL  4 /**< potential evaluations */
+#define PSPIO_COUNTER_EVAL_PROJECTOR  5 /**< projector evaluations */
+#define PSPIO_COUNTER_EVAL_STATE      6 /**< wavefunction evaluations */
+#define PSPIO_COUNTER_EVAL_XC         7 /**< core density evaluations */
+#define PSPIO_COUNTER_EXTRAPOLATIONS  8 /**< evaluations outside of the mesh */
+#define PSPIO_COUNTER_ALLOCS          9 /**< objects allocated */
+#define PSPIO_COUNTER_COPIES         10 /**< objects copied */
+
+/**
+ * Instrumentation timers
+ *
+ * Note: keep the number of timers up-to-date
+ */
+#define PSPIO_NTIMERS 3
+#define PSPIO_TIMER_READ        0 /**< time spent reading files */
+#define PSPIO_TIMER_WRITE       1 /**< time spent writing files */
+#define PSPIO_TIMER_INTERP_INIT 2 /**< time spent initializing interpolations */
+
 #endif
@@ -26,8 +26,12 @@
 #include "config.h"
 #endif
 
-/* Store successive errors in a chain */
-static pspio_error_t *pspio_error_chain = NULL;
+#if !defined PSPIO_THREAD_LOCAL
+#define PSPIO_THREAD_LOCAL
+#endif
+
+/* Store successive errors in a chain, one per thread */
+static PSPIO_THREAD_LOCAL pspio_error_t *pspio_error_chain = NULL;
 
 int pspio_error_add(int error_id, const char *filename, int line, const char *routine)
 {
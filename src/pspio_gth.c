@@ -0,0 +1,525 @@
+/* Copyright (C) 2018 Micael Oliveira <micael.oliveira@mpsd.mpg.de>
+ *                    Yann Pouillon <devops@materialsevolution.es>
+ *
+ * This file is part of Libpspio.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * version 2.0. If a copy of the MPL was not distributed with this file, You
+ * can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Libpspio is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the Mozilla Public License version 2.0 for
+ * more details.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+
+#include "pspio_gth.h"
+#include "util.h"
+
+#if defined HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+
+/**********************************************************************
+ * Private routines                                                   *
+ **********************************************************************/
+
+/* Below this value of r/(sqrt(2) rloc), erf(u)/u is taken from its series */
+#define GTH_SERIES_U 1.0e-2
+
+/* Returns r^n, or 0 for negative n, whose coefficients always vanish */
+static double gth_pow(double r, int n)
+{
+  double p = 1.0;
+
+  if ( n < 0 ) return 0.0;
+  while ( n-- > 0 ) p *= r;
+
+  return p;
+}
+
+/* Derivatives of order 0 to 2 of the erf(u)/u series, without 2/sqrt(pi) */
+static double gth_erf_series(double u, int order)
+{
+  double u2 = u*u;
+
+  switch (order) {
+  case 0:
+    return 1.0 - u2/3.0 + u2*u2/10.0 - u2*u2*u2/42.0;
+  case 1:
+    return u*(-2.0/3.0 + 0.4*u2 - u2*u2/7.0);
+  default:
+    return -2.0/3.0 + 1.2*u2 - 5.0*u2*u2/7.0;
+  }
+}
+
+/* Derivatives of order 0 to 2 of the local part */
+static double gth_local(const pspio_gth_term_t *term, double r, int order)
+{
+  double a, z, u, x, e, s, c, q, dq, d2q, vc, vg;
+
+  a = term->r;
+  z = term->zion;
+  u = r / (sqrt(2.0)*a);
+  x = r / a;
+
+  /* Long-range part, -zion erf(u)/r */
+  if ( u < GTH_SERIES_U ) {
+    s = -z * 2.0/sqrt(M_PI) * gth_erf_series(u, order);
+    switch (order) {
+    case 0:
+      vc = s / (sqrt(2.0)*a);
+      break;
+    case 1:
+      vc = s / (2.0*a*a);
+      break;
+    default:
+      vc = s / (2.0*sqrt(2.0)*a*a*a);
+    }
+  } else {
+    c = z * sqrt(2.0/M_PI) / a;
+    e = exp(-u*u);
+    switch (order) {
+    case 0:
+      vc = -z * erf(u) / r;
+      break;
+    case 1:
+      vc = z * erf(u)/(r*r) - c*e/r;
+      break;
+    default:
+      vc = -2.0*z*erf(u)/(r*r*r) + 2.0*c*e/(r*r) + c*e/(a*a);
+    }
+  }
+
+  /* Short-range part, exp(-x^2/2) Q(x) */
+  e = exp(-0.5*x*x);
+  q = term->c[0] + x*x*(term->c[1] + x*x*(term->c[2] + x*x*term->c[3]));
+  dq = x*(2.0*term->c[1] + x*x*(4.0*term->c[2] + 6.0*x*x*term->c[3]));
+  d2q = 2.0*term->c[1] + x*x*(12.0*term->c[2] + 30.0*x*x*term->c[3]);
+  switch (order) {
+  case 0:
+    vg = e*q;
+    break;
+  case 1:
+    vg = e*(dq - x*q)/a;
+    break;
+  default:
+    vg = e*((x*x - 1.0)*q - 2.0*x*dq + d2q)/(a*a);
+  }
+
+  return vc + vg;
+}
+
+/* Derivatives of order 0 to 2 of a projector */
+static double gth_projector(const pspio_gth_term_t *term, double r, int order)
+{
+  int m;
+  double a2, e;
+
+  m = term->l + 2*term->i;
+  a2 = term->r * term->r;
+  e = term->norm * exp(-0.5*r*r/a2);
+
+  switch (order) {
+  case 0:
+    return e*gth_pow(r, m);
+  case 1:
+    return e*(m*gth_pow(r, m-1) - gth_pow(r, m+1)/a2);
+  default:
+    return e*(m*(m-1)*gth_pow(r, m-2) - (2*m+1)*gth_pow(r, m)/a2 +
+      gth_pow(r, m+2)/(a2*a2));
+  }
+}
+
+/*
+ * Generalized Laguerre polynomial L_i^(a)(t) and its derivative, for
+ * i up to 2
+ */
+static void gth_laguerre(int i, double a, double t, double *p, double *dp)
+{
+  switch (i) {
+  case 0:
+    *p = 1.0;
+    *dp = 0.0;
+    break;
+  case 1:
+    *p = 1.0 + a - t;
+    *dp = -1.0;
+    break;
+  default:
+    *p = 0.5*((a + 1.0)*(a + 2.0) - 2.0*(a + 2.0)*t + t*t);
+    *dp = t - (a + 2.0);
+  }
+}
+
+/*
+ * Fourier-Bessel transform of a projector, from
+ *   int r^(l+2+2i) j_l(qr) exp(-r^2/(2 r_l^2)) dr =
+ *     sqrt(pi)/2^(l+2) i! (2 r_l^2)^(l+3/2+i) q^l exp(-t) L_i^(l+1/2)(t)
+ * with t = (q r_l)^2/2
+ */
+static double gth_projector_q(const pspio_gth_term_t *term, double q, int order)
+{
+  int l, i;
+  double a2, t, pre, lag, dlag, ql;
+
+  l = term->l;
+  i = term->i;
+  a2 = term->r * term->r;
+  t = 0.5*q*q*a2;
+
+  pre = 4.0*M_PI*term->norm * sqrt(M_PI)/gth_pow(2.0, l+2) *
+    ((i == 2) ? 2.0 : 1.0) * pow(2.0*a2, l + 1.5 + i) * exp(-t);
+  gth_laguerre(i, l + 0.5, t, &lag, &dlag);
+  ql = gth_pow(q, l);
+
+  if ( order == 0 ) return pre*ql*lag;
+
+  return pre*(l*gth_pow(q, l-1)*lag + ql*q*a2*(dlag - lag));
+}
+
+/* Transform of the local part and its derivative, for q > 0 */
+static double gth_local_q(const pspio_gth_term_t *term, double q, int order)
+{
+  double a, y, e, p, dp, g;
+  const double *c = term->c;
+
+  a = term->r;
+  y = q*q*a*a;
+  e = exp(-0.5*y);
+  g = sqrt(8.0*M_PI*M_PI*M_PI) * a*a*a;
+  p = c[0] + c[1]*(3.0 - y) + c[2]*(15.0 - 10.0*y + y*y) +
+    c[3]*(105.0 - 105.0*y + 21.0*y*y - y*y*y);
+
+  if ( q == 0.0 ) {
+    assert(order == 0);
+    return 2.0*M_PI*term->zion*a*a + g*p;
+  }
+
+  if ( order == 0 ) return -4.0*M_PI*term->zion*e/(q*q) + g*e*p;
+
+  dp = -c[1] + c[2]*(2.0*y - 10.0) + c[3]*(-105.0 + 42.0*y - 3.0*y*y);
+  return 4.0*M_PI*term->zion*e*(a*a/q + 2.0/(q*q*q)) +
+    g*e*q*a*a*(2.0*dp - p);
+}
+
+
+/**********************************************************************
+ * Global routines                                                    *
+ **********************************************************************/
+
+int pspio_gth_alloc(pspio_gth_t **gth)
+{
+  assert(gth != NULL);
+  assert(*gth == NULL);
+
+  *gth = (pspio_gth_t *) malloc (sizeof(pspio_gth_t));
+  FULFILL_OR_EXIT( *gth != NULL, PSPIO_ENOMEM );
+
+  memset(*gth, 0, sizeof(pspio_gth_t));
+  (*gth)->l_max = -1;
+
+  return PSPIO_SUCCESS;
+}
+
+int pspio_gth_init(pspio_gth_t *gth, double zion, double rloc, int nc,
+                   const double *c)
+{
+  int i;
+
+  assert(gth != NULL);
+  assert(nc >= 0 && nc <= 4);
+  assert(nc == 0 || c != NULL);
+
+  FULFILL_OR_RETURN( rloc > 0.0, PSPIO_EVALUE );
+
+  gth->zion = zion;
+  gth->rloc = rloc;
+  for (i=0; i<4; i++) {
+    gth->c[i] = (i < nc) ? c[i] : 0.0;
+  }
+
+  return PSPIO_SUCCESS;
+}
+
+int pspio_gth_set_channel(pspio_gth_t *gth, int l, double r, int n,
+                          const double *h, const double *k)
+{
+  int i, j;
+
+  assert(gth != NULL);
+  assert(n == 0 || h != NULL);
+
+  FULFILL_OR_RETURN( (l >= 0) && (l <= PSPIO_GTH_L_MAX), PSPIO_EVALUE );
+  FULFILL_OR_RETURN( (n >= 0) && (n <= PSPIO_GTH_N_PROJ), PSPIO_EVALUE );
+  FULFILL_OR_RETURN( (n == 0) || (r > 0.0), PSPIO_EVALUE );
+
+  memset(gth->h[l], 0, sizeof(gth->h[l]));
+  memset(gth->k[l], 0, sizeof(gth->k[l]));
+  for (i=0; i<n; i++) {
+    for (j=0; j<n; j++) {
+      gth->h[l][i][j] = 0.5*(h[i*n+j] + h[j*n+i]);
+      if ( (k != NULL) && (l > 0) ) gth->k[l][i][j] = 0.5*(k[i*n+j] + k[j*n+i]);
+    }
+  }
+  gth->r[l] = (n > 0) ? r : 0.0;
+  gth->n_proj[l] = n;
+
+  gth->l_max = -1;
+  for (i=0; i<=PSPIO_GTH_L_MAX; i++) {
+    if ( gth->n_proj[i] > 0 ) gth->l_max = i;
+  }
+
+  return PSPIO_SUCCESS;
+}
+
+int pspio_gth_set_channel_hgh(pspio_gth_t *gth, int l, double r,
+                              const double h[3], const double k[3])
+{
+  /* Off-diagonal elements 12, 13 and 23 in units of 22, 33 and 33 */
+  const double rel[3][3] = {
+    {-0.5*sqrt(3.0/5.0), 0.5*sqrt(5.0/21.0), -0.5*sqrt(100.0/63.0)},
+    {-0.5*sqrt(5.0/7.0), sqrt(35.0/11.0)/6.0, -14.0/(6.0*sqrt(11.0))},
+    {-0.5*sqrt(7.0/9.0), 0.5*sqrt(63.0/143.0), -9.0/sqrt(143.0)}
+  };
+  int i, n;
+  double hm[9], km[9];
+
+  assert(h != NULL);
+
+  FULFILL_OR_RETURN( (l >= 0) && (l <= PSPIO_GTH_L_MAX), PSPIO_EVALUE );
+
+  /* The trailing zeros of the diagonal are not projectors */
+  n = 0;
+  if ( r > 0.0 ) {
+    for (i=0; i<3; i++) {
+      if ( h[i] != 0.0 ) n = i + 1;
+    }
+  }
+
+  memset(hm, 0, sizeof(hm));
+  memset(km, 0, sizeof(km));
+  for (i=0; i<n; i++) {
+    hm[i*n+i] = h[i];
+    if ( k != NULL ) km[i*n+i] = k[i];
+  }
+  if ( l < 3 ) {
+    if ( n > 1 ) {
+      hm[1] = hm[n] = rel[l][0]*h[1];
+      if ( k != NULL ) km[1] = km[n] = rel[l][0]*k[1];
+    }
+    if ( n > 2 ) {
+      hm[2] = hm[6] = rel[l][1]*h[2];
+      hm[5] = hm[7] = rel[l][2]*h[2];
+      if ( k != NULL ) {
+        km[2] = km[6] = rel[l][1]*k[2];
+        km[5] = km[7] = rel[l][2]*k[2];
+      }
+    }
+  }
+
+  return pspio_gth_set_channel(gth, l, r, n, hm, (k != NULL) ? km : NULL);
+}
+
+int pspio_gth_copy(pspio_gth_t **dst, const pspio_gth_t *src)
+{
+  assert(dst != NULL);
+  assert(src != NULL);
+
+  if ( *dst == NULL ) {
+    SUCCEED_OR_RETURN( pspio_gth_alloc(dst) );
+  }
+  memcpy(*dst, src, sizeof(pspio_gth_t));
+
+  return PSPIO_SUCCESS;
+}
+
+void pspio_gth_free(pspio_gth_t *gth)
+{
+  free(gth);
+}
+
+
+/**********************************************************************
+ * Getters                                                            *
+ **********************************************************************/
+
+double pspio_gth_get_zion(const pspio_gth_t *gth)
+{
+  assert(gth != NULL);
+
+  return gth->zion;
+}
+
+double pspio_gth_get_rloc(const pspio_gth_t *gth)
+{
+  assert(gth != NULL);
+
+  return gth->rloc;
+}
+
+double pspio_gth_get_c(const pspio_gth_t *gth, int i)
+{
+  assert(gth != NULL);
+  assert(i >= 0 && i < 4);
+
+  return gth->c[i];
+}
+
+int pspio_gth_get_l_max(const pspio_gth_t *gth)
+{
+  assert(gth != NULL);
+
+  return gth->l_max;
+}
+
+int pspio_gth_get_n_proj(const pspio_gth_t *gth, int l)
+{
+  assert(gth != NULL);
+  assert(l >= 0 && l <= PSPIO_GTH_L_MAX);
+
+  return gth->n_proj[l];
+}
+
+double pspio_gth_get_r(const pspio_gth_t *gth, int l)
+{
+  assert(gth != NULL);
+  assert(l >= 0 && l <= PSPIO_GTH_L_MAX);
+
+  return gth->r[l];
+}
+
+double pspio_gth_get_h(const pspio_gth_t *gth, int l, int i, int j)
+{
+  assert(gth != NULL);
+  assert(l >= 0 && l <= PSPIO_GTH_L_MAX);
+  assert(i >= 0 && i < PSPIO_GTH_N_PROJ && j >= 0 && j < PSPIO_GTH_N_PROJ);
+
+  return gth->h[l][i][j];
+}
+
+double pspio_gth_get_k(const pspio_gth_t *gth, int l, int i, int j)
+{
+  assert(gth != NULL);
+  assert(l >= 0 && l <= PSPIO_GTH_L_MAX);
+  assert(i >= 0 && i < PSPIO_GTH_N_PROJ && j >= 0 && j < PSPIO_GTH_N_PROJ);
+
+  return gth->k[l][i][j];
+}
+
+
+/**********************************************************************
+ * Utility routines                                                   *
+ **********************************************************************/
+
+int pspio_gth_cmp(const pspio_gth_t *gth1, const pspio_gth_t *gth2)
+{
+  int l, i, j;
+
+  assert(gth1 != NULL);
+  assert(gth2 != NULL);
+
+  if ( (fabs(gth1->zion - gth2->zion) > 1e-10) ||
+       (fabs(gth1->rloc - gth2->rloc) > 1e-10) ||
+       (gth1->l_max != gth2->l_max) ) {
+    return PSPIO_DIFF;
+  }
+  for (i=0; i<4; i++) {
+    if ( fabs(gth1->c[i] - gth2->c[i]) > 1e-10 ) return PSPIO_DIFF;
+  }
+  for (l=0; l<=PSPIO_GTH_L_MAX; l++) {
+    if ( (gth1->n_proj[l] != gth2->n_proj[l]) ||
+         (fabs(gth1->r[l] - gth2->r[l]) > 1e-10) ) {
+      return PSPIO_DIFF;
+    }
+    for (i=0; i<PSPIO_GTH_N_PROJ; i++) {
+      for (j=0; j<PSPIO_GTH_N_PROJ; j++) {
+        if ( (fabs(gth1->h[l][i][j] - gth2->h[l][i][j]) > 1e-10) ||
+             (fabs(gth1->k[l][i][j] - gth2->k[l][i][j]) > 1e-10) ) {
+          return PSPIO_DIFF;
+        }
+      }
+    }
+  }
+
+  return PSPIO_EQUAL;
+}
+
+int pspio_gth_term_local(const pspio_gth_t *gth, pspio_gth_term_t *term)
+{
+  assert(gth != NULL);
+  assert(term != NULL);
+
+  FULFILL_OR_RETURN( gth->rloc > 0.0, PSPIO_EVALUE );
+
+  memset(term, 0, sizeof(pspio_gth_term_t));
+  term->l = -1;
+  term->r = gth->rloc;
+  term->zion = gth->zion;
+  memcpy(term->c, gth->c, sizeof(term->c));
+
+  return PSPIO_SUCCESS;
+}
+
+int pspio_gth_term_projector(const pspio_gth_t *gth, int l, int i,
+                             pspio_gth_term_t *term)
+{
+  double x;
+
+  assert(gth != NULL);
+  assert(term != NULL);
+
+  FULFILL_OR_RETURN( (l >= 0) && (l <= PSPIO_GTH_L_MAX), PSPIO_EVALUE );
+  FULFILL_OR_RETURN( (i >= 0) && (i < gth->n_proj[l]), PSPIO_EVALUE );
+
+  memset(term, 0, sizeof(pspio_gth_term_t));
+  term->l = l;
+  term->i = i;
+  term->r = gth->r[l];
+  x = l + (4*i + 3)/2.0;
+  term->norm = sqrt(2.0) / (pow(term->r, x) * sqrt(tgamma(x)));
+
+  return PSPIO_SUCCESS;
+}
+
+double pspio_gth_term_eval(const pspio_gth_term_t *term, double r)
+{
+  assert(term != NULL);
+
+  return (term->l < 0) ? gth_local(term, r, 0) : gth_projector(term, r, 0);
+}
+
+double pspio_gth_term_eval_deriv(const pspio_gth_term_t *term, double r)
+{
+  assert(term != NULL);
+
+  return (term->l < 0) ? gth_local(term, r, 1) : gth_projector(term, r, 1);
+}
+
+double pspio_gth_term_eval_deriv2(const pspio_gth_term_t *term, double r)
+{
+  assert(term != NULL);
+
+  return (term->l < 0) ? gth_local(term, r, 2) : gth_projector(term, r, 2);
+}
+
+double pspio_gth_term_eval_q(const pspio_gth_term_t *term, double q)
+{
+  assert(term != NULL);
+
+  return (term->l < 0) ? gth_local_q(term, q, 0) : gth_projector_q(term, q, 0);
+}
+
+double pspio_gth_term_eval_q_deriv(const pspio_gth_term_t *term, double q)
+{
+  assert(term != NULL);
+  assert(term->l >= 0 || q > 0.0);
+
+  return (term->l < 0) ? gth_local_q(term, q, 1) : gth_projector_q(term, q, 1);
+}
@@ -0,0 +1,304 @@
+/* Copyright (C) 2018 Micael Oliveira <micael.oliveira@mpsd.mpg.de>
+ *                    Yann Pouillon <devops@materialsevolution.es>
+ *
+ * This file is part of Libpspio.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * version 2.0. If a copy of the MPL was not distributed with this file, You
+ * can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Libpspio is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the Mozilla Public License version 2.0 for
+ * more details.
+ */
+
+#ifndef PSPIO_GTH_H
+#define PSPIO_GTH_H
+
+/**
+ * @file pspio_gth.h
+ * @brief header file for the analytic pseudopotentials of Goedecker,
+ *        Teter and Hutter (GTH) and of Hartwigsen, Goedecker and Hutter
+ *        (HGH)
+ */
+
+#include "pspio_error.h"
+
+
+/**********************************************************************
+ * Defines                                                            *
+ **********************************************************************/
+
+#define PSPIO_GTH_L_MAX  3 /**< Highest angular momentum channel */
+#define PSPIO_GTH_N_PROJ 3 /**< Maximum number of projectors per channel */
+
+
+/**********************************************************************
+ * Data structures                                                    *
+ **********************************************************************/
+
+/**
+ * Parameters of a GTH/HGH pseudopotential. The local part is
+ *
+ *   V(r) = -zion/r erf(x/sqrt(2)) + exp(-x^2/2) (C1 + C2 x^2 + C3 x^4 + C4 x^6)
+ *
+ * with x = r/rloc, and the projectors of channel l are
+ *
+ *   p_i(r) = sqrt(2) r^(l+2i) exp(-r^2/(2 r_l^2)) /
+ *            (r_l^(l+(4i+3)/2) sqrt(Gamma(l+(4i+3)/2)))
+ *
+ * for i = 0, 1, 2, coupled by the symmetric matrices h and k.
+ */
+typedef struct{
+  double zion;       /**< Ionic charge */
+  double rloc;       /**< Radius of the local part */
+  double c[4];       /**< Coefficients C1 to C4 of the local part */
+  int l_max;         /**< Highest channel with projectors, -1 if none */
+  int n_proj[PSPIO_GTH_L_MAX+1]; /**< Number of projectors per channel */
+  double r[PSPIO_GTH_L_MAX+1];   /**< Radii r_l of the channels */
+  double h[PSPIO_GTH_L_MAX+1][PSPIO_GTH_N_PROJ][PSPIO_GTH_N_PROJ]; /**< Couplings h_ij of the projectors */
+  double k[PSPIO_GTH_L_MAX+1][PSPIO_GTH_N_PROJ][PSPIO_GTH_N_PROJ]; /**< Spin-orbit couplings k_ij, zero for l = 0 */
+} pspio_gth_t;
+
+/**
+ * Single term of a GTH/HGH pseudopotential, either the local part or
+ * one projector, evaluated in closed form by the pspio_gth_term_eval
+ * routines. Potentials and projectors built from such a term have no
+ * radial mesh.
+ */
+typedef struct{
+  int l;          /**< Angular momentum of the projector, -1 for the local part */
+  int i;          /**< Index of the projector in its channel, from 0 */
+  double r;       /**< rloc for the local part, r_l for a projector */
+  double zion;    /**< Ionic charge, for the local part */
+  double c[4];    /**< C1 to C4, for the local part */
+  double norm;    /**< Normalization factor, for a projector */
+} pspio_gth_term_t;
+
+
+/**********************************************************************
+ * Global routines                                                    *
+ **********************************************************************/
+
+/**
+ * Allocates memory and presets the parameters to an empty local part
+ * without projectors
+ *
+ * @param[in,out] gth: GTH parameters
+ * @return error code
+ * @note gth must be NULL on input.
+ */
+int pspio_gth_alloc(pspio_gth_t **gth);
+
+/**
+ * Sets the local part
+ *
+ * @param[in,out] gth: GTH parameters
+ * @param[in] zion: ionic charge
+ * @param[in] rloc: radius of the local part
+ * @param[in] nc: number of coefficients, from 0 to 4
+ * @param[in] c: coefficients C1 to C_nc, the others are set to zero
+ * @return error code: PSPIO_EVALUE if rloc is not positive
+ */
+int pspio_gth_init(pspio_gth_t *gth, double zion, double rloc, int nc,
+                   const double *c);
+
+/**
+ * Sets the projectors of a channel
+ *
+ * @param[in,out] gth: GTH parameters
+ * @param[in] l: angular momentum, from 0 to PSPIO_GTH_L_MAX
+ * @param[in] r: radius r_l of the channel
+ * @param[in] n: number of projectors, from 0 to PSPIO_GTH_N_PROJ
+ * @param[in] h: n x n couplings, row-major
+ * @param[in] k: n x n spin-orbit couplings, row-major, or NULL
+ * @return error code: PSPIO_EVALUE for an invalid channel, or if r is
+ *         not positive while n is
+ * @note Both matrices are symmetrized.
+ */
+int pspio_gth_set_channel(pspio_gth_t *gth, int l, double r, int n,
+                          const double *h, const double *k);
+
+/**
+ * Sets the projectors of a channel from the diagonal couplings only,
+ * as given in the HGH tables. The number of projectors is the position
+ * of the last non-zero diagonal element of h, and the off-diagonal
+ * elements of h and k follow from the HGH relations (Phys. Rev. B 58,
+ * 3641, eqs. 52-54).
+ *
+ * @param[in,out] gth: GTH parameters
+ * @param[in] l: angular momentum, from 0 to PSPIO_GTH_L_MAX
+ * @param[in] r: radius r_l of the channel
+ * @param[in] h: diagonal couplings h_11, h_22 and h_33
+ * @param[in] k: diagonal spin-orbit couplings, or NULL
+ * @return error code
+ * @note The relations are only given up to l = 2, f channels keep a
+ *       diagonal coupling.
+ */
+int pspio_gth_set_channel_hgh(pspio_gth_t *gth, int l, double r,
+                              const double h[3], const double k[3]);
+
+/**
+ * Duplicates GTH parameters
+ *
+ * @param[out] dst: destination, allocated here if NULL
+ * @param[in] src: source
+ * @return error code
+ */
+int pspio_gth_copy(pspio_gth_t **dst, const pspio_gth_t *src);
+
+/**
+ * Frees all memory associated with the GTH parameters
+ *
+ * @param[in,out] gth: GTH parameters
+ */
+void pspio_gth_free(pspio_gth_t *gth);
+
+
+/**********************************************************************
+ * Getters                                                            *
+ **********************************************************************/
+
+/**
+ * @param[in] gth: GTH parameters
+ * @return ionic charge
+ */
+double pspio_gth_get_zion(const pspio_gth_t *gth);
+
+/**
+ * @param[in] gth: GTH parameters
+ * @return radius of the local part
+ */
+double pspio_gth_get_rloc(const pspio_gth_t *gth);
+
+/**
+ * @param[in] gth: GTH parameters
+ * @param[in] i: index of the coefficient, from 0 to 3
+ * @return coefficient C_(i+1) of the local part
+ */
+double pspio_gth_get_c(const pspio_gth_t *gth, int i);
+
+/**
+ * @param[in] gth: GTH parameters
+ * @return highest channel with projectors, -1 if none
+ */
+int pspio_gth_get_l_max(const pspio_gth_t *gth);
+
+/**
+ * @param[in] gth: GTH parameters
+ * @param[in] l: angular momentum
+ * @return number of projectors of channel l
+ */
+int pspio_gth_get_n_proj(const pspio_gth_t *gth, int l);
+
+/**
+ * @param[in] gth: GTH parameters
+ * @param[in] l: angular momentum
+ * @return radius r_l of channel l
+ */
+double pspio_gth_get_r(const pspio_gth_t *gth, int l);
+
+/**
+ * @param[in] gth: GTH parameters
+ * @param[in] l: angular momentum
+ * @param[in] i, j: indices of the projectors, from 0
+ * @return coupling h_ij of channel l
+ */
+double pspio_gth_get_h(const pspio_gth_t *gth, int l, int i, int j);
+
+/**
+ * @param[in] gth: GTH parameters
+ * @param[in] l: angular momentum
+ * @param[in] i, j: indices of the projectors, from 0
+ * @return spin-orbit coupling k_ij of channel l
+ */
+double pspio_gth_get_k(const pspio_gth_t *gth, int l, int i, int j);
+
+
+/**********************************************************************
+ * Utility routines                                                   *
+ **********************************************************************/
+
+/**
+ * Compares two sets of GTH parameters
+ *
+ * @param[in] gth1: first set
+ * @param[in] gth2: second set
+ * @return PSPIO_EQUAL when equal, PSPIO_DIFF when different
+ */
+int pspio_gth_cmp(const pspio_gth_t *gth1, const pspio_gth_t *gth2);
+
+/**
+ * Extracts the local part of the parameters
+ *
+ * @param[in] gth: GTH parameters
+ * @param[out] term: term to initialize
+ * @return error code
+ */
+int pspio_gth_term_local(const pspio_gth_t *gth, pspio_gth_term_t *term);
+
+/**
+ * Extracts a projector of the parameters
+ *
+ * @param[in] gth: GTH parameters
+ * @param[in] l: angular momentum
+ * @param[in] i: index of the projector in channel l, from 0
+ * @param[out] term: term to initialize
+ * @return error code: PSPIO_EVALUE if channel l has no such projector
+ */
+int pspio_gth_term_projector(const pspio_gth_t *gth, int l, int i,
+                             pspio_gth_term_t *term);
+
+/**
+ * Returns the value of a term at a point, in real space
+ *
+ * @param[in] term: term to evaluate
+ * @param[in] r: radius
+ * @return V(r) for the local part, p_i(r) for a projector
+ * @note Projectors do not include the factor r of tabulated beta
+ *       functions.
+ */
+double pspio_gth_term_eval(const pspio_gth_term_t *term, double r);
+
+/**
+ * Returns the first derivative of a term with respect to r
+ *
+ * @param[in] term: term to evaluate
+ * @param[in] r: radius
+ * @return value of the derivative at r
+ */
+double pspio_gth_term_eval_deriv(const pspio_gth_term_t *term, double r);
+
+/**
+ * Returns the second derivative of a term with respect to r
+ *
+ * @param[in] term: term to evaluate
+ * @param[in] r: radius
+ * @return value of the second derivative at r
+ */
+double pspio_gth_term_eval_deriv2(const pspio_gth_term_t *term, double r);
+
+/**
+ * Returns the value of a term in reciprocal space, i.e. its radial
+ * Fourier transform 4 pi int r^2 j_l(q r) f(r) dr
+ *
+ * @param[in] term: term to evaluate
+ * @param[in] q: norm of the wave vector
+ * @return value of the transform at q
+ * @note The Coulomb tail of the local part diverges as -4 pi zion/q^2.
+ *       At q = 0 the finite remainder, i.e. the limit of
+ *       V(q) + 4 pi zion/q^2, is returned instead.
+ */
+double pspio_gth_term_eval_q(const pspio_gth_term_t *term, double q);
+
+/**
+ * Returns the derivative of a term in reciprocal space with respect to q
+ *
+ * @param[in] term: term to evaluate
+ * @param[in] q: norm of the wave vector, positive for the local part
+ * @return value of the derivative at q
+ */
+double pspio_gth_term_eval_q_deriv(const pspio_gth_term_t *term, double q);
+
+#endif
@@ -0,0 +1,300 @@
+/* Copyright (C) 2018 Micael Oliveira <micael.oliveira@mpsd.mpg.de>
+ *                    Yann Pouillon <devops@materialsevolution.es>
+ *
+ * This file is part of Libpspio.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * version 2.0. If a copy of the MPL was not distributed with this file, You
+ * can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Libpspio is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the Mozilla Public License version 2.0 for
+ * more details.
+ */
+
+/**
+ * @file pspio_hermite.c
+ * @brief local cubic and quintic Hermite interpolation
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "pspio_hermite.h"
+
+#if defined HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+
+/**********************************************************************
+ * Data structures                                                    *
+ **********************************************************************/
+
+struct hermite_t {
+  int order;         /**< Order of the interpolating polynomials (3 or 5) */
+  int np;            /**< Number of knots */
+  const double *t;   /**< Knots (not owned) */
+  const double *y;   /**< Values at the knots (not owned) */
+  const double *yp;  /**< First derivatives at the knots (not owned) */
+  const double *ypp; /**< Second derivatives at the knots (not owned) */
+  double *data;      /**< Copy of the knots and values, owned by copies */
+};
+
+
+/**********************************************************************
+ * Private routines                                                   *
+ **********************************************************************/
+
+/*
+ * Finite difference weights of the derivatives of order 0 to 2 at z,
+ * for the n points x, following B. Fornberg, Math. Comp. 51, 699 (1988)
+ */
+static void hermite_fd_weights(double z, const double *x, int n, double c[][3])
+{
+  int i, j, k, mn;
+  double c1, c2, c3, c4, c5;
+
+  for (i=0; i<n; i++) {
+    c[i][0] = 0.0;
+    c[i][1] = 0.0;
+    c[i][2] = 0.0;
+  }
+
+  c1 = 1.0;
+  c4 = x[0] - z;
+  c[0][0] = 1.0;
+  for (i=1; i<n; i++) {
+    mn = (i < 2) ? i : 2;
+    c2 = 1.0;
+    c5 = c4;
+    c4 = x[i] - z;
+    for (j=0; j<i; j++) {
+      c3 = x[i] - x[j];
+      c2 *= c3;
+      if ( j == i-1 ) {
+        for (k=mn; k>0; k--) {
+          c[i][k] = c1*(k*c[i-1][k-1] - c5*c[i-1][k])/c2;
+        }
+        c[i][0] = -c1*c5*c[i-1][0]/c2;
+      }
+      for (k=mn; k>0; k--) {
+        c[j][k] = (c4*c[j][k] - k*c[j][k-1])/c3;
+      }
+      c[j][0] = c4*c[j][0]/c3;
+    }
+    c1 = c2;
+  }
+}
+
+/* Returns the interval containing r, the outer ones extending to infinity */
+static int hermite_search(const hermite_t *herm, double r)
+{
+  int lo, hi, mid;
+
+  lo = 0;
+  hi = herm->np - 1;
+  while ( hi - lo > 1 ) {
+    mid = (lo + hi)/2;
+    if ( r < herm->t[mid] ) {
+      hi = mid;
+    } else {
+      lo = mid;
+    }
+  }
+
+  return lo;
+}
+
+
+/**********************************************************************
+ * Global routines                                                    *
+ **********************************************************************/
+
+int hermite_alloc(hermite_t **herm, int order, int np)
+{
+  assert(herm != NULL);
+  assert(np > 1);
+
+  FULFILL_OR_RETURN( (order == 3) || (order == 5), PSPIO_EVALUE );
+
+  *herm = (hermite_t *) malloc (sizeof(hermite_t));
+  FULFILL_OR_EXIT( *herm != NULL, PSPIO_ENOMEM );
+
+  (*herm)->order = order;
+  (*herm)->np = np;
+  (*herm)->t = NULL;
+  (*herm)->y = NULL;
+  (*herm)->yp = NULL;
+  (*herm)->ypp = NULL;
+  (*herm)->data = NULL;
+
+  return PSPIO_SUCCESS;
+}
+
+void hermite_init(hermite_t *herm, const double *t, const double *y,
+                  const double *yp, const double *ypp)
+{
+  assert(herm != NULL);
+  assert(t != NULL && y != NULL && yp != NULL);
+  assert(herm->order == 3 || ypp != NULL);
+
+  free(herm->data);
+  herm->data = NULL;
+  herm->t = t;
+  herm->y = y;
+  herm->yp = yp;
+  herm->ypp = ypp;
+}
+
+int hermite_copy(hermite_t **dst, const hermite_t *src)
+{
+  int np, nvec;
+  double *data;
+
+  assert(dst != NULL);
+  assert(src != NULL);
+
+  hermite_free(*dst);
+  SUCCEED_OR_RETURN( hermite_alloc(dst, src->order, src->np) );
+  if ( src->t == NULL ) return PSPIO_SUCCESS;
+
+  /* The copy keeps its own data, since the source may not outlive it */
+  np = src->np;
+  nvec = (src->ypp != NULL) ? 4 : 3;
+  data = (double *) malloc ((size_t)nvec * np * sizeof(double));
+  FULFILL_OR_EXIT( data != NULL, PSPIO_ENOMEM );
+  memcpy(data, src->t, np * sizeof(double));
+  memcpy(data + np, src->y, np * sizeof(double));
+  memcpy(data + 2*np, src->yp, np * sizeof(double));
+  if ( src->ypp != NULL ) {
+    memcpy(data + 3*np, src->ypp, np * sizeof(double));
+  }
+  hermite_init(*dst, data, data + np, data + 2*np,
+    (src->ypp != NULL) ? data + 3*np : NULL);
+  (*dst)->data = data;
+
+  return PSPIO_SUCCESS;
+}
+
+void hermite_free(hermite_t *herm)
+{
+  if ( herm != NULL ) {
+    free(herm->data);
+    free(herm);
+  }
+}
+
+
+/**********************************************************************
+ * Utility routines                                                   *
+ **********************************************************************/
+
+void hermite_nodes_derivs(int np, const double *t, const double *y,
+                          double *yp, double *ypp)
+{
+  int i, k, n, k0;
+  double c[7][3];
+
+  assert(np > 1);
+  assert(t != NULL && y != NULL);
+
+  /* Stencils of 7 points, centered when possible */
+  n = (np < 7) ? np : 7;
+  for (i=0; i<np; i++) {
+    k0 = i - n/2;
+    if ( k0 < 0 ) k0 = 0;
+    if ( k0 > np - n ) k0 = np - n;
+    hermite_fd_weights(t[i], &t[k0], n, c);
+    if ( yp != NULL ) {
+      yp[i] = 0.0;
+      for (k=0; k<n; k++) yp[i] += c[k][1]*y[k0+k];
+    }
+    if ( ypp != NULL ) {
+      ypp[i] = 0.0;
+      for (k=0; k<n; k++) ypp[i] += c[k][2]*y[k0+k];
+    }
+  }
+}
+
+void hermite_eval_located(const hermite_t *herm, int ival, double r,
+                          double *yval, double *ypval, double *yppval)
+{
+  double h, u, dy, dm, ds, m0, m1, s0, s1;
+  double c2, c3, c4, c5;
+
+  assert(herm != NULL);
+  assert(herm->t != NULL);
+  assert((ival >= 0) && (ival < herm->np - 1));
+
+  /* Polynomial in u = (r - t_i)/h, with derivatives scaled by h */
+  h = herm->t[ival+1] - herm->t[ival];
+  u = (r - herm->t[ival])/h;
+  m0 = h*herm->yp[ival];
+  m1 = h*herm->yp[ival+1];
+  dy = herm->y[ival+1] - herm->y[ival] - m0;
+  if ( herm->order == 3 ) {
+    c2 = 3.0*dy - (m1 - m0);
+    c3 = (m1 - m0) - 2.0*dy;
+    c4 = 0.0;
+    c5 = 0.0;
+  } else {
+    s0 = h*h*herm->ypp[ival];
+    s1 = h*h*herm->ypp[ival+1];
+    c2 = 0.5*s0;
+    dy -= c2;
+    dm = m1 - m0 - s0;
+    ds = s1 - s0;
+    c3 = 10.0*dy - 4.0*dm + 0.5*ds;
+    c4 = -15.0*dy + 7.0*dm - ds;
+    c5 = 6.0*dy - 3.0*dm + 0.5*ds;
+  }
+
+  if ( yval != NULL ) {
+    *yval = herm->y[ival] + u*(m0 + u*(c2 + u*(c3 + u*(c4 + u*c5))));
+  }
+  if ( ypval != NULL ) {
+    *ypval = (m0 + u*(2.0*c2 + u*(3.0*c3 + u*(4.0*c4 + u*5.0*c5))))/h;
+  }
+  if ( yppval != NULL ) {
+    *yppval = (2.0*c2 + u*(6.0*c3 + u*(12.0*c4 + u*20.0*c5)))/(h*h);
+  }
+}
+
+void hermite_eval(const hermite_t *herm, double r,
+                  double *yval, double *ypval, double *yppval)
+{
+  assert(herm != NULL);
+
+  hermite_eval_located(herm, hermite_search(herm, r), r, yval, ypval, yppval);
+}
+
+void hermite_eval_nodes(const hermite_t *herm, double *yp, double *ypp)
+{
+  int i, n;
+
+  assert(herm != NULL);
+
+  n = herm->np;
+  for (i=0; i<n-1; i++) {
+    hermite_eval_located(herm, i, herm->t[i], NULL,
+      (yp != NULL) ? &yp[i] : NULL, (ypp != NULL) ? &ypp[i] : NULL);
+  }
+  hermite_eval_located(herm, n-2, herm->t[n-1], NULL,
+    (yp != NULL) ? &yp[n-1] : NULL, (ypp != NULL) ? &ypp[n-1] : NULL);
+}
+
+size_t hermite_memory_usage(const hermite_t *herm)
+{
+  size_t size;
+
+  if ( herm == NULL ) return 0;
+  size = sizeof(hermite_t);
+  if ( herm->data != NULL ) {
+    size += (size_t)((herm->ypp != NULL) ? 4 : 3) * herm->np * sizeof(double);
+  }
+
+  return size;
+}
@@ -0,0 +1,138 @@
+/* Copyright (C) 2018 Micael Oliveira <micael.oliveira@mpsd.mpg.de>
+ *                    Yann Pouillon <devops@materialsevolution.es>
+ *
+ * This file is part of Libpspio.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * version 2.0. If a copy of the MPL was not distributed with this file, You
+ * can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Libpspio is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the Mozilla Public License version 2.0 for
+ * more details.
+ */
+
+#ifndef PSPIO_HERMITE_H
+#define PSPIO_HERMITE_H
+
+/**
+ * @file pspio_hermite.h
+ * @brief header file for the local Hermite interpolation of functions
+ *        whose derivatives are known on the mesh
+ */
+
+#include <stddef.h>
+
+#include "pspio_error.h"
+
+
+/**********************************************************************
+ * Data structures                                                    *
+ **********************************************************************/
+
+/**
+ * Hermite interpolation data structure. The knots, the values and the
+ * derivatives are not copied: the arrays given to hermite_init must
+ * outlive the structure.
+ */
+typedef struct hermite_t hermite_t;
+
+
+/**********************************************************************
+ * Global routines                                                    *
+ **********************************************************************/
+
+/**
+ * Allocates a Hermite interpolation structure
+ * @param[out] herm: interpolation structure
+ * @param[in] order: 3 for cubic (uses f and f') or 5 for quintic (uses
+ *                   f, f' and f'') interpolation
+ * @param[in] np: number of knots
+ * @return error code
+ */
+int hermite_alloc(hermite_t **herm, int order, int np);
+
+/**
+ * Sets the data to interpolate. Each interval only depends on its two
+ * knots, hence there is nothing to solve.
+ * @param[in,out] herm: interpolation structure
+ * @param[in] t: knots, in increasing order
+ * @param[in] y: values of the function at the knots
+ * @param[in] yp: values of its first derivative at the knots
+ * @param[in] ypp: values of its second derivative at the knots (not
+ *                 used by the cubic interpolation, may be NULL then)
+ */
+void hermite_init(hermite_t *herm, const double *t, const double *y,
+                  const double *yp, const double *ypp);
+
+/**
+ * Duplicates a Hermite interpolation structure. The copy holds its own
+ * copy of the data, until it is bound to other data by hermite_init.
+ * @param[out] dst: destination structure, replaced if already allocated
+ * @param[in] src: source structure
+ * @return error code
+ */
+int hermite_copy(hermite_t **dst, const hermite_t *src);
+
+/**
+ * Frees a Hermite interpolation structure
+ * @param[in,out] herm: interpolation structure
+ */
+void hermite_free(hermite_t *herm);
+
+
+/**********************************************************************
+ * Utility routines                                                   *
+ **********************************************************************/
+
+/**
+ * Estimates the derivatives of a function at the knots from its values,
+ * with 7-point finite differences (sixth order for the first derivative
+ * and fifth order for the second one), so that the interpolation keeps
+ * at least the accuracy of a cubic spline
+ * @param[in] np: number of knots
+ * @param[in] t: knots, in increasing order
+ * @param[in] y: values of the function at the knots
+ * @param[out] yp: first derivative at the knots (may be NULL)
+ * @param[out] ypp: second derivative at the knots (may be NULL)
+ */
+void hermite_nodes_derivs(int np, const double *t, const double *y,
+                          double *yp, double *ypp);
+
+/**
+ * Evaluates the interpolation and its derivatives at r, within the
+ * interval [t[ival], t[ival+1]]
+ * @param[in] herm: interpolation structure
+ * @param[in] ival: index of the interval
+ * @param[in] r: point where to evaluate the interpolation
+ * @param[out] yval: value (may be NULL)
+ * @param[out] ypval: first derivative (may be NULL)
+ * @param[out] yppval: second derivative (may be NULL)
+ */
+void hermite_eval_located(const hermite_t *herm, int ival, double r,
+                          double *yval, double *ypval, double *yppval);
+
+/**
+ * Same as hermite_eval_located, looking for the interval of r first.
+ * Points outside of the knots use the polynomial of the closest interval.
+ */
+void hermite_eval(const hermite_t *herm, double r,
+                  double *yval, double *ypval, double *yppval);
+
+/**
+ * Evaluates the first and second derivatives of the interpolation at
+ * the knots, the last knot belonging to the last interval
+ * @param[in] herm: interpolation structure
+ * @param[out] yp: first derivatives (may be NULL)
+ * @param[out] ypp: second derivatives (may be NULL)
+ */
+void hermite_eval_nodes(const hermite_t *herm, double *yp, double *ypp);
+
+/**
+ * @param[in] herm: interpolation structure
+ * @return memory used by the structure, in bytes
+ */
+size_t hermite_memory_usage(const hermite_t *herm);
+
+#endif
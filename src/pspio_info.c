@@ -16,7 +16,7 @@
 
 /**
  * @file pspio_info.c
- * @brief Libpspio version information 
+ * @brief Libpspio version and instrumentation information
  */
 
 #include <stdlib.h>
@@ -24,7 +24,9 @@
 #include <assert.h>
 #include <string.h>
 
+#include "pspio_error.h"
 #include "pspio_info.h"
+#include "instrument.h"
 
 #if defined HAVE_CONFIG_H
 #include "config.h"
@@ -33,6 +35,65 @@
 #define PACKAGE_STRING ""
 #endif
 
+#if defined INSTRUMENTATION_MODE
+#include <time.h>
+#endif
+
+
+/**********************************************************************
+ * Instrumentation storage                                            *
+ **********************************************************************/
+
+static const char *counter_names[PSPIO_NCOUNTERS] = {
+  "bytes_read",
+  "lines_parsed",
+  "spline_inits",
+  "eval_meshfunc",
+  "eval_potential",
+  "eval_projector",
+  "eval_state",
+  "eval_xc",
+  "extrapolations",
+  "allocs",
+  "copies"
+};
+
+static const char *timer_names[PSPIO_NTIMERS] = {
+  "read",
+  "write",
+  "interp_init"
+};
+
+#if defined INSTRUMENTATION_MODE
+int instr_enabled = 1;
+PSPIO_THREAD_LOCAL long instr_counters[PSPIO_NCOUNTERS];
+PSPIO_THREAD_LOCAL double instr_timers[PSPIO_NTIMERS];
+
+double instr_clock(void)
+{
+#if defined HAVE_CLOCK_GETTIME
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + 1.0e-9*(double)ts.tv_nsec;
+#else
+  return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+char *instr_fgets(char *s, int size, FILE *stream)
+{
+  char *line = fgets(s, size, stream);
+
+  if ( (line != NULL) && instr_enabled ) {
+    instr_counters[PSPIO_COUNTER_BYTES_READ] += (long)strlen(line);
+    instr_counters[PSPIO_COUNTER_LINES_PARSED] += 1;
+  }
+
+  return line;
+}
+#endif
+
 
 /**********************************************************************
  * Global routines                                                    *
@@ -61,3 +122,83 @@ void pspio_info_string(char *info)
   strncpy(info, PACKAGE_STRING, s);
   info[s] = '\0';
 }
+
+int pspio_info_instrumentation_enabled(void)
+{
+#if defined INSTRUMENTATION_MODE
+  return instr_enabled;
+#else
+  return 0;
+#endif
+}
+
+int pspio_info_set_instrumentation(int enable)
+{
+#if defined INSTRUMENTATION_MODE
+  instr_enabled = (enable != 0);
+#else
+  FULFILL_OR_RETURN( enable == 0, PSPIO_ENOSUPPORT );
+#endif
+
+  return PSPIO_SUCCESS;
+}
+
+void pspio_info_reset_instrumentation(void)
+{
+#if defined INSTRUMENTATION_MODE
+  memset(instr_counters, 0, sizeof(instr_counters));
+  memset(instr_timers, 0, sizeof(instr_timers));
+#endif
+}
+
+long pspio_info_get_counter(int counter)
+{
+  assert((counter >= 0) && (counter < PSPIO_NCOUNTERS));
+
+#if defined INSTRUMENTATION_MODE
+  return instr_counters[counter];
+#else
+  return 0;
+#endif
+}
+
+double pspio_info_get_timer(int timer)
+{
+  assert((timer >= 0) && (timer < PSPIO_NTIMERS));
+
+#if defined INSTRUMENTATION_MODE
+  return instr_timers[timer];
+#else
+  return 0.0;
+#endif
+}
+
+const char *pspio_info_counter_name(int counter)
+{
+  assert((counter >= 0) && (counter < PSPIO_NCOUNTERS));
+
+  return counter_names[counter];
+}
+
+const char *pspio_info_timer_name(int timer)
+{
+  assert((timer >= 0) && (timer < PSPIO_NTIMERS));
+
+  return timer_names[timer];
+}
+
+void pspio_info_dump(FILE *fd)
+{
+  int i;
+
+  if ( fd == NULL ) fd = stdout;
+
+  fprintf(fd, "libpspio instrumentation: %s\n",
+    pspio_info_instrumentation_enabled() ? "on" : "off");
+  for (i=0; i<PSPIO_NCOUNTERS; i++) {
+    fprintf(fd, "  %-16s %16ld\n", counter_names[i], pspio_info_get_counter(i));
+  }
+  for (i=0; i<PSPIO_NTIMERS; i++) {
+    fprintf(fd, "  %-16s %16.6f s\n", timer_names[i], pspio_info_get_timer(i));
+  }
+}
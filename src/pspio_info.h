@@ -17,12 +17,16 @@
 
 /**
  * @file pspio_info.h
- * @brief Libpspio version information 
+ * @brief Libpspio version and instrumentation information
  */
 
 #if !defined PSPIO_INFO_H
 #define PSPIO_INFO_H
 
+#include <stdio.h>
+
+#include "pspio_common.h"
+
 /**********************************************************************
  * Global routines                                                    *
  **********************************************************************/
@@ -41,4 +45,59 @@ void pspio_info_version(int *major, int *minor, int *micro);
  */
 void pspio_info_string(char *info);
 
+/**
+ * Tell whether the instrumentation counters and timers are being updated.
+ * @return 1 if the library was configured with --enable-instrumentation
+ *         and the instrumentation has not been switched off, 0 otherwise.
+ */
+int pspio_info_instrumentation_enabled(void);
+
+/**
+ * Switch the instrumentation on or off at runtime. The instrumentation is
+ * on by default when it has been enabled at configure time.
+ * @param[in] enable: 1 to switch the instrumentation on, 0 to switch it off
+ * @return error code, PSPIO_ENOSUPPORT if enable is 1 and the library was
+ *         configured without instrumentation
+ */
+int pspio_info_set_instrumentation(int enable);
+
+/**
+ * Reset the counters and timers of the calling thread.
+ */
+void pspio_info_reset_instrumentation(void);
+
+/**
+ * Get the value of an instrumentation counter for the calling thread.
+ * @param[in] counter: one of the PSPIO_COUNTER_* values
+ * @return value of the counter, 0 if instrumentation is not available
+ */
+long pspio_info_get_counter(int counter);
+
+/**
+ * Get the value of an instrumentation timer for the calling thread.
+ * @param[in] timer: one of the PSPIO_TIMER_* values
+ * @return accumulated time in seconds, 0 if instrumentation is not available
+ */
+double pspio_info_get_timer(int timer);
+
+/**
+ * Get the name of an instrumentation counter.
+ * @param[in] counter: one of the PSPIO_COUNTER_* values
+ * @return name of the counter
+ */
+const char *pspio_info_counter_name(int counter);
+
+/**
+ * Get the name of an instrumentation timer.
+ * @param[in] timer: one of the PSPIO_TIMER_* values
+ * @return name of the timer
+ */
+const char *pspio_info_timer_name(int timer);
+
+/**
+ * Write the counters and timers of the calling thread to a stream.
+ * @param[in] fd: stream to write to, stdout if NULL
+ */
+void pspio_info_dump(FILE *fd);
+
 #endif
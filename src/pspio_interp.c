@@ -17,6 +17,8 @@
 #include <assert.h>
 #include <string.h>
 
+#include "instrument.h"
+#include "pspio_hermite.h"
 #include "pspio_interp.h"
 #include "pspio_jb_spline.h"
 
@@ -45,8 +47,77 @@ struct pspio_interp_t {
 
   /* Objects to be used with jb_spline */
   jb_spline_t *jb_spl;       /**< JB spline structure */
+
+  /* Objects to be used with the Hermite interpolation */
+  hermite_t *herm;           /**< Hermite interpolation structure */
+
+  /* Single-precision copy */
+  int single;  /**< Whether the single-precision copy is kept */
+  float *s_t;  /**< Mesh points */
+  float *s_hinv; /**< Inverse of the width of each interval */
+  float *s_c;  /**< Coefficients of the cubic of each interval, 4 per interval */
 };
 
+
+/**********************************************************************
+ * Private routines                                                   *
+ **********************************************************************/
+
+/*
+ * Builds the single-precision copy of an initialized interpolation,
+ * from its values and slopes at the mesh points
+ */
+static void interp_single_init(pspio_interp_t *interp, const pspio_mesh_t *mesh,
+                               const double *f)
+{
+  int i, np;
+  double h, m0, m1;
+  double *fp;
+  float *c;
+
+  np = mesh->np;
+  fp = (double *) malloc (np * sizeof(double));
+  FULFILL_OR_EXIT( fp != NULL, PSPIO_ENOMEM );
+  pspio_interp_eval_nodes(interp, mesh, fp, NULL);
+
+  for (i=0; i<np; i++) {
+    interp->s_t[i] = (float)mesh->r[i];
+  }
+  for (i=0; i<np-1; i++) {
+    h = mesh->r[i+1] - mesh->r[i];
+    interp->s_hinv[i] = (float)(1.0 / h);
+    m0 = h * fp[i];
+    m1 = h * fp[i+1];
+    c = interp->s_c + 4*i;
+    c[0] = (float)f[i];
+    c[1] = (float)m0;
+    c[2] = (float)(3.0*(f[i+1] - f[i]) - 2.0*m0 - m1);
+    c[3] = (float)(2.0*(f[i] - f[i+1]) + m0 + m1);
+  }
+
+  free(fp);
+}
+
+/* Returns the interval of the single-precision mesh containing r */
+static int interp_single_search(const pspio_interp_t *interp, float r)
+{
+  int lo, hi, mid;
+
+  lo = 0;
+  hi = interp->size - 1;
+  while ( hi - lo > 1 ) {
+    mid = (lo + hi)/2;
+    if ( r < interp->s_t[mid] ) {
+      hi = mid;
+    } else {
+      lo = mid;
+    }
+  }
+
+  return lo;
+}
+
+
 /**********************************************************************
  * Global routines                                                    *
  **********************************************************************/
@@ -58,6 +129,7 @@ int pspio_interp_alloc(pspio_interp_t **interp, int method, int size)
 
   *interp = (pspio_interp_t *) malloc (sizeof(pspio_interp_t));
   FULFILL_OR_EXIT(*interp != NULL, PSPIO_ENOMEM);
+  INSTR_COUNT(PSPIO_COUNTER_ALLOCS);
 
   /* Make sure all pointers are initialized to NULL, as only some of them will be used */
 #ifdef HAVE_GSL
@@ -65,6 +137,21 @@ int pspio_interp_alloc(pspio_interp_t **interp, int method, int size)
   (*interp)->gsl_acc = NULL;
 #endif
   (*interp)->jb_spl = NULL;
+  (*interp)->herm = NULL;
+
+  (*interp)->single = (method & PSPIO_INTERP_SINGLE) != 0;
+  (*interp)->s_t = NULL;
+  (*interp)->s_hinv = NULL;
+  (*interp)->s_c = NULL;
+  if ( (*interp)->single ) {
+    method &= ~PSPIO_INTERP_SINGLE;
+    (*interp)->s_t = (float *) malloc (size * sizeof(float));
+    FULFILL_OR_EXIT( (*interp)->s_t != NULL, PSPIO_ENOMEM );
+    (*interp)->s_hinv = (float *) malloc ((size - 1) * sizeof(float));
+    FULFILL_OR_EXIT( (*interp)->s_hinv != NULL, PSPIO_ENOMEM );
+    (*interp)->s_c = (float *) malloc (4 * (size - 1) * sizeof(float));
+    FULFILL_OR_EXIT( (*interp)->s_c != NULL, PSPIO_ENOMEM );
+  }
 
   (*interp)->method = method;
   (*interp)->size = size;
@@ -78,6 +165,12 @@ int pspio_interp_alloc(pspio_interp_t **interp, int method, int size)
   case PSPIO_INTERP_JB_CSPLINE:
     SUCCEED_OR_RETURN( jb_spline_alloc(&((*interp)->jb_spl), (*interp)->size) );
     break;
+  case PSPIO_INTERP_HERMITE3:
+    SUCCEED_OR_RETURN( hermite_alloc(&((*interp)->herm), 3, (*interp)->size) );
+    break;
+  case PSPIO_INTERP_HERMITE5:
+    SUCCEED_OR_RETURN( hermite_alloc(&((*interp)->herm), 5, (*interp)->size) );
+    break;
   default:
     RETURN_WITH_ERROR( PSPIO_ENOSUPPORT );
   }
@@ -92,7 +185,13 @@ int pspio_interp_copy(pspio_interp_t **dst, const pspio_interp_t *src)
   if ( *dst != NULL ) {
     pspio_interp_free(*dst);
   }
-  SUCCEED_OR_RETURN(pspio_interp_alloc(dst, src->method, src->size));
+  SUCCEED_OR_RETURN(pspio_interp_alloc(dst,
+    src->single ? (src->method | PSPIO_INTERP_SINGLE) : src->method, src->size));
+  if ( src->single ) {
+    memcpy((*dst)->s_t, src->s_t, src->size * sizeof(float));
+    memcpy((*dst)->s_hinv, src->s_hinv, (src->size - 1) * sizeof(float));
+    memcpy((*dst)->s_c, src->s_c, 4 * (src->size - 1) * sizeof(float));
+  }
 
   switch (src->method) {
 #ifdef HAVE_GSL
@@ -112,10 +211,16 @@ int pspio_interp_copy(pspio_interp_t **dst, const pspio_interp_t *src)
     case PSPIO_INTERP_JB_CSPLINE:
       SUCCEED_OR_RETURN( jb_spline_copy(&((*dst)->jb_spl), src->jb_spl) );
       break;
+    case PSPIO_INTERP_HERMITE3:
+    case PSPIO_INTERP_HERMITE5:
+      SUCCEED_OR_RETURN( hermite_copy(&((*dst)->herm), src->herm) );
+      break;
     default:
       RETURN_WITH_ERROR( PSPIO_ENOSUPPORT );
   }
 
+  INSTR_COUNT(PSPIO_COUNTER_COPIES);
+
   return PSPIO_SUCCESS;
 }
 
@@ -124,11 +229,14 @@ int pspio_interp_init(pspio_interp_t *interp, const pspio_mesh_t *mesh, const do
 #ifdef HAVE_GSL
   int ierr;
 #endif
+  INSTR_TIMER_DECLARE(t_init);
 
   assert(interp != NULL);
   assert(mesh != NULL);
   assert(f != NULL);
 
+  INSTR_COUNT(PSPIO_COUNTER_SPLINE_INITS);
+  INSTR_TIMER_START(t_init);
   switch (interp->method) {
 #ifdef HAVE_GSL
     case PSPIO_INTERP_GSL_CSPLINE:
@@ -144,10 +252,97 @@ int pspio_interp_init(pspio_interp_t *interp, const pspio_mesh_t *mesh, const do
     default:
       RETURN_WITH_ERROR( PSPIO_ENOSUPPORT );
   }
+  if ( interp->single ) {
+    interp_single_init(interp, mesh, f);
+  }
+  INSTR_TIMER_STOP(PSPIO_TIMER_INTERP_INIT, t_init);
+
+  return PSPIO_SUCCESS;
+}
+
+int pspio_interp_init_derivs(pspio_interp_t *interp, const pspio_mesh_t *mesh,
+                             const double *f, const double *fp, const double *fpp)
+{
+  assert(interp != NULL);
+  assert(mesh != NULL);
+  assert(f != NULL);
+
+  switch (interp->method) {
+    case PSPIO_INTERP_HERMITE3:
+    case PSPIO_INTERP_HERMITE5:
+      FULFILL_OR_RETURN( fp != NULL, PSPIO_EVALUE );
+      FULFILL_OR_RETURN( (fpp != NULL) || (interp->method == PSPIO_INTERP_HERMITE3),
+        PSPIO_EVALUE );
+      INSTR_COUNT(PSPIO_COUNTER_SPLINE_INITS);
+      hermite_init(interp->herm, mesh->r, f, fp, fpp);
+      if ( interp->single ) {
+        interp_single_init(interp, mesh, f);
+      }
+      break;
+    default:
+      SUCCEED_OR_RETURN( pspio_interp_init(interp, mesh, f) );
+  }
 
   return PSPIO_SUCCESS;
 }
 
+int pspio_interp_init_batch(int n, pspio_interp_t **interp,
+                            const pspio_mesh_t *mesh, const double *const *f)
+{
+  int i, ierr, njb;
+  jb_spline_t **jb_spl;
+  const double **jb_f;
+  jb_spline_factor_t *factor = NULL;
+  INSTR_TIMER_DECLARE(t_init);
+
+  assert(n == 0 || (interp != NULL && f != NULL));
+  assert(mesh != NULL);
+
+  if ( n == 0 ) return PSPIO_SUCCESS;
+
+  /* The JB splines share the factorization of the mesh, the others are
+     initialized one by one */
+  jb_spl = (jb_spline_t **) malloc (n * sizeof(jb_spline_t *));
+  FULFILL_OR_EXIT( jb_spl != NULL, PSPIO_ENOMEM );
+  jb_f = (const double **) malloc (n * sizeof(double *));
+  FULFILL_OR_EXIT( jb_f != NULL, PSPIO_ENOMEM );
+
+  ierr = PSPIO_SUCCESS;
+  njb = 0;
+  for (i=0; (i<n) && (ierr == PSPIO_SUCCESS); i++) {
+    if ( interp[i]->method == PSPIO_INTERP_JB_CSPLINE ) {
+      jb_spl[njb] = interp[i]->jb_spl;
+      jb_f[njb] = f[i];
+      njb++;
+    } else {
+      ierr = pspio_interp_init(interp[i], mesh, f[i]);
+    }
+  }
+
+  if ( (ierr == PSPIO_SUCCESS) && (njb > 0) ) {
+    INSTR_ADD(PSPIO_COUNTER_SPLINE_INITS, njb);
+    INSTR_TIMER_START(t_init);
+    ierr = jb_spline_factor_alloc(&factor, mesh->np);
+    if ( ierr == PSPIO_SUCCESS ) {
+      ierr = jb_spline_factor_init(factor, mesh->r);
+    }
+    if ( ierr == PSPIO_SUCCESS ) {
+      ierr = jb_spline_init_batch(njb, jb_spl, factor, mesh->r, jb_f);
+    }
+    jb_spline_factor_free(factor);
+    for (i=0; (i<n) && (ierr == PSPIO_SUCCESS); i++) {
+      if ( (interp[i]->method == PSPIO_INTERP_JB_CSPLINE) && interp[i]->single ) {
+        interp_single_init(interp[i], mesh, f[i]);
+      }
+    }
+    INSTR_TIMER_STOP(PSPIO_TIMER_INTERP_INIT, t_init);
+  }
+
+  free(jb_f);
+  free(jb_spl);
+  RETURN_WITH_ERROR( ierr );
+}
+
 void pspio_interp_free(pspio_interp_t *interp) {
 
   if (interp != NULL) {
@@ -162,11 +357,18 @@ void pspio_interp_free(pspio_interp_t *interp) {
     case PSPIO_INTERP_JB_CSPLINE:
       jb_spline_free(interp->jb_spl);
       break;
+    case PSPIO_INTERP_HERMITE3:
+    case PSPIO_INTERP_HERMITE5:
+      hermite_free(interp->herm);
+      break;
     default:
       /* Nothing do do */
       break;
     }
 
+    free(interp->s_t);
+    free(interp->s_hinv);
+    free(interp->s_c);
     free(interp);
   }
 }
@@ -178,6 +380,8 @@ void pspio_interp_free(pspio_interp_t *interp) {
 
 double pspio_interp_eval(const pspio_interp_t *interp, double r)
 {
+  double ret;
+
   assert(interp != NULL);
 
   switch (interp->method) {
@@ -187,6 +391,10 @@ double pspio_interp_eval(const pspio_interp_t *interp, double r)
 #endif
   case PSPIO_INTERP_JB_CSPLINE:
     return jb_spline_eval(interp->jb_spl, r);
+  case PSPIO_INTERP_HERMITE3:
+  case PSPIO_INTERP_HERMITE5:
+    hermite_eval(interp->herm, r, &ret, NULL, NULL);
+    return ret;
   default:
     return 0.0;
   }
@@ -194,6 +402,8 @@ double pspio_interp_eval(const pspio_interp_t *interp, double r)
 
 double pspio_interp_eval_deriv(const pspio_interp_t *interp, double r)
 {
+  double ret;
+
   assert(interp != NULL);
 
   switch (interp->method) {
@@ -203,6 +413,10 @@ double pspio_interp_eval_deriv(const pspio_interp_t *interp, double r)
 #endif
   case PSPIO_INTERP_JB_CSPLINE:
     return jb_spline_eval_deriv(interp->jb_spl, r);
+  case PSPIO_INTERP_HERMITE3:
+  case PSPIO_INTERP_HERMITE5:
+    hermite_eval(interp->herm, r, NULL, &ret, NULL);
+    return ret;
   default:
     return 0.0;
   }
@@ -210,6 +424,8 @@ double pspio_interp_eval_deriv(const pspio_interp_t *interp, double r)
 
 double pspio_interp_eval_deriv2(const pspio_interp_t *interp, double r)
 {
+  double ret;
+
   assert(interp != NULL);
 
   switch (interp->method) {
@@ -219,7 +435,180 @@ double pspio_interp_eval_deriv2(const pspio_interp_t *interp, double r)
 #endif
   case PSPIO_INTERP_JB_CSPLINE:
     return jb_spline_eval_deriv2(interp->jb_spl, r);
+  case PSPIO_INTERP_HERMITE3:
+  case PSPIO_INTERP_HERMITE5:
+    hermite_eval(interp->herm, r, NULL, NULL, &ret);
+    return ret;
   default:
     return 0.0;
   }
 }
+
+double pspio_interp_eval_located(const pspio_interp_t *interp,
+                                 const pspio_mesh_loc_t *loc)
+{
+  double ret;
+
+  assert(interp != NULL);
+  assert(loc != NULL);
+
+  switch (interp->method) {
+#ifdef HAVE_GSL
+  case PSPIO_INTERP_GSL_CSPLINE:
+    interp->gsl_acc->cache = loc->i;
+    return gsl_spline_eval(interp->gsl_spl, loc->r, interp->gsl_acc);
+#endif
+  case PSPIO_INTERP_JB_CSPLINE:
+    jb_spline_eval_located(interp->jb_spl, loc->i, loc->r, &ret, NULL, NULL);
+    return ret;
+  case PSPIO_INTERP_HERMITE3:
+  case PSPIO_INTERP_HERMITE5:
+    hermite_eval_located(interp->herm, loc->i, loc->r, &ret, NULL, NULL);
+    return ret;
+  default:
+    return 0.0;
+  }
+}
+
+double pspio_interp_eval_deriv_located(const pspio_interp_t *interp,
+                                       const pspio_mesh_loc_t *loc)
+{
+  double ret;
+
+  assert(interp != NULL);
+  assert(loc != NULL);
+
+  switch (interp->method) {
+#ifdef HAVE_GSL
+  case PSPIO_INTERP_GSL_CSPLINE:
+    interp->gsl_acc->cache = loc->i;
+    return gsl_spline_eval_deriv(interp->gsl_spl, loc->r, interp->gsl_acc);
+#endif
+  case PSPIO_INTERP_JB_CSPLINE:
+    jb_spline_eval_located(interp->jb_spl, loc->i, loc->r, NULL, &ret, NULL);
+    return ret;
+  case PSPIO_INTERP_HERMITE3:
+  case PSPIO_INTERP_HERMITE5:
+    hermite_eval_located(interp->herm, loc->i, loc->r, NULL, &ret, NULL);
+    return ret;
+  default:
+    return 0.0;
+  }
+}
+
+double pspio_interp_eval_deriv2_located(const pspio_interp_t *interp,
+                                        const pspio_mesh_loc_t *loc)
+{
+  double ret;
+
+  assert(interp != NULL);
+  assert(loc != NULL);
+
+  switch (interp->method) {
+#ifdef HAVE_GSL
+  case PSPIO_INTERP_GSL_CSPLINE:
+    interp->gsl_acc->cache = loc->i;
+    return gsl_spline_eval_deriv2(interp->gsl_spl, loc->r, interp->gsl_acc);
+#endif
+  case PSPIO_INTERP_JB_CSPLINE:
+    jb_spline_eval_located(interp->jb_spl, loc->i, loc->r, NULL, NULL, &ret);
+    return ret;
+  case PSPIO_INTERP_HERMITE3:
+  case PSPIO_INTERP_HERMITE5:
+    hermite_eval_located(interp->herm, loc->i, loc->r, NULL, NULL, &ret);
+    return ret;
+  default:
+    return 0.0;
+  }
+}
+
+void pspio_interp_eval_float_batch(const pspio_interp_t *interp, int n,
+                                   const float *r, float *f)
+{
+  int i, k;
+  float u;
+  const float *c;
+
+  assert(interp != NULL);
+  assert(interp->single);
+  assert(n == 0 || (r != NULL && f != NULL));
+
+  for (i=0; i<n; i++) {
+    k = interp_single_search(interp, r[i]);
+    u = (r[i] - interp->s_t[k]) * interp->s_hinv[k];
+    c = interp->s_c + 4*k;
+    f[i] = c[0] + u*(c[1] + u*(c[2] + u*c[3]));
+  }
+}
+
+void pspio_interp_eval_deriv_float_batch(const pspio_interp_t *interp, int n,
+                                         const float *r, float *fp)
+{
+  int i, k;
+  float u;
+  const float *c;
+
+  assert(interp != NULL);
+  assert(interp->single);
+  assert(n == 0 || (r != NULL && fp != NULL));
+
+  for (i=0; i<n; i++) {
+    k = interp_single_search(interp, r[i]);
+    u = (r[i] - interp->s_t[k]) * interp->s_hinv[k];
+    c = interp->s_c + 4*k;
+    fp[i] = (c[1] + u*(2.0f*c[2] + u*3.0f*c[3])) * interp->s_hinv[k];
+  }
+}
+
+void pspio_interp_eval_nodes(const pspio_interp_t *interp, const pspio_mesh_t *mesh,
+                             double *fp, double *fpp)
+{
+  int i;
+
+  assert(interp != NULL);
+  assert(mesh != NULL);
+
+  switch (interp->method) {
+  case PSPIO_INTERP_JB_CSPLINE:
+    jb_spline_eval_nodes(interp->jb_spl, fp, fpp);
+    break;
+  case PSPIO_INTERP_HERMITE3:
+  case PSPIO_INTERP_HERMITE5:
+    hermite_eval_nodes(interp->herm, fp, fpp);
+    break;
+  default:
+    for (i=0; i<mesh->np; i++) {
+      if ( fp != NULL ) fp[i] = pspio_interp_eval_deriv(interp, mesh->r[i]);
+      if ( fpp != NULL ) fpp[i] = pspio_interp_eval_deriv2(interp, mesh->r[i]);
+    }
+  }
+}
+
+void pspio_interp_memory_usage(const pspio_interp_t *interp, pspio_memory_t *usage)
+{
+  assert(usage != NULL);
+
+  if ( interp == NULL ) return;
+
+  usage->metadata += sizeof(pspio_interp_t);
+  if ( interp->single ) {
+    usage->splines += (6 * interp->size - 5) * sizeof(float);
+  }
+  switch (interp->method) {
+#ifdef HAVE_GSL
+  case PSPIO_INTERP_GSL_CSPLINE:
+    /* Copies of x and y, plus the c, g, diag and offdiag arrays of the
+       cubic spline state */
+    usage->splines += sizeof(gsl_spline) + sizeof(gsl_interp) +
+      sizeof(gsl_interp_accel) + 6 * interp->size * sizeof(double);
+    break;
+#endif
+  case PSPIO_INTERP_JB_CSPLINE:
+    usage->splines += jb_spline_memory_usage(interp->jb_spl);
+    break;
+  case PSPIO_INTERP_HERMITE3:
+  case PSPIO_INTERP_HERMITE5:
+    usage->splines += hermite_memory_usage(interp->herm);
+    break;
+  }
+}
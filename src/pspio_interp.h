@@ -23,6 +23,7 @@
 
 #include "pspio_common.h"
 #include "pspio_error.h"
+#include "pspio_hermite.h"
 #include "pspio_jb_spline.h"
 #include "pspio_mesh.h"
 
@@ -53,7 +54,9 @@ typedef struct pspio_interp_t pspio_interp_t;
  * Allocates memory and preset
  * 
  * @param[in,out] func: function structure
- * @param[in] method: interpolation method
+ * @param[in] method: interpolation method, optionally combined with
+ *            PSPIO_INTERP_SINGLE to also keep a single-precision copy of
+ *            the interpolation for pspio_interp_eval_float_batch
  * @param[in] np: number of points
  * @return error code
  * @note np should be larger than 1.
@@ -79,9 +82,42 @@ int pspio_interp_copy(pspio_interp_t **dst, const pspio_interp_t *src);
  * @param[in] mesh: mesh structure.
  * @param[in] f: values of the function on the mesh.
  * @return error code
+ * @note The Hermite methods need the derivatives of the function, see
+ *       pspio_interp_init_derivs.
  */
 int pspio_interp_init(pspio_interp_t *interp, const pspio_mesh_t *mesh, const double *f);
 
+/**
+ * Initializes the interpolation object from the values of the function
+ * and of its derivatives on the mesh. The spline methods only use f,
+ * while the Hermite methods keep references to the mesh points and to
+ * the arrays they need, without copying them.
+ * @param[in,out] interp: interpolation structure to be initialized.
+ * @param[in] mesh: mesh structure.
+ * @param[in] f: values of the function on the mesh.
+ * @param[in] fp: values of its first derivative on the mesh (may be NULL
+ *            for the spline methods)
+ * @param[in] fpp: values of its second derivative on the mesh (may be
+ *            NULL, except for PSPIO_INTERP_HERMITE5)
+ * @return error code
+ * @note With the Hermite methods, mesh and the arrays must outlive interp.
+ */
+int pspio_interp_init_derivs(pspio_interp_t *interp, const pspio_mesh_t *mesh,
+                             const double *f, const double *fp, const double *fpp);
+
+/**
+ * Initializes n interpolation objects defined on the same mesh. The
+ * cubic splines of the JB method share a single factorization of the
+ * mesh and are solved for together.
+ * @param[in] n: number of interpolation objects
+ * @param[in,out] interp: interpolation structures to be initialized
+ * @param[in] mesh: mesh structure
+ * @param[in] f: values of each function on the mesh
+ * @return error code
+ */
+int pspio_interp_init_batch(int n, pspio_interp_t **interp,
+                            const pspio_mesh_t *mesh, const double *const *f);
+
 /**
  * Frees all memory associated with the interpolation structure
  * 
@@ -123,4 +159,81 @@ double pspio_interp_eval_deriv(const pspio_interp_t *interp, double r);
  */
 double pspio_interp_eval_deriv2(const pspio_interp_t *interp, double r);
 
+/**
+ * Same as pspio_interp_eval, at a point located with pspio_mesh_locate
+ * on the mesh used to initialize interp
+ * @param[in] interp: interpolation structure
+ * @param[in] loc: position of the point
+ * @return value of the function
+ */
+double pspio_interp_eval_located(const pspio_interp_t *interp,
+                                 const pspio_mesh_loc_t *loc);
+
+/**
+ * Same as pspio_interp_eval_deriv, at a located point
+ * @param[in] interp: interpolation structure
+ * @param[in] loc: position of the point
+ * @return value of the derivative
+ */
+double pspio_interp_eval_deriv_located(const pspio_interp_t *interp,
+                                       const pspio_mesh_loc_t *loc);
+
+/**
+ * Same as pspio_interp_eval_deriv2, at a located point
+ * @param[in] interp: interpolation structure
+ * @param[in] loc: position of the point
+ * @return value of the second derivative
+ */
+double pspio_interp_eval_deriv2_located(const pspio_interp_t *interp,
+                                        const pspio_mesh_loc_t *loc);
+
+/**
+ * Evaluates the interpolated function at n points in single precision.
+ * The interpolation must have been allocated with PSPIO_INTERP_SINGLE.
+ * Its single-precision copy stores, for each interval, the cubic Hermite
+ * polynomial built from the values and first derivatives of the
+ * interpolation at the ends of the interval, which is exact for the
+ * cubic methods.
+ *
+ * @param[in] interp: interpolation structure
+ * @param[in] n: number of points
+ * @param[in] r: points were we want to evaluate the function
+ * @param[out] f: values of the function
+ * @note Points outside of the mesh use the cubic of the closest interval.
+ */
+void pspio_interp_eval_float_batch(const pspio_interp_t *interp, int n,
+                                   const float *r, float *f);
+
+/**
+ * Same as pspio_interp_eval_float_batch for the first derivative
+ *
+ * @param[in] interp: interpolation structure
+ * @param[in] n: number of points
+ * @param[in] r: points were we want to evaluate the derivative
+ * @param[out] fp: values of the derivative
+ */
+void pspio_interp_eval_deriv_float_batch(const pspio_interp_t *interp, int n,
+                                         const float *r, float *fp);
+
+/**
+ * Evaluates the first and second derivatives of the interpolated
+ * function at all the points of the mesh it was initialized with.
+ * @param[in] interp: interpolation structure
+ * @param[in] mesh: mesh used to initialize interp
+ * @param[out] fp: values of the first derivative (may be NULL)
+ * @param[out] fpp: values of the second derivative (may be NULL)
+ */
+void pspio_interp_eval_nodes(const pspio_interp_t *interp, const pspio_mesh_t *mesh,
+                             double *fp, double *fpp);
+
+/**
+ * Adds the memory footprint of interp to usage.
+ * For GSL interpolation objects the size of the coefficients is an
+ * estimate based on the cubic spline state of GSL.
+ *
+ * @param[in] interp: interp structure, may be NULL
+ * @param[in,out] usage: memory footprint to update
+ */
+void pspio_interp_memory_usage(const pspio_interp_t *interp, pspio_memory_t *usage);
+
 #endif
@@ -43,6 +43,59 @@ struct jb_spline_t {
     double* ypp;
 };
 
+/**
+ * LU factorization of the natural cubic spline system of a mesh
+ */
+struct jb_spline_factor_t {
+    int np;          /**< Number of knots */
+    double *h_inv;   /**< Inverse of the knot spacings */
+    double *mult;    /**< Multipliers of the forward elimination */
+    double *piv_inv; /**< Inverse of the pivots */
+    double *upper;   /**< Super-diagonal of the system */
+    int nwork;       /**< Size of the workspace */
+    double *work;    /**< Workspace holding the interleaved right-hand sides */
+};
+
+
+/**********************************************************************
+ * Private routines                                                   *
+ **********************************************************************/
+
+/* Evaluates a piecewise cubic spline in a given interval */
+static void jb_spline_cubic_val_in(const double *t, const double *y,
+                                   const double *ypp, int ival, double tval,
+                                   double *yval, double *ypval, double *yppval)
+{
+  double dt;
+  double h;
+
+/*
+  In the interval I, the polynomial is in terms of a normalized
+  coordinate between 0 and 1.
+*/
+  dt = tval - t[ival];
+  h = t[ival+1] - t[ival];
+
+  if (yval != NULL) {
+    *yval = y[ival]
+    + dt * ( ( y[ival+1] - y[ival] ) / h
+           - ( ypp[ival+1] / 6.0 + ypp[ival] / 3.0 ) * h
+    + dt * ( 0.5 * ypp[ival]
+    + dt * ( ( ypp[ival+1] - ypp[ival] ) / ( 6.0 * h ) ) ) );
+  }
+
+  if (ypval != NULL) {
+    *ypval = ( y[ival+1] - y[ival] ) / h
+    - ( ypp[ival+1] / 6.0 + ypp[ival] / 3.0 ) * h
+    + dt * ( ypp[ival]
+    + dt * ( 0.5 * ( ypp[ival+1] - ypp[ival] ) / h ) );
+  }
+
+  if (yppval != NULL) {
+    *yppval = ypp[ival] + dt * ( ypp[ival+1] - ypp[ival] ) / h;
+  }
+}
+
 
 /**********************************************************************
  * Global routines                                                    *
@@ -69,13 +122,196 @@ int jb_spline_alloc(jb_spline_t **spline, int np)
 
 int jb_spline_init(jb_spline_t **spline, const double *r, const double *f, int np)
 {
-  memcpy((*spline)->t, r, np * sizeof(double));
-  memcpy((*spline)->y, f, np * sizeof(double));
-  (*spline)->ypp = jb_natural_spline_cubic_init(np, r, f);
+  int ierr;
+  jb_spline_factor_t *factor = NULL;
+
+  SUCCEED_OR_RETURN( jb_spline_factor_alloc(&factor, np) );
+  ierr = jb_spline_factor_init(factor, r);
+  if ( ierr == PSPIO_SUCCESS ) {
+    ierr = jb_spline_init_batch(1, spline, factor, r, &f);
+  }
+  jb_spline_factor_free(factor);
+
+  RETURN_WITH_ERROR( ierr );
+}
+
+int jb_spline_init_batch(int n, jb_spline_t **splines, jb_spline_factor_t *factor,
+                         const double *r, const double *const *f)
+{
+  int i, np;
+  double **ypp;
+
+  assert(factor != NULL);
+  assert(n == 0 || (splines != NULL && f != NULL));
+
+  if ( n == 0 ) return PSPIO_SUCCESS;
+
+  np = factor->np;
+  ypp = (double **) malloc (n * sizeof(double *));
+  FULFILL_OR_EXIT( ypp != NULL, PSPIO_ENOMEM );
+  for (i=0; i<n; i++) {
+    assert(splines[i]->np == np);
+    memcpy(splines[i]->t, r, np * sizeof(double));
+    memcpy(splines[i]->y, f[i], np * sizeof(double));
+    ypp[i] = splines[i]->ypp;
+  }
+  jb_spline_factor_solve(factor, n, f, ypp);
+  free(ypp);
+
+  return PSPIO_SUCCESS;
+}
+
+int jb_spline_factor_alloc(jb_spline_factor_t **factor, int np)
+{
+  assert(factor != NULL);
+  assert(np > 1);
+
+  *factor = (jb_spline_factor_t *) malloc (sizeof(jb_spline_factor_t));
+  FULFILL_OR_EXIT( *factor != NULL, PSPIO_ENOMEM );
+
+  (*factor)->np = np;
+  (*factor)->h_inv = (double *) malloc (np * sizeof(double));
+  FULFILL_OR_EXIT( (*factor)->h_inv != NULL, PSPIO_ENOMEM );
+  (*factor)->mult = (double *) malloc (np * sizeof(double));
+  FULFILL_OR_EXIT( (*factor)->mult != NULL, PSPIO_ENOMEM );
+  (*factor)->piv_inv = (double *) malloc (np * sizeof(double));
+  FULFILL_OR_EXIT( (*factor)->piv_inv != NULL, PSPIO_ENOMEM );
+  (*factor)->upper = (double *) malloc (np * sizeof(double));
+  FULFILL_OR_EXIT( (*factor)->upper != NULL, PSPIO_ENOMEM );
+  (*factor)->nwork = 0;
+  (*factor)->work = NULL;
 
   return PSPIO_SUCCESS;
 }
 
+int jb_spline_factor_init(jb_spline_factor_t *factor, const double *t)
+{
+  int i, np;
+  double diag, piv;
+
+  assert(factor != NULL);
+  assert(t != NULL);
+
+  np = factor->np;
+  for (i=0; i<np-1; i++) {
+    FULFILL_OR_RETURN( t[i+1] > t[i], PSPIO_EVALUE );
+    factor->h_inv[i] = 1.0 / (t[i+1] - t[i]);
+  }
+  factor->h_inv[np-1] = 0.0;
+
+  /*
+    With natural boundary conditions, the second derivatives at both
+    ends vanish and the interior ones solve the tridiagonal system
+
+      h(i-1)/6 ypp(i-1) + (h(i-1) + h(i))/3 ypp(i) + h(i)/6 ypp(i+1)
+        = (y(i+1) - y(i))/h(i) - (y(i) - y(i-1))/h(i-1)
+
+    which is factorized here without pivoting, as it is diagonally
+    dominant.
+  */
+  for (i=0; i<np; i++) {
+    factor->mult[i] = 0.0;
+    factor->piv_inv[i] = 0.0;
+    factor->upper[i] = 0.0;
+  }
+  piv = 0.0;
+  for (i=1; i<np-1; i++) {
+    diag = (t[i+1] - t[i-1]) / 3.0;
+    factor->upper[i] = (t[i+1] - t[i]) / 6.0;
+    if ( i > 1 ) {
+      factor->mult[i] = (t[i] - t[i-1]) / 6.0 / piv;
+      diag -= factor->mult[i] * factor->upper[i-1];
+    }
+    piv = diag;
+    factor->piv_inv[i] = 1.0 / piv;
+  }
+
+  return PSPIO_SUCCESS;
+}
+
+void jb_spline_factor_solve(jb_spline_factor_t *factor, int nrhs,
+                            const double *const *y, double *const *ypp)
+{
+  int i, j, np;
+  double *w, *wp;
+  const double *h_inv;
+
+  assert(factor != NULL);
+  assert(nrhs == 0 || (y != NULL && ypp != NULL));
+
+  np = factor->np;
+  for (j=0; j<nrhs; j++) {
+    ypp[j][0] = 0.0;
+    ypp[j][np-1] = 0.0;
+  }
+  if ( (np < 3) || (nrhs == 0) ) return;
+
+  /* Grow the workspace if needed */
+  if ( factor->nwork < np * nrhs ) {
+    free(factor->work);
+    factor->nwork = np * nrhs;
+    factor->work = (double *) malloc (factor->nwork * sizeof(double));
+    FULFILL_OR_EXIT( factor->work != NULL, PSPIO_ENOMEM );
+  }
+  h_inv = factor->h_inv;
+
+  /* Right-hand sides, interleaved so that the sweeps below run over
+     contiguous memory for all the functions at once */
+  for (j=0; j<nrhs; j++) {
+    for (i=1; i<np-1; i++) {
+      factor->work[i*nrhs + j] = (y[j][i+1] - y[j][i]) * h_inv[i] -
+        (y[j][i] - y[j][i-1]) * h_inv[i-1];
+    }
+  }
+
+  /* Forward elimination */
+  for (i=2; i<np-1; i++) {
+    w = factor->work + i*nrhs;
+    wp = w - nrhs;
+    for (j=0; j<nrhs; j++) {
+      w[j] -= factor->mult[i] * wp[j];
+    }
+  }
+
+  /* Back substitution */
+  w = factor->work + (np-2)*nrhs;
+  for (j=0; j<nrhs; j++) {
+    w[j] *= factor->piv_inv[np-2];
+  }
+  for (i=np-3; i>0; i--) {
+    w = factor->work + i*nrhs;
+    wp = w + nrhs;
+    for (j=0; j<nrhs; j++) {
+      w[j] = (w[j] - factor->upper[i] * wp[j]) * factor->piv_inv[i];
+    }
+  }
+
+  for (j=0; j<nrhs; j++) {
+    for (i=1; i<np-1; i++) {
+      ypp[j][i] = factor->work[i*nrhs + j];
+    }
+  }
+}
+
+void jb_spline_factor_free(jb_spline_factor_t *factor)
+{
+  if ( factor != NULL ) {
+    free(factor->h_inv);
+    free(factor->mult);
+    free(factor->piv_inv);
+    free(factor->upper);
+    free(factor->work);
+    free(factor);
+  }
+}
+
+size_t jb_spline_memory_usage(const jb_spline_t *spline)
+{
+  assert(spline != NULL);
+
+  return sizeof(jb_spline_t) + 3 * spline->np * sizeof(double);
+}
+
 double *jb_spline_cubic_init(int n, const double *t, const double *y, int ibcbeg,
 			     double ybcbeg, int ibcend, double ybcend)
 /******************************************************************************/
@@ -359,16 +595,22 @@ double *jb_spline_cubic_init(int n, const double *t, const double *y, int ibcbeg
 
 double *jb_natural_spline_cubic_init(int n, const double *t, const double *y)
 {
-  int ibcbeg, ibcend;
-  double ybcbeg, ybcend;
+  double *ypp;
+  jb_spline_factor_t *factor = NULL;
 
-  /* defining boundary conditions for the natural spline */
-  ibcbeg = 2;
-  ibcend = 2;
-  ybcbeg = 0.0;
-  ybcend = 0.0;
+  ypp = (double *) malloc (n * sizeof(double));
+  FULFILL_OR_EXIT( ypp != NULL, PSPIO_ENOMEM );
 
-  return jb_spline_cubic_init(n, t, y, ibcbeg, ybcbeg, ibcend, ybcend);
+  jb_spline_factor_alloc(&factor, n);
+  if ( jb_spline_factor_init(factor, t) == PSPIO_SUCCESS ) {
+    jb_spline_factor_solve(factor, 1, &y, &ypp);
+  } else {
+    free(ypp);
+    ypp = NULL;
+  }
+  jb_spline_factor_free(factor);
+
+  return ypp;
 }
 
 int jb_spline_copy(jb_spline_t **dst, const jb_spline_t *src)
@@ -441,6 +683,50 @@ double jb_spline_eval_deriv2(const jb_spline_t *spline, double r)
   return ret;
 }
 
+void jb_spline_eval_nodes(const jb_spline_t *spline, double *yp, double *ypp)
+{
+  int i, n;
+  double h;
+  const double *t, *y, *s;
+
+  assert(spline != NULL);
+
+  n = spline->np;
+  t = spline->t;
+  y = spline->y;
+  s = spline->ypp;
+
+  /* Same expressions as jb_spline_cubic_val, without the search of the
+     interval, the last knot belonging to the last interval */
+  if ( yp != NULL ) {
+    for (i=0; i<n-1; i++) {
+      h = t[i+1] - t[i];
+      yp[i] = ( y[i+1] - y[i] ) / h - ( s[i+1] / 6.0 + s[i] / 3.0 ) * h;
+    }
+    h = t[n-1] - t[n-2];
+    yp[n-1] = ( y[n-1] - y[n-2] ) / h
+      - ( s[n-1] / 6.0 + s[n-2] / 3.0 ) * h
+      + h * ( s[n-2] + h * ( 0.5 * ( s[n-1] - s[n-2] ) / h ) );
+  }
+  if ( ypp != NULL ) {
+    for (i=0; i<n-1; i++) {
+      ypp[i] = s[i];
+    }
+    h = t[n-1] - t[n-2];
+    ypp[n-1] = s[n-2] + h * ( s[n-1] - s[n-2] ) / h;
+  }
+}
+
+void jb_spline_eval_located(const jb_spline_t *spline, int ival, double r,
+                            double *yval, double *ypval, double *yppval)
+{
+  assert(spline != NULL);
+  assert((ival >= 0) && (ival < spline->np - 1));
+
+  jb_spline_cubic_val_in(spline->t, spline->y, spline->ypp, ival, r,
+                         yval, ypval, yppval);
+}
+
 void jb_spline_cubic_val(int n, const double *t, const double *y, const double *ypp, 
 			 double tval, double *yval, double *ypval, double *yppval)
 /******************************************************************************/
@@ -505,8 +791,6 @@ void jb_spline_cubic_val(int n, const double *t, const double *y, const double *
     TVAL. If YPPVAL is NULL, the second derivative is not computed.
 */
 {
-  double dt;
-  double h;
   int i;
   int ival;
 /*
@@ -523,32 +807,7 @@ void jb_spline_cubic_val(int n, const double *t, const double *y, const double *
       break;
     }
   }
-/*
-  In the interval I, the polynomial is in terms of a normalized
-  coordinate between 0 and 1.
-*/
-  dt = tval - t[ival];
-  h = t[ival+1] - t[ival];
-
-  if (yval != NULL) {
-    *yval = y[ival]
-    + dt * ( ( y[ival+1] - y[ival] ) / h
-           - ( ypp[ival+1] / 6.0 + ypp[ival] / 3.0 ) * h
-    + dt * ( 0.5 * ypp[ival]
-    + dt * ( ( ypp[ival+1] - ypp[ival] ) / ( 6.0 * h ) ) ) );
-  }
-
-  if (ypval != NULL) {
-    *ypval = ( y[ival+1] - y[ival] ) / h
-    - ( ypp[ival+1] / 6.0 + ypp[ival] / 3.0 ) * h
-    + dt * ( ypp[ival]
-    + dt * ( 0.5 * ( ypp[ival+1] - ypp[ival] ) / h ) );
-  }
-
-  if (yppval != NULL) {
-    *yppval = ypp[ival] + dt * ( ypp[ival+1] - ypp[ival] ) / h;
-  }
-
+  jb_spline_cubic_val_in(t, y, ypp, ival, tval, yval, ypval, yppval);
 }
 
 double *penta(int n, double a1[], double a2[], double a3[], double a4[], 
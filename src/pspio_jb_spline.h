@@ -39,6 +39,12 @@
  */
 typedef struct jb_spline_t jb_spline_t;
 
+/**
+ * Factorization of the natural cubic spline system of a mesh, shared by
+ * all the functions defined on it
+ */
+typedef struct jb_spline_factor_t jb_spline_factor_t;
+
 
 /**********************************************************************
  * Global routines                                                    *
@@ -55,6 +61,44 @@ int jb_spline_alloc(jb_spline_t **spline, int np);
 int jb_spline_init(jb_spline_t **spline, const double *f, const double *r, 
 		   int np);
 
+/**
+ * Initializes n splines defined on the same mesh at once, solving for
+ * all their second derivatives in a single sweep.
+ * @param[in] n: number of splines
+ * @param[in,out] splines: splines allocated with jb_spline_alloc
+ * @param[in,out] factor: factorization of the mesh (its workspace is used)
+ * @param[in] r: mesh points
+ * @param[in] f: values of each function on the mesh
+ * @return error code
+ */
+int jb_spline_init_batch(int n, jb_spline_t **splines, jb_spline_factor_t *factor,
+                         const double *r, const double *const *f);
+
+/**
+ * Allocates a spline factorization for np knots.
+ */
+int jb_spline_factor_alloc(jb_spline_factor_t **factor, int np);
+
+/**
+ * Computes the LU factorization of the natural spline system for the
+ * knots t, which must be strictly increasing.
+ */
+int jb_spline_factor_init(jb_spline_factor_t *factor, const double *t);
+
+/**
+ * Computes the second derivatives ypp of the natural splines through
+ * nrhs sets of values y, using a workspace stored in the factorization.
+ * @note As the workspace is shared, a factorization can only be used by
+ *       one thread at a time.
+ */
+void jb_spline_factor_solve(jb_spline_factor_t *factor, int nrhs,
+                            const double *const *y, double *const *ypp);
+
+/**
+ * Frees a spline factorization.
+ */
+void jb_spline_factor_free(jb_spline_factor_t *factor);
+
 /**
  * 
  */
@@ -97,12 +141,32 @@ double jb_spline_eval_deriv(const jb_spline_t *spline, double r);
  */
 double jb_spline_eval_deriv2(const jb_spline_t *spline, double r);
 
+/**
+ * Evaluates the first and second derivatives of the spline at all its
+ * knots, in linear time. Either output may be NULL.
+ */
+void jb_spline_eval_nodes(const jb_spline_t *spline, double *yp, double *ypp);
+
+/**
+ * Evaluates the spline, and its derivatives, at a point r lying in the
+ * interval ival (or beyond the first or last interval). Any output may
+ * be NULL.
+ */
+void jb_spline_eval_located(const jb_spline_t *spline, int ival, double r,
+                            double *yval, double *ypval, double *yppval);
+
 /**
  * Evaluates a piecewise cubic spline at a point.
  */
 void jb_spline_cubic_val(int n, const double *t, const double *y, const double *ypp, 
 			 double tval, double *yval, double *ypval, double *yppval);
 
+/**
+ * Returns the number of bytes allocated for the spline, including the
+ * structure itself.
+ */
+size_t jb_spline_memory_usage(const jb_spline_t *spline);
+
 /**
  * Solves a pentadiagonal system of linear equations.
  */
@@ -0,0 +1,803 @@
+/* Copyright (C) 2018 Micael Oliveira <micael.oliveira@mpsd.mpg.de>
+ *                    Yann Pouillon <devops@materialsevolution.es>
+ *
+ * This file is part of Libpspio.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * version 2.0. If a copy of the MPL was not distributed with this file, You
+ * can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Libpspio is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the Mozilla Public License version 2.0 for
+ * more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "pspio_library.h"
+
+#if defined HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#if defined HAVE_DIRENT_H && defined HAVE_SYS_STAT_H
+#include <dirent.h>
+#include <sys/stat.h>
+#define PSPIO_LIBRARY_CRAWL 1
+#endif
+
+#if defined HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#if defined HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+
+/**********************************************************************
+ * Data structures                                                    *
+ **********************************************************************/
+
+/* Layout of the index files */
+static const char library_magic[8] = {'P','S','P','I','O','L','I','B'};
+#define PSPIO_LIBRARY_VERSION 1
+
+/* Fixed-size part of an entry, as stored in the index files */
+typedef struct{
+  int64_t mtime;
+  int64_t size;
+  double z;
+  double zvalence;
+  int32_t format;
+  int32_t l_max;
+  int32_t np;
+  int32_t n_states;
+  int32_t exchange;
+  int32_t correlation;
+  int32_t flags;
+  int32_t path_len;
+  char symbol[4];
+} library_record_t;
+
+
+/**********************************************************************
+ * Private routines                                                   *
+ **********************************************************************/
+
+/* Frees the entries of a library and forgets its root */
+static void library_clear(pspio_library_t *library)
+{
+  int i;
+
+  for (i=0; i<library->n_entries; i++) {
+    free(library->entries[i].path);
+  }
+  free(library->entries);
+  library->entries = NULL;
+  library->n_entries = 0;
+  free(library->root);
+  library->root = NULL;
+}
+
+static char *library_strdup(const char *s)
+{
+  char *copy;
+
+  copy = (char *) malloc (strlen(s) + 1);
+  FULFILL_OR_EXIT( copy != NULL, PSPIO_ENOMEM );
+  strcpy(copy, s);
+
+  return copy;
+}
+
+/* Length of a directory name without its trailing slashes */
+static size_t library_root_len(const char *root)
+{
+  size_t len = strlen(root);
+
+  while ( (len > 1) && (root[len-1] == '/') ) len--;
+
+  return len;
+}
+
+static int library_entry_cmp(const void *a, const void *b)
+{
+  return strcmp(((const pspio_library_entry_t *)a)->path,
+                ((const pspio_library_entry_t *)b)->path);
+}
+
+/* Fills an entry from the header of its file */
+static void library_entry_parse(pspio_library_entry_t *entry)
+{
+  const pspio_xc_t *xc;
+  pspio_pspdata_t *pspdata = NULL;
+
+  /* Files pspio cannot read stay in the index with an unknown format */
+  entry->format = PSPIO_FMT_UNKNOWN;
+  strcpy(entry->symbol, "");
+  entry->z = 0.0;
+  entry->zvalence = 0.0;
+  entry->l_max = 0;
+  entry->np = 0;
+  entry->n_states = 0;
+  entry->exchange = -1;
+  entry->correlation = -1;
+  entry->flags = 0;
+
+  if ( pspio_pspdata_alloc(&pspdata) != PSPIO_SUCCESS ) return;
+
+  if ( pspio_pspdata_read_header(pspdata, PSPIO_FMT_UNKNOWN, entry->path) ==
+       PSPIO_SUCCESS ) {
+    entry->format = pspio_pspdata_get_format_guessed(pspdata);
+    strncpy(entry->symbol, pspio_pspdata_get_symbol(pspdata), 3);
+    entry->symbol[3] = '\0';
+    entry->z = pspio_pspdata_get_z(pspdata);
+    entry->zvalence = pspio_pspdata_get_zvalence(pspdata);
+    entry->l_max = pspio_pspdata_get_l_max(pspdata);
+    entry->np = pspio_pspdata_get_np(pspdata);
+    entry->n_states = pspio_pspdata_get_n_states(pspdata);
+    xc = pspio_pspdata_get_xc(pspdata);
+    if ( xc != NULL ) {
+      entry->exchange = pspio_xc_get_exchange(xc);
+      entry->correlation = pspio_xc_get_correlation(xc);
+      if ( pspio_xc_has_nlcc(xc) ) entry->flags |= PSPIO_LIBRARY_NLCC;
+    }
+  }
+  pspio_pspdata_free(pspdata);
+
+  /* Failing to read a file is not an error of the scan */
+  pspio_error_free();
+}
+
+#if defined PSPIO_LIBRARY_CRAWL
+/* Growable list of the files found by the crawler */
+typedef struct{
+  int n;
+  int size;
+  pspio_library_entry_t *entries;
+} library_files_t;
+
+/* Directories waiting to be read and files found, shared by the crawlers */
+typedef struct{
+  int n_dirs;
+  int size_dirs;
+  char **dirs;
+  int busy; /* crawlers reading a directory */
+  library_files_t *files;
+#if defined HAVE_PTHREAD
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+#endif
+} library_walk_t;
+
+/* Queues a directory, with the lock held */
+static void library_walk_push(library_walk_t *walk, char *dir)
+{
+  if ( walk->n_dirs == walk->size_dirs ) {
+    walk->size_dirs = (walk->size_dirs == 0) ? 16 : 2*walk->size_dirs;
+    walk->dirs = (char **) realloc (walk->dirs, walk->size_dirs*sizeof(char *));
+    FULFILL_OR_EXIT( walk->dirs != NULL, PSPIO_ENOMEM );
+  }
+  walk->dirs[walk->n_dirs++] = dir;
+}
+
+/* Adds a regular file to the list, with the lock held */
+static void library_walk_add(library_walk_t *walk, char *path,
+                             const struct stat *st)
+{
+  library_files_t *files = walk->files;
+  pspio_library_entry_t *entry;
+
+  if ( files->n == files->size ) {
+    files->size = (files->size == 0) ? 64 : 2*files->size;
+    files->entries = (pspio_library_entry_t *) realloc (files->entries,
+      files->size*sizeof(pspio_library_entry_t));
+    FULFILL_OR_EXIT( files->entries != NULL, PSPIO_ENOMEM );
+  }
+  entry = &files->entries[files->n++];
+  memset(entry, 0, sizeof(pspio_library_entry_t));
+  entry->path = path;
+  entry->mtime = (int64_t)st->st_mtime;
+  entry->size = (int64_t)st->st_size;
+}
+
+/* Lists the regular files of dir and queues its subdirectories */
+static void library_walk_dir(library_walk_t *walk, const char *dir)
+{
+  DIR *dp;
+  struct dirent *de;
+  struct stat st;
+  char *path;
+  size_t len;
+
+  /* Unreadable directories are skipped */
+  dp = opendir(dir);
+  if ( dp == NULL ) return;
+
+  len = strlen(dir);
+  while ( (de = readdir(dp)) != NULL ) {
+    if ( de->d_name[0] == '.' ) continue;
+
+    path = (char *) malloc (len + strlen(de->d_name) + 2);
+    FULFILL_OR_EXIT( path != NULL, PSPIO_ENOMEM );
+    sprintf(path, (len > 0 && dir[len-1] == '/') ? "%s%s" : "%s/%s",
+            dir, de->d_name);
+
+    if ( lstat(path, &st) != 0 ) {
+      free(path);
+      continue;
+    }
+
+    /* Follow links to files, but not to directories */
+    if ( S_ISLNK(st.st_mode) &&
+         ((stat(path, &st) != 0) || S_ISDIR(st.st_mode)) ) {
+      free(path);
+      continue;
+    }
+
+    if ( !S_ISDIR(st.st_mode) && !S_ISREG(st.st_mode) ) {
+      free(path);
+      continue;
+    }
+#if defined HAVE_PTHREAD
+    pthread_mutex_lock(&walk->lock);
+#endif
+    if ( S_ISDIR(st.st_mode) ) {
+      library_walk_push(walk, path);
+#if defined HAVE_PTHREAD
+      pthread_cond_signal(&walk->cond);
+#endif
+    } else {
+      library_walk_add(walk, path, &st);
+    }
+#if defined HAVE_PTHREAD
+    pthread_mutex_unlock(&walk->lock);
+#endif
+  }
+
+  closedir(dp);
+}
+
+/* Reads queued directories until none is left and no crawler can add any */
+static void *library_walk_worker(void *arg)
+{
+  char *dir;
+  library_walk_t *walk = (library_walk_t *)arg;
+
+  while ( 1 ) {
+#if defined HAVE_PTHREAD
+    pthread_mutex_lock(&walk->lock);
+    while ( (walk->n_dirs == 0) && (walk->busy > 0) ) {
+      pthread_cond_wait(&walk->cond, &walk->lock);
+    }
+#endif
+    if ( walk->n_dirs == 0 ) {
+#if defined HAVE_PTHREAD
+      pthread_cond_broadcast(&walk->cond);
+      pthread_mutex_unlock(&walk->lock);
+#endif
+      break;
+    }
+    dir = walk->dirs[--walk->n_dirs];
+    walk->busy++;
+#if defined HAVE_PTHREAD
+    pthread_mutex_unlock(&walk->lock);
+#endif
+
+    library_walk_dir(walk, dir);
+    free(dir);
+
+#if defined HAVE_PTHREAD
+    pthread_mutex_lock(&walk->lock);
+#endif
+    walk->busy--;
+#if defined HAVE_PTHREAD
+    if ( walk->busy == 0 ) pthread_cond_broadcast(&walk->cond);
+    pthread_mutex_unlock(&walk->lock);
+#endif
+  }
+
+  return NULL;
+}
+
+/*
+ * Adds the regular files below dir to the list, with nthreads threads
+ * reading the directories, including the caller. The order of the files
+ * is not defined.
+ */
+static void library_crawl(const char *dir, library_files_t *files,
+                          int nthreads)
+{
+  library_walk_t walk;
+#if defined HAVE_PTHREAD
+  int i, n_workers;
+  pthread_t *workers;
+#endif
+
+  walk.n_dirs = 0;
+  walk.size_dirs = 0;
+  walk.dirs = NULL;
+  walk.busy = 0;
+  walk.files = files;
+  library_walk_push(&walk, library_strdup(dir));
+
+#if defined HAVE_PTHREAD
+  n_workers = (nthreads > 1) ? nthreads - 1 : 0;
+
+  pthread_mutex_init(&walk.lock, NULL);
+  pthread_cond_init(&walk.cond, NULL);
+  workers = NULL;
+  if ( n_workers > 0 ) {
+    workers = (pthread_t *) malloc (n_workers*sizeof(pthread_t));
+    FULFILL_OR_EXIT( workers != NULL, PSPIO_ENOMEM );
+  }
+
+  /* Threads that cannot be started simply leave more work to the others */
+  for (i=0; i<n_workers; i++) {
+    if ( pthread_create(&workers[i], NULL, library_walk_worker, &walk) != 0 ) {
+      break;
+    }
+  }
+  n_workers = i;
+
+  library_walk_worker(&walk);
+
+  for (i=0; i<n_workers; i++) {
+    pthread_join(workers[i], NULL);
+  }
+  free(workers);
+  pthread_cond_destroy(&walk.cond);
+  pthread_mutex_destroy(&walk.lock);
+#else
+  library_walk_worker(&walk);
+#endif
+
+  free(walk.dirs);
+}
+#endif
+
+/* Work shared by the threads parsing the files */
+typedef struct{
+  pspio_library_entry_t *entries;
+  const int *todo;
+  int n_todo;
+  int next;
+#if defined HAVE_PTHREAD
+  pthread_mutex_t lock;
+#endif
+} library_work_t;
+
+static void *library_parse_worker(void *arg)
+{
+  int i;
+  library_work_t *work = (library_work_t *)arg;
+
+  while ( 1 ) {
+#if defined HAVE_PTHREAD
+    pthread_mutex_lock(&work->lock);
+#endif
+    i = work->next++;
+#if defined HAVE_PTHREAD
+    pthread_mutex_unlock(&work->lock);
+#endif
+    if ( i >= work->n_todo ) break;
+
+    library_entry_parse(&work->entries[work->todo[i]]);
+  }
+
+  return NULL;
+}
+
+/* Parses the listed entries with nthreads threads, including the caller */
+static void library_parse(pspio_library_entry_t *entries, const int *todo,
+                          int n_todo, int nthreads)
+{
+  library_work_t work;
+#if defined HAVE_PTHREAD
+  int i, n_workers;
+  pthread_t *workers;
+#endif
+
+  work.entries = entries;
+  work.todo = todo;
+  work.n_todo = n_todo;
+  work.next = 0;
+
+#if defined HAVE_PTHREAD
+  if ( nthreads > n_todo ) nthreads = n_todo;
+  n_workers = (nthreads > 1) ? nthreads - 1 : 0;
+
+  pthread_mutex_init(&work.lock, NULL);
+  workers = NULL;
+  if ( n_workers > 0 ) {
+    workers = (pthread_t *) malloc (n_workers*sizeof(pthread_t));
+    FULFILL_OR_EXIT( workers != NULL, PSPIO_ENOMEM );
+  }
+
+  /* Threads that cannot be started simply leave more work to the others */
+  for (i=0; i<n_workers; i++) {
+    if ( pthread_create(&workers[i], NULL, library_parse_worker, &work) != 0 ) {
+      break;
+    }
+  }
+  n_workers = i;
+
+  library_parse_worker(&work);
+
+  for (i=0; i<n_workers; i++) {
+    pthread_join(workers[i], NULL);
+  }
+  free(workers);
+  pthread_mutex_destroy(&work.lock);
+#else
+  library_parse_worker(&work);
+#endif
+}
+
+
+/**********************************************************************
+ * Global routines                                                    *
+ **********************************************************************/
+
+int pspio_library_alloc(pspio_library_t **library)
+{
+  assert(library != NULL);
+  assert(*library == NULL);
+
+  *library = (pspio_library_t *) malloc (sizeof(pspio_library_t));
+  FULFILL_OR_EXIT( *library != NULL, PSPIO_ENOMEM );
+
+  (*library)->root = NULL;
+  (*library)->n_entries = 0;
+  (*library)->entries = NULL;
+  (*library)->n_parsed = 0;
+
+  return PSPIO_SUCCESS;
+}
+
+int pspio_library_scan(pspio_library_t *library, const char *root,
+                       int nthreads)
+{
+#if defined PSPIO_LIBRARY_CRAWL
+  int i, n_todo;
+  int *todo;
+  char *path, *dir;
+  size_t len;
+  DIR *dp;
+  library_files_t files;
+  pspio_library_entry_t *old;
+
+  assert(library != NULL);
+  assert(root != NULL);
+
+  /* "dir" and "dir/" are the same root */
+  len = library_root_len(root);
+  dir = (char *) malloc (len + 1);
+  FULFILL_OR_EXIT( dir != NULL, PSPIO_ENOMEM );
+  memcpy(dir, root, len);
+  dir[len] = '\0';
+
+  /* Check the root before touching the index */
+  dp = opendir(dir);
+  if ( dp == NULL ) {
+    free(dir);
+    RETURN_WITH_ERROR( PSPIO_ENOFILE );
+  }
+  closedir(dp);
+
+  /* Entries of another tree cannot be reused */
+  if ( (library->root != NULL) &&
+       ((library_root_len(library->root) != len) ||
+        (strncmp(library->root, dir, len) != 0)) ) {
+    library_clear(library);
+  }
+
+  if ( nthreads <= 0 ) {
+#if defined HAVE_UNISTD_H && defined _SC_NPROCESSORS_ONLN
+    nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if ( nthreads <= 0 ) nthreads = 1;
+  }
+
+  files.n = 0;
+  files.size = 0;
+  files.entries = NULL;
+  library_crawl(dir, &files, nthreads);
+  if ( files.n > 1 ) {
+    qsort(files.entries, files.n, sizeof(pspio_library_entry_t),
+          library_entry_cmp);
+  }
+
+  /* Reuse the entries of unchanged files, list the others for parsing */
+  todo = NULL;
+  if ( files.n > 0 ) {
+    todo = (int *) malloc (files.n*sizeof(int));
+    FULFILL_OR_EXIT( todo != NULL, PSPIO_ENOMEM );
+  }
+  n_todo = 0;
+  for (i=0; i<files.n; i++) {
+    old = NULL;
+    if ( library->n_entries > 0 ) {
+      old = (pspio_library_entry_t *) bsearch(&files.entries[i],
+        library->entries, library->n_entries, sizeof(pspio_library_entry_t),
+        library_entry_cmp);
+    }
+    if ( (old != NULL) && (old->mtime == files.entries[i].mtime) &&
+         (old->size == files.entries[i].size) ) {
+      path = files.entries[i].path;
+      files.entries[i] = *old;
+      files.entries[i].path = path;
+    } else {
+      todo[n_todo++] = i;
+    }
+  }
+
+#if !defined HAVE_THREAD_LOCAL
+  /* The readers report their errors through a chain shared by all the
+     threads without thread-local storage */
+  nthreads = 1;
+#endif
+  library_parse(files.entries, todo, n_todo, nthreads);
+  free(todo);
+
+  /* Replace the entries, dropping the files that disappeared */
+  for (i=0; i<library->n_entries; i++) {
+    free(library->entries[i].path);
+  }
+  free(library->entries);
+  library->entries = files.entries;
+  library->n_entries = files.n;
+  library->n_parsed = n_todo;
+  if ( library->root == NULL ) {
+    library->root = dir;
+  } else {
+    free(dir);
+  }
+
+  return PSPIO_SUCCESS;
+#else
+  RETURN_WITH_ERROR( PSPIO_ENOSUPPORT );
+#endif
+}
+
+int pspio_library_save(const pspio_library_t *library, const char *file_name)
+{
+  int i, ierr;
+  int32_t header[3];
+  FILE *fp;
+  library_record_t rec;
+  const pspio_library_entry_t *entry;
+
+  assert(library != NULL);
+  assert(file_name != NULL);
+
+  fp = fopen(file_name, "wb");
+  FULFILL_OR_RETURN( fp != NULL, PSPIO_ENOFILE );
+
+  /* Header: magic, version, number of entries, length of the root */
+  header[0] = PSPIO_LIBRARY_VERSION;
+  header[1] = library->n_entries;
+  header[2] = (library->root == NULL) ? 0 : (int32_t)strlen(library->root);
+  ierr = PSPIO_SUCCESS;
+  if ( (fwrite(library_magic, sizeof(library_magic), 1, fp) != 1) ||
+       (fwrite(header, sizeof(header), 1, fp) != 1) ||
+       ((header[2] > 0) && (fwrite(library->root, header[2], 1, fp) != 1)) ) {
+    ierr = PSPIO_EIO;
+  }
+
+  for (i=0; (i<library->n_entries) && (ierr == PSPIO_SUCCESS); i++) {
+    entry = &library->entries[i];
+    memset(&rec, 0, sizeof(rec));
+    rec.mtime = entry->mtime;
+    rec.size = entry->size;
+    rec.z = entry->z;
+    rec.zvalence = entry->zvalence;
+    rec.format = entry->format;
+    rec.l_max = entry->l_max;
+    rec.np = entry->np;
+    rec.n_states = entry->n_states;
+    rec.exchange = entry->exchange;
+    rec.correlation = entry->correlation;
+    rec.flags = entry->flags;
+    rec.path_len = (int32_t)strlen(entry->path);
+    memcpy(rec.symbol, entry->symbol, sizeof(rec.symbol));
+    if ( (fwrite(&rec, sizeof(rec), 1, fp) != 1) ||
+         (fwrite(entry->path, rec.path_len, 1, fp) != 1) ) {
+      ierr = PSPIO_EIO;
+    }
+  }
+
+  if ( fclose(fp) != 0 ) ierr = PSPIO_EIO;
+  RETURN_WITH_ERROR( ierr );
+}
+
+int pspio_library_load(pspio_library_t *library, const char *file_name)
+{
+  int i, n;
+  int32_t header[3];
+  char magic[8];
+  long pos, left;
+  FILE *fp;
+  library_record_t rec;
+  pspio_library_entry_t *entry;
+
+  assert(library != NULL);
+  assert(file_name != NULL);
+
+  fp = fopen(file_name, "rb");
+  FULFILL_OR_RETURN( fp != NULL, PSPIO_ENOFILE );
+
+  if ( (fread(magic, sizeof(magic), 1, fp) != 1) ||
+       (memcmp(magic, library_magic, sizeof(magic)) != 0) ||
+       (fread(header, sizeof(header), 1, fp) != 1) ||
+       (header[0] != PSPIO_LIBRARY_VERSION) ) {
+    fclose(fp);
+    RETURN_WITH_ERROR( PSPIO_EFILE_FORMAT );
+  }
+
+  /* The sizes stored in the file cannot exceed what is left of it */
+  pos = ftell(fp);
+  if ( (pos < 0) || (fseek(fp, 0, SEEK_END) != 0) ||
+       ((left = ftell(fp) - pos) < 0) || (fseek(fp, pos, SEEK_SET) != 0) ) {
+    fclose(fp);
+    RETURN_WITH_ERROR( PSPIO_EIO );
+  }
+  if ( (header[1] < 0) || (header[2] < 0) || (header[2] > left) ||
+       (header[1] > (left - header[2]) / (long)sizeof(rec)) ) {
+    fclose(fp);
+    RETURN_WITH_ERROR( PSPIO_EFILE_CORRUPT );
+  }
+  left -= header[2];
+
+  library_clear(library);
+  library->n_parsed = 0;
+
+  library->root = (char *) malloc (header[2] + 1);
+  FULFILL_OR_EXIT( library->root != NULL, PSPIO_ENOMEM );
+  if ( (header[2] > 0) && (fread(library->root, header[2], 1, fp) != 1) ) {
+    library_clear(library);
+    fclose(fp);
+    RETURN_WITH_ERROR( PSPIO_EFILE_CORRUPT );
+  }
+  library->root[header[2]] = '\0';
+
+  n = header[1];
+  if ( n > 0 ) {
+    library->entries = (pspio_library_entry_t *) malloc (n*sizeof(pspio_library_entry_t));
+    FULFILL_OR_EXIT( library->entries != NULL, PSPIO_ENOMEM );
+  }
+
+  /* n_entries is kept up to date so that a truncated file is cleaned up */
+  for (i=0; i<n; i++) {
+    left -= sizeof(rec);
+    if ( (fread(&rec, sizeof(rec), 1, fp) != 1) || (rec.path_len <= 0) ||
+         (rec.path_len > left) ) {
+      library_clear(library);
+      fclose(fp);
+      RETURN_WITH_ERROR( PSPIO_EFILE_CORRUPT );
+    }
+    left -= rec.path_len;
+
+    entry = &library->entries[i];
+    entry->path = (char *) malloc (rec.path_len + 1);
+    FULFILL_OR_EXIT( entry->path != NULL, PSPIO_ENOMEM );
+    library->n_entries = i + 1;
+    if ( fread(entry->path, rec.path_len, 1, fp) != 1 ) {
+      library_clear(library);
+      fclose(fp);
+      RETURN_WITH_ERROR( PSPIO_EFILE_CORRUPT );
+    }
+    entry->path[rec.path_len] = '\0';
+
+    entry->mtime = rec.mtime;
+    entry->size = rec.size;
+    entry->format = rec.format;
+    memcpy(entry->symbol, rec.symbol, sizeof(entry->symbol));
+    entry->symbol[3] = '\0';
+    entry->z = rec.z;
+    entry->zvalence = rec.zvalence;
+    entry->l_max = rec.l_max;
+    entry->np = rec.np;
+    entry->n_states = rec.n_states;
+    entry->exchange = rec.exchange;
+    entry->correlation = rec.correlation;
+    entry->flags = rec.flags;
+  }
+
+  FULFILL_OR_RETURN( fclose(fp) == 0, PSPIO_EIO );
+
+  return PSPIO_SUCCESS;
+}
+
+void pspio_library_free(pspio_library_t *library)
+{
+  if ( library != NULL ) {
+    library_clear(library);
+    free(library);
+  }
+}
+
+
+/**********************************************************************
+ * Getters                                                            *
+ **********************************************************************/
+
+int pspio_library_get_n_entries(const pspio_library_t *library)
+{
+  assert(library != NULL);
+
+  return library->n_entries;
+}
+
+const pspio_library_entry_t *pspio_library_get_entry(
+  const pspio_library_t *library, int index)
+{
+  assert(library != NULL);
+  assert(index >= 0 && index < library->n_entries);
+
+  return &library->entries[index];
+}
+
+int pspio_library_get_n_parsed(const pspio_library_t *library)
+{
+  assert(library != NULL);
+
+  return library->n_parsed;
+}
+
+
+/**********************************************************************
+ * Utility routines                                                   *
+ **********************************************************************/
+
+void pspio_library_query_init(pspio_library_query_t *query)
+{
+  assert(query != NULL);
+
+  strcpy(query->symbol, "");
+  query->exchange = -1;
+  query->correlation = -1;
+  query->format = PSPIO_FMT_UNKNOWN;
+  query->flags = 0;
+  query->zvalence_min = -1.0e300;
+  query->zvalence_max = 1.0e300;
+}
+
+int pspio_library_query(const pspio_library_t *library,
+                        const pspio_library_query_t *query,
+                        int *indices, int max_indices)
+{
+  int i, n;
+  const pspio_library_entry_t *entry;
+
+  assert(library != NULL);
+  assert(query != NULL);
+  assert(indices != NULL || max_indices == 0);
+
+  n = 0;
+  for (i=0; i<library->n_entries; i++) {
+    entry = &library->entries[i];
+
+    if ( entry->format == PSPIO_FMT_UNKNOWN ) continue;
+    if ( (query->format != PSPIO_FMT_UNKNOWN) &&
+         (entry->format != query->format) ) continue;
+    if ( (query->symbol[0] != '\0') &&
+         (strcmp(entry->symbol, query->symbol) != 0) ) continue;
+    if ( (query->exchange != -1) && (entry->exchange != query->exchange) ) continue;
+    if ( (query->correlation != -1) &&
+         (entry->correlation != query->correlation) ) continue;
+    if ( (entry->flags & query->flags) != query->flags ) continue;
+    if ( (entry->zvalence < query->zvalence_min) ||
+         (entry->zvalence > query->zvalence_max) ) continue;
+
+    if ( n < max_indices ) indices[n] = i;
+    n++;
+  }
+
+  return n;
+}
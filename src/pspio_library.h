@@ -0,0 +1,196 @@
+/* Copyright (C) 2018 Micael Oliveira <micael.oliveira@mpsd.mpg.de>
+ *                    Yann Pouillon <devops@materialsevolution.es>
+ *
+ * This file is part of Libpspio.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * version 2.0. If a copy of the MPL was not distributed with this file, You
+ * can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Libpspio is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the Mozilla Public License version 2.0 for
+ * more details.
+ */
+
+#ifndef PSPIO_LIBRARY_H
+#define PSPIO_LIBRARY_H
+
+/**
+ * @file pspio_library.h
+ * @brief header file for the index of a library of pseudopotential files
+ */
+
+#include <stdint.h>
+
+#include "pspio_error.h"
+#include "pspio_pspdata.h"
+
+
+/**********************************************************************
+ * Data structures                                                    *
+ **********************************************************************/
+
+/**
+ * Flags of the library entries
+ */
+#define PSPIO_LIBRARY_NLCC 1 /**< Non-linear core corrections */
+
+/**
+ * Metadata of a pseudopotential file, as found in its header
+ */
+typedef struct{
+  char *path;         /**< Path of the file, starting with the library root */
+  int64_t mtime;      /**< Modification time of the file, in seconds */
+  int64_t size;       /**< Size of the file, in bytes */
+
+  int format;         /**< Format of the file */
+  char symbol[4];     /**< Atomic symbol */
+  double z;           /**< Atomic number */
+  double zvalence;    /**< Charge of pseudopotential ion - valence electrons */
+  int l_max;          /**< Maximal angular momentum channel */
+  int np;             /**< Number of mesh points */
+  int n_states;       /**< Number of states */
+  int exchange;       /**< Libxc id of the exchange functional, -1 if unknown */
+  int correlation;    /**< Libxc id of the correlation functional, -1 if unknown */
+  int flags;          /**< Combination of PSPIO_LIBRARY_* flags */
+} pspio_library_entry_t;
+
+/**
+ * Index of all the pseudopotential files found below a directory
+ */
+typedef struct{
+  char *root;                       /**< Directory the index was built from */
+  int n_entries;                    /**< Number of indexed files */
+  pspio_library_entry_t *entries;   /**< Entries, sorted by path */
+  int n_parsed;                     /**< Files parsed by the last scan */
+} pspio_library_t;
+
+/**
+ * Criteria of a query. Fields left to the values set by
+ * pspio_library_query_init match any entry.
+ */
+typedef struct{
+  char symbol[4];     /**< Atomic symbol, "" for any */
+  int exchange;       /**< Libxc id of the exchange, -1 for any */
+  int correlation;    /**< Libxc id of the correlation, -1 for any */
+  int format;         /**< Format, PSPIO_FMT_UNKNOWN for any */
+  int flags;          /**< PSPIO_LIBRARY_* flags that must all be set */
+  double zvalence_min; /**< Lowest valence charge */
+  double zvalence_max; /**< Highest valence charge */
+} pspio_library_query_t;
+
+
+/**********************************************************************
+ * Routines                                                           *
+ **********************************************************************/
+
+/**
+ * Allocates memory for an empty library index
+ * @param[in,out] library: library pointer
+ * @return error code
+ * @note library must be NULL on input.
+ */
+int pspio_library_alloc(pspio_library_t **library);
+
+/**
+ * Crawls a directory tree and indexes every file pspio can read. Files
+ * already present in the index with unchanged modification time and
+ * size are not parsed again, and files that disappeared are dropped, so
+ * that scanning an index loaded with pspio_library_load only costs the
+ * parsing of the changed files.
+ * @param[in,out] library: library pointer
+ * @param[in] root: directory to crawl, trailing slashes are ignored
+ * @param[in] nthreads: number of threads crawling the tree and parsing
+ *            the files, 0 for the number of online processors. Files
+ *            are parsed by a single thread when the compiler provides
+ *            no thread-local storage.
+ * @return error code
+ * @note Only the headers of the files are read, see
+ *       pspio_pspdata_read_header. Hidden files and directories are
+ *       skipped, as well as symbolic links to directories.
+ * @note Files that cannot be read are kept with format PSPIO_FMT_UNKNOWN,
+ *       so that they are not parsed again; queries never return them.
+ * @note Scanning a different root drops all the previous entries.
+ */
+int pspio_library_scan(pspio_library_t *library, const char *root,
+                       int nthreads);
+
+/**
+ * Writes the index to a binary file
+ * @param[in] library: library pointer
+ * @param[in] file_name: file to write
+ * @return error code
+ * @note The file uses the native byte order and is meant to be read
+ *       back on the same kind of machine.
+ */
+int pspio_library_save(const pspio_library_t *library, const char *file_name);
+
+/**
+ * Reads an index written by pspio_library_save, replacing the entries
+ * of the library
+ * @param[in,out] library: library pointer
+ * @param[in] file_name: file to read
+ * @return error code
+ */
+int pspio_library_load(pspio_library_t *library, const char *file_name);
+
+/**
+ * Frees all memory associated with a library index
+ * @param[in,out] library: library pointer
+ */
+void pspio_library_free(pspio_library_t *library);
+
+
+/**********************************************************************
+ * Getters                                                            *
+ **********************************************************************/
+
+/**
+ * Returns the number of indexed files
+ * @param[in] library: library pointer
+ * @return number of entries
+ */
+int pspio_library_get_n_entries(const pspio_library_t *library);
+
+/**
+ * Returns an entry of the index
+ * @param[in] library: library pointer
+ * @param[in] index: index of the entry
+ * @return pointer to the entry
+ */
+const pspio_library_entry_t *pspio_library_get_entry(
+  const pspio_library_t *library, int index);
+
+/**
+ * Returns the number of files parsed by the last scan
+ * @param[in] library: library pointer
+ * @return number of parsed files
+ */
+int pspio_library_get_n_parsed(const pspio_library_t *library);
+
+
+/**********************************************************************
+ * Utility routines                                                   *
+ **********************************************************************/
+
+/**
+ * Sets a query to match any entry
+ * @param[out] query: query pointer
+ */
+void pspio_library_query_init(pspio_library_query_t *query);
+
+/**
+ * Looks for the entries fulfilling all the criteria of a query
+ * @param[in] library: library pointer
+ * @param[in] query: query pointer
+ * @param[out] indices: indices of the matching entries, in path order
+ * @param[in] max_indices: size of indices; at most that many indices
+ *            are stored
+ * @return number of matching entries, which may exceed max_indices
+ */
+int pspio_library_query(const pspio_library_t *library,
+                        const pspio_library_query_t *query,
+                        int *indices, int max_indices);
+
+#endif
@@ -0,0 +1,55 @@
+/* Copyright (C) 2018 Micael Oliveira <micael.oliveira@mpsd.mpg.de>
+ *                    Yann Pouillon <devops@materialsevolution.es>
+ *
+ * This file is part of Libpspio.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * version 2.0. If a copy of the MPL was not distributed with this file, You
+ * can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Libpspio is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the Mozilla Public License version 2.0 for
+ * more details.
+ */
+
+#include <assert.h>
+
+#include "pspio_memory.h"
+
+#if defined HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+
+/**********************************************************************
+ * Global routines                                                    *
+ **********************************************************************/
+
+void pspio_memory_reset(pspio_memory_t *usage)
+{
+  assert(usage != NULL);
+
+  usage->arrays = 0;
+  usage->splines = 0;
+  usage->meshes = 0;
+  usage->metadata = 0;
+}
+
+void pspio_memory_add(pspio_memory_t *dst, const pspio_memory_t *src)
+{
+  assert(dst != NULL);
+  assert(src != NULL);
+
+  dst->arrays += src->arrays;
+  dst->splines += src->splines;
+  dst->meshes += src->meshes;
+  dst->metadata += src->metadata;
+}
+
+size_t pspio_memory_total(const pspio_memory_t *usage)
+{
+  assert(usage != NULL);
+
+  return usage->arrays + usage->splines + usage->meshes + usage->metadata;
+}
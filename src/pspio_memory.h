@@ -0,0 +1,71 @@
+/* Copyright (C) 2018 Micael Oliveira <micael.oliveira@mpsd.mpg.de>
+ *                    Yann Pouillon <devops@materialsevolution.es>
+ *
+ * This file is part of Libpspio.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * version 2.0. If a copy of the MPL was not distributed with this file, You
+ * can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Libpspio is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the Mozilla Public License version 2.0 for
+ * more details.
+ */
+
+#ifndef PSPIO_MEMORY_H
+#define PSPIO_MEMORY_H
+
+/**
+ * @file pspio_memory.h
+ * @brief header file for the memory footprint accounting of the objects
+ */
+
+#include <stddef.h>
+
+
+/**********************************************************************
+ * Data structures                                                    *
+ **********************************************************************/
+
+/**
+ * Memory footprint, in bytes, broken down by category.
+ *
+ * The pspio_*_memory_usage routines add the sizes of the blocks they
+ * allocated to those already stored, so that the footprint of several
+ * objects can be accumulated in a single structure.
+ */
+typedef struct{
+  size_t arrays;   /**< mesh points, function values and derivatives */
+  size_t splines;  /**< interpolation objects and their coefficients */
+  size_t meshes;   /**< meshes duplicated inside the mesh functions */
+  size_t metadata; /**< structures, quantum numbers, labels and tables */
+} pspio_memory_t;
+
+
+/**********************************************************************
+ * Global routines                                                    *
+ **********************************************************************/
+
+/**
+ * Sets all the categories to zero
+ *
+ * @param[out] usage: memory footprint
+ */
+void pspio_memory_reset(pspio_memory_t *usage);
+
+/**
+ * Adds the footprint of src to that of dst
+ *
+ * @param[in,out] dst: memory footprint to update
+ * @param[in] src: memory footprint to add
+ */
+void pspio_memory_add(pspio_memory_t *dst, const pspio_memory_t *src);
+
+/**
+ * @param[in] usage: memory footprint
+ * @return total number of bytes over all the categories
+ */
+size_t pspio_memory_total(const pspio_memory_t *usage);
+
+#endif
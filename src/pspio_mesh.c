@@ -20,6 +20,7 @@
 #include <assert.h>
 #include <math.h>
 
+#include "instrument.h"
 #include "pspio_mesh.h"
 
 #if defined HAVE_CONFIG_H
@@ -40,6 +41,7 @@ int pspio_mesh_alloc(pspio_mesh_t **mesh, int np)
   /* Memory allocation */
   *mesh = (pspio_mesh_t *) malloc (sizeof(pspio_mesh_t));
   FULFILL_OR_EXIT( *mesh != NULL, PSPIO_ENOMEM );
+  INSTR_COUNT(PSPIO_COUNTER_ALLOCS);
 
   (*mesh)->r = NULL;
   (*mesh)->rab = NULL;
@@ -229,6 +231,8 @@ int pspio_mesh_copy(pspio_mesh_t **dst, const pspio_mesh_t *src)
   memcpy((*dst)->r, src->r, src->np * sizeof(double));
   memcpy((*dst)->rab, src->rab, src->np * sizeof(double));
 
+  INSTR_COUNT(PSPIO_COUNTER_COPIES);
+
   return PSPIO_SUCCESS;
 }
 
@@ -309,3 +313,75 @@ int pspio_mesh_cmp(const pspio_mesh_t *mesh1, const pspio_mesh_t *mesh2)
     return PSPIO_DIFF;
   }
 }
+
+int pspio_mesh_locate(const pspio_mesh_t *mesh, double r, pspio_mesh_loc_t *loc)
+{
+  int i, lo, hi, np;
+  double x;
+
+  assert(mesh != NULL);
+  assert(mesh->np > 1);
+  assert(loc != NULL);
+
+  np = mesh->np;
+  loc->r = r;
+  if ( r < mesh->r[0] ) {
+    i = 0;
+    loc->outside = -1;
+  } else if ( r >= mesh->r[np-1] ) {
+    i = np - 2;
+    loc->outside = 1;
+  } else {
+    loc->outside = 0;
+
+    /* Invert the mesh formula, r_i = f(i+1) */
+    switch (mesh->type) {
+    case PSPIO_MESH_LINEAR:
+      x = (r - mesh->b)/mesh->a;
+      break;
+    case PSPIO_MESH_LOG1:
+      x = log(r/mesh->b)/mesh->a;
+      break;
+    case PSPIO_MESH_LOG2:
+      x = log(r/mesh->b + 1.0)/mesh->a;
+      break;
+    default:
+      x = -1.0;
+    }
+
+    if ( (x >= 1.0) && (x < np) ) {
+      /* Fix rounding errors */
+      i = (int)x - 1;
+      while ( (i > 0) && (mesh->r[i] > r) ) i--;
+      while ( (i < np-2) && (mesh->r[i+1] <= r) ) i++;
+    } else {
+      lo = 0;
+      hi = np - 2;
+      while ( lo < hi ) {
+        i = (lo + hi + 1) / 2;
+        if ( mesh->r[i] <= r ) {
+          lo = i;
+        } else {
+          hi = i - 1;
+        }
+      }
+      i = lo;
+    }
+  }
+
+  loc->i = i;
+  loc->h = mesh->r[i+1] - mesh->r[i];
+  loc->t = (r - mesh->r[i]) / loc->h;
+
+  return i;
+}
+
+void pspio_mesh_memory_usage(const pspio_mesh_t *mesh, pspio_memory_t *usage)
+{
+  assert(usage != NULL);
+
+  if ( mesh != NULL ) {
+    usage->metadata += sizeof(pspio_mesh_t);
+    usage->arrays += 2 * mesh->np * sizeof(double);
+  }
+}
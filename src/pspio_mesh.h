@@ -25,6 +25,7 @@
 
 #include "pspio_common.h"
 #include "pspio_error.h"
+#include "pspio_memory.h"
 
 
 /**********************************************************************
@@ -42,6 +43,17 @@ typedef struct{
   double *rab; /**< Factor required for discrete integration: rab(i) = (dr(x)/dx)_{x=i} */
 } pspio_mesh_t;
 
+/**
+* Position of a point relative to the intervals of a mesh
+*/
+typedef struct{
+  double r;    /**< Point */
+  int i;       /**< Interval [r_i, r_{i+1}) holding r, clamped to the first and last ones */
+  double h;    /**< Width of the interval */
+  double t;    /**< Local coordinate (r - r_i)/h, outside [0, 1) beyond the mesh */
+  int outside; /**< -1 below the first point, 1 at or beyond the last one, 0 otherwise */
+} pspio_mesh_loc_t;
+
 
 /**********************************************************************
  * Global routines                                                    *
@@ -185,4 +197,25 @@ const double *pspio_mesh_get_rab(const pspio_mesh_t *mesh);
  */
 int pspio_mesh_cmp(const pspio_mesh_t *mesh1, const pspio_mesh_t *mesh2);
 
+/**
+ * Locates a point on the mesh, so that several functions defined on it
+ * can be evaluated there with a single search (see the *_eval_located
+ * routines). The interval is computed in constant time for the linear
+ * and logarithmic meshes, and by bisection otherwise.
+ * @param[in] mesh: mesh structure
+ * @param[in] r: point to locate
+ * @param[out] loc: position of r
+ * @return index of the interval holding r
+ */
+int pspio_mesh_locate(const pspio_mesh_t *mesh, double r, pspio_mesh_loc_t *loc);
+
+/**
+ * Adds the memory footprint of mesh to usage.
+ * The mesh points and integration weights are counted as arrays.
+ *
+ * @param[in] mesh: mesh structure, may be NULL
+ * @param[in,out] usage: memory footprint to update
+ */
+void pspio_mesh_memory_usage(const pspio_mesh_t *mesh, pspio_memory_t *usage);
+
 #endif
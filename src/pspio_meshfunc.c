@@ -17,15 +17,326 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 #include <assert.h>
 
+#include "instrument.h"
+#include "pspio_hermite.h"
 #include "pspio_meshfunc.h"
 #include "util.h"
 
+#if defined _OPENMP
+#include <omp.h>
+#endif
+
 #if defined HAVE_CONFIG_H
 #include "config.h"
 #endif
 
+#if !defined PSPIO_THREAD_LOCAL
+#define PSPIO_THREAD_LOCAL
+#endif
+
+/* Parts of a mesh function that can be left pending */
+#define MESHFUNC_PENDING_INTERP 1 /* interpolation objects */
+#define MESHFUNC_PENDING_FP     2 /* first derivative, obtained from f */
+#define MESHFUNC_PENDING_FPP    4 /* second derivative, obtained from f */
+
+/* Bounds of the number of cells of the lookup tables */
+#define MESHFUNC_TABLE_MIN 64
+#define MESHFUNC_TABLE_MAX (1 << 20)
+
+/* Whether pspio_meshfunc_init defers the interpolation */
+static PSPIO_THREAD_LOCAL int meshfunc_defer = 0;
+
+/* Interpolation method of new functions, 0 for the library default */
+static PSPIO_THREAD_LOCAL int meshfunc_method = 0;
+
+
+/**********************************************************************
+ * Private routines                                                   *
+ **********************************************************************/
+
+/* Completes a function with pending parts before it is used */
+static void meshfunc_ensure(const pspio_meshfunc_t *func)
+{
+  if ( func->pending ) {
+    DEFER_FUNC_ERROR( pspio_meshfunc_prepare((pspio_meshfunc_t *)func) );
+  }
+}
+
+/*
+ * Returns 1 if the interpolation method only uses the neighbouring mesh
+ * points. Such methods interpolate the derivatives themselves and do not
+ * need their own interpolation objects.
+ */
+static int meshfunc_local(int method)
+{
+  method &= ~PSPIO_INTERP_SINGLE;
+
+  return (method == PSPIO_INTERP_HERMITE3) || (method == PSPIO_INTERP_HERMITE5);
+}
+
+/* Returns 1 if both functions share their mesh and interpolation method */
+static int meshfunc_same_grid(const pspio_meshfunc_t *f1, const pspio_meshfunc_t *f2)
+{
+  if ( f1 == f2 ) return 1;
+
+  return (f1->interp_method == f2->interp_method) &&
+    (f1->mesh->np == f2->mesh->np) &&
+    (memcmp(f1->mesh->r, f2->mesh->r, f1->mesh->np * sizeof(double)) == 0);
+}
+
+/*
+ * Builds the interpolation objects of n pending functions sharing the
+ * same mesh, as well as their missing derivatives
+ */
+static int meshfunc_prepare_group(int n, pspio_meshfunc_t **funcs)
+{
+  int i, ierr;
+  const pspio_mesh_t *mesh = funcs[0]->mesh;
+  pspio_interp_t **interp;
+  const double **vals = NULL;
+
+  /* Local interpolations, the missing derivatives are estimated from
+     the neighbouring points of each function, independently */
+  if ( meshfunc_local(funcs[0]->interp_method) ) {
+    ierr = PSPIO_SUCCESS;
+    for (i=0; (i<n) && (ierr == PSPIO_SUCCESS); i++) {
+      if ( funcs[i]->pending & (MESHFUNC_PENDING_FP | MESHFUNC_PENDING_FPP) ) {
+        hermite_nodes_derivs(mesh->np, mesh->r, funcs[i]->f,
+          (funcs[i]->pending & MESHFUNC_PENDING_FP) ? funcs[i]->fp : NULL,
+          (funcs[i]->pending & MESHFUNC_PENDING_FPP) ? funcs[i]->fpp : NULL);
+      }
+      ierr = pspio_interp_init_derivs(funcs[i]->f_interp, funcs[i]->mesh,
+        funcs[i]->f, funcs[i]->fp, funcs[i]->fpp);
+      if ( ierr == PSPIO_SUCCESS ) {
+        funcs[i]->pending = 0;
+      }
+    }
+    RETURN_WITH_ERROR( ierr );
+  }
+
+  interp = (pspio_interp_t **) malloc (n * sizeof(pspio_interp_t *));
+  FULFILL_OR_EXIT( interp != NULL, PSPIO_ENOMEM );
+  vals = (const double **) calloc (n, sizeof(double *));
+  FULFILL_OR_EXIT( vals != NULL, PSPIO_ENOMEM );
+
+  /* Function */
+  for (i=0; i<n; i++) {
+    interp[i] = funcs[i]->f_interp;
+    vals[i] = funcs[i]->f;
+  }
+  ierr = pspio_interp_init_batch(n, interp, mesh, vals);
+
+  /* Derivatives that were not provided */
+  for (i=0; (i<n) && (ierr == PSPIO_SUCCESS); i++) {
+    pspio_interp_eval_nodes(funcs[i]->f_interp, mesh,
+      (funcs[i]->pending & MESHFUNC_PENDING_FP) ? funcs[i]->fp : NULL,
+      (funcs[i]->pending & MESHFUNC_PENDING_FPP) ? funcs[i]->fpp : NULL);
+  }
+
+  /* First derivative */
+  if ( ierr == PSPIO_SUCCESS ) {
+    for (i=0; i<n; i++) {
+      interp[i] = funcs[i]->fp_interp;
+      vals[i] = funcs[i]->fp;
+    }
+    ierr = pspio_interp_init_batch(n, interp, mesh, vals);
+  }
+
+  /* Second derivative */
+  if ( ierr == PSPIO_SUCCESS ) {
+    for (i=0; i<n; i++) {
+      interp[i] = funcs[i]->fpp_interp;
+      vals[i] = funcs[i]->fpp;
+    }
+    ierr = pspio_interp_init_batch(n, interp, mesh, vals);
+  }
+
+  if ( ierr == PSPIO_SUCCESS ) {
+    for (i=0; i<n; i++) {
+      funcs[i]->pending = 0;
+    }
+  }
+  free(vals);
+  free(interp);
+
+  RETURN_WITH_ERROR( ierr );
+}
+
+/* Frees a lookup table */
+static void meshfunc_table_free(pspio_meshfunc_table_t *table)
+{
+  if ( table != NULL ) {
+    free(table->coef);
+    free(table);
+  }
+}
+
+/* Returns the cell of x and the position of x within it */
+static const double *meshfunc_table_cell(const pspio_meshfunc_table_t *table,
+                                         double x, double *u)
+{
+  int k;
+  double t;
+
+  t = x * table->dx_inv;
+  k = (t < (double)table->n) ? (int)t : table->n - 1;
+  k = (k > 0) ? k : 0;
+  *u = t - k;
+
+  return table->coef + 4*(size_t)k;
+}
+
+/* Evaluates a lookup table */
+static double meshfunc_table_eval(const pspio_meshfunc_table_t *table, double x)
+{
+  double u;
+  const double *c = meshfunc_table_cell(table, x, &u);
+
+  return c[0] + u*(c[1] + u*(c[2] + u*c[3]));
+}
+
+/*
+ * Builds a lookup table of n cells. The values at the nodes come from
+ * the interpolation of the function and the slopes from finite
+ * differences of these values, so that the cells are cubic Hermite
+ * polynomials and the table is continuous with a continuous derivative.
+ */
+static pspio_meshfunc_table_t *meshfunc_table_init(const pspio_meshfunc_t *func,
+                                                   int var, int n)
+{
+  int k, q;
+  double xmax, dx, x, r, m0, m1;
+  double *xk, *g, *d, *c;
+  pspio_meshfunc_table_t *table;
+
+  table = (pspio_meshfunc_table_t *) malloc (sizeof(pspio_meshfunc_table_t));
+  FULFILL_OR_EXIT( table != NULL, PSPIO_ENOMEM );
+  table->coef = (double *) malloc (4 * (size_t)n * sizeof(double));
+  FULFILL_OR_EXIT( table->coef != NULL, PSPIO_ENOMEM );
+  xk = (double *) malloc (3 * ((size_t)n + 1) * sizeof(double));
+  FULFILL_OR_EXIT( xk != NULL, PSPIO_ENOMEM );
+  g = xk + n + 1;
+  d = g + n + 1;
+
+  xmax = func->mesh->r[func->mesh->np-1];
+  if ( var == PSPIO_TABLE_R2 ) xmax *= xmax;
+  dx = xmax / n;
+  table->var = var;
+  table->n = n;
+  table->dx_inv = 1.0 / dx;
+
+  /* Nodes */
+  for (k=0; k<=n; k++) {
+    xk[k] = k * dx;
+    r = (var == PSPIO_TABLE_R2) ? sqrt(xk[k]) : xk[k];
+    g[k] = pspio_meshfunc_eval(func, r);
+  }
+  hermite_nodes_derivs(n+1, xk, g, d, NULL);
+
+  /* Cubic of each cell, in terms of the position within the cell */
+  for (k=0; k<n; k++) {
+    c = table->coef + 4*(size_t)k;
+    m0 = dx * d[k];
+    m1 = dx * d[k+1];
+    c[0] = g[k];
+    c[1] = m0;
+    c[2] = 3.0*(g[k+1] - g[k]) - 2.0*m0 - m1;
+    c[3] = 2.0*(g[k] - g[k+1]) + m0 + m1;
+  }
+
+  /* Error at the quarter points of the cells */
+  table->err = 0.0;
+  for (k=0; k<n; k++) {
+    for (q=1; q<4; q++) {
+      x = (k + 0.25*q) * dx;
+      r = (var == PSPIO_TABLE_R2) ? sqrt(x) : x;
+      table->err = fmax(table->err,
+        fabs(meshfunc_table_eval(table, x) - pspio_meshfunc_eval(func, r)));
+    }
+  }
+
+  free(xk);
+
+  return table;
+}
+
+/*
+ * Same as meshfunc_prepare_group, distributing the functions over the
+ * OpenMP threads, if any. Each function only depends on its own data and
+ * the factorization of the mesh is the same in every chunk, hence the
+ * results do not depend on the number of threads.
+ */
+static int meshfunc_prepare_parallel(int n, pspio_meshfunc_t **funcs)
+{
+#if defined _OPENMP
+  int c, i0, i1, nchunk, ierr;
+  int *status;
+
+  nchunk = omp_get_max_threads();
+  if ( nchunk > n ) nchunk = n;
+  if ( (nchunk < 2) || omp_in_parallel() ) {
+    return meshfunc_prepare_group(n, funcs);
+  }
+
+  status = (int *) malloc (nchunk * sizeof(int));
+  FULFILL_OR_EXIT( status != NULL, PSPIO_ENOMEM );
+
+#pragma omp parallel for schedule(static) private(i0, i1)
+  for (c=0; c<nchunk; c++) {
+    i0 = (int)(((long)n * c) / nchunk);
+    i1 = (int)(((long)n * (c+1)) / nchunk);
+    status[c] = meshfunc_prepare_group(i1 - i0, funcs + i0);
+  }
+
+  ierr = PSPIO_SUCCESS;
+  for (c=0; (c<nchunk) && (ierr == PSPIO_SUCCESS); c++) {
+    ierr = status[c];
+  }
+  free(status);
+
+  RETURN_WITH_ERROR( ierr );
+#else
+  return meshfunc_prepare_group(n, funcs);
+#endif
+}
+
+/* Linear extrapolation of a function at a point beyond the mesh */
+static double meshfunc_extrapolate(const pspio_meshfunc_t *func, const double *vals,
+                                   const pspio_mesh_loc_t *loc)
+{
+  int i = loc->i;
+
+  INSTR_COUNT(PSPIO_COUNTER_EXTRAPOLATIONS);
+
+  return linear_extrapolation(func->mesh->r[i], func->mesh->r[i+1],
+                              vals[i], vals[i+1], loc->r);
+}
+
+/* Returns the index of the mesh point equal to r, or -1 */
+static int meshfunc_node(const pspio_meshfunc_t *func, double r)
+{
+  int lo, hi, mid;
+  const double *x = func->mesh->r;
+
+  lo = 0;
+  hi = func->mesh->np - 1;
+  while ( lo <= hi ) {
+    mid = (lo + hi) / 2;
+    if ( x[mid] < r ) {
+      lo = mid + 1;
+    } else if ( x[mid] > r ) {
+      hi = mid - 1;
+    } else {
+      return mid;
+    }
+  }
+
+  return -1;
+}
+
 
 /**********************************************************************
  * Global routines                                                    *
@@ -41,6 +352,7 @@ int pspio_meshfunc_alloc(pspio_meshfunc_t **func, int np)
 
   *func = (pspio_meshfunc_t *) malloc (sizeof(pspio_meshfunc_t));
   FULFILL_OR_EXIT( *func != NULL, PSPIO_ENOMEM );
+  INSTR_COUNT(PSPIO_COUNTER_ALLOCS);
 
   (*func)->mesh = NULL;
   ierr = pspio_mesh_alloc(&(*func)->mesh, np);
@@ -50,11 +362,20 @@ int pspio_meshfunc_alloc(pspio_meshfunc_t **func, int np)
     RETURN_WITH_ERROR( ierr );
   }
 
+  /* PSPIO_INTERP_SINGLE alone selects the default method */
+  if ( (meshfunc_method & ~PSPIO_INTERP_SINGLE) != 0 ) {
+    (*func)->interp_method = meshfunc_method;
+  } else {
 #ifdef HAVE_GSL
-  (*func)->interp_method = PSPIO_INTERP_GSL_CSPLINE;
+    (*func)->interp_method = PSPIO_INTERP_GSL_CSPLINE | meshfunc_method;
 #else
-  (*func)->interp_method = PSPIO_INTERP_JB_CSPLINE;
+    (*func)->interp_method = PSPIO_INTERP_JB_CSPLINE | meshfunc_method;
 #endif
+  }
+  (*func)->f_interp = NULL;
+  (*func)->fp_interp = NULL;
+  (*func)->fpp_interp = NULL;
+  (*func)->table = NULL;
 
   (*func)->f = (double *) malloc (np * sizeof(double));
   FULFILL_OR_EXIT( (*func)->f != NULL, PSPIO_ENOMEM );
@@ -64,12 +385,20 @@ int pspio_meshfunc_alloc(pspio_meshfunc_t **func, int np)
   (*func)->fp = (double *) malloc (np * sizeof(double));
   FULFILL_OR_EXIT( (*func)->fp != NULL, PSPIO_ENOMEM );
   memset((*func)->fp, 0, np*sizeof(double));
-  SUCCEED_OR_RETURN( pspio_interp_alloc(&(*func)->fp_interp, (*func)->interp_method, np) );
+  if ( !meshfunc_local((*func)->interp_method) ) {
+    SUCCEED_OR_RETURN( pspio_interp_alloc(&(*func)->fp_interp,
+      (*func)->interp_method & ~PSPIO_INTERP_SINGLE, np) );
+  }
 
   (*func)->fpp = (double *) malloc (np * sizeof(double));
   FULFILL_OR_EXIT( (*func)->fpp != NULL, PSPIO_ENOMEM );
   memset((*func)->fpp, 0, np*sizeof(double));
-  SUCCEED_OR_RETURN( pspio_interp_alloc(&(*func)->fpp_interp, (*func)->interp_method, np) );
+  if ( !meshfunc_local((*func)->interp_method) ) {
+    SUCCEED_OR_RETURN( pspio_interp_alloc(&(*func)->fpp_interp,
+      (*func)->interp_method & ~PSPIO_INTERP_SINGLE, np) );
+  }
+
+  (*func)->pending = 0;
 
   return PSPIO_SUCCESS;
 }
@@ -77,8 +406,6 @@ int pspio_meshfunc_alloc(pspio_meshfunc_t **func, int np)
 int pspio_meshfunc_init(pspio_meshfunc_t *func, const pspio_mesh_t *mesh, 
 			const double *f, const double *fp, const double *fpp)
 {
-  int i;
-
   assert(func != NULL);
   assert(func->f != NULL);
   assert(mesh != NULL);
@@ -86,34 +413,93 @@ int pspio_meshfunc_init(pspio_meshfunc_t *func, const pspio_mesh_t *mesh,
   /* Copy mesh */
   SUCCEED_OR_RETURN( pspio_mesh_copy(&func->mesh, mesh) );
 
-  /* Function */
-  memcpy(func->f, f, mesh->np * sizeof(double));
-  SUCCEED_OR_RETURN( pspio_interp_init(func->f_interp, mesh, func->f) );
+  /* The lookup table of the previous data is not valid anymore */
+  meshfunc_table_free(func->table);
+  func->table = NULL;
 
-  /* First derivative */
+  /* Function and derivatives, the missing ones are obtained from f */
+  func->pending = MESHFUNC_PENDING_INTERP;
+  memcpy(func->f, f, mesh->np * sizeof(double));
   if ( fp != NULL ) {
     memcpy(func->fp, fp, mesh->np * sizeof(double));
   } else {
-    for (i=0; i<mesh->np; i++) 
-      func->fp[i] = pspio_interp_eval_deriv(func->f_interp, mesh->r[i]);
+    func->pending |= MESHFUNC_PENDING_FP;
   }
-  SUCCEED_OR_RETURN( pspio_interp_init(func->fp_interp, mesh, func->fp) );
-
-  /* Second derivative */
   if ( fpp != NULL ) {
     memcpy(func->fpp, fpp, mesh->np * sizeof(double));
   } else {
-    for (i=0; i<mesh->np; i++)
-      func->fpp[i] = pspio_interp_eval_deriv2(func->f_interp, mesh->r[i]);
+    func->pending |= MESHFUNC_PENDING_FPP;
+  }
+
+  if ( !meshfunc_defer ) {
+    SUCCEED_OR_RETURN( pspio_meshfunc_prepare(func) );
   }
-  SUCCEED_OR_RETURN( pspio_interp_init(func->fpp_interp, mesh, func->fpp) );
 
   return PSPIO_SUCCESS;
 }
 
+int pspio_meshfunc_defer_interp(int defer)
+{
+  int prev = meshfunc_defer;
+
+  meshfunc_defer = defer;
+
+  return prev;
+}
+
+int pspio_meshfunc_default_interp(int method)
+{
+  int prev = meshfunc_method;
+
+  meshfunc_method = method;
+
+  return prev;
+}
+
+int pspio_meshfunc_prepare(pspio_meshfunc_t *func)
+{
+  assert(func != NULL);
+
+  RETURN_WITH_ERROR( pspio_meshfunc_prepare_batch(1, &func) );
+}
+
+int pspio_meshfunc_prepare_batch(int n, pspio_meshfunc_t *const *funcs)
+{
+  int i, k, ngroup, ierr;
+  pspio_meshfunc_t **group;
+
+  assert(n == 0 || funcs != NULL);
+
+  if ( n == 0 ) return PSPIO_SUCCESS;
+
+  group = (pspio_meshfunc_t **) malloc (n * sizeof(pspio_meshfunc_t *));
+  FULFILL_OR_EXIT( group != NULL, PSPIO_ENOMEM );
+
+  /* Gather the pending functions sharing a mesh and an interpolation
+     method, so that their splines are built together */
+  ierr = PSPIO_SUCCESS;
+  for (i=0; (i<n) && (ierr == PSPIO_SUCCESS); i++) {
+    if ( !funcs[i]->pending ) continue;
+
+    /* The functions of previous groups are not pending anymore */
+    ngroup = 0;
+    for (k=i; k<n; k++) {
+      if ( funcs[k]->pending && meshfunc_same_grid(funcs[i], funcs[k]) ) {
+        group[ngroup++] = funcs[k];
+      }
+    }
+    ierr = meshfunc_prepare_parallel(ngroup, group);
+  }
+
+  free(group);
+  RETURN_WITH_ERROR( ierr );
+}
+
 int pspio_meshfunc_copy(pspio_meshfunc_t **dst, const pspio_meshfunc_t *src)
 {
   int np;
+  pspio_interp_t *interp[3];
+  const double *vals[3];
 
   assert(src != NULL);
 
@@ -148,17 +534,48 @@ int pspio_meshfunc_copy(pspio_meshfunc_t **dst, const pspio_meshfunc_t *src)
 
   SUCCEED_OR_RETURN( pspio_mesh_copy(&(*dst)->mesh, src->mesh) );
 
-  memcpy((*dst)->f, src->f, np * sizeof(double));
-  SUCCEED_OR_RETURN( pspio_interp_alloc(&(*dst)->f_interp, src->interp_method, np) );
-  SUCCEED_OR_RETURN( pspio_interp_init((*dst)->f_interp, (*dst)->mesh, (*dst)->f) );
+  meshfunc_table_free((*dst)->table);
+  (*dst)->table = NULL;
+  if ( src->table != NULL ) {
+    (*dst)->table = (pspio_meshfunc_table_t *) malloc (sizeof(pspio_meshfunc_table_t));
+    FULFILL_OR_EXIT( (*dst)->table != NULL, PSPIO_ENOMEM );
+    *(*dst)->table = *src->table;
+    (*dst)->table->coef = (double *) malloc (4 * (size_t)src->table->n * sizeof(double));
+    FULFILL_OR_EXIT( (*dst)->table->coef != NULL, PSPIO_ENOMEM );
+    memcpy((*dst)->table->coef, src->table->coef, 4 * (size_t)src->table->n * sizeof(double));
+  }
 
+  /* Pending parts of src stay pending in dst */
+  (*dst)->interp_method = src->interp_method;
+  (*dst)->pending = src->pending;
+  memcpy((*dst)->f, src->f, np * sizeof(double));
   memcpy((*dst)->fp, src->fp, np * sizeof(double));
-  SUCCEED_OR_RETURN( pspio_interp_alloc(&(*dst)->fp_interp, src->interp_method, np) );
-  SUCCEED_OR_RETURN( pspio_interp_init((*dst)->fp_interp, (*dst)->mesh, (*dst)->fp) );
-
   memcpy((*dst)->fpp, src->fpp, np * sizeof(double));
-  SUCCEED_OR_RETURN( pspio_interp_alloc(&(*dst)->fpp_interp, src->interp_method, np) );
-  SUCCEED_OR_RETURN( pspio_interp_init((*dst)->fpp_interp, (*dst)->mesh, (*dst)->fpp) );
+  SUCCEED_OR_RETURN( pspio_interp_alloc(&(*dst)->f_interp, src->interp_method, np) );
+  if ( meshfunc_local(src->interp_method) ) {
+    if ( !src->pending ) {
+      SUCCEED_OR_RETURN( pspio_interp_init_derivs((*dst)->f_interp, (*dst)->mesh,
+        (*dst)->f, (*dst)->fp, (*dst)->fpp) );
+    }
+    INSTR_COUNT(PSPIO_COUNTER_COPIES);
+    return PSPIO_SUCCESS;
+  }
+  SUCCEED_OR_RETURN( pspio_interp_alloc(&(*dst)->fp_interp,
+    src->interp_method & ~PSPIO_INTERP_SINGLE, np) );
+  SUCCEED_OR_RETURN( pspio_interp_alloc(&(*dst)->fpp_interp,
+    src->interp_method & ~PSPIO_INTERP_SINGLE, np) );
+
+  if ( !src->pending ) {
+    interp[0] = (*dst)->f_interp;
+    interp[1] = (*dst)->fp_interp;
+    interp[2] = (*dst)->fpp_interp;
+    vals[0] = (*dst)->f;
+    vals[1] = (*dst)->fp;
+    vals[2] = (*dst)->fpp;
+    SUCCEED_OR_RETURN( pspio_interp_init_batch(3, interp, (*dst)->mesh, vals) );
+  }
+
+  INSTR_COUNT(PSPIO_COUNTER_COPIES);
 
   return PSPIO_SUCCESS;
 }
@@ -177,6 +594,8 @@ void pspio_meshfunc_free(pspio_meshfunc_t *func)
     free(func->fpp);
     pspio_interp_free(func->fpp_interp);
 
+    meshfunc_table_free(func->table);
+
     free(func);
   }
 }
@@ -196,6 +615,7 @@ const double *pspio_meshfunc_get_function(const pspio_meshfunc_t *func)
 const double *pspio_meshfunc_get_deriv1(const pspio_meshfunc_t *func)
 {
   assert(func != NULL);
+  meshfunc_ensure(func);
 
   return func->fp;
 }
@@ -203,6 +623,7 @@ const double *pspio_meshfunc_get_deriv1(const pspio_meshfunc_t *func)
 const double *pspio_meshfunc_get_deriv2(const pspio_meshfunc_t *func)
 {
   assert(func != NULL);
+  meshfunc_ensure(func);
 
   return func->fpp;
 }
@@ -233,6 +654,8 @@ int pspio_meshfunc_cmp(const pspio_meshfunc_t *meshfunc1,
 
   assert(meshfunc1 != NULL);
   assert(meshfunc2 != NULL);
+  meshfunc_ensure(meshfunc1);
+  meshfunc_ensure(meshfunc2);
 
   if ( pspio_mesh_cmp(meshfunc1->mesh, meshfunc2->mesh) == PSPIO_EQUAL) {
     for (i=0; i<pspio_mesh_get_np(meshfunc1->mesh); i++) {
@@ -249,7 +672,16 @@ int pspio_meshfunc_cmp(const pspio_meshfunc_t *meshfunc1,
 
 double pspio_meshfunc_eval(const pspio_meshfunc_t *func, double r)
 {
+  int i;
+
   assert(func != NULL);
+  INSTR_COUNT(PSPIO_COUNTER_EVAL_MESHFUNC);
+
+  /* Mesh points do not need the interpolation */
+  if ( func->pending ) {
+    if ( (i = meshfunc_node(func, r)) >= 0 ) return func->f[i];
+    meshfunc_ensure(func);
+  }
 
   /*
     If the value of r is smaller than the first mesh point or if
@@ -257,8 +689,10 @@ double pspio_meshfunc_eval(const pspio_meshfunc_t *func, double r)
     linear extrapolation to evaluate the function at r.
   */
   if ( r < func->mesh->r[0] ) {
+    INSTR_COUNT(PSPIO_COUNTER_EXTRAPOLATIONS);
     return linear_extrapolation(func->mesh->r[0], func->mesh->r[1], func->f[0], func->f[1], r);
   } else if ( r >= func->mesh->r[func->mesh->np-1] ) {
+    INSTR_COUNT(PSPIO_COUNTER_EXTRAPOLATIONS);
     return linear_extrapolation(func->mesh->r[func->mesh->np-2], func->mesh->r[func->mesh->np-1], 
 				func->f[func->mesh->np-2], func->f[func->mesh->np-1], r);
   } else {
@@ -268,25 +702,48 @@ double pspio_meshfunc_eval(const pspio_meshfunc_t *func, double r)
 
 double pspio_meshfunc_eval_deriv(const pspio_meshfunc_t *func, double r)
 {
+  int i;
+
   assert(func != NULL);
+  INSTR_COUNT(PSPIO_COUNTER_EVAL_MESHFUNC);
+
+  /* Mesh points do not need the interpolation */
+  if ( func->pending ) {
+    if ( !(func->pending & MESHFUNC_PENDING_FP) && ((i = meshfunc_node(func, r)) >= 0) ) return func->fp[i];
+    meshfunc_ensure(func);
+  }
 
   /* If the value of r is smaller than the first mesh point or if
      it is greater or equal to the last mesh point, then we use a
      linear extrapolation to evaluate the function at r.
   */
   if ( r < func->mesh->r[0] ) {
+    INSTR_COUNT(PSPIO_COUNTER_EXTRAPOLATIONS);
     return linear_extrapolation(func->mesh->r[0], func->mesh->r[1], func->fp[0], func->fp[1], r);
   } else if ( r >= func->mesh->r[func->mesh->np-1] ) {
+    INSTR_COUNT(PSPIO_COUNTER_EXTRAPOLATIONS);
     return linear_extrapolation(func->mesh->r[func->mesh->np-2], func->mesh->r[func->mesh->np-1], 
 				func->fp[func->mesh->np-2], func->fp[func->mesh->np-1], r);
   } else {
+    if ( func->fp_interp == NULL ) {
+      return pspio_interp_eval_deriv(func->f_interp, r);
+    }
     return pspio_interp_eval(func->fp_interp, r);
   }
 }
 
 double pspio_meshfunc_eval_deriv2(const pspio_meshfunc_t *func, double r)
 {
+  int i;
+
   assert(func != NULL);
+  INSTR_COUNT(PSPIO_COUNTER_EVAL_MESHFUNC);
+
+  /* Mesh points do not need the interpolation */
+  if ( func->pending ) {
+    if ( !(func->pending & MESHFUNC_PENDING_FPP) && ((i = meshfunc_node(func, r)) >= 0) ) return func->fpp[i];
+    meshfunc_ensure(func);
+  }
 
   /*
     If the value of r is smaller than the first mesh point or if
@@ -294,11 +751,272 @@ double pspio_meshfunc_eval_deriv2(const pspio_meshfunc_t *func, double r)
     linear extrapolation to evaluate the function at r.
   */
   if ( r < func->mesh->r[0] ) {
+    INSTR_COUNT(PSPIO_COUNTER_EXTRAPOLATIONS);
     return linear_extrapolation(func->mesh->r[0], func->mesh->r[1], func->fpp[0], func->fpp[1], r);
   } else if ( r >= func->mesh->r[func->mesh->np-1] ) {
+    INSTR_COUNT(PSPIO_COUNTER_EXTRAPOLATIONS);
     return linear_extrapolation(func->mesh->r[func->mesh->np-2], func->mesh->r[func->mesh->np-1], 
 				func->fpp[func->mesh->np-2], func->fpp[func->mesh->np-1], r);
   } else {
+    if ( func->fpp_interp == NULL ) {
+      return pspio_interp_eval_deriv2(func->f_interp, r);
+    }
     return pspio_interp_eval(func->fpp_interp, r);
   }
 }
+
+double pspio_meshfunc_eval_located(const pspio_meshfunc_t *func,
+                                   const pspio_mesh_loc_t *loc)
+{
+  assert(func != NULL);
+  assert(loc != NULL);
+  assert(loc->i < func->mesh->np - 1);
+  INSTR_COUNT(PSPIO_COUNTER_EVAL_MESHFUNC);
+
+  /* Mesh points do not need the interpolation */
+  if ( func->pending ) {
+    if ( !loc->outside && (loc->t == 0.0) ) return func->f[loc->i];
+    meshfunc_ensure(func);
+  }
+
+  if ( loc->outside ) {
+    return meshfunc_extrapolate(func, func->f, loc);
+  } else {
+    return pspio_interp_eval_located(func->f_interp, loc);
+  }
+}
+
+double pspio_meshfunc_eval_deriv_located(const pspio_meshfunc_t *func,
+                                         const pspio_mesh_loc_t *loc)
+{
+  assert(func != NULL);
+  assert(loc != NULL);
+  assert(loc->i < func->mesh->np - 1);
+  INSTR_COUNT(PSPIO_COUNTER_EVAL_MESHFUNC);
+
+  meshfunc_ensure(func);
+
+  if ( loc->outside ) {
+    return meshfunc_extrapolate(func, func->fp, loc);
+  } else {
+    if ( func->fp_interp == NULL ) {
+      return pspio_interp_eval_deriv_located(func->f_interp, loc);
+    }
+    return pspio_interp_eval_located(func->fp_interp, loc);
+  }
+}
+
+double pspio_meshfunc_eval_deriv2_located(const pspio_meshfunc_t *func,
+                                          const pspio_mesh_loc_t *loc)
+{
+  assert(func != NULL);
+  assert(loc != NULL);
+  assert(loc->i < func->mesh->np - 1);
+  INSTR_COUNT(PSPIO_COUNTER_EVAL_MESHFUNC);
+
+  meshfunc_ensure(func);
+
+  if ( loc->outside ) {
+    return meshfunc_extrapolate(func, func->fpp, loc);
+  } else {
+    if ( func->fpp_interp == NULL ) {
+      return pspio_interp_eval_deriv2_located(func->f_interp, loc);
+    }
+    return pspio_interp_eval_located(func->fpp_interp, loc);
+  }
+}
+
+void pspio_meshfunc_eval_batch(const pspio_meshfunc_t *func, int n,
+                               const double *r, double *f)
+{
+  int i;
+
+  assert(func != NULL);
+  assert(n == 0 || (r != NULL && f != NULL));
+
+  for (i=0; i<n; i++) {
+    f[i] = pspio_meshfunc_eval(func, r[i]);
+  }
+}
+
+void pspio_meshfunc_eval_deriv_batch(const pspio_meshfunc_t *func, int n,
+                                     const double *r, double *fp)
+{
+  int i;
+
+  assert(func != NULL);
+  assert(n == 0 || (r != NULL && fp != NULL));
+
+  for (i=0; i<n; i++) {
+    fp[i] = pspio_meshfunc_eval_deriv(func, r[i]);
+  }
+}
+
+void pspio_meshfunc_eval_deriv2_batch(const pspio_meshfunc_t *func, int n,
+                                      const double *r, double *fpp)
+{
+  int i;
+
+  assert(func != NULL);
+  assert(n == 0 || (r != NULL && fpp != NULL));
+
+  for (i=0; i<n; i++) {
+    fpp[i] = pspio_meshfunc_eval_deriv2(func, r[i]);
+  }
+}
+
+void pspio_meshfunc_eval_float_batch(const pspio_meshfunc_t *func, int n,
+                                     const float *r, float *f)
+{
+  int i, np;
+  const double *rm;
+
+  assert(func != NULL);
+  assert(func->interp_method & PSPIO_INTERP_SINGLE);
+  assert(n == 0 || (r != NULL && f != NULL));
+  meshfunc_ensure(func);
+
+  pspio_interp_eval_float_batch(func->f_interp, n, r, f);
+
+  /* Linear extrapolation beyond the mesh, as in pspio_meshfunc_eval */
+  np = func->mesh->np;
+  rm = func->mesh->r;
+  for (i=0; i<n; i++) {
+    if ( r[i] < rm[0] ) {
+      f[i] = (float)linear_extrapolation(rm[0], rm[1], func->f[0], func->f[1], r[i]);
+    } else if ( r[i] >= rm[np-1] ) {
+      f[i] = (float)linear_extrapolation(rm[np-2], rm[np-1], func->f[np-2], func->f[np-1], r[i]);
+    }
+  }
+}
+
+void pspio_meshfunc_eval_deriv_float_batch(const pspio_meshfunc_t *func, int n,
+                                           const float *r, float *fp)
+{
+  int i, np;
+  const double *rm;
+
+  assert(func != NULL);
+  assert(func->interp_method & PSPIO_INTERP_SINGLE);
+  assert(n == 0 || (r != NULL && fp != NULL));
+  meshfunc_ensure(func);
+
+  pspio_interp_eval_deriv_float_batch(func->f_interp, n, r, fp);
+
+  np = func->mesh->np;
+  rm = func->mesh->r;
+  for (i=0; i<n; i++) {
+    if ( r[i] < rm[0] ) {
+      fp[i] = (float)linear_extrapolation(rm[0], rm[1], func->fp[0], func->fp[1], r[i]);
+    } else if ( r[i] >= rm[np-1] ) {
+      fp[i] = (float)linear_extrapolation(rm[np-2], rm[np-1], func->fp[np-2], func->fp[np-1], r[i]);
+    }
+  }
+}
+
+int pspio_meshfunc_tabulate(pspio_meshfunc_t *func, int var, double tol)
+{
+  int n;
+  pspio_meshfunc_table_t *table;
+
+  assert(func != NULL);
+
+  FULFILL_OR_RETURN( (var == PSPIO_TABLE_R) || (var == PSPIO_TABLE_R2), PSPIO_EVALUE );
+  FULFILL_OR_RETURN( tol > 0.0, PSPIO_EVALUE );
+  SUCCEED_OR_RETURN( pspio_meshfunc_prepare(func) );
+
+  meshfunc_table_free(func->table);
+  func->table = NULL;
+
+  /* Refine the grid until the target is met, starting from the
+     resolution of the mesh */
+  n = (func->mesh->np > MESHFUNC_TABLE_MIN) ? func->mesh->np : MESHFUNC_TABLE_MIN;
+  while ( 1 ) {
+    table = meshfunc_table_init(func, var, n);
+    if ( (table->err <= tol) || (2*n > MESHFUNC_TABLE_MAX) ) break;
+    meshfunc_table_free(table);
+    n *= 2;
+  }
+  if ( table->err > tol ) {
+    meshfunc_table_free(table);
+    RETURN_WITH_ERROR( PSPIO_EVALUE );
+  }
+  func->table = table;
+
+  return PSPIO_SUCCESS;
+}
+
+int pspio_meshfunc_get_table_size(const pspio_meshfunc_t *func)
+{
+  assert(func != NULL);
+
+  return (func->table != NULL) ? func->table->n : 0;
+}
+
+double pspio_meshfunc_get_table_error(const pspio_meshfunc_t *func)
+{
+  assert(func != NULL);
+
+  return (func->table != NULL) ? func->table->err : 0.0;
+}
+
+double pspio_meshfunc_eval_table(const pspio_meshfunc_t *func, double x)
+{
+  assert(func != NULL);
+  assert(func->table != NULL);
+
+  return meshfunc_table_eval(func->table, x);
+}
+
+double pspio_meshfunc_eval_table_deriv(const pspio_meshfunc_t *func, double x)
+{
+  double u;
+  const double *c;
+
+  assert(func != NULL);
+  assert(func->table != NULL);
+
+  c = meshfunc_table_cell(func->table, x, &u);
+
+  return (c[1] + u*(2.0*c[2] + u*3.0*c[3])) * func->table->dx_inv;
+}
+
+void pspio_meshfunc_eval_table_batch(const pspio_meshfunc_t *func, int n,
+                                     const double *x, double *f)
+{
+  int i;
+  const pspio_meshfunc_table_t *table;
+
+  assert(func != NULL);
+  assert(func->table != NULL);
+  assert(n == 0 || (x != NULL && f != NULL));
+
+  table = func->table;
+  for (i=0; i<n; i++) {
+    f[i] = meshfunc_table_eval(table, x[i]);
+  }
+}
+
+void pspio_meshfunc_memory_usage(const pspio_meshfunc_t *func, pspio_memory_t *usage)
+{
+  pspio_memory_t mesh_usage;
+
+  assert(usage != NULL);
+
+  if ( func == NULL ) return;
+
+  usage->metadata += sizeof(pspio_meshfunc_t);
+  usage->arrays += 3 * func->mesh->np * sizeof(double);
+
+  pspio_memory_reset(&mesh_usage);
+  pspio_mesh_memory_usage(func->mesh, &mesh_usage);
+  usage->meshes += pspio_memory_total(&mesh_usage);
+
+  pspio_interp_memory_usage(func->f_interp, usage);
+  pspio_interp_memory_usage(func->fp_interp, usage);
+  pspio_interp_memory_usage(func->fpp_interp, usage);
+  if ( func->table != NULL ) {
+    usage->metadata += sizeof(pspio_meshfunc_table_t);
+    usage->splines += 4 * (size_t)func->table->n * sizeof(double);
+  }
+}
@@ -30,6 +30,17 @@
  * Data structures                                                    *
  **********************************************************************/
 
+/**
+ * Uniform lookup table of a mesh function, see pspio_meshfunc_tabulate
+ */
+typedef struct{
+  int var;       /**< Variable of the table, PSPIO_TABLE_R or PSPIO_TABLE_R2 */
+  int n;         /**< Number of cells */
+  double dx_inv; /**< Inverse of the width of the cells */
+  double err;    /**< Largest error of the table found when building it */
+  double *coef;  /**< Coefficients of the cubic of each cell, 4 per cell */
+} pspio_meshfunc_table_t;
+
 /**
 * Mesh function structure
 */
@@ -49,6 +60,10 @@ typedef struct{
   double *fpp;                 /**< second derivative on the mesh */
   pspio_interp_t *fpp_interp; /**< second derivative interpolation object */
 
+  int pending; /**< parts still to be built, see pspio_meshfunc_prepare */
+
+  pspio_meshfunc_table_t *table; /**< lookup table, if any */
+
 } pspio_meshfunc_t;
 
 
@@ -80,6 +95,59 @@ int pspio_meshfunc_alloc(pspio_meshfunc_t **func, int np);
 int pspio_meshfunc_init(pspio_meshfunc_t *func, const pspio_mesh_t *mesh, 
 			const double *f, const double *fp, const double *fpp);
 
+/**
+ * Selects whether pspio_meshfunc_init builds the interpolation objects
+ * right away (the default) or leaves them pending until they are first
+ * needed or pspio_meshfunc_prepare is called. While pending, evaluating
+ * a function exactly at one of its mesh points returns the stored value
+ * without building anything.
+ *
+ * @param[in] defer: 1 to defer the interpolation, 0 to build it at once
+ * @return previous setting
+ * @note The setting only affects the calling thread.
+ */
+int pspio_meshfunc_defer_interp(int defer);
+
+/**
+ * Selects the interpolation method of the functions allocated afterwards
+ * by pspio_meshfunc_alloc, including the ones allocated when reading a
+ * file. With PSPIO_INTERP_HERMITE3 and PSPIO_INTERP_HERMITE5 the function
+ * and its derivatives are interpolated locally from the stored values and
+ * derivatives, without solving any system; the derivatives that are not
+ * provided to pspio_meshfunc_init are estimated by finite differences.
+ *
+ * @param[in] method: interpolation method, 0 for the library default,
+ *            optionally combined with PSPIO_INTERP_SINGLE
+ * @return previous setting
+ * @note The setting only affects the calling thread.
+ */
+int pspio_meshfunc_default_interp(int method);
+
+/**
+ * Builds the pending interpolation objects of a function, as well as the
+ * derivatives that were not provided to pspio_meshfunc_init.
+ *
+ * @param[in,out] func: function structure
+ * @return error code
+ * @note Functions with pending parts are completed on first use, which
+ *       is not thread-safe: prepare them before sharing them between
+ *       threads.
+ */
+int pspio_meshfunc_prepare(pspio_meshfunc_t *func);
+
+/**
+ * Same as pspio_meshfunc_prepare for n functions. The splines of the
+ * functions sharing a mesh are built together, with a single
+ * factorization of the spline system. When the library is built with
+ * OpenMP, the functions are distributed over the threads, with results
+ * identical to the serial ones.
+ *
+ * @param[in] n: number of functions
+ * @param[in,out] funcs: function structures
+ * @return error code
+ */
+int pspio_meshfunc_prepare_batch(int n, pspio_meshfunc_t *const *funcs);
+
 /**
  * Duplicates a mesh function structure
  * 
@@ -191,5 +259,173 @@ double pspio_meshfunc_eval_deriv(const pspio_meshfunc_t *func, double r);
  */
 double pspio_meshfunc_eval_deriv2(const pspio_meshfunc_t *func, double r);
 
+/**
+ * Returns the value of the function at a point located with
+ * pspio_mesh_locate, without searching the mesh again.
+ * 
+ * @param[in] func: function structure
+ * @param[in] loc: position of the point on the mesh of the function
+ * @return value of the function
+ */
+double pspio_meshfunc_eval_located(const pspio_meshfunc_t *func,
+                                   const pspio_mesh_loc_t *loc);
+
+/**
+ * Returns the value of the derivative of the function at a located
+ * point.
+ * 
+ * @param[in] func: function structure
+ * @param[in] loc: position of the point on the mesh of the function
+ * @return value of the derivative
+ */
+double pspio_meshfunc_eval_deriv_located(const pspio_meshfunc_t *func,
+                                         const pspio_mesh_loc_t *loc);
+
+/**
+ * Returns the value of the second derivative of the function at a
+ * located point.
+ * 
+ * @param[in] func: function structure
+ * @param[in] loc: position of the point on the mesh of the function
+ * @return value of the second derivative
+ */
+double pspio_meshfunc_eval_deriv2_located(const pspio_meshfunc_t *func,
+                                          const pspio_mesh_loc_t *loc);
+
+/**
+ * Evaluates the function at an arbitrary number of points.
+ * 
+ * @param[in] func: function structure
+ * @param[in] n: number of points
+ * @param[in] r: points were we want to evaluate the function
+ * @param[out] f: values of the function at r
+ */
+void pspio_meshfunc_eval_batch(const pspio_meshfunc_t *func, int n,
+                               const double *r, double *f);
+
+/**
+ * Evaluates the derivative of the function at an arbitrary number of
+ * points.
+ * 
+ * @param[in] func: function structure
+ * @param[in] n: number of points
+ * @param[in] r: points were we want to evaluate the derivative
+ * @param[out] fp: values of the derivative at r
+ */
+void pspio_meshfunc_eval_deriv_batch(const pspio_meshfunc_t *func, int n,
+                                     const double *r, double *fp);
+
+/**
+ * Evaluates the second derivative of the function at an arbitrary
+ * number of points.
+ * 
+ * @param[in] func: function structure
+ * @param[in] n: number of points
+ * @param[in] r: points were we want to evaluate the second derivative
+ * @param[out] fpp: values of the second derivative at r
+ */
+void pspio_meshfunc_eval_deriv2_batch(const pspio_meshfunc_t *func, int n,
+                                      const double *r, double *fpp);
+
+/**
+ * Evaluates the function at an arbitrary number of points in single
+ * precision, halving the memory traffic of the interpolation. The
+ * function must use an interpolation method combined with
+ * PSPIO_INTERP_SINGLE (see pspio_meshfunc_default_interp); its double
+ * precision data is kept unchanged.
+ *
+ * @param[in] func: function structure
+ * @param[in] n: number of points
+ * @param[in] r: points were we want to evaluate the function
+ * @param[out] f: values of the function at r
+ */
+void pspio_meshfunc_eval_float_batch(const pspio_meshfunc_t *func, int n,
+                                     const float *r, float *f);
+
+/**
+ * Same as pspio_meshfunc_eval_float_batch for the first derivative,
+ * which is the one of the interpolation of the function.
+ *
+ * @param[in] func: function structure
+ * @param[in] n: number of points
+ * @param[in] r: points were we want to evaluate the derivative
+ * @param[out] fp: values of the derivative at r
+ */
+void pspio_meshfunc_eval_deriv_float_batch(const pspio_meshfunc_t *func, int n,
+                                           const float *r, float *fp);
+
+/**
+ * Builds a lookup table of the function on a uniform grid, for very
+ * fast repeated evaluations. The grid covers [0, r_max] in r, or
+ * [0, r_max^2] in r^2 so that distances do not need a square root, where
+ * r_max is the last point of the mesh. The grid is refined until the
+ * table reproduces pspio_meshfunc_eval within tol. Each cell stores the
+ * coefficients of a cubic, contiguously.
+ *
+ * @param[in,out] func: function structure
+ * @param[in] var: variable of the table, PSPIO_TABLE_R or PSPIO_TABLE_R2
+ * @param[in] tol: largest absolute error allowed
+ * @return error code, PSPIO_EVALUE if tol cannot be achieved, in which
+ *         case func has no table
+ * @note The table is discarded when the function is initialized again.
+ * @note In r^2, functions with a non-zero slope at the origin behave as
+ *       sqrt(r^2) near it, which limits the accuracy that can be reached.
+ */
+int pspio_meshfunc_tabulate(pspio_meshfunc_t *func, int var, double tol);
+
+/**
+ * @param[in] func: function structure
+ * @return number of cells of the lookup table, 0 if there is none
+ */
+int pspio_meshfunc_get_table_size(const pspio_meshfunc_t *func);
+
+/**
+ * @param[in] func: function structure
+ * @return largest error of the lookup table, measured at the quarter
+ *         points of every cell, or 0 if there is none
+ */
+double pspio_meshfunc_get_table_error(const pspio_meshfunc_t *func);
+
+/**
+ * Evaluates the function with its lookup table
+ *
+ * @param[in] func: function structure, with a lookup table
+ * @param[in] x: r or r^2, following the variable of the table
+ * @return value of the function
+ * @note Points beyond the table use the cubic of the closest cell.
+ */
+double pspio_meshfunc_eval_table(const pspio_meshfunc_t *func, double x);
+
+/**
+ * Evaluates the derivative of the function with respect to the variable
+ * of its lookup table (r or r^2)
+ *
+ * @param[in] func: function structure, with a lookup table
+ * @param[in] x: r or r^2, following the variable of the table
+ * @return value of the derivative
+ */
+double pspio_meshfunc_eval_table_deriv(const pspio_meshfunc_t *func, double x);
+
+/**
+ * Evaluates the function with its lookup table at an arbitrary number
+ * of points.
+ *
+ * @param[in] func: function structure, with a lookup table
+ * @param[in] n: number of points
+ * @param[in] x: r or r^2 at each point, following the variable of the table
+ * @param[out] f: values of the function
+ */
+void pspio_meshfunc_eval_table_batch(const pspio_meshfunc_t *func, int n,
+                                     const double *x, double *f);
+
+/**
+ * Adds the memory footprint of func to usage.
+ * The copy of the mesh owned by the function is counted as a
+ * duplicated mesh and the lookup table, if any, as spline coefficients.
+ *
+ * @param[in] func: meshfunc structure, may be NULL
+ * @param[in,out] usage: memory footprint to update
+ */
+void pspio_meshfunc_memory_usage(const pspio_meshfunc_t *func, pspio_memory_t *usage);
 
 #endif
@@ -0,0 +1,521 @@
+/* Copyright (C) 2018 Micael Oliveira <micael.oliveira@mpsd.mpg.de>
+ *                    Yann Pouillon <devops@materialsevolution.es>
+ *
+ * This file is part of Libpspio.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * version 2.0. If a copy of the MPL was not distributed with this file, You
+ * can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Libpspio is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the Mozilla Public License version 2.0 for
+ * more details.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "pspio_packed.h"
+#include "pspio_jb_spline.h"
+
+#if defined HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+
+/**********************************************************************
+ * Private routines                                                   *
+ **********************************************************************/
+
+/* Allocates a zero-filled block aligned on PSPIO_PACKED_ALIGN bytes */
+static double *packed_block_alloc(size_t size)
+{
+  void *block = NULL;
+
+  if ( size == 0 ) return NULL;
+
+#if defined HAVE_POSIX_MEMALIGN
+  if ( posix_memalign(&block, PSPIO_PACKED_ALIGN, size * sizeof(double)) != 0 ) {
+    block = NULL;
+  }
+  FULFILL_OR_EXIT( block != NULL, PSPIO_ENOMEM );
+#else
+  {
+    void *base;
+
+    /* Align by hand, keeping the address to free just before the block */
+    base = malloc(size * sizeof(double) + PSPIO_PACKED_ALIGN + sizeof(void *));
+    FULFILL_OR_EXIT( base != NULL, PSPIO_ENOMEM );
+    block = (void *)(((uintptr_t)base + sizeof(void *) + PSPIO_PACKED_ALIGN - 1) &
+                     ~(uintptr_t)(PSPIO_PACKED_ALIGN - 1));
+    ((void **)block)[-1] = base;
+  }
+#endif
+  memset(block, 0, size * sizeof(double));
+
+  return (double *)block;
+}
+
+/* Frees a block allocated by packed_block_alloc */
+static void packed_block_free(double *block)
+{
+#if defined HAVE_POSIX_MEMALIGN
+  free(block);
+#else
+  if ( block != NULL ) free(((void **)block)[-1]);
+#endif
+}
+
+/*
+ * Copies the values of a mesh function into column icol of a block. Only
+ * functions interpolated by cubic splines are accepted, since the packed
+ * evaluation rebuilds the same splines.
+ */
+static int packed_block_set(double *block, int ld, int icol,
+                            const pspio_meshfunc_t *func, int np)
+{
+  int method;
+
+  assert(func != NULL);
+
+  method = pspio_meshfunc_get_interp_method(func) & ~PSPIO_INTERP_SINGLE;
+  FULFILL_OR_RETURN( (method == PSPIO_INTERP_GSL_CSPLINE) ||
+                     (method == PSPIO_INTERP_JB_CSPLINE), PSPIO_ENOSUPPORT );
+  FULFILL_OR_RETURN( pspio_mesh_get_np(pspio_meshfunc_get_mesh(func)) == np,
+                     PSPIO_EVALUE );
+  memcpy(block + (size_t)icol * ld, pspio_meshfunc_get_function(func),
+         np * sizeof(double));
+
+  return PSPIO_SUCCESS;
+}
+
+/*
+ * Builds the spline coefficients of the n columns of a block. For mesh
+ * point i, the values of all the functions are stored at coef[2*i*n]
+ * and their second derivatives at coef[(2*i+1)*n].
+ */
+static double *packed_coef_init(const double *block, int ld, int n,
+                                const pspio_mesh_t *mesh)
+{
+  int i, j, np, ierr;
+  double *coef, *ypp;
+  const double **y;
+  double **yppl;
+  jb_spline_factor_t *factor = NULL;
+
+  if ( n == 0 ) return NULL;
+
+  np = mesh->np;
+  coef = (double *) malloc ((size_t)2 * np * n * sizeof(double));
+  FULFILL_OR_EXIT( coef != NULL, PSPIO_ENOMEM );
+  ypp = (double *) malloc ((size_t)np * n * sizeof(double));
+  FULFILL_OR_EXIT( ypp != NULL, PSPIO_ENOMEM );
+  y = (const double **) malloc (n * sizeof(double *));
+  FULFILL_OR_EXIT( y != NULL, PSPIO_ENOMEM );
+  yppl = (double **) malloc (n * sizeof(double *));
+  FULFILL_OR_EXIT( yppl != NULL, PSPIO_ENOMEM );
+
+  for (j=0; j<n; j++) {
+    y[j] = block + (size_t)j * ld;
+    yppl[j] = ypp + (size_t)j * np;
+  }
+  ierr = jb_spline_factor_alloc(&factor, np);
+  if ( ierr == PSPIO_SUCCESS ) {
+    ierr = jb_spline_factor_init(factor, mesh->r);
+  }
+  if ( ierr == PSPIO_SUCCESS ) {
+    jb_spline_factor_solve(factor, n, y, yppl);
+    for (i=0; i<np; i++) {
+      for (j=0; j<n; j++) {
+        coef[(size_t)2*i*n + j] = y[j][i];
+        coef[(size_t)(2*i+1)*n + j] = yppl[j][i];
+      }
+    }
+  } else {
+    free(coef);
+    coef = NULL;
+  }
+  jb_spline_factor_free(factor);
+
+  free(yppl);
+  free(y);
+  free(ypp);
+
+  return coef;
+}
+
+/* Evaluates the n functions of a coefficient table at r */
+static void packed_coef_eval(const pspio_packed_t *packed, const double *coef,
+                             int n, double r, double *f, double *fp)
+{
+  int j;
+  double a, b, c, d, h, d0, d1;
+  const double *y0, *s0, *y1, *s1;
+  pspio_mesh_loc_t loc;
+
+  assert(n == 0 || f != NULL);
+
+  if ( n == 0 ) return;
+
+  pspio_mesh_locate(packed->mesh, r, &loc);
+  y0 = coef + (size_t)2*loc.i*n;
+  s0 = y0 + n;
+  y1 = s0 + n;
+  s1 = y1 + n;
+  h = loc.h;
+  a = 1.0 - loc.t;
+  b = loc.t;
+
+  if ( loc.outside ) {
+    /* Linear extrapolation, as in pspio_meshfunc_eval */
+    for (j=0; j<n; j++) {
+      f[j] = a*y0[j] + b*y1[j];
+    }
+    if ( fp != NULL ) {
+      for (j=0; j<n; j++) {
+        d0 = (y1[j] - y0[j])/h - (2.0*s0[j] + s1[j])*h/6.0;
+        d1 = (y1[j] - y0[j])/h + (s0[j] + 2.0*s1[j])*h/6.0;
+        fp[j] = a*d0 + b*d1;
+      }
+    }
+  } else {
+    c = (a*a*a - a)*h*h/6.0;
+    d = (b*b*b - b)*h*h/6.0;
+    for (j=0; j<n; j++) {
+      f[j] = a*y0[j] + b*y1[j] + c*s0[j] + d*s1[j];
+    }
+    if ( fp != NULL ) {
+      c = -(3.0*a*a - 1.0)*h/6.0;
+      d = (3.0*b*b - 1.0)*h/6.0;
+      for (j=0; j<n; j++) {
+        fp[j] = (y1[j] - y0[j])/h + c*s0[j] + d*s1[j];
+      }
+    }
+  }
+}
+
+/* Releases the blocks and metadata arrays, keeping the structure */
+static void packed_reset(pspio_packed_t *packed)
+{
+  free(packed->states_n);
+  free(packed->states_l);
+  free(packed->states_j);
+  packed_block_free(packed->states);
+  free(packed->potentials_l);
+  free(packed->potentials_j);
+  packed_block_free(packed->potentials);
+  free(packed->projectors_l);
+  free(packed->projectors_j);
+  packed_block_free(packed->projectors);
+  free(packed->states_coef);
+  free(packed->potentials_coef);
+  free(packed->projectors_coef);
+
+  packed->mesh = NULL;
+  packed->np = 0;
+  packed->ld = 0;
+  packed->n_states = 0;
+  packed->states_n = NULL;
+  packed->states_l = NULL;
+  packed->states_j = NULL;
+  packed->states = NULL;
+  packed->n_potentials = 0;
+  packed->potentials_l = NULL;
+  packed->potentials_j = NULL;
+  packed->potentials = NULL;
+  packed->n_projectors = 0;
+  packed->projectors_l = NULL;
+  packed->projectors_j = NULL;
+  packed->projectors = NULL;
+  packed->states_coef = NULL;
+  packed->potentials_coef = NULL;
+  packed->projectors_coef = NULL;
+}
+
+
+/**********************************************************************
+ * Global routines                                                    *
+ **********************************************************************/
+
+int pspio_packed_alloc(pspio_packed_t **packed)
+{
+  assert(packed != NULL);
+  assert(*packed == NULL);
+
+  *packed = (pspio_packed_t *) malloc (sizeof(pspio_packed_t));
+  FULFILL_OR_EXIT( *packed != NULL, PSPIO_ENOMEM );
+
+  (*packed)->states_n = NULL;
+  (*packed)->states_l = NULL;
+  (*packed)->states_j = NULL;
+  (*packed)->states = NULL;
+  (*packed)->potentials_l = NULL;
+  (*packed)->potentials_j = NULL;
+  (*packed)->potentials = NULL;
+  (*packed)->projectors_l = NULL;
+  (*packed)->projectors_j = NULL;
+  (*packed)->projectors = NULL;
+  (*packed)->states_coef = NULL;
+  (*packed)->potentials_coef = NULL;
+  (*packed)->projectors_coef = NULL;
+  packed_reset(*packed);
+
+  return PSPIO_SUCCESS;
+}
+
+int pspio_packed_init(pspio_packed_t *packed, const pspio_pspdata_t *pspdata)
+{
+  int i, ierr, ncol;
+  const pspio_qn_t *qn;
+
+  assert(packed != NULL);
+  assert(pspdata != NULL);
+
+  packed_reset(packed);
+  FULFILL_OR_RETURN( pspdata->mesh != NULL, PSPIO_EVALUE );
+
+  /* Round np up so that every column is aligned as well */
+  ncol = PSPIO_PACKED_ALIGN / sizeof(double);
+  packed->mesh = pspdata->mesh;
+  packed->np = pspio_mesh_get_np(pspdata->mesh);
+  packed->ld = ((packed->np + ncol - 1) / ncol) * ncol;
+
+  ierr = PSPIO_SUCCESS;
+
+  /* States */
+  packed->n_states = (pspdata->loaded & PSPIO_LOAD_STATES) ? pspdata->n_states : 0;
+  if ( packed->n_states > 0 ) {
+    packed->states_n = (int *) malloc (packed->n_states * sizeof(int));
+    FULFILL_OR_EXIT( packed->states_n != NULL, PSPIO_ENOMEM );
+    packed->states_l = (int *) malloc (packed->n_states * sizeof(int));
+    FULFILL_OR_EXIT( packed->states_l != NULL, PSPIO_ENOMEM );
+    packed->states_j = (double *) malloc (packed->n_states * sizeof(double));
+    FULFILL_OR_EXIT( packed->states_j != NULL, PSPIO_ENOMEM );
+    packed->states = packed_block_alloc((size_t)packed->ld * packed->n_states);
+
+    for (i=0; (i<packed->n_states) && (ierr == PSPIO_SUCCESS); i++) {
+      qn = pspio_state_get_qn(pspdata->states[i]);
+      packed->states_n[i] = pspio_qn_get_n(qn);
+      packed->states_l[i] = pspio_qn_get_l(qn);
+      packed->states_j[i] = pspio_qn_get_j(qn);
+      ierr = packed_block_set(packed->states, packed->ld, i,
+               pspio_state_get_wf(pspdata->states[i]), packed->np);
+    }
+  }
+
+  /* Potentials */
+  packed->n_potentials = (pspdata->loaded & PSPIO_LOAD_POTENTIALS) ? pspdata->n_potentials : 0;
+  if ( (packed->n_potentials > 0) && (ierr == PSPIO_SUCCESS) ) {
+    packed->potentials_l = (int *) malloc (packed->n_potentials * sizeof(int));
+    FULFILL_OR_EXIT( packed->potentials_l != NULL, PSPIO_ENOMEM );
+    packed->potentials_j = (double *) malloc (packed->n_potentials * sizeof(double));
+    FULFILL_OR_EXIT( packed->potentials_j != NULL, PSPIO_ENOMEM );
+    packed->potentials = packed_block_alloc((size_t)packed->ld * packed->n_potentials);
+
+    for (i=0; (i<packed->n_potentials) && (ierr == PSPIO_SUCCESS); i++) {
+      qn = pspio_potential_get_qn(pspdata->potentials[i]);
+      packed->potentials_l[i] = pspio_qn_get_l(qn);
+      packed->potentials_j[i] = pspio_qn_get_j(qn);
+      ierr = packed_block_set(packed->potentials, packed->ld, i,
+               pspdata->potentials[i]->v, packed->np);
+    }
+  }
+
+  /* Projectors */
+  packed->n_projectors = (pspdata->loaded & PSPIO_LOAD_PROJECTORS) ? pspdata->n_projectors : 0;
+  if ( (packed->n_projectors > 0) && (ierr == PSPIO_SUCCESS) ) {
+    packed->projectors_l = (int *) malloc (packed->n_projectors * sizeof(int));
+    FULFILL_OR_EXIT( packed->projectors_l != NULL, PSPIO_ENOMEM );
+    packed->projectors_j = (double *) malloc (packed->n_projectors * sizeof(double));
+    FULFILL_OR_EXIT( packed->projectors_j != NULL, PSPIO_ENOMEM );
+    packed->projectors = packed_block_alloc((size_t)packed->ld * packed->n_projectors);
+
+    for (i=0; (i<packed->n_projectors) && (ierr == PSPIO_SUCCESS); i++) {
+      qn = pspio_projector_get_qn(pspdata->projectors[i]);
+      packed->projectors_l[i] = pspio_qn_get_l(qn);
+      packed->projectors_j[i] = pspio_qn_get_j(qn);
+      ierr = packed_block_set(packed->projectors, packed->ld, i,
+               pspdata->projectors[i]->proj, packed->np);
+    }
+  }
+
+  /* Spline coefficients */
+  if ( ierr == PSPIO_SUCCESS ) {
+    packed->states_coef = packed_coef_init(packed->states, packed->ld,
+      packed->n_states, packed->mesh);
+    packed->potentials_coef = packed_coef_init(packed->potentials, packed->ld,
+      packed->n_potentials, packed->mesh);
+    packed->projectors_coef = packed_coef_init(packed->projectors, packed->ld,
+      packed->n_projectors, packed->mesh);
+    if ( ((packed->n_states > 0) && (packed->states_coef == NULL)) ||
+         ((packed->n_potentials > 0) && (packed->potentials_coef == NULL)) ||
+         ((packed->n_projectors > 0) && (packed->projectors_coef == NULL)) ) {
+      ierr = PSPIO_EVALUE;
+    }
+  }
+
+  /* Do not leave a partially packed structure behind */
+  if ( ierr != PSPIO_SUCCESS ) {
+    packed_reset(packed);
+    RETURN_WITH_ERROR( ierr );
+  }
+
+  return PSPIO_SUCCESS;
+}
+
+void pspio_packed_free(pspio_packed_t *packed)
+{
+  if ( packed != NULL ) {
+    packed_reset(packed);
+    free(packed);
+  }
+}
+
+
+/**********************************************************************
+ * Getters                                                            *
+ **********************************************************************/
+
+const pspio_mesh_t *pspio_packed_get_mesh(const pspio_packed_t *packed)
+{
+  assert(packed != NULL);
+
+  return packed->mesh;
+}
+
+int pspio_packed_get_np(const pspio_packed_t *packed)
+{
+  assert(packed != NULL);
+
+  return packed->np;
+}
+
+int pspio_packed_get_ld(const pspio_packed_t *packed)
+{
+  assert(packed != NULL);
+
+  return packed->ld;
+}
+
+int pspio_packed_get_n_states(const pspio_packed_t *packed)
+{
+  assert(packed != NULL);
+
+  return packed->n_states;
+}
+
+const double *pspio_packed_get_states(const pspio_packed_t *packed)
+{
+  assert(packed != NULL);
+
+  return packed->states;
+}
+
+const int *pspio_packed_get_states_n(const pspio_packed_t *packed)
+{
+  assert(packed != NULL);
+
+  return packed->states_n;
+}
+
+const int *pspio_packed_get_states_l(const pspio_packed_t *packed)
+{
+  assert(packed != NULL);
+
+  return packed->states_l;
+}
+
+const double *pspio_packed_get_states_j(const pspio_packed_t *packed)
+{
+  assert(packed != NULL);
+
+  return packed->states_j;
+}
+
+int pspio_packed_get_n_potentials(const pspio_packed_t *packed)
+{
+  assert(packed != NULL);
+
+  return packed->n_potentials;
+}
+
+const double *pspio_packed_get_potentials(const pspio_packed_t *packed)
+{
+  assert(packed != NULL);
+
+  return packed->potentials;
+}
+
+const int *pspio_packed_get_potentials_l(const pspio_packed_t *packed)
+{
+  assert(packed != NULL);
+
+  return packed->potentials_l;
+}
+
+const double *pspio_packed_get_potentials_j(const pspio_packed_t *packed)
+{
+  assert(packed != NULL);
+
+  return packed->potentials_j;
+}
+
+int pspio_packed_get_n_projectors(const pspio_packed_t *packed)
+{
+  assert(packed != NULL);
+
+  return packed->n_projectors;
+}
+
+const double *pspio_packed_get_projectors(const pspio_packed_t *packed)
+{
+  assert(packed != NULL);
+
+  return packed->projectors;
+}
+
+const int *pspio_packed_get_projectors_l(const pspio_packed_t *packed)
+{
+  assert(packed != NULL);
+
+  return packed->projectors_l;
+}
+
+const double *pspio_packed_get_projectors_j(const pspio_packed_t *packed)
+{
+  assert(packed != NULL);
+
+  return packed->projectors_j;
+}
+
+
+/**********************************************************************
+ * Utility routines                                                   *
+ **********************************************************************/
+
+void pspio_packed_eval_states(const pspio_packed_t *packed, double r,
+                              double *f, double *fp)
+{
+  assert(packed != NULL);
+
+  packed_coef_eval(packed, packed->states_coef, packed->n_states, r, f, fp);
+}
+
+void pspio_packed_eval_potentials(const pspio_packed_t *packed, double r,
+                                  double *f, double *fp)
+{
+  assert(packed != NULL);
+
+  packed_coef_eval(packed, packed->potentials_coef, packed->n_potentials, r, f, fp);
+}
+
+void pspio_packed_eval_projectors(const pspio_packed_t *packed, double r,
+                                  double *f, double *fp)
+{
+  assert(packed != NULL);
+
+  packed_coef_eval(packed, packed->projectors_coef, packed->n_projectors, r, f, fp);
+}
@@ -0,0 +1,264 @@
+/* Copyright (C) 2018 Micael Oliveira <micael.oliveira@mpsd.mpg.de>
+ *                    Yann Pouillon <devops@materialsevolution.es>
+ *
+ * This file is part of Libpspio.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * version 2.0. If a copy of the MPL was not distributed with this file, You
+ * can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Libpspio is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the Mozilla Public License version 2.0 for
+ * more details.
+ */
+
+#ifndef PSPIO_PACKED_H
+#define PSPIO_PACKED_H
+
+/**
+ * @file pspio_packed.h
+ * @brief header file for the packed (structure-of-arrays) view of the
+ *        radial functions of a pseudopotential
+ */
+
+#include "pspio_error.h"
+#include "pspio_mesh.h"
+#include "pspio_pspdata.h"
+
+
+/**********************************************************************
+ * Data structures                                                    *
+ **********************************************************************/
+
+/**
+ * Packed view of the radial functions stored in a pspdata structure.
+ *
+ * Each kind of function is stored in a single column-major block of
+ * ld x n values, where column i holds the values of the i-th function
+ * on the mesh. The leading dimension ld is np rounded up so that every
+ * column starts on a PSPIO_PACKED_ALIGN-byte boundary; the padding is
+ * zero-filled.
+ */
+typedef struct{
+  const pspio_mesh_t *mesh; /**< Mesh shared by all the blocks (not owned) */
+  int np;                   /**< Number of mesh points */
+  int ld;                   /**< Leading dimension of the blocks */
+
+  /* States */
+  int n_states;       /**< Number of wavefunctions */
+  int *states_n;      /**< Main quantum number of each wavefunction */
+  int *states_l;      /**< Angular momentum of each wavefunction */
+  double *states_j;   /**< Total angular momentum of each wavefunction */
+  double *states;     /**< ld x n_states block of wavefunctions */
+
+  /* Potentials */
+  int n_potentials;     /**< Number of semi-local potentials */
+  int *potentials_l;    /**< Angular momentum of each potential */
+  double *potentials_j; /**< Total angular momentum of each potential */
+  double *potentials;   /**< ld x n_potentials block of potentials */
+
+  /* Projectors */
+  int n_projectors;     /**< Number of projectors */
+  int *projectors_l;    /**< Angular momentum of each projector */
+  double *projectors_j; /**< Total angular momentum of each projector */
+  double *projectors;   /**< ld x n_projectors block of projectors */
+
+  /* Spline coefficients, see pspio_packed_eval_states */
+  double *states_coef;      /**< Coefficients of the wavefunctions */
+  double *potentials_coef;  /**< Coefficients of the potentials */
+  double *projectors_coef;  /**< Coefficients of the projectors */
+
+} pspio_packed_t;
+
+/**
+ * Alignment, in bytes, of the packed blocks and of their columns
+ */
+#define PSPIO_PACKED_ALIGN 64
+
+
+/**********************************************************************
+ * Global routines                                                    *
+ **********************************************************************/
+
+/**
+ * Allocates memory and presets the packed structure
+ *
+ * @param[in,out] packed: packed structure
+ * @return error code
+ */
+int pspio_packed_alloc(pspio_packed_t **packed);
+
+/**
+ * Packs all the wavefunctions, potentials and projectors of pspdata,
+ * together with the coefficients of their cubic splines. Any data
+ * previously stored in packed is released first.
+ *
+ * @param[in,out] packed: packed structure
+ * @param[in] pspdata: pseudopotential data to pack
+ * @return error code: PSPIO_EVALUE if pspdata has no mesh, e.g. for
+ *         analytic pseudopotentials, PSPIO_ENOSUPPORT if a function is
+ *         not interpolated by cubic splines
+ * @note The packed evaluation only reproduces cubic splines, hence
+ *       functions interpolated by Hermite polynomials are rejected.
+ * @note The packed structure refers to the mesh of pspdata, so pspdata
+ *       must outlive it.
+ * @note Components that were not loaded, see pspio_pspdata_read_select,
+ *       are packed as empty blocks.
+ */
+int pspio_packed_init(pspio_packed_t *packed, const pspio_pspdata_t *pspdata);
+
+/**
+ * Frees all memory associated with the packed structure
+ *
+ * @param[in,out] packed: packed structure
+ */
+void pspio_packed_free(pspio_packed_t *packed);
+
+
+/**********************************************************************
+ * Getters                                                            *
+ **********************************************************************/
+
+/**
+ * @param[in] packed: packed structure
+ * @return pointer to the mesh shared by all the blocks
+ */
+const pspio_mesh_t *pspio_packed_get_mesh(const pspio_packed_t *packed);
+
+/**
+ * @param[in] packed: packed structure
+ * @return number of mesh points
+ */
+int pspio_packed_get_np(const pspio_packed_t *packed);
+
+/**
+ * @param[in] packed: packed structure
+ * @return leading dimension of the blocks
+ */
+int pspio_packed_get_ld(const pspio_packed_t *packed);
+
+/**
+ * @param[in] packed: packed structure
+ * @return number of wavefunctions
+ */
+int pspio_packed_get_n_states(const pspio_packed_t *packed);
+
+/**
+ * @param[in] packed: packed structure
+ * @return pointer to the ld x n_states block of wavefunctions
+ */
+const double *pspio_packed_get_states(const pspio_packed_t *packed);
+
+/**
+ * @param[in] packed: packed structure
+ * @return pointer to the main quantum numbers of the wavefunctions
+ */
+const int *pspio_packed_get_states_n(const pspio_packed_t *packed);
+
+/**
+ * @param[in] packed: packed structure
+ * @return pointer to the angular momenta of the wavefunctions
+ */
+const int *pspio_packed_get_states_l(const pspio_packed_t *packed);
+
+/**
+ * @param[in] packed: packed structure
+ * @return pointer to the total angular momenta of the wavefunctions
+ */
+const double *pspio_packed_get_states_j(const pspio_packed_t *packed);
+
+/**
+ * @param[in] packed: packed structure
+ * @return number of potentials
+ */
+int pspio_packed_get_n_potentials(const pspio_packed_t *packed);
+
+/**
+ * @param[in] packed: packed structure
+ * @return pointer to the ld x n_potentials block of potentials
+ */
+const double *pspio_packed_get_potentials(const pspio_packed_t *packed);
+
+/**
+ * @param[in] packed: packed structure
+ * @return pointer to the angular momenta of the potentials
+ */
+const int *pspio_packed_get_potentials_l(const pspio_packed_t *packed);
+
+/**
+ * @param[in] packed: packed structure
+ * @return pointer to the total angular momenta of the potentials
+ */
+const double *pspio_packed_get_potentials_j(const pspio_packed_t *packed);
+
+/**
+ * @param[in] packed: packed structure
+ * @return number of projectors
+ */
+int pspio_packed_get_n_projectors(const pspio_packed_t *packed);
+
+/**
+ * @param[in] packed: packed structure
+ * @return pointer to the ld x n_projectors block of projectors
+ */
+const double *pspio_packed_get_projectors(const pspio_packed_t *packed);
+
+/**
+ * @param[in] packed: packed structure
+ * @return pointer to the angular momenta of the projectors
+ */
+const int *pspio_packed_get_projectors_l(const pspio_packed_t *packed);
+
+/**
+ * @param[in] packed: packed structure
+ * @return pointer to the total angular momenta of the projectors
+ */
+const double *pspio_packed_get_projectors_j(const pspio_packed_t *packed);
+
+
+/**********************************************************************
+ * Utility routines                                                   *
+ **********************************************************************/
+
+/**
+ * Evaluates all the wavefunctions at the same point, with a single
+ * search of the mesh. The spline coefficients of each interval are
+ * stored point by point for all the functions, so that the ones needed
+ * here are read from a single contiguous block.
+ *
+ * @param[in] packed: packed structure
+ * @param[in] r: point were we want to evaluate the functions
+ * @param[out] f: values of the n_states wavefunctions at r
+ * @param[out] fp: values of their derivatives at r (may be NULL)
+ * @note The values agree with pspio_meshfunc_eval, the derivatives are
+ *       the ones of the spline of each function.
+ */
+void pspio_packed_eval_states(const pspio_packed_t *packed, double r,
+                              double *f, double *fp);
+
+/**
+ * Evaluates all the potentials at the same point, as
+ * pspio_packed_eval_states does.
+ *
+ * @param[in] packed: packed structure
+ * @param[in] r: point were we want to evaluate the functions
+ * @param[out] f: values of the n_potentials potentials at r
+ * @param[out] fp: values of their derivatives at r (may be NULL)
+ */
+void pspio_packed_eval_potentials(const pspio_packed_t *packed, double r,
+                                  double *f, double *fp);
+
+/**
+ * Evaluates all the projectors at the same point, as
+ * pspio_packed_eval_states does.
+ *
+ * @param[in] packed: packed structure
+ * @param[in] r: point were we want to evaluate the functions
+ * @param[out] f: values of the n_projectors projectors at r
+ * @param[out] fp: values of their derivatives at r (may be NULL)
+ */
+void pspio_packed_eval_projectors(const pspio_packed_t *packed, double r,
+                                  double *f, double *fp);
+
+#endif
@@ -16,8 +16,10 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
+#include "instrument.h"
 #include "pspio_potential.h"
 
 #if defined HAVE_CONFIG_H
@@ -39,7 +41,9 @@ int pspio_potential_alloc(pspio_potential_t **potential, int np)
 
   *potential = (pspio_potential_t *) malloc (sizeof(pspio_potential_t));
   FULFILL_OR_EXIT(*potential != NULL, PSPIO_ENOMEM);
+  INSTR_COUNT(PSPIO_COUNTER_ALLOCS);
 
+  (*potential)->analytic = NULL;
   (*potential)->v = NULL;
   ierr = pspio_meshfunc_alloc(&(*potential)->v, np);
   if ( ierr != PSPIO_SUCCESS ) {
@@ -59,6 +63,32 @@ int pspio_potential_alloc(pspio_potential_t **potential, int np)
   return PSPIO_SUCCESS;
 }
 
+int pspio_potential_alloc_analytic(pspio_potential_t **potential)
+{
+  int ierr;
+
+  assert(potential != NULL);
+  assert(*potential == NULL);
+
+  *potential = (pspio_potential_t *) malloc (sizeof(pspio_potential_t));
+  FULFILL_OR_EXIT(*potential != NULL, PSPIO_ENOMEM);
+  INSTR_COUNT(PSPIO_COUNTER_ALLOCS);
+
+  (*potential)->v = NULL;
+  (*potential)->analytic = (pspio_gth_term_t *) malloc (sizeof(pspio_gth_term_t));
+  FULFILL_OR_EXIT((*potential)->analytic != NULL, PSPIO_ENOMEM);
+
+  (*potential)->qn = NULL;
+  ierr = pspio_qn_alloc(&(*potential)->qn);
+  if ( ierr != PSPIO_SUCCESS ) {
+    pspio_potential_free(*potential);
+    *potential = NULL;
+    RETURN_WITH_ERROR( ierr );
+  }
+
+  return PSPIO_SUCCESS;
+}
+
 int pspio_potential_init(pspio_potential_t *potential, const pspio_qn_t *qn,
 			 const pspio_mesh_t *mesh, const double *vofr)
 {
@@ -73,11 +103,39 @@ int pspio_potential_init(pspio_potential_t *potential, const pspio_qn_t *qn,
   return PSPIO_SUCCESS;
 }
 
+int pspio_potential_init_analytic(pspio_potential_t *potential,
+  const pspio_qn_t *qn, const pspio_gth_term_t *term)
+{
+  assert(potential != NULL);
+  assert(potential->analytic != NULL);
+  assert(qn != NULL);
+  assert(term != NULL);
+
+  SUCCEED_OR_RETURN( pspio_qn_copy(&potential->qn, qn) );
+  *potential->analytic = *term;
+
+  return PSPIO_SUCCESS;
+}
+
 int pspio_potential_copy(pspio_potential_t **dst, const pspio_potential_t *src) {
   int np;
 
   assert(src != NULL);
 
+  /* Analytic potentials only carry their expression */
+  if ( src->analytic != NULL ) {
+    if ( (*dst != NULL) && ((*dst)->analytic == NULL) ) {
+      pspio_potential_free(*dst);
+      *dst = NULL;
+    }
+    if ( *dst == NULL ) {
+      SUCCEED_OR_RETURN( pspio_potential_alloc_analytic(dst) );
+    }
+    SUCCEED_OR_RETURN( pspio_potential_init_analytic(*dst, src->qn, src->analytic) );
+    INSTR_COUNT(PSPIO_COUNTER_COPIES);
+    return PSPIO_SUCCESS;
+  }
+
   np = pspio_mesh_get_np(src->v->mesh);
 
   if ( *dst == NULL ) {
@@ -88,7 +146,7 @@ int pspio_potential_copy(pspio_potential_t **dst, const pspio_potential_t *src)
    * The mesh of the destination potential must have the same number
    * of points as the mesh of the source potential
    */
-  if ( pspio_mesh_get_np((*dst)->v->mesh) != np ) {
+  if ( ((*dst)->v == NULL) || (pspio_mesh_get_np((*dst)->v->mesh) != np) ) {
     pspio_potential_free(*dst);
     *dst = NULL;
     SUCCEED_OR_RETURN(pspio_potential_alloc(dst, np));
@@ -97,6 +155,8 @@ int pspio_potential_copy(pspio_potential_t **dst, const pspio_potential_t *src)
   SUCCEED_OR_RETURN( pspio_meshfunc_copy(&(*dst)->v, src->v) );
   SUCCEED_OR_RETURN( pspio_qn_copy(&(*dst)->qn, src->qn) );
 
+  INSTR_COUNT(PSPIO_COUNTER_COPIES);
+
   return PSPIO_SUCCESS;
 }
 
@@ -105,6 +165,7 @@ void pspio_potential_free(pspio_potential_t *potential)
 {
   if (potential != NULL) {
     pspio_meshfunc_free(potential->v);
+    free(potential->analytic);
     pspio_qn_free(potential->qn);
     free(potential);
   }
@@ -122,6 +183,20 @@ const pspio_qn_t *pspio_potential_get_qn(const pspio_potential_t *potential)
   return potential->qn;
 }
 
+const pspio_meshfunc_t *pspio_potential_get_v(const pspio_potential_t *potential)
+{
+  assert(potential != NULL);
+
+  return potential->v;
+}
+
+const pspio_gth_term_t *pspio_potential_get_analytic(const pspio_potential_t *potential)
+{
+  assert(potential != NULL);
+
+  return potential->analytic;
+}
+
 
 /**********************************************************************
  * Utility routines                                                   *
@@ -130,8 +205,15 @@ const pspio_qn_t *pspio_potential_get_qn(const pspio_potential_t *potential)
 int pspio_potential_cmp(const pspio_potential_t *potential1, const
                         pspio_potential_t *potential2) {
 
+  if ((potential1->analytic == NULL) != (potential2->analytic == NULL)) {
+    return PSPIO_DIFF;
+  }
+
   if ((pspio_qn_cmp(potential1->qn, potential2->qn) == PSPIO_DIFF) ||
-      (pspio_meshfunc_cmp(potential1->v, potential2->v) == PSPIO_DIFF)) {
+      ((potential1->analytic != NULL) &&
+       (memcmp(potential1->analytic, potential2->analytic, sizeof(pspio_gth_term_t)) != 0)) ||
+      ((potential1->analytic == NULL) &&
+       (pspio_meshfunc_cmp(potential1->v, potential2->v) == PSPIO_DIFF))) {
     return PSPIO_DIFF;
   } else {
     return PSPIO_EQUAL;
@@ -141,20 +223,74 @@ int pspio_potential_cmp(const pspio_potential_t *potential1, const
 double pspio_potential_eval(const pspio_potential_t *potential, double r)
 {
   assert(potential != NULL);
+  INSTR_COUNT(PSPIO_COUNTER_EVAL_POTENTIAL);
 
+  if ( potential->analytic != NULL ) return pspio_gth_term_eval(potential->analytic, r);
   return pspio_meshfunc_eval(potential->v, r);
 }
 
 double pspio_potential_eval_deriv(const pspio_potential_t *potential, double r)
 {
   assert(potential != NULL);
+  INSTR_COUNT(PSPIO_COUNTER_EVAL_POTENTIAL);
 
+  if ( potential->analytic != NULL ) return pspio_gth_term_eval_deriv(potential->analytic, r);
   return pspio_meshfunc_eval_deriv(potential->v, r);
 }
 
 double pspio_potential_eval_deriv2(const pspio_potential_t *potential, double r)
 {
   assert(potential != NULL);
+  INSTR_COUNT(PSPIO_COUNTER_EVAL_POTENTIAL);
 
+  if ( potential->analytic != NULL ) return pspio_gth_term_eval_deriv2(potential->analytic, r);
   return pspio_meshfunc_eval_deriv2(potential->v, r);
 }
+
+double pspio_potential_eval_located(const pspio_potential_t *potential, const pspio_mesh_loc_t *loc)
+{
+  assert(potential != NULL);
+  INSTR_COUNT(PSPIO_COUNTER_EVAL_POTENTIAL);
+
+  if ( potential->analytic != NULL ) return pspio_gth_term_eval(potential->analytic, loc->r);
+  return pspio_meshfunc_eval_located(potential->v, loc);
+}
+
+double pspio_potential_eval_deriv_located(const pspio_potential_t *potential, const pspio_mesh_loc_t *loc)
+{
+  assert(potential != NULL);
+  INSTR_COUNT(PSPIO_COUNTER_EVAL_POTENTIAL);
+
+  if ( potential->analytic != NULL ) return pspio_gth_term_eval_deriv(potential->analytic, loc->r);
+  return pspio_meshfunc_eval_deriv_located(potential->v, loc);
+}
+
+double pspio_potential_eval_q(const pspio_potential_t *potential, double q)
+{
+  assert(potential != NULL);
+  assert(potential->analytic != NULL);
+  INSTR_COUNT(PSPIO_COUNTER_EVAL_POTENTIAL);
+
+  return pspio_gth_term_eval_q(potential->analytic, q);
+}
+
+double pspio_potential_eval_q_deriv(const pspio_potential_t *potential, double q)
+{
+  assert(potential != NULL);
+  assert(potential->analytic != NULL);
+  INSTR_COUNT(PSPIO_COUNTER_EVAL_POTENTIAL);
+
+  return pspio_gth_term_eval_q_deriv(potential->analytic, q);
+}
+
+void pspio_potential_memory_usage(const pspio_potential_t *potential, pspio_memory_t *usage)
+{
+  assert(usage != NULL);
+
+  if ( potential == NULL ) return;
+
+  usage->metadata += sizeof(pspio_potential_t);
+  if ( potential->qn != NULL ) usage->metadata += sizeof(pspio_qn_t);
+  if ( potential->analytic != NULL ) usage->metadata += sizeof(pspio_gth_term_t);
+  pspio_meshfunc_memory_usage(potential->v, usage);
+}
@@ -22,6 +22,7 @@
 #define PSPIO_POTENTIAL_H
 
 #include "pspio_error.h"
+#include "pspio_gth.h"
 #include "pspio_mesh.h"
 #include "pspio_meshfunc.h"
 #include "pspio_qn.h"
@@ -36,7 +37,8 @@
  */
 typedef struct{
   pspio_qn_t *qn;      /**< struct with quantum numbers n l j for the potential */
-  pspio_meshfunc_t *v; /**< pseudopotential, on a radial mesh */
+  pspio_meshfunc_t *v; /**< pseudopotential, on a radial mesh, NULL if analytic */
+  pspio_gth_term_t *analytic; /**< closed-form expression, NULL if tabulated */
 } pspio_potential_t;
 
 
@@ -54,6 +56,15 @@ typedef struct{
  */
 int pspio_potential_alloc(pspio_potential_t **potential, const int np);
 
+/**
+ * Allocates memory and preset a potential given by a closed-form
+ * expression instead of values on a mesh
+ *
+ * @param[in,out] potential: potential structure
+ * @return error code
+ */
+int pspio_potential_alloc_analytic(pspio_potential_t **potential);
+
 /**
  * Initializes the potential data.
  * @param[in,out] potential: potential structure to be initialized
@@ -66,6 +77,17 @@ int pspio_potential_alloc(pspio_potential_t **potential, const int np);
  */
 int pspio_potential_init(pspio_potential_t *potential, const pspio_qn_t *qn, const pspio_mesh_t *mesh, const double *vofr);
 
+/**
+ * Initializes an analytic potential.
+ * @param[in,out] potential: potential structure to be initialized
+ * @param[in] qn: pointer to quantum numbers
+ * @param[in] term: closed-form expression of the potential
+ * @return error code
+ * @note The potential pointer has to be allocated first with the
+ *       pspio_potential_alloc_analytic method.
+ */
+int pspio_potential_init_analytic(pspio_potential_t *potential, const pspio_qn_t *qn, const pspio_gth_term_t *term);
+
 /**
  * Duplicates a potential structure.
  * @param[out] dst: destination potential structure pointer
@@ -101,6 +123,23 @@ void pspio_potential_free(pspio_potential_t *potential);
  */
 const pspio_qn_t *pspio_potential_get_qn(const pspio_potential_t *potential);
 
+/**
+ * Returns a pointer to the mesh function of the potential
+ * 
+ * @param[in] potential: potential structure
+ * @return pointer to the potential mesh function
+ * @note The potential pointer has to be fully set.
+ */
+const pspio_meshfunc_t *pspio_potential_get_v(const pspio_potential_t *potential);
+
+/**
+ * Returns a pointer to the closed-form expression of the potential
+ *
+ * @param[in] potential: potential structure
+ * @return pointer to the expression, NULL if the potential is tabulated
+ */
+const pspio_gth_term_t *pspio_potential_get_analytic(const pspio_potential_t *potential);
+
 
 /**********************************************************************
  * Utility routines                                                   *
@@ -146,5 +185,56 @@ double pspio_potential_eval_deriv(const pspio_potential_t *potential, double r);
  */
 double pspio_potential_eval_deriv2(const pspio_potential_t *potential, double r);
 
+/**
+ * Returns the value of the potential at a point located with
+ * pspio_mesh_locate, sharing the search with other functions
+ * defined on the same mesh
+ *
+ * @param[in] potential: potential structure
+ * @param[in] loc: position of the point
+ * @return value of the potential at loc
+ * @note The potential pointer has to be fully set.
+ */
+double pspio_potential_eval_located(const pspio_potential_t *potential, const pspio_mesh_loc_t *loc);
+
+/**
+ * Returns the value of the derivative of the potential at a located point
+ *
+ * @param[in] potential: potential structure
+ * @param[in] loc: position of the point
+ * @return value of the derivative at loc
+ * @note The potential pointer has to be fully set.
+ */
+double pspio_potential_eval_deriv_located(const pspio_potential_t *potential, const pspio_mesh_loc_t *loc);
+
+/**
+ * Returns the radial Fourier transform of an analytic potential, see
+ * pspio_gth_term_eval_q
+ *
+ * @param[in] potential: potential structure
+ * @param[in] q: norm of the wave vector
+ * @return value of the transform at q
+ * @note The potential must be analytic.
+ */
+double pspio_potential_eval_q(const pspio_potential_t *potential, double q);
+
+/**
+ * Returns the derivative of the radial Fourier transform of an
+ * analytic potential
+ *
+ * @param[in] potential: potential structure
+ * @param[in] q: norm of the wave vector
+ * @return value of the derivative at q
+ * @note The potential must be analytic.
+ */
+double pspio_potential_eval_q_deriv(const pspio_potential_t *potential, double q);
+
+/**
+ * Adds the memory footprint of potential to usage
+ *
+ * @param[in] potential: potential structure, may be NULL
+ * @param[in,out] usage: memory footprint to update
+ */
+void pspio_potential_memory_usage(const pspio_potential_t *potential, pspio_memory_t *usage);
 
 #endif
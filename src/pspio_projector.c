@@ -16,9 +16,11 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include <math.h>
 
+#include "instrument.h"
 #include "pspio_projector.h"
 
 #if defined HAVE_CONFIG_H
@@ -40,7 +42,9 @@ int pspio_projector_alloc(pspio_projector_t **projector, int np)
 
   *projector = (pspio_projector_t *) malloc (sizeof(pspio_projector_t));
   FULFILL_OR_EXIT(*projector != NULL, PSPIO_ENOMEM);
+  INSTR_COUNT(PSPIO_COUNTER_ALLOCS);
 
+  (*projector)->analytic = NULL;
   (*projector)->proj = NULL;
   ierr = pspio_meshfunc_alloc(&(*projector)->proj, np);
   if ( ierr != PSPIO_SUCCESS ) {
@@ -60,6 +64,33 @@ int pspio_projector_alloc(pspio_projector_t **projector, int np)
   return PSPIO_SUCCESS;
 }
 
+int pspio_projector_alloc_analytic(pspio_projector_t **projector)
+{
+  int ierr;
+
+  assert(projector != NULL);
+  assert(*projector == NULL);
+
+  *projector = (pspio_projector_t *) malloc (sizeof(pspio_projector_t));
+  FULFILL_OR_EXIT(*projector != NULL, PSPIO_ENOMEM);
+  INSTR_COUNT(PSPIO_COUNTER_ALLOCS);
+
+  (*projector)->energy = 0.;
+  (*projector)->proj = NULL;
+  (*projector)->analytic = (pspio_gth_term_t *) malloc (sizeof(pspio_gth_term_t));
+  FULFILL_OR_EXIT((*projector)->analytic != NULL, PSPIO_ENOMEM);
+
+  (*projector)->qn = NULL;
+  ierr = pspio_qn_alloc(&(*projector)->qn);
+  if ( ierr != PSPIO_SUCCESS ) {
+    pspio_projector_free(*projector);
+    *projector = NULL;
+    RETURN_WITH_ERROR( ierr );
+  }
+
+  return PSPIO_SUCCESS;
+}
+
 int pspio_projector_init(pspio_projector_t *projector, const pspio_qn_t *qn, 
 			 const pspio_mesh_t *mesh, const double *pofr)
 {
@@ -75,12 +106,42 @@ int pspio_projector_init(pspio_projector_t *projector, const pspio_qn_t *qn,
   return PSPIO_SUCCESS;
 }
 
+int pspio_projector_init_analytic(pspio_projector_t *projector,
+  const pspio_qn_t *qn, const pspio_gth_term_t *term)
+{
+  assert(projector != NULL);
+  assert(projector->analytic != NULL);
+  assert(qn != NULL);
+  assert(term != NULL);
+
+  projector->energy = 0.;
+  SUCCEED_OR_RETURN(pspio_qn_copy(&projector->qn, qn));
+  *projector->analytic = *term;
+
+  return PSPIO_SUCCESS;
+}
+
 int pspio_projector_copy(pspio_projector_t **dst, const pspio_projector_t *src)
 {
   int np;
 
   assert(src != NULL);
 
+  /* Analytic projectors only carry their expression */
+  if ( src->analytic != NULL ) {
+    if ( (*dst != NULL) && ((*dst)->analytic == NULL) ) {
+      pspio_projector_free(*dst);
+      *dst = NULL;
+    }
+    if ( *dst == NULL ) {
+      SUCCEED_OR_RETURN( pspio_projector_alloc_analytic(dst) );
+    }
+    SUCCEED_OR_RETURN( pspio_projector_init_analytic(*dst, src->qn, src->analytic) );
+    (*dst)->energy = src->energy;
+    INSTR_COUNT(PSPIO_COUNTER_COPIES);
+    return PSPIO_SUCCESS;
+  }
+
   np = pspio_mesh_get_np(src->proj->mesh);
 
   if ( *dst == NULL ) {
@@ -91,7 +152,7 @@ int pspio_projector_copy(pspio_projector_t **dst, const pspio_projector_t *src)
    * The mesh of the destination projector must have the same number
    * of points as the mesh of the source projector
    */
-  if ( pspio_mesh_get_np((*dst)->proj->mesh) != np ) {
+  if ( ((*dst)->proj == NULL) || (pspio_mesh_get_np((*dst)->proj->mesh) != np) ) {
     pspio_projector_free(*dst);
     *dst = NULL;
     SUCCEED_OR_RETURN(pspio_projector_alloc(dst, np));
@@ -101,6 +162,8 @@ int pspio_projector_copy(pspio_projector_t **dst, const pspio_projector_t *src)
   SUCCEED_OR_RETURN( pspio_qn_copy(&(*dst)->qn, src->qn) );
   (*dst)->energy = src->energy;
 
+  INSTR_COUNT(PSPIO_COUNTER_COPIES);
+
   return PSPIO_SUCCESS;
 }
 
@@ -108,6 +171,7 @@ void pspio_projector_free(pspio_projector_t *projector)
 {
   if (projector != NULL) {
     pspio_meshfunc_free(projector->proj);
+    free(projector->analytic);
     pspio_qn_free(projector->qn);
     free(projector);
   }
@@ -145,6 +209,20 @@ const pspio_qn_t *pspio_projector_get_qn(const pspio_projector_t *projector)
   return projector->qn;
 }
 
+const pspio_meshfunc_t *pspio_projector_get_proj(const pspio_projector_t *projector)
+{
+  assert(projector != NULL);
+
+  return projector->proj;
+}
+
+const pspio_gth_term_t *pspio_projector_get_analytic(const pspio_projector_t *projector)
+{
+  assert(projector != NULL);
+
+  return projector->analytic;
+}
+
 
 /**********************************************************************
  * Utility routines                                                   *
@@ -156,8 +234,15 @@ int pspio_projector_cmp(const pspio_projector_t *projector1, const
   assert(projector1 != NULL);
   assert(projector2 != NULL);
 
+  if ((projector1->analytic == NULL) != (projector2->analytic == NULL)) {
+    return PSPIO_DIFF;
+  }
+
   if ((pspio_qn_cmp(projector1->qn, projector2->qn) == PSPIO_DIFF) ||
-      (pspio_meshfunc_cmp(projector1->proj, projector2->proj) == PSPIO_DIFF) ||
+      ((projector1->analytic != NULL) &&
+       (memcmp(projector1->analytic, projector2->analytic, sizeof(pspio_gth_term_t)) != 0)) ||
+      ((projector1->analytic == NULL) &&
+       (pspio_meshfunc_cmp(projector1->proj, projector2->proj) == PSPIO_DIFF)) ||
       (fabs(projector1->energy - projector2->energy) > 1e-10)) {
     return PSPIO_DIFF;
   } else {
@@ -168,42 +253,74 @@ int pspio_projector_cmp(const pspio_projector_t *projector1, const
 double pspio_projector_eval(const pspio_projector_t *projector, double r)
 {
   assert(projector != NULL);
+  INSTR_COUNT(PSPIO_COUNTER_EVAL_PROJECTOR);
 
+  if ( projector->analytic != NULL ) return pspio_gth_term_eval(projector->analytic, r);
   return pspio_meshfunc_eval(projector->proj, r);
 }
 
 double pspio_projector_eval_deriv(const pspio_projector_t *projector, double r)
 {
   assert(projector != NULL);
+  INSTR_COUNT(PSPIO_COUNTER_EVAL_PROJECTOR);
 
+  if ( projector->analytic != NULL ) return pspio_gth_term_eval_deriv(projector->analytic, r);
   return pspio_meshfunc_eval_deriv(projector->proj, r);
 }
 
 double pspio_projector_eval_deriv2(const pspio_projector_t *projector, double r)
 {
   assert(projector != NULL);
+  INSTR_COUNT(PSPIO_COUNTER_EVAL_PROJECTOR);
 
+  if ( projector->analytic != NULL ) return pspio_gth_term_eval_deriv2(projector->analytic, r);
   return pspio_meshfunc_eval_deriv2(projector->proj, r);
 }
 
-int * pspio_projectors_per_l(pspio_projector_t ** const projectors, int nproj)
+double pspio_projector_eval_located(const pspio_projector_t *projector, const pspio_mesh_loc_t *loc)
 {
-  int i, l;
-  int * ret;
+  assert(projector != NULL);
+  INSTR_COUNT(PSPIO_COUNTER_EVAL_PROJECTOR);
 
-  assert(projectors != NULL);
-  assert(nproj > 0);
+  if ( projector->analytic != NULL ) return pspio_gth_term_eval(projector->analytic, loc->r);
+  return pspio_meshfunc_eval_located(projector->proj, loc);
+}
 
-  ret = (unsigned int *) malloc (6*sizeof(unsigned int));
-  for (i=0; i<6; i++) {
-    ret[i] = 0;
-  }
+double pspio_projector_eval_deriv_located(const pspio_projector_t *projector, const pspio_mesh_loc_t *loc)
+{
+  assert(projector != NULL);
+  INSTR_COUNT(PSPIO_COUNTER_EVAL_PROJECTOR);
 
-  for (i=0;i<nproj;i++) {
-    l = projectors[i]->qn->l;
-    FULFILL_OR_EXIT( l < 6, PSPIO_ENOMEM );
-    ret[l] += 1;
-  }
+  if ( projector->analytic != NULL ) return pspio_gth_term_eval_deriv(projector->analytic, loc->r);
+  return pspio_meshfunc_eval_deriv_located(projector->proj, loc);
+}
+
+double pspio_projector_eval_q(const pspio_projector_t *projector, double q)
+{
+  assert(projector != NULL);
+  assert(projector->analytic != NULL);
+  INSTR_COUNT(PSPIO_COUNTER_EVAL_PROJECTOR);
+
+  return pspio_gth_term_eval_q(projector->analytic, q);
+}
+
+double pspio_projector_eval_q_deriv(const pspio_projector_t *projector, double q)
+{
+  assert(projector != NULL);
+  assert(projector->analytic != NULL);
+  INSTR_COUNT(PSPIO_COUNTER_EVAL_PROJECTOR);
+
+  return pspio_gth_term_eval_q_deriv(projector->analytic, q);
+}
+
+void pspio_projector_memory_usage(const pspio_projector_t *projector, pspio_memory_t *usage)
+{
+  assert(usage != NULL);
+
+  if ( projector == NULL ) return;
 
-  return ret;
+  usage->metadata += sizeof(pspio_projector_t);
+  if ( projector->qn != NULL ) usage->metadata += sizeof(pspio_qn_t);
+  if ( projector->analytic != NULL ) usage->metadata += sizeof(pspio_gth_term_t);
+  pspio_meshfunc_memory_usage(projector->proj, usage);
 }
@@ -23,6 +23,7 @@
 #define PSPIO_PROJECTOR_H
 
 #include "pspio_error.h"
+#include "pspio_gth.h"
 #include "pspio_mesh.h"
 #include "pspio_meshfunc.h"
 #include "pspio_qn.h"
@@ -38,7 +39,8 @@
 typedef struct{
   pspio_qn_t *qn;         /**< quantum numbers for present projector */
   double energy;          /**< projector energy */
-  pspio_meshfunc_t *proj; /**< projector on a mesh */
+  pspio_meshfunc_t *proj; /**< projector on a mesh, NULL if analytic */
+  pspio_gth_term_t *analytic; /**< closed-form expression, NULL if tabulated */
 } pspio_projector_t;
 
 
@@ -56,6 +58,15 @@ typedef struct{
  */
 int pspio_projector_alloc(pspio_projector_t **projector, int np);
 
+/**
+ * Allocates memory and preset a projector given by a closed-form
+ * expression instead of values on a mesh
+ *
+ * @param[in,out] projector: projector structure
+ * @return error code
+ */
+int pspio_projector_alloc_analytic(pspio_projector_t **projector);
+
 /**
  * Initializes the projector data.
  * @param[in,out] projector: projector structure to be initialized
@@ -70,6 +81,18 @@ int pspio_projector_alloc(pspio_projector_t **projector, int np);
 int pspio_projector_init(pspio_projector_t *projector, const pspio_qn_t *qn, 
                          const pspio_mesh_t *mesh, const double *pofr);
 
+/**
+ * Initializes an analytic projector.
+ * @param[in,out] projector: projector structure to be initialized
+ * @param[in] qn: pointer to quantum numbers
+ * @param[in] term: closed-form expression of the projector
+ * @return error code
+ * @note The projector pointer has to be allocated first with the
+ *       pspio_projector_alloc_analytic method.
+ */
+int pspio_projector_init_analytic(pspio_projector_t *projector, const pspio_qn_t *qn,
+                                  const pspio_gth_term_t *term);
+
 /**
  * Duplicates a projector structure.
  * @param[out] dst: destination projector structure pointer
@@ -127,6 +150,23 @@ double pspio_projector_get_energy(const pspio_projector_t *projector);
  */
 const pspio_qn_t *pspio_projector_get_qn(const pspio_projector_t *projector);
 
+/**
+ * Returns a pointer to the mesh function of the projector
+ * 
+ * @param[in] projector: projector structure
+ * @return pointer to the projector mesh function
+ * @note The projector pointer has to be fully set.
+ */
+const pspio_meshfunc_t *pspio_projector_get_proj(const pspio_projector_t *projector);
+
+/**
+ * Returns a pointer to the closed-form expression of the projector
+ *
+ * @param[in] projector: projector structure
+ * @return pointer to the expression, NULL if the projector is tabulated
+ */
+const pspio_gth_term_t *pspio_projector_get_analytic(const pspio_projector_t *projector);
+
 
 /**********************************************************************
  * Utility routines                                                   *
@@ -173,11 +213,55 @@ double pspio_projector_eval_deriv(const pspio_projector_t *projector, double r);
 double pspio_projector_eval_deriv2(const pspio_projector_t *projector, double r);
 
 /**
- * Return a count of projectors per angular momentum
+ * Returns the value of the projector at a point located with
+ * pspio_mesh_locate, sharing the search with other functions
+ * defined on the same mesh
+ *
+ * @param[in] projector: projector structure
+ * @param[in] loc: position of the point
+ * @return value of the projector at loc
+ * @note The projector pointer has to be fully set.
+ */
+double pspio_projector_eval_located(const pspio_projector_t *projector, const pspio_mesh_loc_t *loc);
+
+/**
+ * Returns the value of the derivative of the projector at a located point
+ *
+ * @param[in] projector: projector structure
+ * @param[in] loc: position of the point
+ * @return value of the derivative at loc
+ * @note The projector pointer has to be fully set.
+ */
+double pspio_projector_eval_deriv_located(const pspio_projector_t *projector, const pspio_mesh_loc_t *loc);
+
+/**
+ * Returns the radial Fourier transform of an analytic projector, see
+ * pspio_gth_term_eval_q
+ *
+ * @param[in] projector: projector structure
+ * @param[in] q: norm of the wave vector
+ * @return value of the transform at q
+ * @note The projector must be analytic.
+ */
+double pspio_projector_eval_q(const pspio_projector_t *projector, double q);
+
+/**
+ * Returns the derivative of the radial Fourier transform of an
+ * analytic projector
+ *
+ * @param[in] projector: projector structure
+ * @param[in] q: norm of the wave vector
+ * @return value of the derivative at q
+ * @note The projector must be analytic.
+ */
+double pspio_projector_eval_q_deriv(const pspio_projector_t *projector, double q);
+
+/**
+ * Adds the memory footprint of projector to usage
  *
- * @param[in] projectors: the projectors to count
- * @param[in] nproj: the total number of projectors
+ * @param[in] projector: projector structure, may be NULL
+ * @param[in,out] usage: memory footprint to update
  */
-int * pspio_projectors_per_l(pspio_projector_t ** const projectors, int nproj);
+void pspio_projector_memory_usage(const pspio_projector_t *projector, pspio_memory_t *usage);
 
 #endif
@@ -16,21 +16,735 @@
  * more details.
  */
 
+#include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include "instrument.h"
 #include "pspio_common.h"
 #include "pspio_error.h"
 #include "pspio_meshfunc.h"
 #include "pspio_pspdata.h"
+#include "pspio_resample.h"
 #include "fhi.h"
 #include "upf.h"
 #include "abinit.h"
+#include "hgh.h"
+#include "psml.h"
+#include "compress.h"
 
 #if defined HAVE_CONFIG_H
 #include "config.h"
 #endif
 
+#if defined HAVE_PTHREAD
+#include <pthread.h>
+#endif
+#if defined HAVE_POSIX_FADVISE
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+/**********************************************************************
+ * Private routines                                                   *
+ **********************************************************************/
+
+/*
+ * Collects the addresses of all the functions of pspdata. If funcs is
+ * NULL, only counts them. Analytic potentials and projectors have no
+ * function to collect.
+ */
+static int pspdata_functions(pspio_pspdata_t *pspdata, pspio_meshfunc_t ***funcs)
+{
+  int i, n = 0;
+
+  for (i=0; i<pspdata->n_states; i++) {
+    if ( pspdata->states[i] == NULL ) continue;
+    if ( funcs != NULL ) funcs[n] = &pspdata->states[i]->wf;
+    n++;
+  }
+  for (i=0; i<pspdata->n_potentials; i++) {
+    if ( (pspdata->potentials[i] == NULL) || (pspdata->potentials[i]->v == NULL) ) continue;
+    if ( funcs != NULL ) funcs[n] = &pspdata->potentials[i]->v;
+    n++;
+  }
+  for (i=0; i<pspdata->n_projectors; i++) {
+    if ( (pspdata->projectors[i] == NULL) || (pspdata->projectors[i]->proj == NULL) ) continue;
+    if ( funcs != NULL ) funcs[n] = &pspdata->projectors[i]->proj;
+    n++;
+  }
+  if ( (pspdata->vlocal != NULL) && (pspdata->vlocal->v != NULL) ) {
+    if ( funcs != NULL ) funcs[n] = &pspdata->vlocal->v;
+    n++;
+  }
+  if ( (pspdata->xc != NULL) && (pspdata->xc->nlcc_dens != NULL) ) {
+    if ( funcs != NULL ) funcs[n] = &pspdata->xc->nlcc_dens;
+    n++;
+  }
+  if ( pspdata->rho_valence != NULL ) {
+    if ( funcs != NULL ) funcs[n] = &pspdata->rho_valence;
+    n++;
+  }
+
+  return n;
+}
+
+/* Builds the pending interpolation objects of all the functions */
+static int pspdata_prepare(pspio_pspdata_t *pspdata)
+{
+  int i, n, ierr;
+  pspio_meshfunc_t ***addr, **funcs;
+
+  n = pspdata_functions(pspdata, NULL);
+  if ( n == 0 ) return PSPIO_SUCCESS;
+
+  addr = (pspio_meshfunc_t ***) malloc (n * sizeof(pspio_meshfunc_t **));
+  FULFILL_OR_EXIT( addr != NULL, PSPIO_ENOMEM );
+  funcs = (pspio_meshfunc_t **) malloc (n * sizeof(pspio_meshfunc_t *));
+  FULFILL_OR_EXIT( funcs != NULL, PSPIO_ENOMEM );
+  pspdata_functions(pspdata, addr);
+  for (i=0; i<n; i++) {
+    funcs[i] = *addr[i];
+  }
+
+  /* All the functions usually share the mesh of pspdata */
+  ierr = pspio_meshfunc_prepare_batch(n, funcs);
+
+  free(funcs);
+  free(addr);
+  RETURN_WITH_ERROR( ierr );
+}
+
+/*
+ * Returns the channel of the lookup index for the quantum numbers
+ * (l, j), or -1 if j is neither 0 nor l+-1/2
+ */
+static int pspdata_index_channel(int l, double j)
+{
+  if ( l < 0 ) return -1;
+  if ( j == 0.0 ) return 3*l;
+  if ( (l > 0) && (j == l - 0.5) ) return 3*l + 1;
+  if ( j == l + 0.5 ) return 3*l + 2;
+
+  return -1;
+}
+
+static void pspdata_index_free(pspio_pspdata_t *pspdata)
+{
+  if ( pspdata->index != NULL ) {
+    free(pspdata->index->block);
+    free(pspdata->index);
+    pspdata->index = NULL;
+  }
+}
+
+/*
+ * Rebuilds the index discarded by a setter before it is used, returns
+ * NULL if pspdata cannot be indexed yet
+ */
+static const pspio_pspdata_index_t *pspdata_index_ensure(const pspio_pspdata_t *pspdata)
+{
+  if ( pspdata->index == NULL ) {
+    DEFER_FUNC_ERROR( pspio_pspdata_build_index((pspio_pspdata_t *)pspdata) );
+  }
+
+  return pspdata->index;
+}
+
+/* Running state of the content hash */
+typedef struct{
+  uint64_t h; /* hash of the words seen so far */
+  uint64_t n; /* number of words seen so far */
+} pspdata_hash_t;
+
+/* Mixes one 64-bit word into the hash, as in the body of MurmurHash3 */
+static void pspdata_hash_word(pspdata_hash_t *hs, uint64_t k)
+{
+  k *= 0x87c37b91114253d5ULL;
+  k = (k << 31) | (k >> 33);
+  k *= 0x4cf5ad432745937fULL;
+  hs->h ^= k;
+  hs->h = (hs->h << 27) | (hs->h >> 37);
+  hs->h = hs->h*5 + 0x52dce729ULL;
+  hs->n++;
+}
+
+static void pspdata_hash_double(pspdata_hash_t *hs, double x)
+{
+  uint64_t k;
+
+  /* Values that compare equal must hash alike: -0.0 is hashed as 0.0,
+     and all NaNs as the same one */
+  if ( x == 0.0 ) {
+    x = 0.0;
+  } else if ( x != x ) {
+    x = NAN;
+  }
+  memcpy(&k, &x, sizeof(k));
+  pspdata_hash_word(hs, k);
+}
+
+static void pspdata_hash_doubles(pspdata_hash_t *hs, int n, const double *x)
+{
+  int i;
+
+  pspdata_hash_word(hs, (uint64_t)n);
+  for (i=0; i<n; i++) {
+    pspdata_hash_double(hs, x[i]);
+  }
+}
+
+/* Strings are hashed 8 characters at a time, after their length */
+static void pspdata_hash_string(pspdata_hash_t *hs, const char *str)
+{
+  size_t i, len;
+  uint64_t k;
+
+  len = (str == NULL) ? 0 : strlen(str);
+  pspdata_hash_word(hs, (uint64_t)len);
+  for (i=0; i<len; i+=8) {
+    k = 0;
+    memcpy(&k, str + i, (len - i < 8) ? len - i : 8);
+    pspdata_hash_word(hs, k);
+  }
+}
+
+static void pspdata_hash_qn(pspdata_hash_t *hs, const pspio_qn_t *qn)
+{
+  pspdata_hash_word(hs, (uint64_t)qn->n);
+  pspdata_hash_word(hs, (uint64_t)qn->l);
+  pspdata_hash_double(hs, qn->j);
+}
+
+/* Only the values of the functions are hashed, with their mesh */
+static void pspdata_hash_meshfunc(pspdata_hash_t *hs, const pspio_meshfunc_t *func)
+{
+  pspdata_hash_word(hs, (func == NULL) ? 0 : 1);
+  if ( func == NULL ) return;
+
+  pspdata_hash_word(hs, (uint64_t)func->mesh->type);
+  pspdata_hash_doubles(hs, func->mesh->np, func->mesh->r);
+  pspdata_hash_doubles(hs, func->mesh->np, func->f);
+}
+
+static uint64_t pspdata_hash_compute(const pspio_pspdata_t *pspdata)
+{
+  int i;
+  uint64_t h;
+  pspdata_hash_t hs;
+
+  hs.h = 0x9e3779b97f4a7c15ULL;
+  hs.n = 0;
+
+  /* General data */
+  pspdata_hash_string(&hs, pspdata->symbol);
+  pspdata_hash_double(&hs, pspdata->z);
+  pspdata_hash_double(&hs, pspdata->zvalence);
+  pspdata_hash_double(&hs, pspdata->nelvalence);
+  pspdata_hash_word(&hs, (uint64_t)pspdata->l_max);
+  pspdata_hash_word(&hs, (uint64_t)pspdata->wave_eq);
+  pspdata_hash_double(&hs, pspdata->total_energy);
+  pspdata_hash_word(&hs, (pspdata->mesh == NULL) ? 0 : 1);
+  if ( pspdata->mesh != NULL ) {
+    pspdata_hash_word(&hs, (uint64_t)pspdata->mesh->type);
+    pspdata_hash_doubles(&hs, pspdata->mesh->np, pspdata->mesh->r);
+  }
+
+  /* States */
+  pspdata_hash_word(&hs, (uint64_t)pspdata->n_states);
+  for (i=0; i<pspdata->n_states; i++) {
+    pspdata_hash_word(&hs, (pspdata->states[i] == NULL) ? 0 : 1);
+    if ( pspdata->states[i] == NULL ) continue;
+    pspdata_hash_qn(&hs, pspdata->states[i]->qn);
+    pspdata_hash_double(&hs, pspdata->states[i]->occ);
+    pspdata_hash_double(&hs, pspdata->states[i]->eigenval);
+    pspdata_hash_string(&hs, pspdata->states[i]->label);
+    pspdata_hash_double(&hs, pspdata->states[i]->rc);
+    pspdata_hash_meshfunc(&hs, pspdata->states[i]->wf);
+  }
+
+  /* Potentials */
+  pspdata_hash_word(&hs, (uint64_t)pspdata->scheme);
+  pspdata_hash_word(&hs, (uint64_t)pspdata->n_potentials);
+  for (i=0; i<pspdata->n_potentials; i++) {
+    pspdata_hash_word(&hs, (pspdata->potentials[i] == NULL) ? 0 : 1);
+    if ( pspdata->potentials[i] == NULL ) continue;
+    pspdata_hash_qn(&hs, pspdata->potentials[i]->qn);
+    pspdata_hash_meshfunc(&hs, pspdata->potentials[i]->v);
+  }
+
+  /* Projectors */
+  pspdata_hash_word(&hs, (uint64_t)pspdata->n_projectors);
+  for (i=0; i<pspdata->n_projectors; i++) {
+    pspdata_hash_word(&hs, (pspdata->projectors[i] == NULL) ? 0 : 1);
+    if ( pspdata->projectors[i] == NULL ) continue;
+    pspdata_hash_qn(&hs, pspdata->projectors[i]->qn);
+    pspdata_hash_double(&hs, pspdata->projectors[i]->energy);
+    pspdata_hash_meshfunc(&hs, pspdata->projectors[i]->proj);
+  }
+  if ( pspdata->projector_energies != NULL ) {
+    pspdata_hash_doubles(&hs, pspdata->n_projectors*pspdata->n_projectors,
+      pspdata->projector_energies);
+  }
+  pspdata_hash_word(&hs, (uint64_t)pspdata->projectors_l_max);
+  pspdata_hash_word(&hs, (uint64_t)pspdata->l_local);
+  pspdata_hash_meshfunc(&hs, (pspdata->vlocal == NULL) ? NULL : pspdata->vlocal->v);
+
+  /* XC and valence density */
+  pspdata_hash_word(&hs, (pspdata->xc == NULL) ? 0 : 1);
+  if ( pspdata->xc != NULL ) {
+    pspdata_hash_word(&hs, (uint64_t)pspdata->xc->exchange);
+    pspdata_hash_word(&hs, (uint64_t)pspdata->xc->correlation);
+    pspdata_hash_word(&hs, (uint64_t)pspdata->xc->nlcc_scheme);
+    pspdata_hash_double(&hs, pspdata->xc->nlcc_pf_scale);
+    pspdata_hash_double(&hs, pspdata->xc->nlcc_pf_value);
+    pspdata_hash_meshfunc(&hs, pspdata->xc->nlcc_dens);
+  }
+  pspdata_hash_meshfunc(&hs, pspdata->rho_valence);
+
+  /* Analytic parameters, which also define the analytic functions */
+  pspdata_hash_word(&hs, (pspdata->gth == NULL) ? 0 : 1);
+  if ( pspdata->gth != NULL ) {
+    pspdata_hash_double(&hs, pspdata->gth->zion);
+    pspdata_hash_double(&hs, pspdata->gth->rloc);
+    pspdata_hash_doubles(&hs, 4, pspdata->gth->c);
+    for (i=0; i<=PSPIO_GTH_L_MAX; i++) {
+      pspdata_hash_word(&hs, (uint64_t)pspdata->gth->n_proj[i]);
+      pspdata_hash_double(&hs, pspdata->gth->r[i]);
+      pspdata_hash_doubles(&hs, PSPIO_GTH_N_PROJ*PSPIO_GTH_N_PROJ,
+        &pspdata->gth->h[i][0][0]);
+      pspdata_hash_doubles(&hs, PSPIO_GTH_N_PROJ*PSPIO_GTH_N_PROJ,
+        &pspdata->gth->k[i][0][0]);
+    }
+  }
+
+  /* Finalization of MurmurHash3, 0 is kept for "not computed" */
+  h = hs.h ^ hs.n;
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+
+  return (h == 0) ? 1 : h;
+}
+
+/* Tolerance test of pspio_pspdata_cmp */
+static int pspdata_cmp_double(double x, double y, double tol)
+{
+  double s;
+
+  s = (fabs(x) > fabs(y)) ? fabs(x) : fabs(y);
+  s = (s > 1.0) ? s : 1.0;
+
+  return fabs(x - y) <= tol*s;
+}
+
+/*
+ * Compares two arrays with the tolerance of pspio_pspdata_cmp. The
+ * inner loop has no early exit, so that the compiler can vectorize it.
+ */
+static int pspdata_cmp_doubles(int n, const double *x, const double *y, double tol)
+{
+  int i, i0, i1, diff;
+  double a, b, s;
+
+  for (i0=0; i0<n; i0+=256) {
+    i1 = (i0 + 256 < n) ? i0 + 256 : n;
+    diff = 0;
+    for (i=i0; i<i1; i++) {
+      a = fabs(x[i]);
+      b = fabs(y[i]);
+      s = (a > b) ? a : b;
+      s = (s > 1.0) ? s : 1.0;
+      diff |= (fabs(x[i] - y[i]) > tol*s);
+    }
+    if ( diff ) return 0;
+  }
+
+  return 1;
+}
+
+static int pspdata_cmp_string(const char *str1, const char *str2)
+{
+  if ( (str1 == NULL) || (str2 == NULL) ) return str1 == str2;
+
+  return strcmp(str1, str2) == 0;
+}
+
+static int pspdata_cmp_qn(const pspio_qn_t *qn1, const pspio_qn_t *qn2)
+{
+  return (qn1->n == qn2->n) && (qn1->l == qn2->l) && (qn1->j == qn2->j);
+}
+
+static int pspdata_cmp_mesh(const pspio_mesh_t *mesh1, const pspio_mesh_t *mesh2,
+                            double tol)
+{
+  if ( (mesh1 == NULL) || (mesh2 == NULL) ) return mesh1 == mesh2;
+
+  return (mesh1->type == mesh2->type) && (mesh1->np == mesh2->np) &&
+    pspdata_cmp_doubles(mesh1->np, mesh1->r, mesh2->r, tol);
+}
+
+static int pspdata_cmp_meshfunc(const pspio_meshfunc_t *func1,
+                                const pspio_meshfunc_t *func2, double tol)
+{
+  if ( (func1 == NULL) || (func2 == NULL) ) return func1 == func2;
+
+  return pspdata_cmp_mesh(func1->mesh, func2->mesh, tol) &&
+    pspdata_cmp_doubles(func1->mesh->np, func1->f, func2->f, tol);
+}
+
+/*
+ * Reads a file with the interpolation of all the functions deferred
+ * while parsing. Only the PSPIO_LOAD_* components are loaded. The
+ * interpolation is built at the end if prepare is set, otherwise it is
+ * left pending. If header is set, only the header of the file is read.
+ */
+static int pspdata_read(pspio_pspdata_t *pspdata, int file_format,
+                        const char *file_name, int components, int prepare,
+                        int header)
+{
+  int ierr, ierr_close, fmt, defer;
+  char *buffer;
+  FILE * fp;
+  INSTR_TIMER_DECLARE(t_read);
+
+  assert(pspdata != NULL);
+
+  /* Stop if pspdata already contains some information */
+  assert(pspdata->format_guessed == PSPIO_FMT_UNKNOWN);
+
+  /* Open file, decompressing it if needed */
+  INSTR_TIMER_START(t_read);
+  SUCCEED_OR_RETURN( compress_fopen(file_name, &fp, &buffer) );
+
+  /* Read from file */
+  ierr = PSPIO_ERROR;
+  defer = pspio_meshfunc_defer_interp(1);
+  for (fmt=0; fmt<PSPIO_FMT_NFORMATS; fmt++) {
+    if ( (file_format != PSPIO_FMT_UNKNOWN) && (fmt != file_format) ) {
+      continue;
+    }
+    
+    /* The error chain should be reset, as some errors might have been
+       set in the previous iteration of this loop */
+    pspio_error_free();
+
+    /* Always rewind the file to allow for multiple reads */
+    FULFILL_OR_RETURN(fp != NULL, PSPIO_ENOFILE);
+    rewind(fp);
+
+    /* The readers skip the components that are not wanted */
+    pspdata->loaded = header ? 0 : components;
+
+    fflush(stdout);
+    switch (fmt) {
+    case PSPIO_FMT_ABINIT_2:
+    case PSPIO_FMT_ABINIT_3:
+    case PSPIO_FMT_ABINIT_6:
+    case PSPIO_FMT_ABINIT_10:
+      ierr = header ? pspio_abinit_read_header(fp, pspdata, fmt) :
+        pspio_abinit_read(fp, pspdata, fmt);
+      break;
+    case PSPIO_FMT_OCTOPUS_HGH:
+      ierr = header ? pspio_hgh_read_header(fp, pspdata) :
+        pspio_hgh_read(fp, pspdata);
+      break;
+    case PSPIO_FMT_FHI98PP:
+      ierr = header ? pspio_fhi_read_header(fp, pspdata) :
+        pspio_fhi_read(fp, pspdata);
+      break;
+    case PSPIO_FMT_UPF:
+      ierr = header ? pspio_upf_read_header(fp, pspdata) :
+        pspio_upf_read(fp, pspdata);
+      break;
+    case PSPIO_FMT_XML:
+      ierr = header ? pspio_psml_read_header(fp, pspdata) :
+        pspio_psml_read(fp, pspdata);
+      break;
+
+    default:
+      ierr = PSPIO_ENOSUPPORT;
+    }
+
+    if (ierr != PSPIO_SUCCESS) pspio_pspdata_reset(pspdata);
+
+    /* Store the format */
+    if ( (ierr == PSPIO_SUCCESS) || (file_format != PSPIO_FMT_UNKNOWN) ) {
+      pspdata->format_guessed = fmt;
+      break;
+    }
+  }
+  pspio_meshfunc_defer_interp(defer);
+
+  if ( ierr == PSPIO_SUCCESS ) {
+  }
+
+  /* Close file */
+  ierr_close = fclose(fp);
+  free(buffer);
+  FULFILL_OR_RETURN( ierr_close == 0, PSPIO_EIO );
+
+  /* Make sure ierr is not silently ignored */
+  FULFILL_OR_RETURN(ierr == PSPIO_SUCCESS, ierr);
+
+  /* There are no functions to index or interpolate in a header */
+  if ( header ) {
+    INSTR_TIMER_STOP(PSPIO_TIMER_READ, t_read);
+    return PSPIO_SUCCESS;
+  }
+
+  /* Index the states, potentials and projectors */
+  SUCCEED_OR_RETURN( pspio_pspdata_build_index(pspdata) );
+
+  /* Build the interpolation objects */
+  if ( prepare ) {
+    SUCCEED_OR_RETURN( pspdata_prepare(pspdata) );
+  }
+  INSTR_TIMER_STOP(PSPIO_TIMER_READ, t_read);
+
+  return PSPIO_SUCCESS;
+}
+
+/*
+ * Formats pspdata into a newly allocated buffer. The format writers
+ * emit into a stream backed by memory, so that the destination only
+ * receives the whole file at once.
+ */
+static int pspdata_write(pspio_pspdata_t *pspdata, int file_format,
+                         char **buffer, size_t *size)
+{
+  int l, ierr, ierr_close;
+  FILE *fp;
+
+  *buffer = NULL;
+  *size = 0;
+
+  /* Partially loaded data would make an incomplete file */
+  FULFILL_OR_RETURN( pspdata->loaded == PSPIO_LOAD_ALL, PSPIO_EVALUE );
+
+  /* The file formats hold tabulated functions */
+  FULFILL_OR_RETURN( pspdata->gth == NULL, PSPIO_ENOSUPPORT );
+
+  if (pspdata->index == NULL) {
+    SUCCEED_OR_RETURN(pspio_pspdata_build_index(pspdata));
+  }
+
+  /* FHI98PP files hold one semilocal potential per channel on a log1
+     mesh, which other formats do not always provide */
+  if ( (file_format == PSPIO_FMT_FHI98PP) ||
+       (file_format == PSPIO_FMT_ABINIT_6) ) {
+    FULFILL_OR_RETURN( pspdata->mesh->type == PSPIO_MESH_LOG1,
+      PSPIO_ENOSUPPORT );
+    for (l=0; l<=pspdata->l_max; l++) {
+      FULFILL_OR_RETURN( pspio_pspdata_find_potential(pspdata, l, 0.0) >= 0,
+        PSPIO_ENOSUPPORT );
+    }
+  }
+
+  /* The other formats have a header describing the exchange and
+     correlation and the generation of the pseudopotential */
+  if ( file_format != PSPIO_FMT_FHI98PP ) {
+    FULFILL_OR_RETURN( pspdata->xc != NULL, PSPIO_ENOSUPPORT );
+    if ( pspdata->pspinfo == NULL ) {
+      SUCCEED_OR_RETURN( pspio_pspinfo_alloc(&pspdata->pspinfo) );
+    }
+  }
+
+  /* UPF files hold a local potential and projectors */
+  if ( file_format == PSPIO_FMT_UPF ) {
+    FULFILL_OR_RETURN( pspdata->vlocal != NULL, PSPIO_ENOSUPPORT );
+  }
+
+  /* ABINIT files start with the element */
+  if ( (file_format == PSPIO_FMT_ABINIT_5) ||
+       (file_format == PSPIO_FMT_ABINIT_6) ) {
+    FULFILL_OR_RETURN( pspdata->z > 0.0, PSPIO_ENOSUPPORT );
+  }
+
+#if defined HAVE_OPEN_MEMSTREAM
+  fp = open_memstream(buffer, size);
+#else
+  fp = tmpfile();
+#endif
+  FULFILL_OR_RETURN( fp != NULL, PSPIO_EIO );
+
+  /* Write in the selected format */
+  switch(file_format) {
+    case PSPIO_FMT_ABINIT_5:
+    case PSPIO_FMT_ABINIT_6:
+      ierr = pspio_abinit_write(fp, pspdata, file_format);
+      break;
+    case PSPIO_FMT_FHI98PP:
+      ierr = pspio_fhi_write(fp, pspdata);
+      break;
+    case PSPIO_FMT_UPF:
+      ierr = pspio_upf_write(fp, pspdata);
+      break;
+    default:
+      ierr = PSPIO_EFILE_FORMAT;
+  }
+
+#if !defined HAVE_OPEN_MEMSTREAM
+  /* Read the temporary file back */
+  if ( ierr == PSPIO_SUCCESS ) {
+    *size = (size_t)ftell(fp);
+    *buffer = (char *) malloc ((*size + 1) * sizeof(char));
+    FULFILL_OR_EXIT( *buffer != NULL, PSPIO_ENOMEM );
+    rewind(fp);
+    if ( fread(*buffer, 1, *size, fp) != *size ) ierr = PSPIO_EIO;
+    (*buffer)[*size] = '\0';
+  }
+#endif
+  ierr_close = fclose(fp);
+
+  if ( (ierr != PSPIO_SUCCESS) || (ierr_close != 0) ) {
+    free(*buffer);
+    *buffer = NULL;
+    *size = 0;
+  }
+  FULFILL_OR_RETURN( ierr_close == 0, PSPIO_EIO );
+  FULFILL_OR_RETURN( ierr == PSPIO_SUCCESS, ierr );
+
+  return PSPIO_SUCCESS;
+}
+
+/* Reads a file and writes it in another format, without interpolating */
+static int pspdata_convert(int src_format, const char *src_name,
+                           int dst_format, const char *dst_name)
+{
+  int ierr;
+  pspio_pspdata_t *pspdata = NULL;
+
+  SUCCEED_OR_RETURN( pspio_pspdata_alloc(&pspdata) );
+  ierr = pspdata_read(pspdata, src_format, src_name, PSPIO_LOAD_ALL, 0, 0);
+  if ( ierr == PSPIO_SUCCESS ) {
+    ierr = pspio_pspdata_write(pspdata, dst_format, dst_name);
+  }
+  pspio_pspdata_free(pspdata);
+
+  return ierr;
+}
+
+#if defined HAVE_PTHREAD
+/*
+ * Two-stage conversion pipeline: a worker thread parses the files into
+ * a ring of two slots while the calling thread writes them out.
+ */
+typedef struct{
+  int n;
+  int src_format;
+  const char *const *src_names;
+  int interp_method;
+  int interp_defer;
+
+  pspio_pspdata_t *slot[2];
+  int slot_ierr[2];
+  int slot_full[2];
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+} pspdata_pipeline_t;
+
+static void *pspdata_pipeline_read(void *arg)
+{
+  int i, k, ierr;
+  pspio_pspdata_t *pspdata;
+  pspdata_pipeline_t *pipe = (pspdata_pipeline_t *)arg;
+
+  /* The interpolation settings are per thread: use the caller's */
+  pspio_meshfunc_default_interp(pipe->interp_method);
+  pspio_meshfunc_defer_interp(pipe->interp_defer);
+
+  for (i=0; i<pipe->n; i++) {
+    k = i % 2;
+
+    /* Wait for the writer to release the slot */
+    pthread_mutex_lock(&pipe->lock);
+    while ( pipe->slot_full[k] ) {
+      pthread_cond_wait(&pipe->cond, &pipe->lock);
+    }
+    pthread_mutex_unlock(&pipe->lock);
+
+    pspdata = NULL;
+    ierr = pspio_pspdata_alloc(&pspdata);
+    if ( ierr == PSPIO_SUCCESS ) {
+      ierr = pspdata_read(pspdata, pipe->src_format, pipe->src_names[i],
+        PSPIO_LOAD_ALL, 0, 0);
+    }
+
+    pthread_mutex_lock(&pipe->lock);
+    pipe->slot[k] = pspdata;
+    pipe->slot_ierr[k] = ierr;
+    pipe->slot_full[k] = 1;
+    pthread_cond_broadcast(&pipe->cond);
+    pthread_mutex_unlock(&pipe->lock);
+  }
+
+  /* Errors were reported through the slots */
+  pspio_error_free();
+
+  return NULL;
+}
+#endif
+
+/* State of an asynchronous read */
+struct pspio_request_s{
+  pspio_pspdata_t *pspdata;
+  int file_format;
+  char *file_name;
+  int ierr;
+  int done;
+  int interp_method;
+  int interp_defer;
+#if defined HAVE_PTHREAD
+  int threaded;
+  pthread_t worker;
+  pthread_mutex_t lock;
+#endif
+};
+
+/* Asks the kernel to start reading a file ahead of the parser */
+static void pspdata_prefetch(const char *file_name)
+{
+#if defined HAVE_POSIX_FADVISE
+  int fd;
+
+  fd = open(file_name, O_RDONLY);
+  if ( fd >= 0 ) {
+    posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+    close(fd);
+  }
+#endif
+}
+
+#if defined HAVE_PTHREAD
+static void *pspdata_request_read(void *arg)
+{
+  int ierr;
+  pspio_request_t *request = (pspio_request_t *)arg;
+
+  /* The interpolation settings are per thread: use the caller's */
+  pspio_meshfunc_default_interp(request->interp_method);
+  pspio_meshfunc_defer_interp(request->interp_defer);
+
+  ierr = pspdata_read(request->pspdata, request->file_format,
+    request->file_name, PSPIO_LOAD_ALL, 1, 0);
+
+  /* The error chain of the worker is not seen by the caller */
+  pspio_error_free();
+
+  pthread_mutex_lock(&request->lock);
+  request->ierr = ierr;
+  request->done = 1;
+  pthread_mutex_unlock(&request->lock);
+
+  return NULL;
+}
+#endif
+
 
 /**********************************************************************
  * Global routines                                                    *
@@ -44,10 +758,12 @@ int pspio_pspdata_alloc(pspio_pspdata_t **pspdata)
   /* Memory allocation */
   *pspdata = (pspio_pspdata_t *) malloc (sizeof(pspio_pspdata_t));
   FULFILL_OR_EXIT(*pspdata != NULL, PSPIO_ENOMEM);
+  INSTR_COUNT(PSPIO_COUNTER_ALLOCS);
 
   /* Nullify pointers and initialize all values to 0 */
   (*pspdata)->pspinfo = NULL;
   (*pspdata)->format_guessed = PSPIO_FMT_UNKNOWN;
+  (*pspdata)->loaded = PSPIO_LOAD_ALL;
   strcpy((*pspdata)->symbol, "");
   (*pspdata)->z = 0.0;
   (*pspdata)->zvalence = 0.0;
@@ -57,8 +773,8 @@ int pspio_pspdata_alloc(pspio_pspdata_t **pspdata)
   (*pspdata)->total_energy = 0.0;
 
   (*pspdata)->mesh = NULL;
+  (*pspdata)->np = 0;
 
-  (*pspdata)->qn_to_istate = NULL;
   (*pspdata)->n_states = 0;
   (*pspdata)->states = NULL;
 
@@ -78,119 +794,359 @@ int pspio_pspdata_alloc(pspio_pspdata_t **pspdata)
 
   (*pspdata)->rho_valence = NULL;
 
+  (*pspdata)->gth = NULL;
+
+  (*pspdata)->index = NULL;
+  (*pspdata)->hash = 0;
+
   return PSPIO_SUCCESS;
 }
 
 int pspio_pspdata_read(pspio_pspdata_t *pspdata, int file_format,
 		       const char *file_name) 
 {
-  int ierr, fmt;
+  return pspdata_read(pspdata, file_format, file_name, PSPIO_LOAD_ALL, 1, 0);
+}
+
+int pspio_pspdata_read_header(pspio_pspdata_t *pspdata, int file_format,
+                              const char *file_name)
+{
+  return pspdata_read(pspdata, file_format, file_name, 0, 0, 1);
+}
+
+int pspio_pspdata_read_select(pspio_pspdata_t *pspdata, int file_format,
+                              const char *file_name, int components)
+{
+  return pspdata_read(pspdata, file_format, file_name,
+                      components & PSPIO_LOAD_ALL, 1, 0);
+}
+
+int pspio_pspdata_read_async(pspio_pspdata_t *pspdata, int file_format,
+                             const char *file_name, pspio_request_t **request)
+{
+  pspio_request_t *req;
+
+  assert(pspdata != NULL);
+  assert(file_name != NULL);
+  assert(request != NULL);
+
+  req = (pspio_request_t *) malloc (sizeof(pspio_request_t));
+  FULFILL_OR_EXIT( req != NULL, PSPIO_ENOMEM );
+  req->file_name = (char *) malloc ((strlen(file_name)+1) * sizeof(char));
+  FULFILL_OR_EXIT( req->file_name != NULL, PSPIO_ENOMEM );
+  strcpy(req->file_name, file_name);
+  req->pspdata = pspdata;
+  req->file_format = file_format;
+  req->ierr = PSPIO_SUCCESS;
+  req->done = 0;
+  req->interp_method = pspio_meshfunc_default_interp(0);
+  pspio_meshfunc_default_interp(req->interp_method);
+  req->interp_defer = pspio_meshfunc_defer_interp(0);
+  pspio_meshfunc_defer_interp(req->interp_defer);
+  *request = req;
+
+  pspdata_prefetch(file_name);
+
+#if defined HAVE_PTHREAD
+  pthread_mutex_init(&req->lock, NULL);
+  req->threaded = (pthread_create(&req->worker, NULL, pspdata_request_read,
+    req) == 0);
+  if ( req->threaded ) return PSPIO_SUCCESS;
+#endif
+
+  /* No worker available: read now and keep the error for pspio_wait */
+  req->ierr = pspdata_read(pspdata, file_format, file_name, PSPIO_LOAD_ALL,
+    1, 0);
+  pspio_error_free();
+  req->done = 1;
+
+  return PSPIO_SUCCESS;
+}
+
+int pspio_test(pspio_request_t *request, int *done)
+{
+  assert(request != NULL);
+  assert(done != NULL);
+
+#if defined HAVE_PTHREAD
+  pthread_mutex_lock(&request->lock);
+  *done = request->done;
+  pthread_mutex_unlock(&request->lock);
+#else
+  *done = request->done;
+#endif
+
+  return PSPIO_SUCCESS;
+}
+
+int pspio_wait(pspio_request_t **request)
+{
+  int ierr;
+
+  assert(request != NULL);
+  assert(*request != NULL);
+
+#if defined HAVE_PTHREAD
+  if ( (*request)->threaded ) {
+    pthread_join((*request)->worker, NULL);
+  }
+  pthread_mutex_destroy(&(*request)->lock);
+#endif
+  ierr = (*request)->ierr;
+  free((*request)->file_name);
+  free(*request);
+  *request = NULL;
+
+  RETURN_WITH_ERROR( ierr );
+}
+
+int pspio_pspdata_write(pspio_pspdata_t *pspdata, int file_format,
+			const char *file_name) 
+{
   FILE * fp;
+  int ierr;
+  char *buffer;
+  size_t size;
+  INSTR_TIMER_DECLARE(t_write);
 
   assert(pspdata != NULL);
+  assert(file_name != NULL);
 
-  /* Stop if pspdata already contains some information */
-  assert(pspdata->format_guessed == PSPIO_FMT_UNKNOWN);
+  /* Format everything first, then write it at once */
+  INSTR_TIMER_START(t_write);
+  SUCCEED_OR_RETURN( pspdata_write(pspdata, file_format, &buffer, &size) );
 
-  /* Open file */
-  fp = fopen(file_name, "r");
-  FULFILL_OR_RETURN(fp != NULL, PSPIO_ENOFILE);
+  fp = fopen(file_name, "w");
+  if ( fp == NULL ) {
+    free(buffer);
+    RETURN_WITH_ERROR( PSPIO_ENOFILE );
+  }
+  ierr = (fwrite(buffer, 1, size, fp) == size) ? PSPIO_SUCCESS : PSPIO_EIO;
+  if ( fclose(fp) != 0 ) ierr = PSPIO_EIO;
+  free(buffer);
+  INSTR_TIMER_STOP(PSPIO_TIMER_WRITE, t_write);
 
-  /* Read from file */
-  ierr = PSPIO_ERROR;
-  for (fmt=0; fmt<PSPIO_FMT_NFORMATS; fmt++) {
-    if ( (file_format != PSPIO_FMT_UNKNOWN) && (fmt != file_format) ) {
-      continue;
-    }
-    
-    /* The error chain should be reset, as some errors might have been
-       set in the previous iteration of this loop */
-    pspio_error_free();
+  /* Make sure ierr is not silently ignored */
+  RETURN_WITH_ERROR( ierr );
+}
 
-    /* Always rewind the file to allow for multiple reads */
-    FULFILL_OR_RETURN(fp != NULL, PSPIO_ENOFILE);
-    rewind(fp);
+int pspio_pspdata_write_buffer(pspio_pspdata_t *pspdata, int file_format,
+                               char **buffer, size_t *size)
+{
+  INSTR_TIMER_DECLARE(t_write);
 
-    fflush(stdout);
-    switch (fmt) {
-    case PSPIO_FMT_ABINIT_6:
-      ierr = pspio_abinit_read(fp, pspdata, fmt);
-      break;
-    case PSPIO_FMT_FHI98PP:
-      ierr = pspio_fhi_read(fp, pspdata);
-      break;
-    case PSPIO_FMT_UPF:
-      ierr = pspio_upf_read(fp, pspdata);
-      break;
+  assert(pspdata != NULL);
+  assert(buffer != NULL);
+  assert(size != NULL);
 
-    default:
-      ierr = PSPIO_ENOSUPPORT;
-    }
+  INSTR_TIMER_START(t_write);
+  SUCCEED_OR_RETURN( pspdata_write(pspdata, file_format, buffer, size) );
+  INSTR_TIMER_STOP(PSPIO_TIMER_WRITE, t_write);
 
-    if (ierr != PSPIO_SUCCESS) pspio_pspdata_reset(pspdata);
+  return PSPIO_SUCCESS;
+}
 
-    /* Store the format */
-    if ( (ierr == PSPIO_SUCCESS) || (file_format != PSPIO_FMT_UNKNOWN) ) {
-      pspdata->format_guessed = fmt;
-      break;
+int pspio_pspdata_write_sink(pspio_pspdata_t *pspdata, int file_format,
+                             pspio_sink_t sink, void *context)
+{
+  int ierr;
+  char *buffer;
+  size_t size;
+  INSTR_TIMER_DECLARE(t_write);
+
+  assert(pspdata != NULL);
+  assert(sink != NULL);
+
+  INSTR_TIMER_START(t_write);
+  SUCCEED_OR_RETURN( pspdata_write(pspdata, file_format, &buffer, &size) );
+  ierr = sink(buffer, size, context);
+  free(buffer);
+  INSTR_TIMER_STOP(PSPIO_TIMER_WRITE, t_write);
+
+  RETURN_WITH_ERROR( ierr );
+}
+
+int pspio_pspdata_resample(pspio_pspdata_t *pspdata, const pspio_mesh_t *mesh,
+                           int method)
+{
+  int i, n, np, ierr, defer;
+  const pspio_mesh_t *fmesh;
+  const double **f = NULL;
+  double **g = NULL, *block = NULL;
+  pspio_meshfunc_t ***funcs = NULL, *func;
+  pspio_resample_t *plan = NULL;
+
+  assert(pspdata != NULL);
+  assert(mesh != NULL);
+
+  FULFILL_OR_RETURN( pspdata->mesh != NULL, PSPIO_EVALUE );
+  pspdata->hash = 0;
+  FULFILL_OR_RETURN( mesh->np > 1, PSPIO_EVALUE );
+
+  /* The derivatives are needed on the source mesh */
+  SUCCEED_OR_RETURN( pspdata_prepare(pspdata) );
+
+  /* All the functions must live on the mesh of pspdata */
+  n = pspdata_functions(pspdata, NULL);
+  if ( n > 0 ) {
+    funcs = (pspio_meshfunc_t ***) malloc (n * sizeof(pspio_meshfunc_t **));
+    FULFILL_OR_EXIT( funcs != NULL, PSPIO_ENOMEM );
+    pspdata_functions(pspdata, funcs);
+  }
+  ierr = PSPIO_SUCCESS;
+  for (i=0; (i<n) && (ierr == PSPIO_SUCCESS); i++) {
+    fmesh = (*funcs[i])->mesh;
+    if ( (fmesh->np != pspdata->mesh->np) ||
+         (memcmp(fmesh->r, pspdata->mesh->r, fmesh->np * sizeof(double)) != 0) ) {
+      ierr = PSPIO_EVALUE;
+    }
+  }
+  if ( ierr != PSPIO_SUCCESS ) {
+    free(funcs);
+    RETURN_WITH_ERROR( ierr );
+  }
+
+  /* Compute the plan once and map the values and derivatives of all
+     the functions in a single batch */
+  SUCCEED_OR_RETURN( pspio_resample_alloc(&plan) );
+  ierr = pspio_resample_init(plan, pspdata->mesh, mesh, method);
+  if ( (ierr == PSPIO_SUCCESS) && (n > 0) ) {
+    np = mesh->np;
+    f = (const double **) malloc (3 * n * sizeof(double *));
+    FULFILL_OR_EXIT( f != NULL, PSPIO_ENOMEM );
+    g = (double **) malloc (3 * n * sizeof(double *));
+    FULFILL_OR_EXIT( g != NULL, PSPIO_ENOMEM );
+    block = (double *) malloc ((size_t)3 * n * np * sizeof(double));
+    FULFILL_OR_EXIT( block != NULL, PSPIO_ENOMEM );
+    for (i=0; i<n; i++) {
+      f[3*i] = (*funcs[i])->f;
+      f[3*i+1] = (*funcs[i])->fp;
+      f[3*i+2] = (*funcs[i])->fpp;
     }
+    for (i=0; i<3*n; i++) {
+      g[i] = block + (size_t)i * np;
+    }
+    ierr = pspio_resample_apply(plan, 3*n, f, g);
   }
+  pspio_resample_free(plan);
 
+  /* Replace the functions */
+  if ( ierr == PSPIO_SUCCESS ) {
+    defer = pspio_meshfunc_defer_interp(1);
+    for (i=0; (i<n) && (ierr == PSPIO_SUCCESS); i++) {
+      func = NULL;
+      ierr = pspio_meshfunc_alloc(&func, mesh->np);
+      if ( ierr == PSPIO_SUCCESS ) {
+        ierr = pspio_meshfunc_init(func, mesh, g[3*i], g[3*i+1], g[3*i+2]);
+      }
+      if ( ierr == PSPIO_SUCCESS ) {
+        pspio_meshfunc_free(*funcs[i]);
+        *funcs[i] = func;
+      } else {
+        pspio_meshfunc_free(func);
+      }
+    }
+    pspio_meshfunc_defer_interp(defer);
+  }
   if ( ierr == PSPIO_SUCCESS ) {
+    ierr = pspio_mesh_copy(&pspdata->mesh, mesh);
   }
 
-  /* Close file */
-  FULFILL_OR_RETURN( fclose(fp) == 0, PSPIO_EIO );
+  free(block);
+  free(g);
+  free(f);
+  free(funcs);
+  SUCCEED_OR_RETURN( ierr );
 
-  /* Make sure ierr is not silently ignored */
-  FULFILL_OR_RETURN(ierr == PSPIO_SUCCESS, ierr);
+  /* Build the interpolation objects on the new mesh */
+  RETURN_WITH_ERROR( pspdata_prepare(pspdata) );
+}
 
-  /* Create states lookup table */
-  if (pspdata->n_states > 0)
-    SUCCEED_OR_RETURN( pspio_states_lookup_table(pspdata->n_states, pspdata->states, &pspdata->qn_to_istate) );
+int pspio_pspdata_convert(int src_format, const char *src_name,
+                          int dst_format, const char *dst_name)
+{
+  assert(src_name != NULL);
+  assert(dst_name != NULL);
 
-  return PSPIO_SUCCESS;
+  RETURN_WITH_ERROR( pspdata_convert(src_format, src_name, dst_format, dst_name) );
 }
 
-int pspio_pspdata_write(pspio_pspdata_t *pspdata, int file_format,
-			const char *file_name) 
+int pspio_pspdata_convert_batch(int n, int src_format,
+                                const char *const *src_names, int dst_format,
+                                const char *const *dst_names, int *status)
 {
-  FILE * fp;
-  int ierr;
-
-  assert(pspdata != NULL);
+  int i, ierr, ierr_first;
+#if defined HAVE_PTHREAD
+  int k;
+  pspio_pspdata_t *pspdata;
+  pspdata_pipeline_t pipe;
+  pthread_t reader;
+#endif
 
-  if (pspdata->qn_to_istate == NULL) {
-    SUCCEED_OR_RETURN(pspio_states_lookup_table(pspdata->n_states, pspdata->states, &pspdata->qn_to_istate));
+  assert(n >= 0);
+  assert((src_names != NULL) && (dst_names != NULL));
+
+  ierr_first = PSPIO_SUCCESS;
+
+#if defined HAVE_PTHREAD
+  pipe.n = n;
+  pipe.src_format = src_format;
+  pipe.src_names = src_names;
+  pipe.interp_method = pspio_meshfunc_default_interp(0);
+  pspio_meshfunc_default_interp(pipe.interp_method);
+  pipe.interp_defer = pspio_meshfunc_defer_interp(0);
+  pspio_meshfunc_defer_interp(pipe.interp_defer);
+  for (k=0; k<2; k++) {
+    pipe.slot[k] = NULL;
+    pipe.slot_ierr[k] = PSPIO_SUCCESS;
+    pipe.slot_full[k] = 0;
+  }
+  pthread_mutex_init(&pipe.lock, NULL);
+  pthread_cond_init(&pipe.cond, NULL);
+
+  if ( (n > 1) &&
+       (pthread_create(&reader, NULL, pspdata_pipeline_read, &pipe) == 0) ) {
+    for (i=0; i<n; i++) {
+      k = i % 2;
+
+      /* Wait for the reader to fill the slot */
+      pthread_mutex_lock(&pipe.lock);
+      while ( !pipe.slot_full[k] ) {
+        pthread_cond_wait(&pipe.cond, &pipe.lock);
+      }
+      pspdata = pipe.slot[k];
+      ierr = pipe.slot_ierr[k];
+      pthread_mutex_unlock(&pipe.lock);
+
+      if ( ierr == PSPIO_SUCCESS ) {
+        ierr = pspio_pspdata_write(pspdata, dst_format, dst_names[i]);
+      }
+      pspio_pspdata_free(pspdata);
+      if ( status != NULL ) status[i] = ierr;
+      if ( ierr_first == PSPIO_SUCCESS ) ierr_first = ierr;
+
+      pthread_mutex_lock(&pipe.lock);
+      pipe.slot[k] = NULL;
+      pipe.slot_full[k] = 0;
+      pthread_cond_broadcast(&pipe.cond);
+      pthread_mutex_unlock(&pipe.lock);
+    }
+    pthread_join(reader, NULL);
+    n = 0;
   }
 
-  /* Open file */
-  fp = fopen(file_name, "w");
-  FULFILL_OR_RETURN(fp != NULL, PSPIO_ENOFILE);
+  pthread_cond_destroy(&pipe.cond);
+  pthread_mutex_destroy(&pipe.lock);
+#endif
 
-  /* Write to file in the selected format */
-  switch(file_format) {
-    case PSPIO_FMT_ABINIT_5:
-    case PSPIO_FMT_ABINIT_6:
-      ierr = pspio_abinit_write(fp, pspdata, file_format);
-      break;
-    case PSPIO_FMT_FHI98PP:
-      ierr = pspio_fhi_write(fp, pspdata);
-      break;
-    case PSPIO_FMT_UPF:
-      ierr = pspio_upf_write(fp, pspdata);
-      break;
-    default:
-      ierr = PSPIO_EFILE_FORMAT;
+  /* Sequential conversion, when threads are not available or not needed */
+  for (i=0; i<n; i++) {
+    ierr = pspdata_convert(src_format, src_names[i], dst_format, dst_names[i]);
+    if ( status != NULL ) status[i] = ierr;
+    if ( ierr_first == PSPIO_SUCCESS ) ierr_first = ierr;
   }
-  
-  /* Close file and check for ierr being non 0 */
-  FULFILL_OR_RETURN( fclose(fp) == 0, PSPIO_EIO );
-
-  /* Make sure ierr is not silently ignored */
-  RETURN_WITH_ERROR( ierr );
 
-  return PSPIO_SUCCESS;
+  RETURN_WITH_ERROR( ierr_first );
 }
 
 void pspio_pspdata_reset(pspio_pspdata_t *pspdata)
@@ -211,21 +1167,20 @@ void pspio_pspdata_reset(pspio_pspdata_t *pspdata)
   pspdata->l_max = 0;
   pspdata->wave_eq = 0;
   pspdata->total_energy = 0.0;
+  pspdata->loaded = PSPIO_LOAD_ALL;
 
   /* Mesh */
   if (pspdata->mesh != NULL) {
     pspio_mesh_free(pspdata->mesh);
     pspdata->mesh = NULL;
   }
+  pspdata->np = 0;
   
+  /* Lookup index and hash */
+  pspdata_index_free(pspdata);
+  pspdata->hash = 0;
+
   /* States */
-  if (pspdata->qn_to_istate != NULL) {
-    for (i=0; pspdata->qn_to_istate[i]!=NULL; i++) {
-      free(pspdata->qn_to_istate[i]);
-    }
-    free(pspdata->qn_to_istate);
-    pspdata->qn_to_istate = NULL;
-  }
   if (pspdata->states != NULL) {
     for (i=0; i<pspdata->n_states; i++) {
       pspio_state_free(pspdata->states[i]);
@@ -261,6 +1216,7 @@ void pspio_pspdata_reset(pspio_pspdata_t *pspdata)
   pspdata->n_projectors = 0;
   if (pspdata->n_projectors_per_l != NULL) {
     free(pspdata->n_projectors_per_l);
+    pspdata->n_projectors_per_l = NULL;
   }
   pspdata->l_local = 0;
   pspdata->projectors_l_max = 0;
@@ -280,6 +1236,12 @@ void pspio_pspdata_reset(pspio_pspdata_t *pspdata)
     pspio_meshfunc_free(pspdata->rho_valence);
     pspdata->rho_valence = NULL;
   }
+
+  /* Analytic parameters */
+  if (pspdata->gth != NULL) {
+    pspio_gth_free(pspdata->gth);
+    pspdata->gth = NULL;
+  }
 }
 
 void pspio_pspdata_free(pspio_pspdata_t *pspdata)
@@ -298,6 +1260,7 @@ void pspio_pspdata_free(pspio_pspdata_t *pspdata)
 int pspio_pspdata_set_pspinfo(pspio_pspdata_t *pspdata, const pspio_pspinfo_t *pspinfo)
 {
   assert(pspdata != NULL);
+  pspdata->hash = 0;
 
   SUCCEED_OR_RETURN(pspio_pspinfo_copy(&pspdata->pspinfo, pspinfo));
 
@@ -307,6 +1270,7 @@ int pspio_pspdata_set_pspinfo(pspio_pspdata_t *pspdata, const pspio_pspinfo_t *p
 int pspio_pspdata_set_symbol(pspio_pspdata_t *pspdata, const char symbol[])
 {
   assert(pspdata != NULL);
+  pspdata->hash = 0;
 
   if (strlen(symbol) >= 4)
     return PSPIO_STRLEN_ERROR;
@@ -319,6 +1283,7 @@ int pspio_pspdata_set_symbol(pspio_pspdata_t *pspdata, const char symbol[])
 int pspio_pspdata_set_z(pspio_pspdata_t *pspdata, double z)
 {
   assert(pspdata != NULL);
+  pspdata->hash = 0;
 
   pspdata->z = z;
 
@@ -328,6 +1293,7 @@ int pspio_pspdata_set_z(pspio_pspdata_t *pspdata, double z)
 int pspio_pspdata_set_zvalence(pspio_pspdata_t *pspdata, double zvalence)
 {
   assert(pspdata != NULL);
+  pspdata->hash = 0;
 
   pspdata->zvalence = zvalence;
 
@@ -337,6 +1303,7 @@ int pspio_pspdata_set_zvalence(pspio_pspdata_t *pspdata, double zvalence)
 int pspio_pspdata_set_nelvalence(pspio_pspdata_t *pspdata, double nelvalence)
 {
   assert(pspdata != NULL);
+  pspdata->hash = 0;
 
   pspdata->nelvalence = nelvalence;
 
@@ -346,6 +1313,7 @@ int pspio_pspdata_set_nelvalence(pspio_pspdata_t *pspdata, double nelvalence)
 int pspio_pspdata_set_l_max(pspio_pspdata_t *pspdata, int l_max)
 {
   assert(pspdata != NULL);
+  pspdata->hash = 0;
 
   pspdata->l_max = l_max;
 
@@ -355,6 +1323,7 @@ int pspio_pspdata_set_l_max(pspio_pspdata_t *pspdata, int l_max)
 int pspio_pspdata_set_wave_eq(pspio_pspdata_t *pspdata, int wave_eq)
 {
   assert(pspdata != NULL);
+  pspdata->hash = 0;
 
   pspdata->wave_eq = wave_eq;
 
@@ -364,6 +1333,7 @@ int pspio_pspdata_set_wave_eq(pspio_pspdata_t *pspdata, int wave_eq)
 int pspio_pspdata_set_total_energy(pspio_pspdata_t *pspdata, double total_energy)
 {
   assert(pspdata != NULL);
+  pspdata->hash = 0;
 
   pspdata->total_energy = total_energy;
 
@@ -373,6 +1343,7 @@ int pspio_pspdata_set_total_energy(pspio_pspdata_t *pspdata, double total_energy
 int pspio_pspdata_set_mesh(pspio_pspdata_t *pspdata, const pspio_mesh_t *mesh)
 {
   assert(pspdata != NULL);
+  pspdata->hash = 0;
 
   SUCCEED_OR_RETURN(pspio_mesh_copy(&pspdata->mesh, mesh));
 
@@ -384,6 +1355,7 @@ int pspio_pspdata_set_n_states(pspio_pspdata_t *pspdata, int n_states)
   int is;
 
   assert(pspdata != NULL);
+  pspdata->hash = 0;
 
   if (pspdata->n_states >= 0) {
     for (is=0; is<pspdata->n_states; is++) {
@@ -392,6 +1364,7 @@ int pspio_pspdata_set_n_states(pspio_pspdata_t *pspdata, int n_states)
     free(pspdata->states);
   }
 
+  pspdata_index_free(pspdata);
   pspdata->n_states = n_states;
 
   pspdata->states = (pspio_state_t **) malloc ( pspdata->n_states*sizeof(pspio_state_t *));
@@ -406,7 +1379,9 @@ int pspio_pspdata_set_n_states(pspio_pspdata_t *pspdata, int n_states)
 int pspio_pspdata_set_state(pspio_pspdata_t *pspdata, int index, const pspio_state_t *state)
 {
   assert(pspdata != NULL);
+  pspdata->hash = 0;
 
+  pspdata_index_free(pspdata);
   SUCCEED_OR_RETURN( pspio_state_copy(&(pspdata->states[index]), state) )
 
   return PSPIO_SUCCESS;
@@ -415,6 +1390,7 @@ int pspio_pspdata_set_state(pspio_pspdata_t *pspdata, int index, const pspio_sta
 int pspio_pspdata_set_scheme(pspio_pspdata_t *pspdata, int scheme)
 {
   assert(pspdata != NULL);
+  pspdata->hash = 0;
 
   pspdata->scheme = scheme;
 
@@ -426,6 +1402,7 @@ int pspio_pspdata_set_n_potentials(pspio_pspdata_t *pspdata, int n_potentials)
   int ip;
 
   assert(pspdata != NULL);
+  pspdata->hash = 0;
 
   if (pspdata->n_potentials >= 0) {
     for (ip=0; ip<pspdata->n_potentials; ip++) {
@@ -434,6 +1411,7 @@ int pspio_pspdata_set_n_potentials(pspio_pspdata_t *pspdata, int n_potentials)
     free(pspdata->potentials);
   }
 
+  pspdata_index_free(pspdata);
   pspdata->n_potentials = n_potentials;
 
   pspdata->potentials = (pspio_potential_t **) malloc ( pspdata->n_potentials*sizeof(pspio_potential_t *));
@@ -448,7 +1426,9 @@ int pspio_pspdata_set_n_potentials(pspio_pspdata_t *pspdata, int n_potentials)
 int pspio_pspdata_set_potential(pspio_pspdata_t *pspdata, int index, const pspio_potential_t *potential)
 {
   assert(pspdata != NULL);
+  pspdata->hash = 0;
 
+  pspdata_index_free(pspdata);
   SUCCEED_OR_RETURN( pspio_potential_copy(&(pspdata->potentials[index]),
                                           potential) )
 
@@ -460,6 +1440,7 @@ int pspio_pspdata_set_n_projectors(pspio_pspdata_t *pspdata, int n_projectors)
   int ip;
 
   assert(pspdata != NULL);
+  pspdata->hash = 0;
 
   if (pspdata->n_projectors >= 0) {
     for (ip=0; ip<pspdata->n_projectors; ip++) {
@@ -469,6 +1450,7 @@ int pspio_pspdata_set_n_projectors(pspio_pspdata_t *pspdata, int n_projectors)
     free(pspdata->projector_energies);
   }
 
+  pspdata_index_free(pspdata);
   pspdata->n_projectors = n_projectors;
 
   pspdata->projectors = (pspio_projector_t **) malloc ( pspdata->n_projectors*sizeof(pspio_projector_t *));
@@ -486,11 +1468,14 @@ int pspio_pspdata_set_n_projectors(pspio_pspdata_t *pspdata, int n_projectors)
 int pspio_pspdata_set_n_projectors_per_l(pspio_pspdata_t *pspdata, int *n_ppl)
 {
   assert(pspdata != NULL);
+  pspdata->hash = 0;
   assert(pspdata->n_projectors_per_l == NULL);
 
+  /* Without explicit counts, the getter relies on the index */
   if ( n_ppl == NULL ) {
-    pspdata->n_projectors_per_l = pspio_projectors_per_l(pspdata->projectors,
-      pspdata->n_projectors);
+    if ( pspdata->index == NULL ) {
+      SUCCEED_OR_RETURN( pspio_pspdata_build_index(pspdata) );
+    }
   } else {
     pspdata->n_projectors_per_l = n_ppl;
   }
@@ -501,8 +1486,10 @@ int pspio_pspdata_set_n_projectors_per_l(pspio_pspdata_t *pspdata, int *n_ppl)
 int pspio_pspdata_set_projector(pspio_pspdata_t *pspdata, int index, const pspio_projector_t *projector)
 {
   assert(pspdata != NULL);
+  pspdata->hash = 0;
   assert(index >= 0 && index < pspdata->n_projectors);
 
+  pspdata_index_free(pspdata);
   SUCCEED_OR_RETURN( pspio_projector_copy(&(pspdata->projectors[index]), projector) )
 
   return PSPIO_SUCCESS;
@@ -511,6 +1498,7 @@ int pspio_pspdata_set_projector(pspio_pspdata_t *pspdata, int index, const pspio
 int pspio_pspdata_set_projectors_l_max(pspio_pspdata_t *pspdata, int l_max)
 {
   assert(pspdata != NULL);
+  pspdata->hash = 0;
 
   pspdata->projectors_l_max = l_max;
 
@@ -520,6 +1508,7 @@ int pspio_pspdata_set_projectors_l_max(pspio_pspdata_t *pspdata, int l_max)
 int pspio_pspdata_set_l_local(pspio_pspdata_t *pspdata, int l_local)
 {
   assert(pspdata != NULL);
+  pspdata->hash = 0;
 
   pspdata->l_local = l_local;
 
@@ -529,6 +1518,7 @@ int pspio_pspdata_set_l_local(pspio_pspdata_t *pspdata, int l_local)
 int pspio_pspdata_set_vlocal(pspio_pspdata_t *pspdata, const pspio_potential_t *vlocal)
 {
   assert(pspdata != NULL);
+  pspdata->hash = 0;
 
   SUCCEED_OR_RETURN( pspio_potential_copy(&(pspdata->vlocal), vlocal) )
 
@@ -538,6 +1528,7 @@ int pspio_pspdata_set_vlocal(pspio_pspdata_t *pspdata, const pspio_potential_t *
 int pspio_pspdata_set_xc(pspio_pspdata_t *pspdata, const pspio_xc_t *xc)
 {
   assert(pspdata != NULL);
+  pspdata->hash = 0;
 
   SUCCEED_OR_RETURN( pspio_xc_copy(&(pspdata->xc), xc) );
 
@@ -547,6 +1538,7 @@ int pspio_pspdata_set_xc(pspio_pspdata_t *pspdata, const pspio_xc_t *xc)
 int pspio_pspdata_set_rho_valence(pspio_pspdata_t *pspdata, const pspio_meshfunc_t *rho_valence)
 {
   assert(pspdata != NULL);
+  pspdata->hash = 0;
 
   SUCCEED_OR_RETURN( pspio_meshfunc_copy(&(pspdata->rho_valence), rho_valence) )
 
@@ -559,6 +1551,7 @@ int pspio_pspdata_set_projector_energies(pspio_pspdata_t *pspdata,
   int i, j;
 
   assert(pspdata != NULL);
+  pspdata->hash = 0;
   assert(pspdata->projector_energies != NULL && energies != NULL);
 
   for (i = 0; i < pspdata->n_projectors; i++) {
@@ -578,6 +1571,176 @@ int pspio_pspdata_set_projector_energies(pspio_pspdata_t *pspdata,
   return PSPIO_SUCCESS;
 }
 
+int pspio_pspdata_set_gth(pspio_pspdata_t *pspdata, const pspio_gth_t *gth)
+{
+  int l, i, j, ip, n, n_proj;
+  double *energies;
+  pspio_qn_t *qn = NULL;
+  pspio_gth_term_t term;
+  pspio_potential_t *vlocal = NULL;
+  pspio_projector_t *projector = NULL;
+
+  assert(pspdata != NULL);
+  assert(gth != NULL);
+  pspdata->hash = 0;
+
+  FULFILL_OR_RETURN( pspdata->mesh == NULL, PSPIO_EVALUE );
+  SUCCEED_OR_RETURN( pspio_gth_copy(&pspdata->gth, gth) );
+  SUCCEED_OR_RETURN( pspio_qn_alloc(&qn) );
+
+  /* The local potential is not one of the channels */
+  pspdata->l_local = -1;
+  if ( pspdata->loaded & PSPIO_LOAD_VLOCAL ) {
+    SUCCEED_OR_RETURN( pspio_gth_term_local(gth, &term) );
+    SUCCEED_OR_RETURN( pspio_qn_init(qn, 0, -1, 0.0) );
+    SUCCEED_OR_RETURN( pspio_potential_alloc_analytic(&vlocal) );
+    SUCCEED_OR_RETURN( pspio_potential_init_analytic(vlocal, qn, &term) );
+    SUCCEED_OR_RETURN( pspio_pspdata_take_vlocal(pspdata, &vlocal) );
+  }
+
+  /* Projectors, with h as block-diagonal energy matrix */
+  n_proj = 0;
+  for (l=0; l<=gth->l_max; l++) {
+    n_proj += gth->n_proj[l];
+  }
+  if ( gth->l_max >= 0 ) pspdata->projectors_l_max = gth->l_max;
+  if ( n_proj > 0 ) {
+    SUCCEED_OR_RETURN( pspio_pspdata_set_n_projectors(pspdata, n_proj) );
+  }
+  if ( (n_proj > 0) && (pspdata->loaded & PSPIO_LOAD_PROJECTORS) ) {
+    energies = (double *) calloc (n_proj*n_proj, sizeof(double));
+    FULFILL_OR_EXIT( energies != NULL, PSPIO_ENOMEM );
+    ip = 0;
+    for (l=0; l<=gth->l_max; l++) {
+      n = gth->n_proj[l];
+      for (i=0; i<n; i++) {
+        SUCCEED_OR_RETURN( pspio_gth_term_projector(gth, l, i, &term) );
+        SUCCEED_OR_RETURN( pspio_qn_init(qn, i+1, l, 0.0) );
+        SUCCEED_OR_RETURN( pspio_projector_alloc_analytic(&projector) );
+        SUCCEED_OR_RETURN( pspio_projector_init_analytic(projector, qn, &term) );
+        SUCCEED_OR_RETURN( pspio_pspdata_take_projector(pspdata, ip+i, &projector) );
+        for (j=0; j<n; j++) {
+          energies[(ip+i)*n_proj + ip+j] = gth->h[l][i][j];
+        }
+      }
+      ip += n;
+    }
+    SUCCEED_OR_RETURN( pspio_pspdata_set_projector_energies(pspdata, energies) );
+    free(energies);
+  }
+  pspio_qn_free(qn);
+
+  return PSPIO_SUCCESS;
+}
+
+int pspio_pspdata_take_state(pspio_pspdata_t *pspdata, int index, pspio_state_t **state)
+{
+  assert(pspdata != NULL);
+  assert(index >= 0 && index < pspdata->n_states);
+  assert(state != NULL && *state != NULL);
+  if ( pspdata->states[index] == *state ) {
+    *state = NULL;
+    return PSPIO_SUCCESS;
+  }
+  pspdata->hash = 0;
+
+  pspdata_index_free(pspdata);
+  pspio_state_free(pspdata->states[index]);
+  pspdata->states[index] = *state;
+  *state = NULL;
+
+  return PSPIO_SUCCESS;
+}
+
+int pspio_pspdata_take_potential(pspio_pspdata_t *pspdata, int index, pspio_potential_t **potential)
+{
+  assert(pspdata != NULL);
+  assert(index >= 0 && index < pspdata->n_potentials);
+  assert(potential != NULL && *potential != NULL);
+  if ( pspdata->potentials[index] == *potential ) {
+    *potential = NULL;
+    return PSPIO_SUCCESS;
+  }
+  pspdata->hash = 0;
+
+  pspdata_index_free(pspdata);
+  pspio_potential_free(pspdata->potentials[index]);
+  pspdata->potentials[index] = *potential;
+  *potential = NULL;
+
+  return PSPIO_SUCCESS;
+}
+
+int pspio_pspdata_take_projector(pspio_pspdata_t *pspdata, int index, pspio_projector_t **projector)
+{
+  assert(pspdata != NULL);
+  assert(index >= 0 && index < pspdata->n_projectors);
+  assert(projector != NULL && *projector != NULL);
+  if ( pspdata->projectors[index] == *projector ) {
+    *projector = NULL;
+    return PSPIO_SUCCESS;
+  }
+  pspdata->hash = 0;
+
+  pspdata_index_free(pspdata);
+  pspio_projector_free(pspdata->projectors[index]);
+  pspdata->projectors[index] = *projector;
+  *projector = NULL;
+
+  return PSPIO_SUCCESS;
+}
+
+int pspio_pspdata_take_vlocal(pspio_pspdata_t *pspdata, pspio_potential_t **vlocal)
+{
+  assert(pspdata != NULL);
+  assert(vlocal != NULL && *vlocal != NULL);
+  if ( pspdata->vlocal == *vlocal ) {
+    *vlocal = NULL;
+    return PSPIO_SUCCESS;
+  }
+  pspdata->hash = 0;
+
+  pspio_potential_free(pspdata->vlocal);
+  pspdata->vlocal = *vlocal;
+  *vlocal = NULL;
+
+  return PSPIO_SUCCESS;
+}
+
+int pspio_pspdata_take_xc(pspio_pspdata_t *pspdata, pspio_xc_t **xc)
+{
+  assert(pspdata != NULL);
+  assert(xc != NULL && *xc != NULL);
+  if ( pspdata->xc == *xc ) {
+    *xc = NULL;
+    return PSPIO_SUCCESS;
+  }
+  pspdata->hash = 0;
+
+  pspio_xc_free(pspdata->xc);
+  pspdata->xc = *xc;
+  *xc = NULL;
+
+  return PSPIO_SUCCESS;
+}
+
+int pspio_pspdata_take_rho_valence(pspio_pspdata_t *pspdata, pspio_meshfunc_t **rho_valence)
+{
+  assert(pspdata != NULL);
+  assert(rho_valence != NULL && *rho_valence != NULL);
+  if ( pspdata->rho_valence == *rho_valence ) {
+    *rho_valence = NULL;
+    return PSPIO_SUCCESS;
+  }
+  pspdata->hash = 0;
+
+  pspio_meshfunc_free(pspdata->rho_valence);
+  pspdata->rho_valence = *rho_valence;
+  *rho_valence = NULL;
+
+  return PSPIO_SUCCESS;
+}
+
 
 /**********************************************************************
  * Getters                                                            *
@@ -590,6 +1753,13 @@ int pspio_pspdata_get_format_guessed(const pspio_pspdata_t *pspdata)
   return pspdata->format_guessed;
 }
 
+int pspio_pspdata_get_loaded(const pspio_pspdata_t *pspdata)
+{
+  assert(pspdata != NULL);
+
+  return pspdata->loaded;
+}
+
 const pspio_pspinfo_t * pspio_pspdata_get_pspinfo(const pspio_pspdata_t *pspdata)
 {
   assert(pspdata != NULL);
@@ -653,6 +1823,13 @@ const pspio_mesh_t * pspio_pspdata_get_mesh(const pspio_pspdata_t *pspdata)
   return pspdata->mesh;
 }
 
+int pspio_pspdata_get_np(const pspio_pspdata_t *pspdata)
+{
+  assert(pspdata != NULL);
+
+  return (pspdata->mesh != NULL) ? pspdata->mesh->np : pspdata->np;
+}
+
 int pspio_pspdata_get_n_states(const pspio_pspdata_t *pspdata)
 {
   assert(pspdata != NULL);
@@ -701,6 +1878,11 @@ int * pspio_pspdata_get_n_projectors_per_l(const pspio_pspdata_t *pspdata)
 {
   assert(pspdata != NULL);
 
+  if ( (pspdata->n_projectors_per_l == NULL) &&
+       (pspdata_index_ensure(pspdata) != NULL) ) {
+    return pspdata->index->proj_per_l;
+  }
+
   return pspdata->n_projectors_per_l;
 }
 
@@ -756,3 +1938,408 @@ double pspio_pspdata_get_projector_energy(const pspio_pspdata_t *pspdata,
 
   return pspdata->projector_energies[i * pspdata->n_projectors + j];
 }
+
+
+const pspio_gth_t * pspio_pspdata_get_gth(const pspio_pspdata_t *pspdata)
+{
+  assert(pspdata != NULL);
+
+  return pspdata->gth;
+}
+
+
+/**********************************************************************
+ * Utility routines                                                   *
+ **********************************************************************/
+
+int pspio_pspdata_build_index(pspio_pspdata_t *pspdata)
+{
+  int i, l, ch, n_ch, n_ppl, size;
+  const pspio_qn_t *qn;
+  pspio_pspdata_index_t *index;
+
+  assert(pspdata != NULL);
+
+  pspdata_index_free(pspdata);
+
+  /* All the objects of the loaded components must be set, the others
+     are left out of the index */
+  for (i=0; i<pspdata->n_states; i++) {
+    FULFILL_OR_RETURN( (pspdata->states[i] != NULL) ||
+      !(pspdata->loaded & PSPIO_LOAD_STATES), PSPIO_EVALUE );
+  }
+  for (i=0; i<pspdata->n_potentials; i++) {
+    FULFILL_OR_RETURN( (pspdata->potentials[i] != NULL) ||
+      !(pspdata->loaded & PSPIO_LOAD_POTENTIALS), PSPIO_EVALUE );
+  }
+  for (i=0; i<pspdata->n_projectors; i++) {
+    FULFILL_OR_RETURN( (pspdata->projectors[i] != NULL) ||
+      !(pspdata->loaded & PSPIO_LOAD_PROJECTORS), PSPIO_EVALUE );
+  }
+
+  index = (pspio_pspdata_index_t *) malloc (sizeof(pspio_pspdata_index_t));
+  FULFILL_OR_EXIT( index != NULL, PSPIO_ENOMEM );
+
+  /* Dimensions, checking the quantum numbers on the way */
+  index->n_max = 0;
+  index->l_max = 0;
+  for (i=0; i<pspdata->n_states; i++) {
+    if ( pspdata->states[i] == NULL ) continue;
+    qn = pspdata->states[i]->qn;
+    if ( (qn->n < 0) || (pspdata_index_channel(qn->l, qn->j) < 0) ) {
+      free(index);
+      RETURN_WITH_ERROR( PSPIO_EVALUE );
+    }
+    if ( qn->n > index->n_max ) index->n_max = qn->n;
+    if ( qn->l > index->l_max ) index->l_max = qn->l;
+  }
+  for (i=0; i<pspdata->n_potentials; i++) {
+    if ( pspdata->potentials[i] == NULL ) continue;
+    qn = pspdata->potentials[i]->qn;
+    if ( pspdata_index_channel(qn->l, qn->j) < 0 ) {
+      free(index);
+      RETURN_WITH_ERROR( PSPIO_EVALUE );
+    }
+    if ( qn->l > index->l_max ) index->l_max = qn->l;
+  }
+  for (i=0; i<pspdata->n_projectors; i++) {
+    if ( pspdata->projectors[i] == NULL ) continue;
+    qn = pspdata->projectors[i]->qn;
+    if ( pspdata_index_channel(qn->l, qn->j) < 0 ) {
+      free(index);
+      RETURN_WITH_ERROR( PSPIO_EVALUE );
+    }
+    if ( qn->l > index->l_max ) index->l_max = qn->l;
+  }
+  n_ch = 3*(index->l_max + 1);
+  n_ppl = (index->l_max < 6) ? 6 : index->l_max + 1;
+
+  /* Single block for all the arrays */
+  size = (index->n_max + 1)*n_ch + n_ch + (n_ch + 1) +
+    pspdata->n_projectors + n_ppl;
+  index->block = (int *) malloc (size * sizeof(int));
+  FULFILL_OR_EXIT( index->block != NULL, PSPIO_ENOMEM );
+  index->states = index->block;
+  index->potentials = index->states + (index->n_max + 1)*n_ch;
+  index->proj_start = index->potentials + n_ch;
+  index->proj_order = index->proj_start + n_ch + 1;
+  index->proj_per_l = index->proj_order + pspdata->n_projectors;
+
+  /* States and potentials */
+  for (i=0; i<(index->n_max + 1)*n_ch + n_ch; i++) {
+    index->states[i] = -1;
+  }
+  for (i=0; i<pspdata->n_states; i++) {
+    if ( pspdata->states[i] == NULL ) continue;
+    qn = pspdata->states[i]->qn;
+    index->states[qn->n*n_ch + pspdata_index_channel(qn->l, qn->j)] = i;
+  }
+  for (i=0; i<pspdata->n_potentials; i++) {
+    if ( pspdata->potentials[i] == NULL ) continue;
+    qn = pspdata->potentials[i]->qn;
+    index->potentials[pspdata_index_channel(qn->l, qn->j)] = i;
+  }
+
+  /* Projectors, sorted by channel with a counting sort */
+  for (ch=0; ch<=n_ch; ch++) {
+    index->proj_start[ch] = 0;
+  }
+  for (i=0; i<pspdata->n_projectors; i++) {
+    if ( pspdata->projectors[i] == NULL ) continue;
+    qn = pspdata->projectors[i]->qn;
+    index->proj_start[pspdata_index_channel(qn->l, qn->j) + 1]++;
+  }
+  for (ch=0; ch<n_ch; ch++) {
+    index->proj_start[ch+1] += index->proj_start[ch];
+  }
+  for (i=0; i<pspdata->n_projectors; i++) {
+    if ( pspdata->projectors[i] == NULL ) continue;
+    qn = pspdata->projectors[i]->qn;
+    ch = pspdata_index_channel(qn->l, qn->j);
+    index->proj_order[index->proj_start[ch]++] = i;
+  }
+  for (ch=n_ch; ch>0; ch--) {
+    index->proj_start[ch] = index->proj_start[ch-1];
+  }
+  index->proj_start[0] = 0;
+  for (l=0; l<n_ppl; l++) {
+    index->proj_per_l[l] = (l <= index->l_max) ?
+      index->proj_start[3*l+3] - index->proj_start[3*l] : 0;
+  }
+
+  pspdata->index = index;
+
+  return PSPIO_SUCCESS;
+}
+
+int pspio_pspdata_find_state(const pspio_pspdata_t *pspdata, int n, int l,
+                             double j)
+{
+  int ch;
+  const pspio_pspdata_index_t *index;
+
+  assert(pspdata != NULL);
+
+  index = pspdata_index_ensure(pspdata);
+  ch = pspdata_index_channel(l, j);
+  if ( (index == NULL) || (ch < 0) || (l > index->l_max) ||
+       (n < 0) || (n > index->n_max) ) {
+    return -1;
+  }
+
+  return index->states[n*3*(index->l_max + 1) + ch];
+}
+
+int pspio_pspdata_find_potential(const pspio_pspdata_t *pspdata, int l,
+                                 double j)
+{
+  int ch;
+  const pspio_pspdata_index_t *index;
+
+  assert(pspdata != NULL);
+
+  index = pspdata_index_ensure(pspdata);
+  ch = pspdata_index_channel(l, j);
+  if ( (index == NULL) || (ch < 0) || (l > index->l_max) ) {
+    return -1;
+  }
+
+  return index->potentials[ch];
+}
+
+int pspio_pspdata_find_projectors(const pspio_pspdata_t *pspdata, int l,
+                                  double j, const int **indices)
+{
+  int ch;
+  const pspio_pspdata_index_t *index;
+
+  assert(pspdata != NULL);
+  assert(indices != NULL);
+
+  index = pspdata_index_ensure(pspdata);
+  if ( index == NULL ) {
+    *indices = NULL;
+    return 0;
+  }
+  ch = pspdata_index_channel(l, j);
+  if ( (ch < 0) || (l > index->l_max) ) {
+    *indices = index->proj_order;
+    return 0;
+  }
+
+  *indices = index->proj_order + index->proj_start[ch];
+  return index->proj_start[ch+1] - index->proj_start[ch];
+}
+
+int pspio_pspdata_find_projectors_l(const pspio_pspdata_t *pspdata, int l,
+                                    const int **indices)
+{
+  const pspio_pspdata_index_t *index;
+
+  assert(pspdata != NULL);
+
+  index = pspdata_index_ensure(pspdata);
+  if ( index == NULL ) {
+    if ( indices != NULL ) *indices = NULL;
+    return 0;
+  }
+  if ( (l < 0) || (l > index->l_max) ) {
+    if ( indices != NULL ) *indices = index->proj_order;
+    return 0;
+  }
+
+  if ( indices != NULL ) *indices = index->proj_order + index->proj_start[3*l];
+  return index->proj_start[3*l+3] - index->proj_start[3*l];
+}
+
+uint64_t pspio_pspdata_hash(pspio_pspdata_t *pspdata)
+{
+  assert(pspdata != NULL);
+
+  if ( pspdata->hash == 0 ) {
+    pspdata->hash = pspdata_hash_compute(pspdata);
+  }
+
+  return pspdata->hash;
+}
+
+int pspio_pspdata_cmp(const pspio_pspdata_t *pspdata1,
+                      const pspio_pspdata_t *pspdata2, double tol)
+{
+  int i, n, eq;
+  const pspio_state_t *s1, *s2;
+  const pspio_projector_t *p1, *p2;
+  const pspio_xc_t *xc1, *xc2;
+
+  assert(pspdata1 != NULL);
+  assert(pspdata2 != NULL);
+  assert(tol >= 0.0);
+
+  if ( pspdata1 == pspdata2 ) return PSPIO_EQUAL;
+
+  /* Identical contents have identical hashes */
+  if ( (tol == 0.0) && (pspdata1->hash != 0) && (pspdata2->hash != 0) &&
+       (pspdata1->hash != pspdata2->hash) ) {
+    return PSPIO_DIFF;
+  }
+
+  /* General data */
+  eq = pspdata_cmp_string(pspdata1->symbol, pspdata2->symbol) &&
+    pspdata_cmp_double(pspdata1->z, pspdata2->z, tol) &&
+    pspdata_cmp_double(pspdata1->zvalence, pspdata2->zvalence, tol) &&
+    pspdata_cmp_double(pspdata1->nelvalence, pspdata2->nelvalence, tol) &&
+    (pspdata1->l_max == pspdata2->l_max) &&
+    (pspdata1->wave_eq == pspdata2->wave_eq) &&
+    pspdata_cmp_double(pspdata1->total_energy, pspdata2->total_energy, tol) &&
+    pspdata_cmp_mesh(pspdata1->mesh, pspdata2->mesh, tol) &&
+    (pspdata1->n_states == pspdata2->n_states) &&
+    (pspdata1->scheme == pspdata2->scheme) &&
+    (pspdata1->n_potentials == pspdata2->n_potentials) &&
+    (pspdata1->n_projectors == pspdata2->n_projectors) &&
+    (pspdata1->projectors_l_max == pspdata2->projectors_l_max) &&
+    (pspdata1->l_local == pspdata2->l_local);
+  if ( !eq ) return PSPIO_DIFF;
+
+  /* States */
+  for (i=0; (i<pspdata1->n_states) && eq; i++) {
+    s1 = pspdata1->states[i];
+    s2 = pspdata2->states[i];
+    if ( (s1 == NULL) || (s2 == NULL) ) {
+      eq = s1 == s2;
+      continue;
+    }
+    eq = pspdata_cmp_qn(s1->qn, s2->qn) &&
+      pspdata_cmp_double(s1->occ, s2->occ, tol) &&
+      pspdata_cmp_double(s1->eigenval, s2->eigenval, tol) &&
+      pspdata_cmp_string(s1->label, s2->label) &&
+      pspdata_cmp_double(s1->rc, s2->rc, tol) &&
+      pspdata_cmp_meshfunc(s1->wf, s2->wf, tol);
+  }
+
+  /* Potentials */
+  for (i=0; (i<pspdata1->n_potentials) && eq; i++) {
+    if ( (pspdata1->potentials[i] == NULL) || (pspdata2->potentials[i] == NULL) ) {
+      eq = pspdata1->potentials[i] == pspdata2->potentials[i];
+      continue;
+    }
+    eq = pspdata_cmp_qn(pspdata1->potentials[i]->qn, pspdata2->potentials[i]->qn) &&
+      pspdata_cmp_meshfunc(pspdata1->potentials[i]->v, pspdata2->potentials[i]->v, tol);
+  }
+  if ( eq && ((pspdata1->vlocal == NULL) || (pspdata2->vlocal == NULL)) ) {
+    eq = pspdata1->vlocal == pspdata2->vlocal;
+  } else if ( eq ) {
+    eq = pspdata_cmp_meshfunc(pspdata1->vlocal->v, pspdata2->vlocal->v, tol);
+  }
+
+  /* Projectors */
+  for (i=0; (i<pspdata1->n_projectors) && eq; i++) {
+    p1 = pspdata1->projectors[i];
+    p2 = pspdata2->projectors[i];
+    if ( (p1 == NULL) || (p2 == NULL) ) {
+      eq = p1 == p2;
+      continue;
+    }
+    eq = pspdata_cmp_qn(p1->qn, p2->qn) &&
+      pspdata_cmp_double(p1->energy, p2->energy, tol) &&
+      pspdata_cmp_meshfunc(p1->proj, p2->proj, tol);
+  }
+  n = pspdata1->n_projectors*pspdata1->n_projectors;
+  if ( eq && ((pspdata1->projector_energies == NULL) ||
+              (pspdata2->projector_energies == NULL)) ) {
+    eq = (pspdata1->projector_energies == NULL) &&
+      (pspdata2->projector_energies == NULL);
+  } else if ( eq ) {
+    eq = pspdata_cmp_doubles(n, pspdata1->projector_energies,
+      pspdata2->projector_energies, tol);
+  }
+
+  /* XC and valence density */
+  xc1 = pspdata1->xc;
+  xc2 = pspdata2->xc;
+  if ( eq && ((xc1 == NULL) || (xc2 == NULL)) ) {
+    eq = xc1 == xc2;
+  } else if ( eq ) {
+    eq = (xc1->exchange == xc2->exchange) &&
+      (xc1->correlation == xc2->correlation) &&
+      (xc1->nlcc_scheme == xc2->nlcc_scheme) &&
+      pspdata_cmp_double(xc1->nlcc_pf_scale, xc2->nlcc_pf_scale, tol) &&
+      pspdata_cmp_double(xc1->nlcc_pf_value, xc2->nlcc_pf_value, tol) &&
+      pspdata_cmp_meshfunc(xc1->nlcc_dens, xc2->nlcc_dens, tol);
+  }
+  eq = eq && pspdata_cmp_meshfunc(pspdata1->rho_valence, pspdata2->rho_valence, tol);
+
+  /* Analytic parameters */
+  if ( eq && ((pspdata1->gth == NULL) || (pspdata2->gth == NULL)) ) {
+    eq = pspdata1->gth == pspdata2->gth;
+  } else if ( eq ) {
+    eq = pspdata_cmp_double(pspdata1->gth->zion, pspdata2->gth->zion, tol) &&
+      pspdata_cmp_double(pspdata1->gth->rloc, pspdata2->gth->rloc, tol) &&
+      pspdata_cmp_doubles(4, pspdata1->gth->c, pspdata2->gth->c, tol) &&
+      (memcmp(pspdata1->gth->n_proj, pspdata2->gth->n_proj,
+              sizeof(pspdata1->gth->n_proj)) == 0) &&
+      pspdata_cmp_doubles(PSPIO_GTH_L_MAX+1, pspdata1->gth->r, pspdata2->gth->r, tol) &&
+      pspdata_cmp_doubles((PSPIO_GTH_L_MAX+1)*PSPIO_GTH_N_PROJ*PSPIO_GTH_N_PROJ,
+        &pspdata1->gth->h[0][0][0], &pspdata2->gth->h[0][0][0], tol) &&
+      pspdata_cmp_doubles((PSPIO_GTH_L_MAX+1)*PSPIO_GTH_N_PROJ*PSPIO_GTH_N_PROJ,
+        &pspdata1->gth->k[0][0][0], &pspdata2->gth->k[0][0][0], tol);
+  }
+
+  return eq ? PSPIO_EQUAL : PSPIO_DIFF;
+}
+
+void pspio_pspdata_memory_usage(const pspio_pspdata_t *pspdata, pspio_memory_t *usage)
+{
+  int i, n_ch, n_ppl;
+
+  assert(usage != NULL);
+
+  if ( pspdata == NULL ) return;
+
+  usage->metadata += sizeof(pspio_pspdata_t);
+  if ( pspdata->pspinfo != NULL ) usage->metadata += sizeof(pspio_pspinfo_t);
+  pspio_mesh_memory_usage(pspdata->mesh, usage);
+
+  /* States and the lookup index */
+  if ( pspdata->states != NULL ) {
+    usage->metadata += pspdata->n_states * sizeof(pspio_state_t *);
+    for (i=0; i<pspdata->n_states; i++) {
+      pspio_state_memory_usage(pspdata->states[i], usage);
+    }
+  }
+  if ( pspdata->index != NULL ) {
+    n_ch = 3*(pspdata->index->l_max + 1);
+    n_ppl = (pspdata->index->l_max < 6) ? 6 : pspdata->index->l_max + 1;
+    usage->metadata += sizeof(pspio_pspdata_index_t) +
+      ((pspdata->index->n_max + 2)*n_ch + n_ch + 1 +
+       pspdata->n_projectors + n_ppl) * sizeof(int);
+  }
+
+  /* Potentials */
+  if ( pspdata->potentials != NULL ) {
+    usage->metadata += pspdata->n_potentials * sizeof(pspio_potential_t *);
+    for (i=0; i<pspdata->n_potentials; i++) {
+      pspio_potential_memory_usage(pspdata->potentials[i], usage);
+    }
+  }
+  pspio_potential_memory_usage(pspdata->vlocal, usage);
+
+  /* Projectors, with the per-l counts when set explicitly */
+  if ( pspdata->projectors != NULL ) {
+    usage->metadata += pspdata->n_projectors * sizeof(pspio_projector_t *);
+    for (i=0; i<pspdata->n_projectors; i++) {
+      pspio_projector_memory_usage(pspdata->projectors[i], usage);
+    }
+  }
+  if ( pspdata->projector_energies != NULL ) {
+    usage->arrays += pspdata->n_projectors * pspdata->n_projectors * sizeof(double);
+  }
+  if ( pspdata->n_projectors_per_l != NULL ) {
+    usage->metadata += 6 * sizeof(int);
+  }
+
+  /* XC and valence density */
+  pspio_xc_memory_usage(pspdata->xc, usage);
+  pspio_meshfunc_memory_usage(pspdata->rho_valence, usage);
+  if ( pspdata->gth != NULL ) usage->metadata += sizeof(pspio_gth_t);
+}
+
@@ -23,6 +23,10 @@
  * @brief header file for handling the to pseudopotential data structure
  */
 
+#include <stddef.h>
+#include <stdint.h>
+
+#include "pspio_gth.h"
 #include "pspio_mesh.h"
 #include "pspio_meshfunc.h"
 #include "pspio_potential.h"
@@ -36,6 +40,24 @@
  * Data structures                                                    *
  **********************************************************************/
 
+/**
+ * Flat lookup index of the states, potentials and projectors of a
+ * pseudopotential by their quantum numbers. Each angular momentum l is
+ * split in three channels, 3*l+k, where k is 0 for j = 0, 1 for
+ * j = l-1/2 and 2 for j = l+1/2. All the arrays point into a single
+ * block of memory.
+ */
+typedef struct{
+  int n_max;        /**< largest main quantum number of the states */
+  int l_max;        /**< largest angular momentum of the indexed objects */
+  int *states;      /**< (n_max+1) x 3*(l_max+1) state indices, -1 if absent */
+  int *potentials;  /**< 3*(l_max+1) potential indices, -1 if absent */
+  int *proj_start;  /**< 3*(l_max+1)+1 offsets of the channels in proj_order */
+  int *proj_order;  /**< projector indices sorted by channel */
+  int *proj_per_l;  /**< number of projectors per angular momentum */
+  int *block;       /**< memory holding all the arrays above */
+} pspio_pspdata_index_t;
+
 /**
  * Main structure for pseudopotential data
  */
@@ -43,6 +65,7 @@ typedef struct{
   /* general data */
   pspio_pspinfo_t *pspinfo; /**< Generic information about the pseudopotential. */
   int format_guessed;/**< Format of the file guessed by pspio_pspdata_read. */
+  int loaded;        /**< Components loaded by the last read, see PSPIO_LOAD_ALL */
   char symbol[4];    /**< Atomic symbol */
   double z;          /**< Atomic number */
   double zvalence;   /**< charge of pseudopotential ion */
@@ -53,9 +76,9 @@ typedef struct{
 
   /* The radial mesh. */
   pspio_mesh_t *mesh; /**< Radial mesh - all functions should be discretized on this mesh */
+  int np;             /**< Number of mesh points given in the header of the file */
 
   /* The states */
-  int **qn_to_istate;     /**< lookup table giving the position of the state from the quantum numbers */ 
   int n_states;           /**< number of electronic states */
   pspio_state_t **states; /**< struct with electronic states */
 
@@ -79,8 +102,32 @@ typedef struct{
   /* Valence density */
   pspio_meshfunc_t *rho_valence; /**< valence density */
 
+  /* Analytic pseudopotentials */
+  pspio_gth_t *gth; /**< GTH/HGH parameters, NULL for tabulated pseudopotentials */
+
+  /* Lookup index of the states, potentials and projectors */
+  pspio_pspdata_index_t *index; /**< index by quantum numbers */
+
+  /* Content hash, see pspio_pspdata_hash */
+  uint64_t hash; /**< cached content hash, 0 if not computed */
+
 } pspio_pspdata_t;
 
+/**
+ * Handle of an asynchronous read, see pspio_pspdata_read_async
+ */
+typedef struct pspio_request_s pspio_request_t;
+
+/**
+ * Destination of the data written by pspio_pspdata_write_sink
+ *
+ * @param[in] data: contents of the whole file
+ * @param[in] size: size of data, in bytes
+ * @param[in,out] context: pointer given to pspio_pspdata_write_sink
+ * @return error code, PSPIO_SUCCESS if all the data was accepted
+ */
+typedef int (*pspio_sink_t)(const char *data, size_t size, void *context);
+
 
 /**********************************************************************
  * Global routines                                                    *
@@ -108,9 +155,109 @@ void pspio_pspdata_free(pspio_pspdata_t *pspdata);
  * @return error code.
  * @note The file format might be UNKNOWN. In that case all the other
  *       formats are tried until the correct one is found.
+ * @note The interpolation of all the functions is built once the file
+ *       has been parsed, in parallel when the library is built with
+ *       OpenMP.
+ * @note Files compressed with gzip, xz or zstd are recognized by their
+ *       first bytes and decompressed in memory before being parsed; xz
+ *       and zstd are only available when found at configure time,
+ *       otherwise PSPIO_ENOSUPPORT is returned. This applies to all
+ *       the pspio_pspdata_read* routines.
+ * @note GTH and HGH files (PSPIO_FMT_ABINIT_2, PSPIO_FMT_ABINIT_3,
+ *       PSPIO_FMT_ABINIT_10 and PSPIO_FMT_OCTOPUS_HGH) only hold
+ *       parameters: they are read without a mesh, see
+ *       pspio_pspdata_set_gth.
+ * @note PSML files (PSPIO_FMT_XML) are parsed as a stream when XML
+ *       support is enabled at configure time, otherwise
+ *       PSPIO_ENOSUPPORT is returned.
  */
 int pspio_pspdata_read(pspio_pspdata_t *pspdata, int file_format, const char *file_name);
 
+/**
+ * Fills pspdata with the metadata found in the header of a file, without
+ * reading the radial functions: symbol, atomic number, valence charge,
+ * angular momenta, exchange-correlation functional, presence of NLCC,
+ * number of mesh points, states and projectors, and format.
+ * Only the beginning of the file is read.
+ *
+ * @param[in,out] pspdata: pointer to pspdata structure to be filled
+ * @param[in] file_format: the format of the file, might be UNKNOWN
+ * @param[in] file_name: file to be parsed
+ * @return error code
+ * @note The mesh, the states, the potentials and the projectors are not
+ *       allocated; their numbers are available through the getters and
+ *       pspio_pspdata_get_np. To get the data, pspdata has to be reset
+ *       and the file read with pspio_pspdata_read.
+ * @note What is available depends on the format. FHI files only store
+ *       the valence charge, the number of channels and the mesh size,
+ *       and UPF headers do not tell the wave equation. The value of l_max
+ *       is the one declared in the header.
+ */
+int pspio_pspdata_read_header(pspio_pspdata_t *pspdata, int file_format,
+                              const char *file_name);
+
+/**
+ * Fills pspdata with the data read from a given file, as
+ * pspio_pspdata_read, loading only some of its components. The
+ * sections of the file holding the other components are skipped
+ * without being parsed.
+ *
+ * @param[in,out] pspdata: pointer to pspdata structure to be filled
+ * @param[in] file_format: the format of the file, might be UNKNOWN
+ * @param[in] file_name: file to be parsed
+ * @param[in] components: combination of PSPIO_LOAD_* flags
+ * @return error code
+ * @note The numbers of states, potentials and projectors are kept, but
+ *       the getters return NULL for the objects that were not loaded;
+ *       pspio_pspdata_get_loaded tells which components are available.
+ *       The lookup index only covers the loaded objects.
+ * @note Skipping the states of a UPF file leaves the number of valence
+ *       electrons unset and l_max as declared in the header. Skipping
+ *       its projectors leaves l_local unset (-1).
+ * @note A pspdata with components missing cannot be written.
+ */
+int pspio_pspdata_read_select(pspio_pspdata_t *pspdata, int file_format,
+                              const char *file_name, int components);
+
+/**
+ * Starts reading a file in the background, as pspio_pspdata_read, and
+ * returns immediately. The kernel is asked to prefetch the file right
+ * away and the parsing is done by a worker thread, so that the caller
+ * can go on with other work until it calls pspio_wait.
+ *
+ * @param[in,out] pspdata: pointer to pspdata structure to be filled
+ * @param[in] file_format: the format of the file, might be UNKNOWN
+ * @param[in] file_name: file to be parsed
+ * @param[out] request: handle of the read, to pass to pspio_wait
+ * @return error code of the submission; errors of the read itself are
+ *         returned by pspio_wait.
+ * @note pspdata must not be accessed nor freed until pspio_wait has
+ *       returned. Every request must be completed with pspio_wait.
+ * @note Without POSIX threads the file is read before returning.
+ * @note The functions are built with the interpolation settings of the
+ *       calling thread, see pspio_meshfunc_default_interp.
+ */
+int pspio_pspdata_read_async(pspio_pspdata_t *pspdata, int file_format,
+                             const char *file_name, pspio_request_t **request);
+
+/**
+ * Tells whether an asynchronous read has completed, without blocking
+ *
+ * @param[in] request: handle returned by pspio_pspdata_read_async
+ * @param[out] done: 1 if pspio_wait would return immediately, 0 otherwise
+ * @return error code
+ */
+int pspio_test(pspio_request_t *request, int *done);
+
+/**
+ * Waits for an asynchronous read to complete and frees its handle
+ *
+ * @param[in,out] request: handle returned by pspio_pspdata_read_async,
+ *                set to NULL on return
+ * @return error code of the read
+ */
+int pspio_wait(pspio_request_t **request);
+
 /**
  * Writes the pspdata to a given file. If the specified file format is equal
  * to PSPIO_FMT_UNKNOWN, the routine will set it to the actual format value
@@ -119,9 +266,98 @@ int pspio_pspdata_read(pspio_pspdata_t *pspdata, int file_format, const char *fi
  * @param[out] file_name: file write to.
  * @param[in,out] file_format: the format of file_name.
  * @return error code.
+ * @note The file is formatted in memory and written at once; it is not
+ *       created if formatting fails.
+ * @note Analytic pseudopotentials have no tabulated functions to write
+ *       and give PSPIO_ENOSUPPORT.
+ * @note FHI98PP and ABINIT_6 files require a log1 mesh and a semilocal
+ *       potential for each channel, otherwise PSPIO_ENOSUPPORT is
+ *       returned. Data read from UPF files have no semilocal potentials.
+ * @note ABINIT and UPF files require exchange-correlation data, ABINIT
+ *       files the atomic number, and UPF files a local potential,
+ *       otherwise PSPIO_ENOSUPPORT is returned. Data read from FHI98PP
+ *       files have neither an atomic number nor a local potential.
+ *       Default generation information is set when pspdata has none.
  */
 int pspio_pspdata_write(pspio_pspdata_t *pspdata, int file_format, const char *file_name);
 
+/**
+ * Writes the pspdata in a given format to a memory buffer, with the
+ * same contents as pspio_pspdata_write would put in a file.
+ *
+ * @param[in] pspdata: pointer to pspdata structure
+ * @param[in] file_format: the format to write
+ * @param[out] buffer: newly allocated buffer, NUL-terminated, to release
+ *             with free()
+ * @param[out] size: number of bytes in buffer
+ * @return error code
+ * @note On error, buffer is set to NULL and size to 0.
+ */
+int pspio_pspdata_write_buffer(pspio_pspdata_t *pspdata, int file_format,
+                               char **buffer, size_t *size);
+
+/**
+ * Writes the pspdata in a given format through a user callback. The
+ * data is formatted in memory first and handed over to the sink in a
+ * single call.
+ *
+ * @param[in] pspdata: pointer to pspdata structure
+ * @param[in] file_format: the format to write
+ * @param[in] sink: callback receiving the data
+ * @param[in,out] context: pointer passed unchanged to sink
+ * @return error code, the one returned by sink if it failed
+ * @note sink is not called if formatting fails.
+ */
+int pspio_pspdata_write_sink(pspio_pspdata_t *pspdata, int file_format,
+                             pspio_sink_t sink, void *context);
+
+/**
+ * Maps all the functions of pspdata onto a new mesh: wavefunctions,
+ * potentials, projectors, local potential, core density and valence
+ * density, together with their derivatives. The source interval and
+ * interpolation weights of every target point are computed once and
+ * applied to all the functions as a batch.
+ * @param[in,out] pspdata: pointer to pspdata structure
+ * @param[in] mesh: target mesh
+ * @param[in] method: interpolation method (PSPIO_INTERP_*)
+ * @return error code
+ * @note Points beyond the source mesh are linearly extrapolated, as
+ *       pspio_meshfunc_eval does.
+ */
+int pspio_pspdata_resample(pspio_pspdata_t *pspdata, const pspio_mesh_t *mesh,
+                           int method);
+
+/**
+ * Converts a file to another format. The functions are written on the
+ * mesh they were read on, hence no interpolation object is built.
+ * @param[in] src_format: format of src_name, or PSPIO_FMT_UNKNOWN to guess it
+ * @param[in] src_name: file to read
+ * @param[in] dst_format: format of dst_name
+ * @param[in] dst_name: file to write
+ * @return error code, PSPIO_ENOSUPPORT if the data cannot be written in
+ *         dst_format (see pspio_pspdata_write).
+ */
+int pspio_pspdata_convert(int src_format, const char *src_name,
+                          int dst_format, const char *dst_name);
+
+/**
+ * Converts a list of files to another format, as pspio_pspdata_convert
+ * does. When POSIX threads are available, the next file is parsed by a
+ * worker thread while the current one is being written.
+ * @param[in] n: number of files
+ * @param[in] src_format: format of the input files, or PSPIO_FMT_UNKNOWN
+ * @param[in] src_names: files to read
+ * @param[in] dst_format: format of the output files
+ * @param[in] dst_names: files to write
+ * @param[out] status: error code of each conversion (optional)
+ * @return error code of the first conversion that failed, if any.
+ * @note Errors raised while parsing in the worker thread are only
+ *       reported through status.
+ */
+int pspio_pspdata_convert_batch(int n, int src_format,
+                                const char *const *src_names, int dst_format,
+                                const char *const *dst_names, int *status);
+
 /**
  * Reset all the pspdata structure data
  * @param[in,out] pspdata: pointer to pspdata structure to be
@@ -244,6 +480,8 @@ int pspio_pspdata_set_n_projectors(pspio_pspdata_t *pspdata, int n_projectors);
  * @param[in,out] pspdata: pointer to pspdata structure
  * @param[in] n_ppl: array storing the number of projectors for each angular momentum
  * @note array length must be less than 7
+ * @note If n_ppl is NULL, the counts are taken from the index of pspdata,
+ *       which is built if needed.
  * @return error code
  */
 int pspio_pspdata_set_n_projectors_per_l(pspio_pspdata_t *pspdata, int *n_ppl);
@@ -299,6 +537,85 @@ int pspio_pspdata_set_rho_valence(pspio_pspdata_t *pspdata, const pspio_meshfunc
 int pspio_pspdata_set_projector_energies(pspio_pspdata_t *pspdata,
                                          const double *energies);
 
+/**
+ * Sets the parameters of an analytic pseudopotential, with the local
+ * potential and the projectors they define, all evaluated in closed
+ * form. The projectors are ordered by l and by index within their
+ * channel, their energies are the couplings h_ij. Only the local
+ * potential and the projectors of the loaded components are set.
+ *
+ * @param[in,out] pspdata: pointer to pspdata structure, without mesh
+ * @param[in] gth: GTH/HGH parameters
+ * @return error code
+ * @note The spin-orbit couplings k_ij are only available through the
+ *       parameters, see pspio_pspdata_get_gth.
+ */
+int pspio_pspdata_set_gth(pspio_pspdata_t *pspdata, const pspio_gth_t *gth);
+
+/**
+ * Same as pspio_pspdata_set_state, but transfers the ownership of the
+ * state to pspdata instead of copying it. The state previously stored
+ * at this position is freed, unless it is the one given.
+ *
+ * @param[in,out] pspdata: pointer to pspdata structure
+ * @param[in] index: index of state to be set
+ * @param[in,out] state: pointer to an initialized state, set to NULL
+ * @return error code
+ */
+int pspio_pspdata_take_state(pspio_pspdata_t *pspdata, int index, pspio_state_t **state);
+
+/**
+ * Same as pspio_pspdata_set_potential, but transfers the ownership of
+ * the potential, see pspio_pspdata_take_state.
+ *
+ * @param[in,out] pspdata: pointer to pspdata structure
+ * @param[in] index: index of potential to be set
+ * @param[in,out] potential: pointer to an initialized potential, set to NULL
+ * @return error code
+ */
+int pspio_pspdata_take_potential(pspio_pspdata_t *pspdata, int index, pspio_potential_t **potential);
+
+/**
+ * Same as pspio_pspdata_set_projector, but transfers the ownership of
+ * the projector, see pspio_pspdata_take_state.
+ *
+ * @param[in,out] pspdata: pointer to pspdata structure
+ * @param[in] index: index of projector to be set
+ * @param[in,out] projector: pointer to an initialized projector, set to NULL
+ * @return error code
+ */
+int pspio_pspdata_take_projector(pspio_pspdata_t *pspdata, int index, pspio_projector_t **projector);
+
+/**
+ * Same as pspio_pspdata_set_vlocal, but transfers the ownership of the
+ * local potential, see pspio_pspdata_take_state.
+ *
+ * @param[in,out] pspdata: pointer to pspdata structure
+ * @param[in,out] vlocal: pointer to an initialized potential, set to NULL
+ * @return error code
+ */
+int pspio_pspdata_take_vlocal(pspio_pspdata_t *pspdata, pspio_potential_t **vlocal);
+
+/**
+ * Same as pspio_pspdata_set_xc, but transfers the ownership of the xc
+ * data, see pspio_pspdata_take_state.
+ *
+ * @param[in,out] pspdata: pointer to pspdata structure
+ * @param[in,out] xc: pointer to initialized xc data, set to NULL
+ * @return error code
+ */
+int pspio_pspdata_take_xc(pspio_pspdata_t *pspdata, pspio_xc_t **xc);
+
+/**
+ * Same as pspio_pspdata_set_rho_valence, but transfers the ownership of
+ * the valence density, see pspio_pspdata_take_state.
+ *
+ * @param[in,out] pspdata: pointer to pspdata structure
+ * @param[in,out] rho_valence: pointer to an initialized mesh function, set to NULL
+ * @return error code
+ */
+int pspio_pspdata_take_rho_valence(pspio_pspdata_t *pspdata, pspio_meshfunc_t **rho_valence);
+
 /**********************************************************************
  * Getters                                                            *
  **********************************************************************/
@@ -309,6 +626,14 @@ int pspio_pspdata_set_projector_energies(pspio_pspdata_t *pspdata,
  */
 int pspio_pspdata_get_format_guessed(const pspio_pspdata_t *pspdata);
 
+/**
+ * @param[in] pspdata: pointer to pspdata structure
+ * @return combination of the PSPIO_LOAD_* flags of the components
+ *         loaded by the last read, PSPIO_LOAD_ALL if pspdata was not read
+ *         selectively and 0 after pspio_pspdata_read_header
+ */
+int pspio_pspdata_get_loaded(const pspio_pspdata_t *pspdata);
+
 /**
  * @param[in] pspdata: pointer to pspdata structure
  * @return pointer to pseudopotential information
@@ -363,6 +688,13 @@ double pspio_pspdata_get_total_energy(const pspio_pspdata_t *pspdata);
  */
 const pspio_mesh_t * pspio_pspdata_get_mesh(const pspio_pspdata_t *pspdata);
 
+/**
+ * @param[in] pspdata: pointer to pspdata structure
+ * @return number of mesh points, from the mesh if available, otherwise
+ *         from the header of the file read
+ */
+int pspio_pspdata_get_np(const pspio_pspdata_t *pspdata);
+
 /**
  * @param[in] pspdata: pointer to pspdata structure
  * @return number of states
@@ -372,7 +704,7 @@ int pspio_pspdata_get_n_states(const pspio_pspdata_t *pspdata);
 /**
  * @param[in] pspdata: pointer to pspdata structure
  * @param[in] index: index of state to get
- * @return pointer to state
+ * @return pointer to state, NULL if the states were not loaded
  */
 const pspio_state_t * pspio_pspdata_get_state(const pspio_pspdata_t *pspdata, int index);
 
@@ -391,7 +723,7 @@ int pspio_pspdata_get_n_potentials(const pspio_pspdata_t *pspdata);
 /**
  * @param[in] pspdata: pointer to pspdata structure
  * @param[in] index: index of potential to get
- * @return pointer to potential
+ * @return pointer to potential, NULL if the potentials were not loaded
  */
 const pspio_potential_t * pspio_pspdata_get_potential(const pspio_pspdata_t *pspdata, int index);
 
@@ -404,13 +736,17 @@ int pspio_pspdata_get_n_projectors(const pspio_pspdata_t *pspdata);
 /**
  * @param[in] pspdata: pointer to pspdata structure
  * @return number of projectors per angular momentum (maximum up to l=6)
+ * @note Unless they have been set explicitly, the counts are the ones of
+ *       the index of pspdata, with at least 6 entries, rebuilt if a setter
+ *       has discarded it. NULL is returned if pspdata cannot be indexed,
+ *       see pspio_pspdata_build_index.
  */
 int * pspio_pspdata_get_n_projectors_per_l(const pspio_pspdata_t *pspdata);
 
 /**
  * @param[in] pspdata: pointer to pspdata structure
  * @param[in] index: index of projector to get
- * @return pointer to projector
+ * @return pointer to projector, NULL if the projectors were not loaded
  */
 const pspio_projector_t * pspio_pspdata_get_projector(const pspio_pspdata_t *pspdata, int index);
 
@@ -428,7 +764,7 @@ int pspio_pspdata_get_l_local(const pspio_pspdata_t *pspdata);
 
 /**
  * @param[in] pspdata: pointer to pspdata structure
- * @return pointer to the local potential
+ * @return pointer to the local potential, NULL if it was not loaded
  */
 const pspio_potential_t * pspio_pspdata_get_vlocal(const pspio_pspdata_t *pspdata);
 
@@ -440,7 +776,7 @@ const pspio_xc_t * pspio_pspdata_get_xc(const pspio_pspdata_t *pspdata);
 
 /**
  * @param[in] pspdata: pointer to pspdata structure
- * @return pointer to the valence density
+ * @return pointer to the valence density, NULL if it was not loaded
  */
 const pspio_meshfunc_t * pspio_pspdata_get_rho_valence(const pspio_pspdata_t *pspdata);
 
@@ -453,4 +789,121 @@ const pspio_meshfunc_t * pspio_pspdata_get_rho_valence(const pspio_pspdata_t *ps
 double pspio_pspdata_get_projector_energy(const pspio_pspdata_t *pspdata,
                                           int i, int j);
 
+/**
+ * @param[in] pspdata: pointer to pspdata structure
+ * @return pointer to the GTH/HGH parameters, NULL if the
+ *         pseudopotential is tabulated
+ */
+const pspio_gth_t * pspio_pspdata_get_gth(const pspio_pspdata_t *pspdata);
+
+
+/**********************************************************************
+ * Utility routines                                                   *
+ **********************************************************************/
+
+/**
+ * Builds the lookup index of the states, potentials and projectors of
+ * pspdata. The setters of these objects discard the index, and the
+ * lookups below rebuild it when needed; calling this routine after
+ * filling pspdata by hand reports the errors right away.
+ *
+ * @param[in,out] pspdata: pspdata structure
+ * @return error code
+ * @note Objects with a j that is neither 0 nor l+-1/2 are rejected with
+ *       PSPIO_EVALUE, as well as objects not set yet, unless their
+ *       component was not loaded (see pspio_pspdata_get_loaded), in which
+ *       case they are left out. If several states share the same quantum
+ *       numbers, the last one is indexed.
+ */
+int pspio_pspdata_build_index(pspio_pspdata_t *pspdata);
+
+/**
+ * @param[in] pspdata: pspdata structure
+ * @param[in] n: main quantum number
+ * @param[in] l: angular momentum
+ * @param[in] j: total angular momentum
+ * @return position of the state with quantum numbers (n, l, j), or -1
+ */
+int pspio_pspdata_find_state(const pspio_pspdata_t *pspdata, int n, int l,
+                             double j);
+
+/**
+ * @param[in] pspdata: pspdata structure
+ * @param[in] l: angular momentum
+ * @param[in] j: total angular momentum
+ * @return position of the potential of channel (l, j), or -1
+ */
+int pspio_pspdata_find_potential(const pspio_pspdata_t *pspdata, int l,
+                                 double j);
+
+/**
+ * Gives the projectors of channel (l, j) as a contiguous range of
+ * positions, in the order they are stored in pspdata.
+ *
+ * @param[in] pspdata: pspdata structure
+ * @param[in] l: angular momentum
+ * @param[in] j: total angular momentum
+ * @param[out] indices: positions of the projectors (not to be freed)
+ * @return number of projectors of the channel
+ * @note If pspdata cannot be indexed, indices is set to NULL and 0 is
+ *       returned; the lookups of states and potentials return -1.
+ */
+int pspio_pspdata_find_projectors(const pspio_pspdata_t *pspdata, int l,
+                                  double j, const int **indices);
+
+/**
+ * Gives the projectors of angular momentum l, for all j, as a
+ * contiguous range of positions sorted by j.
+ *
+ * @param[in] pspdata: pspdata structure
+ * @param[in] l: angular momentum
+ * @param[out] indices: positions of the projectors (not to be freed),
+ *             may be NULL
+ * @return number of projectors of angular momentum l
+ */
+int pspio_pspdata_find_projectors_l(const pspio_pspdata_t *pspdata, int l,
+                                    const int **indices);
+
+/**
+ * Returns a 64-bit hash of the contents of pspdata, computed in a single
+ * pass over the metadata and the values of all the functions, and cached
+ * until pspdata is modified through its setters. It is only computed
+ * when first asked for, so that reading does not pay for it.
+ *
+ * @param[in,out] pspdata: pspdata structure
+ * @return content hash, never 0
+ * @note The hash covers the physical contents only: the format guessed
+ *       and the generation information (pspinfo) are not included. It
+ *       depends on the exact bit patterns of the values and is stable
+ *       across runs on platforms with the same endianness.
+ */
+uint64_t pspio_pspdata_hash(pspio_pspdata_t *pspdata);
+
+/**
+ * Compares two pspdata structures. Integers, strings and quantum
+ * numbers must match exactly, while two real numbers x and y are
+ * considered equal when |x - y| <= tol * max(1, |x|, |y|). Only the
+ * values of the functions are compared, not their derivatives.
+ *
+ * @param[in] pspdata1: first pspdata structure
+ * @param[in] pspdata2: second pspdata structure
+ * @param[in] tol: relative tolerance, 0 for an exact comparison
+ * @return PSPIO_EQUAL when equal, PSPIO_DIFF when different
+ * @note When tol is 0 and the cached hashes of both structures are
+ *       available, structures with different hashes are reported as
+ *       different without looking at their contents.
+ */
+int pspio_pspdata_cmp(const pspio_pspdata_t *pspdata1,
+                      const pspio_pspdata_t *pspdata2, double tol);
+
+/**
+ * Adds the memory footprint of pspdata to usage.
+ * Only the mesh stored in pspdata is counted as arrays, all the copies
+ * held by the mesh functions are counted as duplicated meshes.
+ *
+ * @param[in] pspdata: pspdata structure, may be NULL
+ * @param[in,out] usage: memory footprint to update
+ */
+void pspio_pspdata_memory_usage(const pspio_pspdata_t *pspdata, pspio_memory_t *usage);
+
 #endif
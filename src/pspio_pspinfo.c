@@ -24,6 +24,7 @@
 #include <string.h>
 #include <memory.h>
 
+#include "instrument.h"
 #include "pspio_pspinfo.h"
 #include "pspio_error.h"
 
@@ -39,6 +40,7 @@ int pspio_pspinfo_alloc(pspio_pspinfo_t **pspinfo)
   /* Memory allocation */
   *pspinfo = (pspio_pspinfo_t *) malloc (sizeof(pspio_pspinfo_t));
   FULFILL_OR_EXIT(*pspinfo != NULL, PSPIO_ENOMEM);
+  INSTR_COUNT(PSPIO_COUNTER_ALLOCS);
 
   /* Initialize variables */
   strcpy((*pspinfo)->author, "Unknown");
@@ -71,6 +73,8 @@ int pspio_pspinfo_copy(pspio_pspinfo_t **dst, const pspio_pspinfo_t *src) {
   strcpy((*dst)->description, src->description);
   (*dst)->time = src->time;
 
+  INSTR_COUNT(PSPIO_COUNTER_COPIES);
+
   return PSPIO_SUCCESS;
 }
 
@@ -20,6 +20,7 @@
 #include <assert.h>
 #include <math.h>
 
+#include "instrument.h"
 #include "pspio_error.h"
 #include "pspio_qn.h"
 
@@ -38,6 +39,7 @@ int pspio_qn_alloc(pspio_qn_t **qn)
 
   *qn = (pspio_qn_t *) malloc (sizeof(pspio_qn_t));
   FULFILL_OR_EXIT(*qn != NULL, PSPIO_ENOMEM);
+  INSTR_COUNT(PSPIO_COUNTER_ALLOCS);
 
   (*qn)->n = 0;
   (*qn)->l = 0;
@@ -72,6 +74,8 @@ int pspio_qn_copy(pspio_qn_t **dst, const pspio_qn_t *src)
   (*dst)->l = src->l;
   (*dst)->j = src->j;
 
+  INSTR_COUNT(PSPIO_COUNTER_COPIES);
+
   return PSPIO_SUCCESS;
 }
 
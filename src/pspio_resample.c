@@ -0,0 +1,199 @@
+/* Copyright (C) 2018 Micael Oliveira <micael.oliveira@mpsd.mpg.de>
+ *                    Yann Pouillon <devops@materialsevolution.es>
+ *
+ * This file is part of Libpspio.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * version 2.0. If a copy of the MPL was not distributed with this file, You
+ * can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Libpspio is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the Mozilla Public License version 2.0 for
+ * more details.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "pspio_resample.h"
+#include "pspio_jb_spline.h"
+
+#if defined HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+
+/**********************************************************************
+ * Private routines                                                   *
+ **********************************************************************/
+
+/* Releases the arrays of the plan, keeping the structure */
+static void resample_reset(pspio_resample_t *plan)
+{
+  free(plan->r_src);
+  free(plan->idx);
+  free(plan->w);
+
+  plan->method = 0;
+  plan->np_src = 0;
+  plan->r_src = NULL;
+  plan->np = 0;
+  plan->idx = NULL;
+  plan->w = NULL;
+}
+
+/* Returns the interval [r[i], r[i+1]) containing x, clamped to [0, np-2] */
+static int resample_locate(const double *r, int np, double x)
+{
+  int lo, hi, mid;
+
+  lo = 0;
+  hi = np - 2;
+  while ( lo < hi ) {
+    mid = (lo + hi + 1) / 2;
+    if ( r[mid] <= x ) {
+      lo = mid;
+    } else {
+      hi = mid - 1;
+    }
+  }
+
+  return lo;
+}
+
+
+/**********************************************************************
+ * Global routines                                                    *
+ **********************************************************************/
+
+int pspio_resample_alloc(pspio_resample_t **plan)
+{
+  assert(plan != NULL);
+  assert(*plan == NULL);
+
+  *plan = (pspio_resample_t *) malloc (sizeof(pspio_resample_t));
+  FULFILL_OR_EXIT( *plan != NULL, PSPIO_ENOMEM );
+
+  (*plan)->r_src = NULL;
+  (*plan)->idx = NULL;
+  (*plan)->w = NULL;
+  resample_reset(*plan);
+
+  return PSPIO_SUCCESS;
+}
+
+int pspio_resample_init(pspio_resample_t *plan, const pspio_mesh_t *src,
+                        const pspio_mesh_t *dst, int method)
+{
+  int i, k, nsrc;
+  double h, s, x, *w;
+
+  assert(plan != NULL);
+  assert((src != NULL) && (dst != NULL));
+
+  FULFILL_OR_RETURN( (method == PSPIO_INTERP_GSL_CSPLINE) ||
+                     (method == PSPIO_INTERP_JB_CSPLINE), PSPIO_ENOSUPPORT );
+  FULFILL_OR_RETURN( (src->np > 1) && (dst->np > 0), PSPIO_EVALUE );
+
+  resample_reset(plan);
+  nsrc = src->np;
+  plan->method = method;
+  plan->np_src = nsrc;
+  plan->np = dst->np;
+
+  plan->r_src = (double *) malloc (nsrc * sizeof(double));
+  FULFILL_OR_EXIT( plan->r_src != NULL, PSPIO_ENOMEM );
+  memcpy(plan->r_src, src->r, nsrc * sizeof(double));
+  plan->idx = (int *) malloc (plan->np * sizeof(int));
+  FULFILL_OR_EXIT( plan->idx != NULL, PSPIO_ENOMEM );
+  plan->w = (double *) malloc (4 * plan->np * sizeof(double));
+  FULFILL_OR_EXIT( plan->w != NULL, PSPIO_ENOMEM );
+
+  for (k=0; k<plan->np; k++) {
+    x = dst->r[k];
+    i = resample_locate(src->r, nsrc, x);
+    h = src->r[i+1] - src->r[i];
+    s = (x - src->r[i]) / h;
+    w = plan->w + 4*k;
+
+    plan->idx[k] = i;
+    w[0] = 1.0 - s;
+    w[1] = s;
+    if ( (x < src->r[0]) || (x >= src->r[nsrc-1]) ) {
+      /* Linear extrapolation */
+      w[2] = 0.0;
+      w[3] = 0.0;
+    } else {
+      w[2] = (w[0]*w[0]*w[0] - w[0]) * h * h / 6.0;
+      w[3] = (w[1]*w[1]*w[1] - w[1]) * h * h / 6.0;
+    }
+  }
+
+  return PSPIO_SUCCESS;
+}
+
+void pspio_resample_free(pspio_resample_t *plan)
+{
+  if ( plan != NULL ) {
+    resample_reset(plan);
+    free(plan);
+  }
+}
+
+
+/**********************************************************************
+ * Utility routines                                                   *
+ **********************************************************************/
+
+int pspio_resample_apply(const pspio_resample_t *plan, int n,
+                         const double *const *f, double *const *g)
+{
+  int i, j, ierr;
+  double *block, **ypp;
+  jb_spline_factor_t *factor = NULL;
+
+  assert(plan != NULL);
+  assert(plan->w != NULL);
+  assert(n == 0 || (f != NULL && g != NULL));
+
+  if ( n == 0 ) return PSPIO_SUCCESS;
+
+  /* Second derivatives of all the functions in a single sweep */
+  block = (double *) malloc ((size_t)n * plan->np_src * sizeof(double));
+  FULFILL_OR_EXIT( block != NULL, PSPIO_ENOMEM );
+  ypp = (double **) malloc (n * sizeof(double *));
+  FULFILL_OR_EXIT( ypp != NULL, PSPIO_ENOMEM );
+  for (j=0; j<n; j++) {
+    ypp[j] = block + (size_t)j * plan->np_src;
+  }
+  ierr = jb_spline_factor_alloc(&factor, plan->np_src);
+  if ( ierr == PSPIO_SUCCESS ) {
+    ierr = jb_spline_factor_init(factor, plan->r_src);
+  }
+  if ( ierr == PSPIO_SUCCESS ) {
+    jb_spline_factor_solve(factor, n, f, ypp);
+  }
+  jb_spline_factor_free(factor);
+
+  if ( ierr == PSPIO_SUCCESS ) {
+#if defined _OPENMP
+#pragma omp parallel for private(i)
+#endif
+    for (j=0; j<n; j++) {
+      int k;
+      const double *y = f[j], *s = ypp[j], *w;
+
+      for (k=0; k<plan->np; k++) {
+        i = plan->idx[k];
+        w = plan->w + 4*k;
+        g[j][k] = w[0]*y[i] + w[1]*y[i+1] + w[2]*s[i] + w[3]*s[i+1];
+      }
+    }
+  }
+
+  free(ypp);
+  free(block);
+  RETURN_WITH_ERROR( ierr );
+}
@@ -0,0 +1,107 @@
+/* Copyright (C) 2018 Micael Oliveira <micael.oliveira@mpsd.mpg.de>
+ *                    Yann Pouillon <devops@materialsevolution.es>
+ *
+ * This file is part of Libpspio.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * version 2.0. If a copy of the MPL was not distributed with this file, You
+ * can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Libpspio is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the Mozilla Public License version 2.0 for
+ * more details.
+ */
+
+#ifndef PSPIO_RESAMPLE_H
+#define PSPIO_RESAMPLE_H
+
+/**
+ * @file pspio_resample.h
+ * @brief header file for the mapping of functions from one mesh onto
+ *        another one
+ */
+
+#include "pspio_common.h"
+#include "pspio_error.h"
+#include "pspio_mesh.h"
+
+
+/**********************************************************************
+ * Data structures                                                    *
+ **********************************************************************/
+
+/**
+ * Resampling plan from a source mesh to a target mesh.
+ *
+ * For each target point k, the interpolant of a function y given on the
+ * source mesh is
+ *
+ *   y(r_k) = w[4k] y[i] + w[4k+1] y[i+1] + w[4k+2] y''[i] + w[4k+3] y''[i+1]
+ *
+ * with i = idx[k], where y'' are the second derivatives of the cubic
+ * spline of y. Points outside of the source mesh are linearly
+ * extrapolated, as pspio_meshfunc_eval does, and have no spline weights.
+ */
+typedef struct{
+  int method;     /**< Interpolation method */
+  int np_src;     /**< Number of points of the source mesh */
+  double *r_src;  /**< Points of the source mesh */
+  int np;         /**< Number of points of the target mesh */
+  int *idx;       /**< Source interval of each target point */
+  double *w;      /**< Weights of each target point (4 x np) */
+} pspio_resample_t;
+
+
+/**********************************************************************
+ * Global routines                                                    *
+ **********************************************************************/
+
+/**
+ * Allocates memory and presets the resampling plan
+ *
+ * @param[in,out] plan: resampling plan
+ * @return error code
+ */
+int pspio_resample_alloc(pspio_resample_t **plan);
+
+/**
+ * Computes the source interval and the weights of every target point.
+ * Any plan previously stored is released first.
+ *
+ * @param[in,out] plan: resampling plan
+ * @param[in] src: mesh the functions are given on
+ * @param[in] dst: mesh the functions are mapped onto
+ * @param[in] method: interpolation method
+ * @return error code
+ * @note Only the cubic spline methods are supported.
+ */
+int pspio_resample_init(pspio_resample_t *plan, const pspio_mesh_t *src,
+                        const pspio_mesh_t *dst, int method);
+
+/**
+ * Frees all memory associated with the resampling plan
+ *
+ * @param[in,out] plan: resampling plan
+ */
+void pspio_resample_free(pspio_resample_t *plan);
+
+
+/**********************************************************************
+ * Utility routines                                                   *
+ **********************************************************************/
+
+/**
+ * Maps n functions onto the target mesh. The functions are processed
+ * in parallel when OpenMP is available.
+ *
+ * @param[in] plan: resampling plan
+ * @param[in] n: number of functions
+ * @param[in] f: values of each function on the source mesh
+ * @param[out] g: values of each function on the target mesh
+ * @return error code
+ */
+int pspio_resample_apply(const pspio_resample_t *plan, int n,
+                         const double *const *f, double *const *g);
+
+#endif
@@ -0,0 +1,687 @@
+/* Copyright (C) 2018 Micael Oliveira <micael.oliveira@mpsd.mpg.de>
+ *                    Yann Pouillon <devops@materialsevolution.es>
+ *
+ * This file is part of Libpspio.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * version 2.0. If a copy of the MPL was not distributed with this file, You
+ * can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Libpspio is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the Mozilla Public License version 2.0 for
+ * more details.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+#include "pspio_shared.h"
+
+#if defined HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#if defined HAVE_SHM_OPEN
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+
+/**********************************************************************
+ * Data structures                                                    *
+ **********************************************************************/
+
+#define SHARED_MAGIC "PSPIOSHM"
+#define SHARED_VERSION 2
+
+/* Time an attaching process waits for a segment still being published */
+#define SHARED_WAIT_MS 10000
+
+/* Arrays stored in a segment */
+enum{
+  SHARED_R = 0,
+  SHARED_RAB,
+  SHARED_STATES_N,
+  SHARED_STATES_L,
+  SHARED_STATES_J,
+  SHARED_STATES,
+  SHARED_STATES_COEF,
+  SHARED_POTENTIALS_L,
+  SHARED_POTENTIALS_J,
+  SHARED_POTENTIALS,
+  SHARED_POTENTIALS_COEF,
+  SHARED_PROJECTORS_L,
+  SHARED_PROJECTORS_J,
+  SHARED_PROJECTORS,
+  SHARED_PROJECTORS_COEF,
+  SHARED_PROJECTOR_ENERGIES,
+  SHARED_VLOCAL,
+  SHARED_NLCC_DENSITY,
+  SHARED_RHO_VALENCE,
+  SHARED_NARRAYS
+};
+
+/*
+ * Header at the start of a segment. The ready flag is set last, so that
+ * a segment still being filled is not mistaken for a complete one.
+ */
+typedef struct{
+  char magic[8];
+  int32_t version;
+  int32_t format;
+  uint64_t size;
+  int32_t ready;
+  int32_t l_local;
+
+  char symbol[4];
+  int32_t l_max;
+  double z;
+  double zvalence;
+  double nelvalence;
+
+  int32_t mesh_type;
+  int32_t np;
+  double mesh_a;
+  double mesh_b;
+
+  int32_t ld;
+  int32_t n_states;
+  int32_t n_potentials;
+  int32_t n_projectors;
+
+  int32_t exchange;
+  int32_t correlation;
+  int32_t nlcc_scheme;
+  int32_t padding;
+
+  uint64_t offset[SHARED_NARRAYS]; /* 0 for empty arrays */
+  uint64_t bytes[SHARED_NARRAYS];
+} shared_header_t;
+
+
+/**********************************************************************
+ * Private routines                                                   *
+ **********************************************************************/
+
+/* Rounds a size up to the alignment of the packed blocks */
+static size_t shared_align(size_t size)
+{
+  return ((size + PSPIO_PACKED_ALIGN - 1) / PSPIO_PACKED_ALIGN) *
+    PSPIO_PACKED_ALIGN;
+}
+
+/* Unmaps the segment and clears the views */
+static void shared_reset(pspio_shared_t *shared)
+{
+#if defined HAVE_SHM_OPEN
+  if ( shared->base != NULL ) {
+    munmap(shared->base, shared->size);
+  }
+#endif
+  free(shared->name);
+
+  shared->name = NULL;
+  shared->base = NULL;
+  shared->size = 0;
+  shared->owner = 0;
+  shared->format = PSPIO_FMT_UNKNOWN;
+  strcpy(shared->symbol, "");
+  shared->z = 0.0;
+  shared->zvalence = 0.0;
+  shared->nelvalence = 0.0;
+  shared->l_max = 0;
+  shared->l_local = 0;
+  shared->exchange = 0;
+  shared->correlation = 0;
+  shared->nlcc_scheme = PSPIO_NLCC_NONE;
+  shared->projector_energies = NULL;
+  shared->vlocal = NULL;
+  shared->nlcc_density = NULL;
+  shared->rho_valence = NULL;
+  memset(&shared->mesh, 0, sizeof(pspio_mesh_t));
+  memset(&shared->packed, 0, sizeof(pspio_packed_t));
+}
+
+#if defined HAVE_SHM_OPEN
+/* Returns the address of an array of the segment, NULL if empty */
+static void *shared_array(const pspio_shared_t *shared,
+                          const shared_header_t *header, int k)
+{
+  return (header->offset[k] == 0) ? NULL :
+    (void *)((char *)shared->base + header->offset[k]);
+}
+
+/* Points the views of the structure to the mapped segment */
+static void shared_map_views(pspio_shared_t *shared)
+{
+  const shared_header_t *header = (const shared_header_t *)shared->base;
+  pspio_packed_t *packed = &shared->packed;
+
+  shared->format = header->format;
+  memcpy(shared->symbol, header->symbol, sizeof(shared->symbol));
+  shared->symbol[3] = '\0';
+  shared->z = header->z;
+  shared->zvalence = header->zvalence;
+  shared->nelvalence = header->nelvalence;
+  shared->l_max = header->l_max;
+  shared->l_local = header->l_local;
+  shared->exchange = header->exchange;
+  shared->correlation = header->correlation;
+  shared->nlcc_scheme = header->nlcc_scheme;
+  shared->projector_energies = (const double *)shared_array(shared, header, SHARED_PROJECTOR_ENERGIES);
+  shared->vlocal = (const double *)shared_array(shared, header, SHARED_VLOCAL);
+  shared->nlcc_density = (const double *)shared_array(shared, header, SHARED_NLCC_DENSITY);
+  shared->rho_valence = (const double *)shared_array(shared, header, SHARED_RHO_VALENCE);
+
+  shared->mesh.type = header->mesh_type;
+  shared->mesh.a = header->mesh_a;
+  shared->mesh.b = header->mesh_b;
+  shared->mesh.np = header->np;
+  shared->mesh.r = (double *)shared_array(shared, header, SHARED_R);
+  shared->mesh.rab = (double *)shared_array(shared, header, SHARED_RAB);
+
+  packed->mesh = &shared->mesh;
+  packed->np = header->np;
+  packed->ld = header->ld;
+  packed->n_states = header->n_states;
+  packed->states_n = (int *)shared_array(shared, header, SHARED_STATES_N);
+  packed->states_l = (int *)shared_array(shared, header, SHARED_STATES_L);
+  packed->states_j = (double *)shared_array(shared, header, SHARED_STATES_J);
+  packed->states = (double *)shared_array(shared, header, SHARED_STATES);
+  packed->states_coef = (double *)shared_array(shared, header, SHARED_STATES_COEF);
+  packed->n_potentials = header->n_potentials;
+  packed->potentials_l = (int *)shared_array(shared, header, SHARED_POTENTIALS_L);
+  packed->potentials_j = (double *)shared_array(shared, header, SHARED_POTENTIALS_J);
+  packed->potentials = (double *)shared_array(shared, header, SHARED_POTENTIALS);
+  packed->potentials_coef = (double *)shared_array(shared, header, SHARED_POTENTIALS_COEF);
+  packed->n_projectors = header->n_projectors;
+  packed->projectors_l = (int *)shared_array(shared, header, SHARED_PROJECTORS_L);
+  packed->projectors_j = (double *)shared_array(shared, header, SHARED_PROJECTORS_J);
+  packed->projectors = (double *)shared_array(shared, header, SHARED_PROJECTORS);
+  packed->projectors_coef = (double *)shared_array(shared, header, SHARED_PROJECTORS_COEF);
+}
+
+/* Checks that a mapped segment is complete and consistent */
+static int shared_check(const void *base, size_t size)
+{
+  int k;
+  size_t np, ld, nst, npot, nproj;
+  const shared_header_t *header = (const shared_header_t *)base;
+  uint64_t expected[SHARED_NARRAYS];
+
+  if ( size < sizeof(shared_header_t) ) return 0;
+  if ( memcmp(header->magic, SHARED_MAGIC, sizeof(header->magic)) != 0 ) return 0;
+  if ( (header->version != SHARED_VERSION) || (header->size != size) ||
+       !header->ready ) return 0;
+  if ( (header->np < 2) || (header->ld < header->np) ) return 0;
+  if ( (header->n_states < 0) || (header->n_potentials < 0) ||
+       (header->n_projectors < 0) ) return 0;
+
+  np = header->np;
+  ld = header->ld;
+  nst = header->n_states;
+  npot = header->n_potentials;
+  nproj = header->n_projectors;
+  expected[SHARED_R] = np * sizeof(double);
+  expected[SHARED_RAB] = np * sizeof(double);
+  expected[SHARED_STATES_N] = nst * sizeof(int);
+  expected[SHARED_STATES_L] = nst * sizeof(int);
+  expected[SHARED_STATES_J] = nst * sizeof(double);
+  expected[SHARED_STATES] = ld * nst * sizeof(double);
+  expected[SHARED_STATES_COEF] = 2 * np * nst * sizeof(double);
+  expected[SHARED_POTENTIALS_L] = npot * sizeof(int);
+  expected[SHARED_POTENTIALS_J] = npot * sizeof(double);
+  expected[SHARED_POTENTIALS] = ld * npot * sizeof(double);
+  expected[SHARED_POTENTIALS_COEF] = 2 * np * npot * sizeof(double);
+  expected[SHARED_PROJECTORS_L] = nproj * sizeof(int);
+  expected[SHARED_PROJECTORS_J] = nproj * sizeof(double);
+  expected[SHARED_PROJECTORS] = ld * nproj * sizeof(double);
+  expected[SHARED_PROJECTORS_COEF] = 2 * np * nproj * sizeof(double);
+  expected[SHARED_PROJECTOR_ENERGIES] = nproj * nproj * sizeof(double);
+  expected[SHARED_VLOCAL] = np * sizeof(double);
+  expected[SHARED_NLCC_DENSITY] = np * sizeof(double);
+  expected[SHARED_RHO_VALENCE] = np * sizeof(double);
+
+  for (k=0; k<SHARED_NARRAYS; k++) {
+    /* The optional arrays may be missing */
+    if ( (header->bytes[k] != expected[k]) &&
+         ((k < SHARED_PROJECTOR_ENERGIES) || (header->bytes[k] != 0)) ) return 0;
+    if ( (header->bytes[k] > 0) && ((header->offset[k] == 0) ||
+         (header->offset[k] % PSPIO_PACKED_ALIGN != 0) ||
+         (header->offset[k] > size) ||
+         (header->bytes[k] > size - header->offset[k])) ) return 0;
+  }
+
+  return 1;
+}
+
+/*
+ * Waits until the segment opened as fd has been filled by its publisher
+ * and returns its size, or 0 if it is not a complete segment
+ */
+static size_t shared_wait(int fd)
+{
+  int i;
+  struct stat st;
+  struct timespec pause = {0, 1000000};
+  shared_header_t header;
+  static const char blank[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+
+  for (i=0; i<SHARED_WAIT_MS; i++) {
+    if ( fstat(fd, &st) != 0 ) return 0;
+    if ( (size_t)st.st_size >= sizeof(header) ) {
+      if ( pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ) {
+        return 0;
+      }
+      if ( header.ready ) return (size_t)st.st_size;
+      /* Only a segment still being filled is waited for */
+      if ( (memcmp(header.magic, SHARED_MAGIC, sizeof(header.magic)) != 0) &&
+           (memcmp(header.magic, blank, sizeof(header.magic)) != 0) ) {
+        return 0;
+      }
+    } else if ( st.st_size > 0 ) {
+      return 0;
+    }
+    nanosleep(&pause, NULL);
+  }
+
+  return 0;
+}
+
+/* Gives the values of a function of pspdata, checking that they are on the mesh */
+static int shared_values(const pspio_meshfunc_t *func, size_t np,
+                         const void **src, uint64_t *bytes)
+{
+  *src = NULL;
+  *bytes = 0;
+  if ( func == NULL ) return PSPIO_SUCCESS;
+
+  FULFILL_OR_RETURN( (size_t)pspio_mesh_get_np(pspio_meshfunc_get_mesh(func)) == np,
+    PSPIO_EVALUE );
+  *src = pspio_meshfunc_get_function(func);
+  *bytes = np * sizeof(double);
+
+  return PSPIO_SUCCESS;
+}
+#endif
+
+
+/**********************************************************************
+ * Global routines                                                    *
+ **********************************************************************/
+
+int pspio_shared_alloc(pspio_shared_t **shared)
+{
+  assert(shared != NULL);
+  assert(*shared == NULL);
+
+  *shared = (pspio_shared_t *) malloc (sizeof(pspio_shared_t));
+  FULFILL_OR_EXIT( *shared != NULL, PSPIO_ENOMEM );
+
+  (*shared)->name = NULL;
+  (*shared)->base = NULL;
+  shared_reset(*shared);
+
+  return PSPIO_SUCCESS;
+}
+
+int pspio_shared_publish(pspio_shared_t *shared, const char *name,
+                         const pspio_pspdata_t *pspdata)
+{
+#if defined HAVE_SHM_OPEN
+  int k, fd, ierr;
+  size_t size, np;
+  void *base;
+  const void *src[SHARED_NARRAYS];
+  shared_header_t header;
+  pspio_packed_t *packed = NULL;
+
+  assert(shared != NULL);
+  assert(shared->base == NULL);
+  assert(name != NULL);
+  assert(pspdata != NULL);
+
+  FULFILL_OR_RETURN( pspdata->mesh != NULL, PSPIO_EVALUE );
+  SUCCEED_OR_RETURN( pspio_packed_alloc(&packed) );
+  ierr = pspio_packed_init(packed, pspdata);
+  if ( ierr != PSPIO_SUCCESS ) {
+    pspio_packed_free(packed);
+    RETURN_WITH_ERROR( ierr );
+  }
+
+  /* Describe the layout of the segment */
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, SHARED_MAGIC, sizeof(header.magic));
+  header.version = SHARED_VERSION;
+  header.format = pspdata->format_guessed;
+  memcpy(header.symbol, pspdata->symbol, sizeof(header.symbol));
+  header.l_max = pspdata->l_max;
+  header.l_local = pspdata->l_local;
+  header.z = pspdata->z;
+  header.zvalence = pspdata->zvalence;
+  header.nelvalence = pspdata->nelvalence;
+  header.mesh_type = pspdata->mesh->type;
+  header.np = packed->np;
+  header.mesh_a = pspdata->mesh->a;
+  header.mesh_b = pspdata->mesh->b;
+  header.ld = packed->ld;
+  header.n_states = packed->n_states;
+  header.n_potentials = packed->n_potentials;
+  header.n_projectors = packed->n_projectors;
+  header.nlcc_scheme = PSPIO_NLCC_NONE;
+  if ( pspdata->xc != NULL ) {
+    header.exchange = pspdata->xc->exchange;
+    header.correlation = pspdata->xc->correlation;
+    header.nlcc_scheme = pspdata->xc->nlcc_scheme;
+  }
+
+  np = packed->np;
+  src[SHARED_R] = pspdata->mesh->r;
+  header.bytes[SHARED_R] = np * sizeof(double);
+  src[SHARED_RAB] = pspdata->mesh->rab;
+  header.bytes[SHARED_RAB] = np * sizeof(double);
+  src[SHARED_STATES_N] = packed->states_n;
+  header.bytes[SHARED_STATES_N] = (size_t)packed->n_states * sizeof(int);
+  src[SHARED_STATES_L] = packed->states_l;
+  header.bytes[SHARED_STATES_L] = (size_t)packed->n_states * sizeof(int);
+  src[SHARED_STATES_J] = packed->states_j;
+  header.bytes[SHARED_STATES_J] = (size_t)packed->n_states * sizeof(double);
+  src[SHARED_STATES] = packed->states;
+  header.bytes[SHARED_STATES] = (size_t)packed->ld * packed->n_states * sizeof(double);
+  src[SHARED_STATES_COEF] = packed->states_coef;
+  header.bytes[SHARED_STATES_COEF] = 2 * np * packed->n_states * sizeof(double);
+  src[SHARED_POTENTIALS_L] = packed->potentials_l;
+  header.bytes[SHARED_POTENTIALS_L] = (size_t)packed->n_potentials * sizeof(int);
+  src[SHARED_POTENTIALS_J] = packed->potentials_j;
+  header.bytes[SHARED_POTENTIALS_J] = (size_t)packed->n_potentials * sizeof(double);
+  src[SHARED_POTENTIALS] = packed->potentials;
+  header.bytes[SHARED_POTENTIALS] = (size_t)packed->ld * packed->n_potentials * sizeof(double);
+  src[SHARED_POTENTIALS_COEF] = packed->potentials_coef;
+  header.bytes[SHARED_POTENTIALS_COEF] = 2 * np * packed->n_potentials * sizeof(double);
+  src[SHARED_PROJECTORS_L] = packed->projectors_l;
+  header.bytes[SHARED_PROJECTORS_L] = (size_t)packed->n_projectors * sizeof(int);
+  src[SHARED_PROJECTORS_J] = packed->projectors_j;
+  header.bytes[SHARED_PROJECTORS_J] = (size_t)packed->n_projectors * sizeof(double);
+  src[SHARED_PROJECTORS] = packed->projectors;
+  header.bytes[SHARED_PROJECTORS] = (size_t)packed->ld * packed->n_projectors * sizeof(double);
+  src[SHARED_PROJECTORS_COEF] = packed->projectors_coef;
+  header.bytes[SHARED_PROJECTORS_COEF] = 2 * np * packed->n_projectors * sizeof(double);
+  src[SHARED_PROJECTOR_ENERGIES] = pspdata->projector_energies;
+  header.bytes[SHARED_PROJECTOR_ENERGIES] = (pspdata->projector_energies == NULL) ? 0 :
+    (size_t)packed->n_projectors * packed->n_projectors * sizeof(double);
+  ierr = shared_values((pspdata->vlocal == NULL) ? NULL : pspdata->vlocal->v, np,
+    &src[SHARED_VLOCAL], &header.bytes[SHARED_VLOCAL]);
+  if ( ierr == PSPIO_SUCCESS ) {
+    ierr = shared_values((pspdata->xc == NULL) ? NULL : pspdata->xc->nlcc_dens, np,
+      &src[SHARED_NLCC_DENSITY], &header.bytes[SHARED_NLCC_DENSITY]);
+  }
+  if ( ierr == PSPIO_SUCCESS ) {
+    ierr = shared_values(pspdata->rho_valence, np,
+      &src[SHARED_RHO_VALENCE], &header.bytes[SHARED_RHO_VALENCE]);
+  }
+  if ( ierr != PSPIO_SUCCESS ) {
+    pspio_packed_free(packed);
+    RETURN_WITH_ERROR( ierr );
+  }
+
+  size = shared_align(sizeof(shared_header_t));
+  for (k=0; k<SHARED_NARRAYS; k++) {
+    if ( header.bytes[k] > 0 ) {
+      header.offset[k] = size;
+      size += shared_align(header.bytes[k]);
+    }
+  }
+  header.size = size;
+
+  /* Create and fill the segment */
+  ierr = PSPIO_SUCCESS;
+  base = MAP_FAILED;
+  fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+  if ( fd < 0 ) {
+    ierr = (errno == EEXIST) ? PSPIO_EVALUE : PSPIO_EIO;
+  } else {
+    if ( ftruncate(fd, (off_t)size) == 0 ) {
+      base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if ( base == MAP_FAILED ) {
+      shm_unlink(name);
+      ierr = PSPIO_EIO;
+    }
+  }
+  if ( ierr == PSPIO_SUCCESS ) {
+    memcpy(base, &header, sizeof(header));
+    for (k=0; k<SHARED_NARRAYS; k++) {
+      if ( header.bytes[k] > 0 ) {
+        memcpy((char *)base + header.offset[k], src[k], header.bytes[k]);
+      }
+    }
+    __sync_synchronize();
+    ((volatile shared_header_t *)base)->ready = 1;
+    mprotect(base, size, PROT_READ);
+  }
+  pspio_packed_free(packed);
+  FULFILL_OR_RETURN( ierr == PSPIO_SUCCESS, ierr );
+
+  shared->name = (char *) malloc ((strlen(name)+1) * sizeof(char));
+  FULFILL_OR_EXIT( shared->name != NULL, PSPIO_ENOMEM );
+  strcpy(shared->name, name);
+  shared->base = base;
+  shared->size = size;
+  shared->owner = 1;
+  shared_map_views(shared);
+
+  return PSPIO_SUCCESS;
+#else
+  assert(shared != NULL);
+  assert(name != NULL);
+  assert(pspdata != NULL);
+
+  RETURN_WITH_ERROR( PSPIO_ENOSUPPORT );
+#endif
+}
+
+int pspio_shared_attach(pspio_shared_t *shared, const char *name)
+{
+#if defined HAVE_SHM_OPEN
+  int fd;
+  size_t size;
+  void *base;
+
+  assert(shared != NULL);
+  assert(shared->base == NULL);
+  assert(name != NULL);
+
+  fd = shm_open(name, O_RDONLY, 0);
+  FULFILL_OR_RETURN( fd >= 0, (errno == ENOENT) ? PSPIO_ENOFILE : PSPIO_EIO );
+  size = shared_wait(fd);
+  if ( size == 0 ) {
+    close(fd);
+    RETURN_WITH_ERROR( PSPIO_EFILE_FORMAT );
+  }
+  base = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  FULFILL_OR_RETURN( base != MAP_FAILED, PSPIO_EIO );
+  if ( !shared_check(base, size) ) {
+    munmap(base, size);
+    RETURN_WITH_ERROR( PSPIO_EFILE_FORMAT );
+  }
+
+  shared->name = (char *) malloc ((strlen(name)+1) * sizeof(char));
+  FULFILL_OR_EXIT( shared->name != NULL, PSPIO_ENOMEM );
+  strcpy(shared->name, name);
+  shared->base = base;
+  shared->size = size;
+  shared->owner = 0;
+  shared_map_views(shared);
+
+  return PSPIO_SUCCESS;
+#else
+  assert(shared != NULL);
+  assert(name != NULL);
+
+  RETURN_WITH_ERROR( PSPIO_ENOSUPPORT );
+#endif
+}
+
+void pspio_shared_free(pspio_shared_t *shared)
+{
+  if ( shared != NULL ) {
+    shared_reset(shared);
+    free(shared);
+  }
+}
+
+int pspio_shared_unlink(const char *name)
+{
+  assert(name != NULL);
+
+#if defined HAVE_SHM_OPEN
+  FULFILL_OR_RETURN( shm_unlink(name) == 0,
+    (errno == ENOENT) ? PSPIO_ENOFILE : PSPIO_EIO );
+
+  return PSPIO_SUCCESS;
+#else
+  RETURN_WITH_ERROR( PSPIO_ENOSUPPORT );
+#endif
+}
+
+
+/**********************************************************************
+ * Getters                                                            *
+ **********************************************************************/
+
+const char *pspio_shared_get_name(const pspio_shared_t *shared)
+{
+  assert(shared != NULL);
+
+  return shared->name;
+}
+
+size_t pspio_shared_get_size(const pspio_shared_t *shared)
+{
+  assert(shared != NULL);
+
+  return shared->size;
+}
+
+int pspio_shared_get_format(const pspio_shared_t *shared)
+{
+  assert(shared != NULL);
+
+  return shared->format;
+}
+
+const char *pspio_shared_get_symbol(const pspio_shared_t *shared)
+{
+  assert(shared != NULL);
+
+  return shared->symbol;
+}
+
+double pspio_shared_get_z(const pspio_shared_t *shared)
+{
+  assert(shared != NULL);
+
+  return shared->z;
+}
+
+double pspio_shared_get_zvalence(const pspio_shared_t *shared)
+{
+  assert(shared != NULL);
+
+  return shared->zvalence;
+}
+
+double pspio_shared_get_nelvalence(const pspio_shared_t *shared)
+{
+  assert(shared != NULL);
+
+  return shared->nelvalence;
+}
+
+int pspio_shared_get_l_max(const pspio_shared_t *shared)
+{
+  assert(shared != NULL);
+
+  return shared->l_max;
+}
+
+int pspio_shared_get_l_local(const pspio_shared_t *shared)
+{
+  assert(shared != NULL);
+
+  return shared->l_local;
+}
+
+int pspio_shared_get_exchange(const pspio_shared_t *shared)
+{
+  assert(shared != NULL);
+
+  return shared->exchange;
+}
+
+int pspio_shared_get_correlation(const pspio_shared_t *shared)
+{
+  assert(shared != NULL);
+
+  return shared->correlation;
+}
+
+int pspio_shared_get_nlcc_scheme(const pspio_shared_t *shared)
+{
+  assert(shared != NULL);
+
+  return shared->nlcc_scheme;
+}
+
+const double *pspio_shared_get_projector_energies(const pspio_shared_t *shared)
+{
+  assert(shared != NULL);
+
+  return shared->projector_energies;
+}
+
+const double *pspio_shared_get_vlocal(const pspio_shared_t *shared)
+{
+  assert(shared != NULL);
+
+  return shared->vlocal;
+}
+
+const double *pspio_shared_get_nlcc_density(const pspio_shared_t *shared)
+{
+  assert(shared != NULL);
+
+  return shared->nlcc_density;
+}
+
+const double *pspio_shared_get_rho_valence(const pspio_shared_t *shared)
+{
+  assert(shared != NULL);
+
+  return shared->rho_valence;
+}
+
+const pspio_mesh_t *pspio_shared_get_mesh(const pspio_shared_t *shared)
+{
+  assert(shared != NULL);
+  assert(shared->base != NULL);
+
+  return &shared->mesh;
+}
+
+const pspio_packed_t *pspio_shared_get_packed(const pspio_shared_t *shared)
+{
+  assert(shared != NULL);
+  assert(shared->base != NULL);
+
+  return &shared->packed;
+}
@@ -0,0 +1,254 @@
+/* Copyright (C) 2018 Micael Oliveira <micael.oliveira@mpsd.mpg.de>
+ *                    Yann Pouillon <devops@materialsevolution.es>
+ *
+ * This file is part of Libpspio.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * version 2.0. If a copy of the MPL was not distributed with this file, You
+ * can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Libpspio is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the Mozilla Public License version 2.0 for
+ * more details.
+ */
+
+#ifndef PSPIO_SHARED_H
+#define PSPIO_SHARED_H
+
+/**
+ * @file pspio_shared.h
+ * @brief header file for the publication of pseudopotential data in
+ *        POSIX shared memory
+ */
+
+#include <stddef.h>
+
+#include "pspio_error.h"
+#include "pspio_mesh.h"
+#include "pspio_packed.h"
+#include "pspio_pspdata.h"
+
+
+/**********************************************************************
+ * Data structures                                                    *
+ **********************************************************************/
+
+/**
+ * Read-only view of a pseudopotential published in a shared-memory
+ * segment.
+ *
+ * The segment holds a header with the scalar data of the
+ * pseudopotential followed by the mesh and the blocks of a packed
+ * structure, each one aligned on PSPIO_PACKED_ALIGN bytes. The header
+ * refers to the blocks by their offsets from the start of the segment,
+ * so that every process can map it at a different address. The mesh and
+ * packed members point into the mapping.
+ */
+typedef struct{
+  char *name;             /**< Name of the segment */
+  void *base;             /**< Address of the mapping, NULL if none */
+  size_t size;            /**< Size of the mapping, in bytes */
+  int owner;              /**< 1 if the segment was created by this process */
+
+  int format;             /**< Format of the file the data was read from */
+  char symbol[4];         /**< Atomic symbol */
+  double z;               /**< Atomic number */
+  double zvalence;        /**< Charge of pseudopotential ion */
+  double nelvalence;      /**< Number of electrons */
+  int l_max;              /**< Maximal angular momentum channel */
+  int l_local;            /**< Angular momentum channel of the local potential */
+  int exchange;           /**< Exchange functional id, 0 if unknown */
+  int correlation;        /**< Correlation functional id, 0 if unknown */
+  int nlcc_scheme;        /**< Scheme used to obtain the core density */
+
+  const double *projector_energies; /**< Projector energies D_ij, NULL if none */
+  const double *vlocal;             /**< Local potential on the mesh, NULL if none */
+  const double *nlcc_density;       /**< Core density on the mesh, NULL if none */
+  const double *rho_valence;        /**< Valence density on the mesh, NULL if none */
+
+  pspio_mesh_t mesh;      /**< Mesh, with its points in the segment */
+  pspio_packed_t packed;  /**< Radial functions, with their blocks in the segment */
+} pspio_shared_t;
+
+
+/**********************************************************************
+ * Global routines                                                    *
+ **********************************************************************/
+
+/**
+ * Allocates memory and presets the shared structure
+ *
+ * @param[in,out] shared: shared structure
+ * @return error code
+ * @note shared must be NULL on input.
+ */
+int pspio_shared_alloc(pspio_shared_t **shared);
+
+/**
+ * Creates a shared-memory segment holding the packed view of pspdata,
+ * see pspio_packed_init, and maps it read-only.
+ *
+ * @param[in,out] shared: shared structure, which must not be mapped
+ * @param[in] name: name of the segment, starting with a slash
+ * @param[in] pspdata: pseudopotential data to publish
+ * @return error code: PSPIO_EVALUE if a segment with that name already
+ *         exists, PSPIO_ENOSUPPORT without POSIX shared memory
+ * @note The segment is marked ready once it has been filled:
+ *       processes attaching before that wait for it.
+ * @note The segment outlives the process until pspio_shared_unlink is
+ *       called.
+ */
+int pspio_shared_publish(pspio_shared_t *shared, const char *name,
+                         const pspio_pspdata_t *pspdata);
+
+/**
+ * Maps read-only a segment created by pspio_shared_publish, possibly
+ * by another process.
+ *
+ * @param[in,out] shared: shared structure, which must not be mapped
+ * @param[in] name: name of the segment
+ * @return error code: PSPIO_ENOFILE if there is no such segment,
+ *         PSPIO_EFILE_FORMAT if it was not written by pspio_shared_publish
+ *         or is still not ready after 10 seconds,
+ *         PSPIO_ENOSUPPORT without POSIX shared memory
+ */
+int pspio_shared_attach(pspio_shared_t *shared, const char *name);
+
+/**
+ * Unmaps the segment, which stays available to the other processes,
+ * and frees all memory associated with the shared structure
+ *
+ * @param[in,out] shared: shared structure
+ */
+void pspio_shared_free(pspio_shared_t *shared);
+
+/**
+ * Removes the name of a segment. Processes that have it mapped keep
+ * their view until they free it.
+ *
+ * @param[in] name: name of the segment
+ * @return error code
+ */
+int pspio_shared_unlink(const char *name);
+
+
+/**********************************************************************
+ * Getters                                                            *
+ **********************************************************************/
+
+/**
+ * @param[in] shared: shared structure
+ * @return name of the segment, NULL if not mapped
+ */
+const char *pspio_shared_get_name(const pspio_shared_t *shared);
+
+/**
+ * @param[in] shared: shared structure
+ * @return size of the segment, in bytes
+ */
+size_t pspio_shared_get_size(const pspio_shared_t *shared);
+
+/**
+ * @param[in] shared: shared structure
+ * @return format of the file the data was read from
+ */
+int pspio_shared_get_format(const pspio_shared_t *shared);
+
+/**
+ * @param[in] shared: shared structure
+ * @return atomic symbol
+ */
+const char *pspio_shared_get_symbol(const pspio_shared_t *shared);
+
+/**
+ * @param[in] shared: shared structure
+ * @return atomic number
+ */
+double pspio_shared_get_z(const pspio_shared_t *shared);
+
+/**
+ * @param[in] shared: shared structure
+ * @return valence charge
+ */
+double pspio_shared_get_zvalence(const pspio_shared_t *shared);
+
+/**
+ * @param[in] shared: shared structure
+ * @return number of electrons
+ */
+double pspio_shared_get_nelvalence(const pspio_shared_t *shared);
+
+/**
+ * @param[in] shared: shared structure
+ * @return maximal angular momentum channel
+ */
+int pspio_shared_get_l_max(const pspio_shared_t *shared);
+
+/**
+ * @param[in] shared: shared structure
+ * @return angular momentum channel of the local potential
+ */
+int pspio_shared_get_l_local(const pspio_shared_t *shared);
+
+/**
+ * @param[in] shared: shared structure
+ * @return exchange functional id
+ */
+int pspio_shared_get_exchange(const pspio_shared_t *shared);
+
+/**
+ * @param[in] shared: shared structure
+ * @return correlation functional id
+ */
+int pspio_shared_get_correlation(const pspio_shared_t *shared);
+
+/**
+ * @param[in] shared: shared structure
+ * @return scheme used to obtain the core density
+ */
+int pspio_shared_get_nlcc_scheme(const pspio_shared_t *shared);
+
+/**
+ * @param[in] shared: shared structure
+ * @return projector energies D_ij, stored as D[i*n_projectors+j], NULL
+ *         if none
+ */
+const double *pspio_shared_get_projector_energies(const pspio_shared_t *shared);
+
+/**
+ * @param[in] shared: shared structure
+ * @return values of the local potential on the mesh, NULL if none
+ */
+const double *pspio_shared_get_vlocal(const pspio_shared_t *shared);
+
+/**
+ * @param[in] shared: shared structure
+ * @return values of the core density on the mesh, NULL if none
+ */
+const double *pspio_shared_get_nlcc_density(const pspio_shared_t *shared);
+
+/**
+ * @param[in] shared: shared structure
+ * @return values of the valence density on the mesh, NULL if none
+ */
+const double *pspio_shared_get_rho_valence(const pspio_shared_t *shared);
+
+/**
+ * @param[in] shared: shared structure
+ * @return pointer to the mesh stored in the segment
+ */
+const pspio_mesh_t *pspio_shared_get_mesh(const pspio_shared_t *shared);
+
+/**
+ * Returns the packed view of the radial functions, to use with the
+ * getters and the pspio_packed_eval_* routines
+ *
+ * @param[in] shared: shared structure
+ * @return pointer to the packed view
+ * @note The view must not be passed to pspio_packed_init nor
+ *       pspio_packed_free.
+ */
+const pspio_packed_t *pspio_shared_get_packed(const pspio_shared_t *shared);
+
+#endif
@@ -18,6 +18,7 @@
 #include <string.h>
 #include <math.h>
 
+#include "instrument.h"
 #include "pspio_state.h"
 #include "util.h"
 
@@ -40,6 +41,7 @@ int pspio_state_alloc(pspio_state_t **state, int np)
 
   *state = (pspio_state_t *) malloc (sizeof(pspio_state_t));
   FULFILL_OR_EXIT( *state != NULL, PSPIO_ENOMEM );
+  INSTR_COUNT(PSPIO_COUNTER_ALLOCS);
 
   (*state)->wf = NULL;
   ierr = pspio_meshfunc_alloc(&(*state)->wf, np);
@@ -131,6 +133,8 @@ int pspio_state_copy(pspio_state_t **dst, const pspio_state_t *src)
   memcpy((*dst)->label, src->label, s);
   (*dst)->label[s] = '\0';
 
+  INSTR_COUNT(PSPIO_COUNTER_COPIES);
+
   return PSPIO_SUCCESS;
 }
 
@@ -254,6 +258,7 @@ int pspio_state_cmp(const pspio_state_t *state1, const pspio_state_t *state2) {
 double pspio_state_wf_eval(const pspio_state_t *state, double r)
 {
   assert(state != NULL);
+  INSTR_COUNT(PSPIO_COUNTER_EVAL_STATE);
   
   return pspio_meshfunc_eval(state->wf, r);
 }
@@ -261,6 +266,7 @@ double pspio_state_wf_eval(const pspio_state_t *state, double r)
 double pspio_state_wf_eval_deriv(const pspio_state_t *state, double r)
 {
   assert(state != NULL);
+  INSTR_COUNT(PSPIO_COUNTER_EVAL_STATE);
   
   return pspio_meshfunc_eval_deriv(state->wf, r);
 }
@@ -268,6 +274,35 @@ double pspio_state_wf_eval_deriv(const pspio_state_t *state, double r)
 double pspio_state_wf_eval_deriv2(const pspio_state_t *state, double r)
 {
   assert(state != NULL);
+  INSTR_COUNT(PSPIO_COUNTER_EVAL_STATE);
   
   return pspio_meshfunc_eval_deriv2(state->wf, r);
 }
+
+double pspio_state_wf_eval_located(const pspio_state_t *state, const pspio_mesh_loc_t *loc)
+{
+  assert(state != NULL);
+  INSTR_COUNT(PSPIO_COUNTER_EVAL_STATE);
+
+  return pspio_meshfunc_eval_located(state->wf, loc);
+}
+
+double pspio_state_wf_eval_deriv_located(const pspio_state_t *state, const pspio_mesh_loc_t *loc)
+{
+  assert(state != NULL);
+  INSTR_COUNT(PSPIO_COUNTER_EVAL_STATE);
+
+  return pspio_meshfunc_eval_deriv_located(state->wf, loc);
+}
+
+void pspio_state_memory_usage(const pspio_state_t *state, pspio_memory_t *usage)
+{
+  assert(usage != NULL);
+
+  if ( state == NULL ) return;
+
+  usage->metadata += sizeof(pspio_state_t);
+  if ( state->qn != NULL ) usage->metadata += sizeof(pspio_qn_t);
+  if ( state->label != NULL ) usage->metadata += strlen(state->label) + 1;
+  pspio_meshfunc_memory_usage(state->wf, usage);
+}
@@ -197,4 +197,32 @@ double pspio_state_wf_eval_deriv(const pspio_state_t *state, double r);
  */
 double pspio_state_wf_eval_deriv2(const pspio_state_t *state, double r);
 
+/**
+ * Returns the value of the wavefunction at a point located with
+ * pspio_mesh_locate, sharing the search with other functions
+ * defined on the same mesh
+ *
+ * @param[in] state: state structure
+ * @param[in] loc: position of the point
+ * @return value of the wavefunction at loc
+ */
+double pspio_state_wf_eval_located(const pspio_state_t *state, const pspio_mesh_loc_t *loc);
+
+/**
+ * Returns the value of the derivative of the wavefunction at a located point
+ *
+ * @param[in] state: state structure
+ * @param[in] loc: position of the point
+ * @return value of the derivative at loc
+ */
+double pspio_state_wf_eval_deriv_located(const pspio_state_t *state, const pspio_mesh_loc_t *loc);
+
+/**
+ * Adds the memory footprint of state to usage
+ *
+ * @param[in] state: state structure, may be NULL
+ * @param[in,out] usage: memory footprint to update
+ */
+void pspio_state_memory_usage(const pspio_state_t *state, pspio_memory_t *usage);
+
 #endif
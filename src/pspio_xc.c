@@ -16,6 +16,7 @@
 #include <stdlib.h>
 #include <assert.h>
 
+#include "instrument.h"
 #include "pspio_xc.h"
 
 #if defined HAVE_CONFIG_H
@@ -34,6 +35,7 @@ int pspio_xc_alloc(pspio_xc_t **xc)
 
   *xc = (pspio_xc_t *) malloc (sizeof(pspio_xc_t));
   FULFILL_OR_RETURN( *xc != NULL, PSPIO_ENOMEM );
+  INSTR_COUNT(PSPIO_COUNTER_ALLOCS);
 
   (*xc)->correlation = XC_NONE;
   (*xc)->exchange = XC_NONE;
@@ -92,6 +94,8 @@ int pspio_xc_copy(pspio_xc_t **dst, const pspio_xc_t *src)
     SUCCEED_OR_RETURN( pspio_meshfunc_copy(&(*dst)->nlcc_dens, src->nlcc_dens) );
   }
 
+  INSTR_COUNT(PSPIO_COUNTER_COPIES);
+
   return PSPIO_SUCCESS;
 }
 
@@ -255,6 +259,7 @@ int pspio_xc_cmp(const pspio_xc_t *xc1, const pspio_xc_t *xc2) {
 double pspio_xc_nlcc_density_eval(const pspio_xc_t *xc, double r)
 {
   assert(xc != NULL);
+  INSTR_COUNT(PSPIO_COUNTER_EVAL_XC);
 
   if (xc->nlcc_scheme != PSPIO_NLCC_NONE) {
     return pspio_meshfunc_eval(xc->nlcc_dens, r);
@@ -266,6 +271,7 @@ double pspio_xc_nlcc_density_eval(const pspio_xc_t *xc, double r)
 double pspio_xc_nlcc_density_eval_deriv(const pspio_xc_t *xc, double r)
 {
   assert(xc != NULL);
+  INSTR_COUNT(PSPIO_COUNTER_EVAL_XC);
 
   if (xc->nlcc_scheme != PSPIO_NLCC_NONE) {
     return pspio_meshfunc_eval_deriv(xc->nlcc_dens, r);
@@ -277,6 +283,7 @@ double pspio_xc_nlcc_density_eval_deriv(const pspio_xc_t *xc, double r)
 double pspio_xc_nlcc_density_eval_deriv2(const pspio_xc_t *xc, double r)
 {
   assert(xc != NULL);
+  INSTR_COUNT(PSPIO_COUNTER_EVAL_XC);
 
   if (xc->nlcc_scheme != PSPIO_NLCC_NONE) {
     return pspio_meshfunc_eval_deriv2(xc->nlcc_dens, r);
@@ -285,9 +292,43 @@ double pspio_xc_nlcc_density_eval_deriv2(const pspio_xc_t *xc, double r)
   }
 }
 
+double pspio_xc_nlcc_density_eval_located(const pspio_xc_t *xc, const pspio_mesh_loc_t *loc)
+{
+  assert(xc != NULL);
+  INSTR_COUNT(PSPIO_COUNTER_EVAL_XC);
+
+  if (xc->nlcc_scheme != PSPIO_NLCC_NONE) {
+    return pspio_meshfunc_eval_located(xc->nlcc_dens, loc);
+  } else {
+    return 0.0;
+  }
+}
+
+double pspio_xc_nlcc_density_eval_deriv_located(const pspio_xc_t *xc, const pspio_mesh_loc_t *loc)
+{
+  assert(xc != NULL);
+  INSTR_COUNT(PSPIO_COUNTER_EVAL_XC);
+
+  if (xc->nlcc_scheme != PSPIO_NLCC_NONE) {
+    return pspio_meshfunc_eval_deriv_located(xc->nlcc_dens, loc);
+  } else {
+    return 0.0;
+  }
+}
+
 int pspio_xc_has_nlcc(const pspio_xc_t *xc)
 {
   assert (xc != NULL);
 
   return (xc->nlcc_scheme != PSPIO_NLCC_NONE);
 }
+
+void pspio_xc_memory_usage(const pspio_xc_t *xc, pspio_memory_t *usage)
+{
+  assert(usage != NULL);
+
+  if ( xc == NULL ) return;
+
+  usage->metadata += sizeof(pspio_xc_t);
+  pspio_meshfunc_memory_usage(xc->nlcc_dens, usage);
+}
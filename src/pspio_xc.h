@@ -239,6 +239,28 @@ double pspio_xc_nlcc_density_eval_deriv(const pspio_xc_t *xc, double r);
  */
 double pspio_xc_nlcc_density_eval_deriv2(const pspio_xc_t *xc, double r);
 
+/**
+ * Returns the value of the core density at a point located with
+ * pspio_mesh_locate, sharing the search with other functions
+ * defined on the same mesh
+ *
+ * @param[in] xc: xc structure
+ * @param[in] loc: position of the point
+ * @return value of the core density at loc
+ * @note The xc pointer has to be fully set.
+ */
+double pspio_xc_nlcc_density_eval_located(const pspio_xc_t *xc, const pspio_mesh_loc_t *loc);
+
+/**
+ * Returns the value of the derivative of the core density at a located point
+ *
+ * @param[in] xc: xc structure
+ * @param[in] loc: position of the point
+ * @return value of the derivative at loc
+ * @note The xc pointer has to be fully set.
+ */
+double pspio_xc_nlcc_density_eval_deriv_located(const pspio_xc_t *xc, const pspio_mesh_loc_t *loc);
+
 /**
  * Returns if xc has non-linear core-corrections
  * @param[in] xc: xc structure
@@ -246,4 +268,12 @@ double pspio_xc_nlcc_density_eval_deriv2(const pspio_xc_t *xc, double r);
  */
 int pspio_xc_has_nlcc(const pspio_xc_t *xc);
 
+/**
+ * Adds the memory footprint of xc to usage
+ *
+ * @param[in] xc: xc structure, may be NULL
+ * @param[in,out] usage: memory footprint to update
+ */
+void pspio_xc_memory_usage(const pspio_xc_t *xc, pspio_memory_t *usage);
+
 #endif
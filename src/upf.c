@@ -49,10 +49,30 @@ int pspio_upf_read(FILE *fp, pspio_pspdata_t *pspdata)
   if ( pspio_xc_has_nlcc(pspdata->xc) ) {
     SUCCEED_OR_RETURN( upf_read_nlcc(fp, np, pspdata) );
   }
-  SUCCEED_OR_RETURN( upf_read_nonlocal(fp, np, pspdata) );
-  SUCCEED_OR_RETURN( upf_read_pswfc(fp, np, pspdata) );
-  SUCCEED_OR_RETURN( upf_read_local(fp, np, pspdata) );
-  SUCCEED_OR_RETURN( upf_read_rhoatom(fp, np, pspdata) );
+
+  /* Sections of the components that were not asked for are skipped */
+  if ( pspdata->loaded & PSPIO_LOAD_PROJECTORS ) {
+    SUCCEED_OR_RETURN( upf_read_nonlocal(fp, np, pspdata) );
+  }
+  if ( pspdata->loaded & PSPIO_LOAD_STATES ) {
+    SUCCEED_OR_RETURN( upf_read_pswfc(fp, np, pspdata) );
+  }
+  if ( pspdata->loaded & PSPIO_LOAD_VLOCAL ) {
+    SUCCEED_OR_RETURN( upf_read_local(fp, np, pspdata) );
+  }
+  if ( pspdata->loaded & PSPIO_LOAD_RHO_VALENCE ) {
+    SUCCEED_OR_RETURN( upf_read_rhoatom(fp, np, pspdata) );
+  }
+
+  return PSPIO_SUCCESS;
+}
+
+int pspio_upf_read_header(FILE *fp, pspio_pspdata_t *pspdata)
+{
+  /* Looking for PP_ADDINFO would mean scanning the whole file, so the
+     wave equation is left unset */
+  SUCCEED_OR_RETURN( upf_read_info(fp, pspdata) );
+  SUCCEED_OR_RETURN( upf_read_header(fp, &pspdata->np, pspdata) );
 
   return PSPIO_SUCCESS;
 }
@@ -48,6 +48,14 @@
  */
 int pspio_upf_read(FILE * fp, pspio_pspdata_t *pspdata);
 
+/**
+ * Read the PP_INFO and PP_HEADER sections of a UPF file only
+ * @param[in] fp a stream of the input file
+ * @param[in,out] pspdata the data structure
+ * @return error code
+ */
+int pspio_upf_read_header(FILE * fp, pspio_pspdata_t *pspdata);
+
 /**
  * Write the data contained in the psp_data structure to a file using the UPF format
  * @param[in] fp a stream of the input file
@@ -23,6 +23,7 @@
 
 #include "pspio_common.h"
 #include "pspio_error.h"
+#include "instrument.h"
 #include "upf.h"
 #include "util.h"
 #include "pspio.h"
@@ -58,7 +59,7 @@ int upf_read_info(FILE *fp, pspio_pspdata_t *pspdata)
 
   /* Store all the lines */
   for (il=0; il<nlines; il++) {
-    FULFILL_OR_RETURN( fgets(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+    FULFILL_OR_RETURN( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
     info = realloc(info, strlen(info)+strlen(line)+1);
     FULFILL_OR_EXIT(info != NULL, PSPIO_ENOMEM);
     strncat(info, line, strlen(line));
@@ -75,6 +76,7 @@ int upf_read_info(FILE *fp, pspio_pspdata_t *pspdata)
 static int upf_read_header_old(FILE *fp, int *np, pspio_pspdata_t *pspdata)
 {
   char line[PSPIO_STRLEN_LINE];
+  char *save = NULL;
   int version_number, i;
   char symbol[4], nlcc_flag[2], xc_string[23];
   int exchange, correlation, l_max, n_states, n_projectors;
@@ -85,66 +87,66 @@ static int upf_read_header_old(FILE *fp, int *np, pspio_pspdata_t *pspdata)
   SUCCEED_OR_RETURN( upf_tag_init(fp,"PP_HEADER", GO_BACK) );
 
   /* Read the version number */
-  FULFILL_OR_RETURN( fgets(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+  FULFILL_OR_RETURN( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
   FULFILL_OR_RETURN( sscanf(line, "%d", &version_number) == 1,
     PSPIO_EFILE_CORRUPT );
  
   /* Read the atomic symbol */
-  FULFILL_OR_RETURN( fgets(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
-  strncpy(symbol, strtok(line," "), 3);
+  FULFILL_OR_RETURN( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+  strncpy(symbol, strtok_r(line, " ", &save), 3);
   symbol[3] = '\0';
   SUCCEED_OR_RETURN( pspio_pspdata_set_symbol(pspdata, symbol) );
   SUCCEED_OR_RETURN( symbol_to_z(symbol, &z) );
   SUCCEED_OR_RETURN( pspio_pspdata_set_z(pspdata, z) );
 
   /* Read the kind of pseudo-potentials US|NC|PAW */
-  FULFILL_OR_RETURN( fgets(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+  FULFILL_OR_RETURN( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
   /* At the moment LIBPSP_IO can only read norm-conserving pseudo-potentials */
-  FULFILL_OR_RETURN( strncmp(strtok(line," "), "NC", 2) == 0, PSPIO_ENOSUPPORT );
+  FULFILL_OR_RETURN( strncmp(strtok_r(line, " ", &save), "NC", 2) == 0, PSPIO_ENOSUPPORT );
 
   /* Read the nonlinear core correction */
-  FULFILL_OR_RETURN( fgets(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+  FULFILL_OR_RETURN( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
   FULFILL_OR_RETURN( sscanf(line, "%1s", nlcc_flag) == 1, PSPIO_EFILE_CORRUPT );
 
   /* Exchange-correlation functional */
   /* Note: the xc string should always contain the first 21 chars of the line */
-  FULFILL_OR_RETURN( fgets(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+  FULFILL_OR_RETURN( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
   strncpy(xc_string, line, 22);
   xc_string[22] = '\0';
   SUCCEED_OR_RETURN( upf_to_libxc(xc_string, &exchange, &correlation) );
 
   /* Read the Z valence */
-  FULFILL_OR_RETURN( fgets(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+  FULFILL_OR_RETURN( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
   FULFILL_OR_RETURN( sscanf(line, "%lf", &zvalence) == 1, PSPIO_EFILE_CORRUPT );
   SUCCEED_OR_RETURN( pspio_pspdata_set_zvalence(pspdata, zvalence) );
 
   /* Read the total energy */
-  FULFILL_OR_RETURN( fgets(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+  FULFILL_OR_RETURN( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
   FULFILL_OR_RETURN( sscanf(line, "%lf", &total_energy) == 1, PSPIO_EFILE_CORRUPT );
   SUCCEED_OR_RETURN( pspio_pspdata_set_total_energy(pspdata, total_energy) );
 
   /* Read the suggested cutoff for wfc and rho */
-  FULFILL_OR_RETURN( fgets(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+  FULFILL_OR_RETURN( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
   FULFILL_OR_RETURN( sscanf(line, "%lf %lf", &wfc_cutoff, &rho_cutoff) == 2, PSPIO_EFILE_CORRUPT );
   
   /* Read the max angular momentun component of the KB projectors */
-  FULFILL_OR_RETURN( fgets(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+  FULFILL_OR_RETURN( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
   FULFILL_OR_RETURN( sscanf(line, "%d", &l_max) == 1, PSPIO_EFILE_CORRUPT );
   SUCCEED_OR_RETURN( pspio_pspdata_set_l_max(pspdata, l_max) );
 
   /* Read the number of points in mesh */
-  FULFILL_OR_RETURN( fgets(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+  FULFILL_OR_RETURN( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
   FULFILL_OR_RETURN( sscanf(line, "%d", np) == 1, PSPIO_EFILE_CORRUPT );
   
   /* Read the number of wavefunctions and projectors */
-  FULFILL_OR_RETURN( fgets(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+  FULFILL_OR_RETURN( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
   FULFILL_OR_RETURN( sscanf(line, "%d %d", &n_states, &n_projectors) == 2, PSPIO_EFILE_CORRUPT );
   SUCCEED_OR_RETURN( pspio_pspdata_set_n_states(pspdata, n_states) );
   SUCCEED_OR_RETURN( pspio_pspdata_set_n_projectors(pspdata, n_projectors) );
 
   /* Skip info on wavefunctions, as it is repeated in the PP_PSWFC block */
   for (i=0; i<pspdata->n_states+1; i++) {
-    FULFILL_OR_RETURN( fgets(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+    FULFILL_OR_RETURN( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
   }
 
   /* Initialize xc */
@@ -318,7 +320,7 @@ static int upf_read_dij_old(FILE *fp, pspio_pspdata_t *pspdata)
   SUCCEED_OR_RETURN( upf_tag_init(fp,"PP_DIJ",NO_GO_BACK) );
 
   /* Read the number of n_dij */
-  FULFILL_OR_EXIT( fgets(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+  FULFILL_OR_EXIT( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
   FULFILL_OR_EXIT( sscanf(line,"%d", &n_dij) == 1, PSPIO_EFILE_CORRUPT );
   FULFILL_OR_EXIT( n_dij == pspdata->n_projectors, PSPIO_EFILE_CORRUPT );
 
@@ -327,7 +329,7 @@ static int upf_read_dij_old(FILE *fp, pspio_pspdata_t *pspdata)
   FULFILL_OR_EXIT(dij != NULL, PSPIO_ENOMEM);
 
   for (i=0; i<n_dij; i++){
-    FULFILL_OR_BREAK( fgets(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+    FULFILL_OR_BREAK( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
     FULFILL_OR_BREAK( sscanf(line,"%d %d %lf", &ii, &jj, &energy) == 3,
       PSPIO_EFILE_CORRUPT );
     FULFILL_OR_BREAK( ii == jj, PSPIO_EVALUE );
@@ -389,12 +391,12 @@ static int upf_read_beta_old(FILE *fp, int np, int index, double *projector_read
 
   SUCCEED_OR_RETURN( upf_tag_init(fp, "PP_BETA", NO_GO_BACK) );
 
-  FULFILL_OR_RETURN( fgets(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+  FULFILL_OR_RETURN( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
   FULFILL_OR_RETURN( sscanf(line, "%d %d", &ii, l) == 2,
                      PSPIO_EFILE_CORRUPT );
 
   /* Read the number of points of projections */
-  FULFILL_OR_RETURN( fgets(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+  FULFILL_OR_RETURN( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
   FULFILL_OR_RETURN( sscanf(line, "%d", &proj_np) == 1, PSPIO_EFILE_CORRUPT );
 
   /* Read the projector function */
@@ -410,7 +412,7 @@ static int upf_read_beta_old(FILE *fp, int np, int index, double *projector_read
       the end of this block, so we will try to skip them. Note that one
       line was already read by upf_tag_check_end.
     */
-    FULFILL_OR_RETURN( fgets(line, PSPIO_STRLEN_LINE, fp) != NULL,
+    FULFILL_OR_RETURN( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL,
                        PSPIO_EIO );
     SUCCEED_OR_RETURN( upf_tag_check_end(fp,"PP_BETA") );
   }
@@ -474,11 +476,11 @@ int upf_read_nonlocal(FILE *fp, int np, pspio_pspdata_t *pspdata)
     SKIP_FUNC_ON_ERROR( upf_tag_init(fp,"PP_ADDINFO",GO_BACK) );
     /* Skip the lines with the wavefunctions info */
     for (i=0; i<pspdata->n_states; i++) {
-      FULFILL_OR_BREAK( fgets(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+      FULFILL_OR_BREAK( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
     }
     /* Read j quantum numbers */
     for (i=0; i<pspdata->n_projectors; i++) {
-      FULFILL_OR_BREAK( fgets(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+      FULFILL_OR_BREAK( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
       FULFILL_OR_BREAK( sscanf(line,"%d %lf",&j, &proj_j[i]) == 2, PSPIO_EFILE_CORRUPT );
     }
   } else {
@@ -530,9 +532,9 @@ int upf_read_local(FILE *fp, int np, pspio_pspdata_t *pspdata)
   for (i=0; i<np; i++) vlocal[i] = 0.0;
 
   /* Deduce l local (this is done in a very crude way and it should
-     probably be made more robust) */
+     probably be made more robust), which needs the projectors */
   pspdata->l_local = -1;
-  for (i=0; i<pspdata->l_max+1; i++) {
+  for (i=0; (i<pspdata->l_max+1) && (pspdata->loaded & PSPIO_LOAD_PROJECTORS); i++) {
     n = 0;
     for (j=0; j<pspdata->n_projectors; j++) {
       if ( pspio_qn_get_l(pspio_projector_get_qn(pspdata->projectors[j])) == i ) n++;
@@ -572,7 +574,7 @@ static int upf_read_pswfc_one_old(FILE *fp, int np, int index, double *wf,
   char ll;
 
   /* Read the quantum numbers and occupations */
-  FULFILL_OR_RETURN( fgets(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+  FULFILL_OR_RETURN( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
   // TODO: ask QE developers whether they still accept the old format
   //       like in the He pseudo
   //FULFILL_OR_BREAK( sscanf(line, "%1d%1c %d %lf", &n, &ll, &l, &occ) == 4, PSPIO_EFILE_CORRUPT );
@@ -656,7 +658,7 @@ int upf_read_pswfc(FILE *fp, int np, pspio_pspdata_t *pspdata)
   if ( pspdata->wave_eq == PSPIO_EQN_DIRAC ) {
     DEFER_FUNC_ERROR( upf_tag_init(fp,"PP_ADDINFO",GO_BACK) );
     for (is=0; is<pspdata->n_states; is++) {
-      FULFILL_OR_BREAK( fgets(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+      FULFILL_OR_BREAK( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
       FULFILL_OR_BREAK( sscanf(line,"%1d%1c %d %d %lf %lf",
         &n, &ll, &i, &l, &j[is], &occ) == 6, PSPIO_EFILE_CORRUPT );
     }
@@ -21,6 +21,7 @@
 #include <string.h>
 #include <ctype.h>
 
+#include "instrument.h"
 #include "upf.h"
 
 #if defined HAVE_CONFIG_H
@@ -40,7 +41,7 @@ int upf_tag_init(FILE * fp, const char * tag, int go_back)
   /* Prepare base string */
   sprintf(init_tag, "<%s", tag);
 
-  while ( fgets(line, sizeof line, fp) != NULL ) {
+  while ( INSTR_FGETS(line, sizeof line, fp) != NULL ) {
     /* Skip white spaces */
     read_string = line;
     while (read_string[0] == ' ') read_string++;
@@ -48,7 +49,7 @@ int upf_tag_init(FILE * fp, const char * tag, int go_back)
     ln = strlen(init_tag);
     if ( strncasecmp(read_string, init_tag, ln) == 0 ) {
       if ( strchr(read_string + ln, '>') ) return PSPIO_SUCCESS;
-      while ( fgets(line, sizeof line, fp) != NULL ) {
+      while ( INSTR_FGETS(line, sizeof line, fp) != NULL ) {
         if ( strchr(line, '>') ) return PSPIO_SUCCESS;
       }
       return PSPIO_EFILE_CORRUPT;
@@ -62,16 +63,16 @@ int upf_tag_check_end(FILE *fp, const char *tag)
 {
   char line[PSPIO_STRLEN_LINE];
   char end_tag[PSPIO_STRLEN_LINE];
-  char * read_string = NULL;
+  char * read_string = NULL, * save = NULL;
   int status;
 
   /* Prepare base string */
   sprintf(end_tag, "</%s>", tag);
 
-  FULFILL_OR_RETURN( fgets(line, sizeof line, fp) != NULL, PSPIO_EIO );
+  FULFILL_OR_RETURN( INSTR_FGETS(line, sizeof line, fp) != NULL, PSPIO_EIO );
   /* Skip white spaces */
   if (line[0] == ' ')
-    read_string = strtok(line," ");
+    read_string = strtok_r(line, " ", &save);
   else
     read_string = line;
 
@@ -95,7 +96,7 @@ char* upf_tag_read_attr(FILE *fp, const char * tag, const char * attr,
 {
   char line[PSPIO_STRLEN_LINE];
   char init_tag[PSPIO_STRLEN_LINE];
-  char * read_string = NULL, * at = NULL;
+  char * read_string = NULL, * at = NULL, * save = NULL;
   int tag_found = 0;
 
   rewind(fp);
@@ -103,7 +104,7 @@ char* upf_tag_read_attr(FILE *fp, const char * tag, const char * attr,
   /* Prepare base string */
   sprintf(init_tag, "<%s", tag);
 
-  while ( fgets(at ? line : buf, PSPIO_STRLEN_LINE, fp) != NULL ) {
+  while ( INSTR_FGETS(at ? line : buf, PSPIO_STRLEN_LINE, fp) != NULL ) {
     /* Skip white spaces */
     read_string = at ? line : buf;
     while (read_string[0] == ' ') read_string++;
@@ -113,11 +114,11 @@ char* upf_tag_read_attr(FILE *fp, const char * tag, const char * attr,
       read_string += strlen(init_tag);
     }
     if ( tag_found && !at && (at = strstr(read_string, attr)) ) {
-      at = strtok(at, "=");
+      at = strtok_r(at, "=", &save);
     }
     /* Ensure that lines are eaten up to the closing bracket. */
     if ( tag_found && strchr(read_string, '>') ) {
-      return at ? strtok(NULL, " \"") : at;
+      return at ? strtok_r(NULL, " \"", &save) : at;
     }
   }
 
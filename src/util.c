@@ -17,6 +17,7 @@
 #include <string.h>
 #include <assert.h>
 
+#include "instrument.h"
 #include "util.h"
 #include "pspio_error.h"
 
@@ -136,12 +137,12 @@ int read_array_4by4(FILE *fp, double *array, int npts) {
     nsup = npts - (npts % 4);
   }
   for (i=0; i<nsup; i+=4) {
-    FULFILL_OR_RETURN( fgets(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+    FULFILL_OR_RETURN( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
     nargs = sscanf(line, "%lf %lf %lf %lf", &tmp[0], &tmp[1], &tmp[2], &tmp[3]);
     FULFILL_OR_RETURN( nargs == 4, PSPIO_EFILE_CORRUPT );
     for (j=0; j<nargs; j++) array[i+j] = tmp[j];
   }
-  FULFILL_OR_RETURN( fgets(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
+  FULFILL_OR_RETURN( INSTR_FGETS(line, PSPIO_STRLEN_LINE, fp) != NULL, PSPIO_EIO );
   nargs = sscanf(line, "%lf %lf %lf %lf", &tmp[0], &tmp[1], &tmp[2], &tmp[3]);
   FULFILL_OR_RETURN( nargs == (npts - nsup), PSPIO_EFILE_CORRUPT );
   for (j=0; j<nargs; j++) array[nsup+j] = tmp[j];
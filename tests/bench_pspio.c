@@ -0,0 +1,492 @@
+/* Copyright (C) 2018 Micael Oliveira <micael.oliveira@mpsd.mpg.de>
+ *                    Yann Pouillon <devops@materialsevolution.es>
+ *
+ * This file is part of Libpspio.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * version 2.0. If a copy of the MPL was not distributed with this file, You
+ * can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Libpspio is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the Mozilla Public License version 2.0 for
+ * more details.
+ */
+
+/**
+ * @file bench_pspio.c
+ * @brief micro- and macro-benchmarks of Libpspio
+ *
+ * Timings are the best of several repetitions and are reported in
+ * seconds per operation, so that lower is always better. Results are
+ * written as JSON or CSV and can be compared against a CSV baseline
+ * produced by a previous run on the same machine.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "pspio.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+
+#define BENCH_NAME_SIZE 128
+#define BENCH_MAX_RECORDS 1024
+#define BENCH_LINE_SIZE 512
+
+typedef struct {
+  char name[BENCH_NAME_SIZE]; /* benchmark identifier */
+  int np;                     /* number of mesh points, 0 if not relevant */
+  double seconds;             /* best time per operation */
+  double rate;                /* throughput derived from seconds */
+  const char *rate_unit;      /* unit of the throughput */
+} bench_record_t;
+
+static bench_record_t records[BENCH_MAX_RECORDS];
+static int n_records = 0;
+
+/* Formats read by the library, with their reference directories */
+static const struct {
+  int fmt;
+  const char *dir;
+} bench_formats[] = {
+  {PSPIO_FMT_ABINIT_2, "abinit_gth"},
+  {PSPIO_FMT_ABINIT_3, "abinit_hgh"},
+  {PSPIO_FMT_ABINIT_6, "abinit6"},
+  {PSPIO_FMT_ABINIT_10, "abinit10"},
+  {PSPIO_FMT_FHI98PP, "fhi"},
+  {PSPIO_FMT_OCTOPUS_HGH, "octopus_hgh"},
+  {PSPIO_FMT_UPF, "UPF"},
+  {PSPIO_FMT_XML, "psml"}
+};
+static const int bench_n_formats = sizeof(bench_formats) / sizeof(bench_formats[0]);
+
+/* Mesh sizes of the synthetic benchmarks */
+static const int bench_sizes[] = {500, 1000, 2000, 5000, 10000, 20000, 50000};
+static const int bench_n_sizes = sizeof(bench_sizes) / sizeof(bench_sizes[0]);
+
+
+/**********************************************************************
+ * Helpers                                                            *
+ **********************************************************************/
+
+static double bench_clock(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (double)ts.tv_sec + 1.0e-9 * (double)ts.tv_nsec;
+}
+
+/* Deterministic generator, so that all runs use the same points */
+static unsigned long bench_seed = 12345UL;
+
+static double bench_random(void)
+{
+  bench_seed = bench_seed * 6364136223846793005UL + 1442695040888963407UL;
+
+  return (double)((bench_seed >> 11) & 0xFFFFFFFFUL) / 4294967296.0;
+}
+
+static int bench_cmp_double(const void *a, const void *b)
+{
+  double da = *(const double *)a, db = *(const double *)b;
+
+  return (da > db) - (da < db);
+}
+
+static void bench_add(const char *name, int np, double seconds,
+                      double work, const char *rate_unit)
+{
+  if ( n_records >= BENCH_MAX_RECORDS ) {
+    fprintf(stderr, "bench_pspio: too many records, ignoring %s\n", name);
+    return;
+  }
+
+  strncpy(records[n_records].name, name, BENCH_NAME_SIZE-1);
+  records[n_records].name[BENCH_NAME_SIZE-1] = '\0';
+  records[n_records].np = np;
+  records[n_records].seconds = seconds;
+  records[n_records].rate = (seconds > 0.0) ? work / seconds : 0.0;
+  records[n_records].rate_unit = rate_unit;
+  n_records++;
+
+  fprintf(stderr, "  %-48s np=%-6d %12.4e s  %12.4f %s\n",
+    name, np, seconds, records[n_records-1].rate, rate_unit);
+}
+
+static long bench_file_size(const char *path)
+{
+  struct stat st;
+
+  if ( stat(path, &st) != 0 ) return -1;
+
+  return (long)st.st_size;
+}
+
+
+/**********************************************************************
+ * Macro-benchmarks: reading and writing reference files              *
+ **********************************************************************/
+
+static void bench_io(const char *refdir, int nrep)
+{
+  int i, irep, ierr, writable;
+  char path[BENCH_LINE_SIZE], name[BENCH_LINE_SIZE], tmpfile[64];
+  double t0, tread, twrite;
+  long fsize, wsize;
+  DIR *dir;
+  struct dirent *ent;
+  pspio_pspdata_t *data = NULL;
+
+  sprintf(tmpfile, "pspio-bench-%6.6d", (int)getpid());
+
+  for (i=0; i<bench_n_formats; i++) {
+    snprintf(path, sizeof(path), "%s/%s", refdir, bench_formats[i].dir);
+    dir = opendir(path);
+    if ( dir == NULL ) {
+      fprintf(stderr, "bench_pspio: cannot open %s, skipping\n", path);
+      continue;
+    }
+
+    while ( (ent = readdir(dir)) != NULL ) {
+      if ( ent->d_name[0] == '.' || strcmp(ent->d_name, "README") == 0 ) continue;
+      if ( snprintf(path, sizeof(path), "%s/%s/%s", refdir,
+             bench_formats[i].dir, ent->d_name) >= (int)sizeof(path) ) {
+        fprintf(stderr, "bench_pspio: path too long for %s, skipping\n", ent->d_name);
+        continue;
+      }
+      fsize = bench_file_size(path);
+
+      /* Not all the formats can be written: reading is timed anyway */
+      tread = -1.0;
+      twrite = -1.0;
+      wsize = 0;
+      writable = 1;
+      for (irep=0; irep<nrep; irep++) {
+        pspio_pspdata_free(data);
+        data = NULL;
+        pspio_pspdata_alloc(&data);
+
+        t0 = bench_clock();
+        ierr = pspio_pspdata_read(data, bench_formats[i].fmt, path);
+        t0 = bench_clock() - t0;
+        if ( ierr != PSPIO_SUCCESS ) {
+          pspio_error_free();
+          break;
+        }
+        if ( tread < 0.0 || t0 < tread ) tread = t0;
+        if ( !writable ) continue;
+
+        t0 = bench_clock();
+        ierr = pspio_pspdata_write(data, bench_formats[i].fmt, tmpfile);
+        t0 = bench_clock() - t0;
+        if ( ierr != PSPIO_SUCCESS ) {
+          pspio_error_free();
+          writable = 0;
+          twrite = -1.0;
+          continue;
+        }
+        if ( twrite < 0.0 || t0 < twrite ) twrite = t0;
+        wsize = bench_file_size(tmpfile);
+      }
+      remove(tmpfile);
+
+      if ( tread >= 0.0 ) {
+        snprintf(name, sizeof(name), "read/%s/%s", bench_formats[i].dir, ent->d_name);
+        bench_add(name, 0, tread, (double)fsize / 1.0e6, "MB/s");
+      }
+      if ( twrite >= 0.0 ) {
+        snprintf(name, sizeof(name), "write/%s/%s", bench_formats[i].dir, ent->d_name);
+        bench_add(name, 0, twrite, (double)wsize / 1.0e6, "MB/s");
+      }
+    }
+
+    closedir(dir);
+  }
+
+  pspio_pspdata_free(data);
+}
+
+
+/**********************************************************************
+ * Micro-benchmarks: mesh functions on synthetic meshes               *
+ **********************************************************************/
+
+static void bench_fill_points(double *r, int n, int kind, double rmin, double rmax)
+{
+  int i;
+  double c;
+
+  switch (kind) {
+  case 2:
+    /* Clustered: narrow bunches around a few centers, as in
+       real-space grids around an atom */
+    for (i=0; i<n; i++) {
+      c = rmin + (rmax - rmin) * (double)(i % 4 + 1) / 5.0;
+      r[i] = c + 0.01 * (rmax - rmin) * (bench_random() - 0.5);
+    }
+    break;
+  default:
+    for (i=0; i<n; i++) {
+      r[i] = rmin + (rmax - rmin) * bench_random();
+    }
+    if ( kind == 1 ) qsort(r, n, sizeof(double), bench_cmp_double);
+  }
+}
+
+static void bench_meshfunc(int nrep, int neval)
+{
+  static const char *kinds[] = {"random", "sorted", "clustered"};
+  int i, k, irep, np;
+  char name[BENCH_NAME_SIZE];
+  double a, b, t0, tbest, rmin, rmax, sum;
+  double *f, *r;
+  const double *mr;
+  pspio_mesh_t *mesh = NULL;
+  pspio_meshfunc_t *func = NULL, *copy = NULL;
+
+  r = (double *) malloc (neval * sizeof(double));
+
+  for (i=0; i<bench_n_sizes; i++) {
+    np = bench_sizes[i];
+
+    /* Logarithmic mesh spanning roughly [1e-4, 50] bohr */
+    b = 1.0e-4;
+    a = log(50.0 / b) / (double)np;
+    pspio_mesh_alloc(&mesh, np);
+    pspio_mesh_init_from_parameters(mesh, PSPIO_MESH_LOG1, a, b);
+    mr = pspio_mesh_get_r(mesh);
+    rmin = mr[0];
+    rmax = mr[np-1];
+
+    f = (double *) malloc (np * sizeof(double));
+    for (k=0; k<np; k++) {
+      f[k] = mr[k] * mr[k] * exp(-mr[k]);
+    }
+
+    /* Interpolator construction */
+    tbest = -1.0;
+    for (irep=0; irep<nrep; irep++) {
+      pspio_meshfunc_free(func);
+      func = NULL;
+      pspio_meshfunc_alloc(&func, np);
+      t0 = bench_clock();
+      pspio_meshfunc_init(func, mesh, f, NULL, NULL);
+      t0 = bench_clock() - t0;
+      if ( tbest < 0.0 || t0 < tbest ) tbest = t0;
+    }
+    bench_add("meshfunc/init", np, tbest, 1.0e-6 * np, "Mpoint/s");
+
+    /* Deep copy */
+    tbest = -1.0;
+    for (irep=0; irep<nrep; irep++) {
+      pspio_meshfunc_free(copy);
+      copy = NULL;
+      t0 = bench_clock();
+      pspio_meshfunc_copy(&copy, func);
+      t0 = bench_clock() - t0;
+      if ( tbest < 0.0 || t0 < tbest ) tbest = t0;
+    }
+    bench_add("meshfunc/copy", np, tbest, 1.0e-6 * np, "Mpoint/s");
+
+    /* Evaluation for several access patterns */
+    for (k=0; k<3; k++) {
+      bench_fill_points(r, neval, k, rmin, rmax);
+      tbest = -1.0;
+      sum = 0.0;
+      for (irep=0; irep<nrep; irep++) {
+        int j;
+        t0 = bench_clock();
+        for (j=0; j<neval; j++) {
+          sum += pspio_meshfunc_eval(func, r[j]);
+        }
+        t0 = bench_clock() - t0;
+        if ( tbest < 0.0 || t0 < tbest ) tbest = t0;
+      }
+      /* Keep the compiler from discarding the evaluations */
+      if ( sum == 0.123456789 ) fprintf(stderr, "%g\n", sum);
+      snprintf(name, sizeof(name), "meshfunc/eval/%s", kinds[k]);
+      bench_add(name, np, tbest / neval, 1.0e-6, "Meval/s");
+    }
+
+    free(f);
+    pspio_meshfunc_free(copy);
+    copy = NULL;
+    pspio_meshfunc_free(func);
+    func = NULL;
+    pspio_mesh_free(mesh);
+    mesh = NULL;
+  }
+
+  free(r);
+}
+
+
+/**********************************************************************
+ * Output and baseline comparison                                     *
+ **********************************************************************/
+
+static void bench_write(FILE *out, const char *format)
+{
+  int i;
+
+  if ( strcmp(format, "csv") == 0 ) {
+    fprintf(out, "name,np,seconds,rate,rate_unit\n");
+    for (i=0; i<n_records; i++) {
+      fprintf(out, "%s,%d,%.6e,%.6e,%s\n", records[i].name, records[i].np,
+        records[i].seconds, records[i].rate, records[i].rate_unit);
+    }
+  } else {
+    fprintf(out, "{\n  \"package\": \"%s\",\n  \"version\": \"%s\",\n",
+      PACKAGE, VERSION);
+    fprintf(out, "  \"results\": [\n");
+    for (i=0; i<n_records; i++) {
+      fprintf(out, "    {\"name\": \"%s\", \"np\": %d, \"seconds\": %.6e, "
+        "\"rate\": %.6e, \"rate_unit\": \"%s\"}%s\n", records[i].name,
+        records[i].np, records[i].seconds, records[i].rate,
+        records[i].rate_unit, (i < n_records-1) ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+  }
+}
+
+/* Returns the number of regressions beyond the given relative tolerance */
+static int bench_compare(const char *baseline, double tol)
+{
+  int i, np, nreg, nfound;
+  char line[BENCH_LINE_SIZE], *name, *tok;
+  double seconds, ratio;
+  FILE *fp;
+
+  fp = fopen(baseline, "r");
+  if ( fp == NULL ) {
+    fprintf(stderr, "bench_pspio: cannot open baseline %s\n", baseline);
+    return -1;
+  }
+
+  nreg = 0;
+  nfound = 0;
+  printf("%-48s %7s %12s %12s %8s\n", "benchmark", "np", "baseline", "current", "ratio");
+  while ( fgets(line, BENCH_LINE_SIZE, fp) != NULL ) {
+    name = strtok(line, ",");
+    if ( name == NULL || strcmp(name, "name") == 0 ) continue;
+    if ( (tok = strtok(NULL, ",")) == NULL ) continue;
+    np = atoi(tok);
+    if ( (tok = strtok(NULL, ",")) == NULL ) continue;
+    seconds = atof(tok);
+
+    for (i=0; i<n_records; i++) {
+      if ( strcmp(records[i].name, name) == 0 && records[i].np == np ) break;
+    }
+    if ( i == n_records || seconds <= 0.0 ) continue;
+
+    nfound++;
+    ratio = records[i].seconds / seconds;
+    printf("%-48s %7d %12.4e %12.4e %8.3f%s\n", name, np, seconds,
+      records[i].seconds, ratio, (ratio > 1.0 + tol) ? "  REGRESSION" : "");
+    if ( ratio > 1.0 + tol ) nreg++;
+  }
+  fclose(fp);
+
+  printf("%d benchmarks compared, %d regressions above %.0f%%\n",
+    nfound, nreg, 100.0 * tol);
+
+  return nreg;
+}
+
+
+/**********************************************************************
+ * Main program                                                       *
+ **********************************************************************/
+
+static void bench_usage(void)
+{
+  fprintf(stderr,
+    "Usage: bench_pspio [-d refdir] [-f json|csv] [-o output] [-b baseline.csv]\n"
+    "                   [-t tolerance] [-r repetitions] [-n evaluations]\n"
+    "                   [-s io|meshfunc]\n");
+}
+
+int main(int argc, char **argv) {
+
+  int opt, nrep, neval, nreg;
+  double tol;
+  const char *refdir, *format, *output, *baseline, *only;
+  FILE *out;
+
+  refdir = "../psp_references";
+  format = "json";
+  output = NULL;
+  baseline = NULL;
+  only = NULL;
+  tol = 0.10;
+  nrep = 5;
+  neval = 10000;
+
+  while ( (opt = getopt(argc, argv, "d:f:o:b:t:r:n:s:h")) != -1 ) {
+    switch (opt) {
+    case 'd': refdir = optarg; break;
+    case 'f': format = optarg; break;
+    case 'o': output = optarg; break;
+    case 'b': baseline = optarg; break;
+    case 't': tol = atof(optarg); break;
+    case 'r': nrep = atoi(optarg); break;
+    case 'n': neval = atoi(optarg); break;
+    case 's': only = optarg; break;
+    default:
+      bench_usage();
+      return 1;
+    }
+  }
+  if ( (strcmp(format, "json") != 0 && strcmp(format, "csv") != 0) ||
+       nrep < 1 || neval < 1 ) {
+    bench_usage();
+    return 1;
+  }
+
+  /* Run the benchmarks */
+  if ( only == NULL || strcmp(only, "io") == 0 ) {
+    fprintf(stderr, "Reading and writing reference files\n");
+    bench_io(refdir, nrep);
+  }
+  if ( only == NULL || strcmp(only, "meshfunc") == 0 ) {
+    fprintf(stderr, "Mesh functions\n");
+    bench_meshfunc(nrep, neval);
+  }
+
+  /* Report */
+  if ( output != NULL ) {
+    out = fopen(output, "w");
+    if ( out == NULL ) {
+      fprintf(stderr, "bench_pspio: cannot write %s\n", output);
+      return 2;
+    }
+    bench_write(out, format);
+    fclose(out);
+  } else {
+    bench_write(stdout, format);
+  }
+
+  /* Compare to the baseline */
+  if ( baseline != NULL ) {
+    nreg = bench_compare(baseline, tol);
+    if ( nreg < 0 ) return 2;
+    if ( nreg > 0 ) return 3;
+  }
+
+  return 0;
+}